@@ -12,6 +12,10 @@
 #define DRAGON_BEGIN namespace drg {
 #define DRAGON_END }
 
+// Instantiate the templates of a source file for both element types (float and double),
+// Templates is a macro taking the element type.
+#define DRAGON_INSTANTIATE(Templates) Templates(float) Templates(double)
+
 #ifdef __CUDA__ 
 	#define USE_CUDA
 #endif
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "BlockedConvolution.h"
+#include "Elementwise.h"
+
+#include <vector>
+#include <algorithm>
+
+DRAGON_BEGIN
+
+namespace {
+
+	// Values calculated at once, TILE x CHANNEL_BLOCK accumulators are held in vector registers.
+	constexpr size_t TILE = 4;
+
+	// acc[t] += values[t] * block for the TILE rows of the tile, like the gemm microkernel.
+	template<class T>
+	inline void multiplyAddTile(T (&acc)[TILE][CHANNEL_BLOCK<T>], const T (&values)[TILE], const T* block) {
+		static_assert(TILE == 4, "The tile is unrolled for 4 rows!");
+		T v0 = values[0], v1 = values[1], v2 = values[2], v3 = values[3];
+		for (size_t l = 0; l < CHANNEL_BLOCK<T>; l++) {
+			T w = block[l];
+			acc[0][l] += v0 * w;
+			acc[1][l] += v1 * w;
+			acc[2][l] += v2 * w;
+			acc[3][l] += v3 * w;
+		}
+	}
+
+	// Offsets of the kernel elements (x, y) in a blocked plane, the first element is the row of the patch.
+	template<class T>
+	std::vector<size_t>& patchOffsets(size_t kernelRows, size_t kernelCols, size_t rowStep) {
+		thread_local std::vector<size_t> offsets;
+		offsets.resize(kernelRows * kernelCols);
+		for (size_t x = 0; x < kernelRows; x++)
+			for (size_t y = 0; y < kernelCols; y++)
+				offsets[x * kernelCols + y] = x * rowStep + y * CHANNEL_BLOCK<T>;
+		return offsets;
+	}
+
+}
+
+template<class T>
+BasicTensor3D<T> blockedKernels(const BasicTensor3D<T>& kernels, size_t outputDepth, size_t inputDepth, bool transposed) {
+	BasicTensor3D<T> result;
+	blockedKernels(result, kernels, outputDepth, inputDepth, transposed);
+	return result;
+}
+
+template<class T>
+void blockedKernels(BasicTensor3D<T>& result, const BasicTensor3D<T>& kernels, size_t outputDepth, size_t inputDepth, bool transposed) {
+	assert((kernels.getDepth() == outputDepth * inputDepth && kernels.getLayout() == Layout::Planar) &&
+		"Parameters not match for blockedKernels!");
+
+	size_t rows = kernels.getRows();
+	size_t cols = kernels.getCols();
+	size_t resultDepth = transposed ? inputDepth : outputDepth;
+	size_t resultPairs = transposed ? outputDepth : inputDepth;
+
+	if (result.getDepth() == resultDepth && result.getRows() == resultPairs * rows && result.getCols() == cols &&
+		result.getLayout() == Layout::Blocked)
+		kernel::fill(result.getData(), T(), result.getCount());
+	else
+		result = BasicTensor3D<T>(resultDepth, resultPairs * rows, cols, T(), Layout::Blocked);
+	for (size_t i = 0; i < outputDepth; i++)
+		for (size_t k = 0; k < inputDepth; k++)
+			for (size_t x = 0; x < rows; x++)
+				for (size_t y = 0; y < cols; y++) {
+					T value = kernels.getData()[((i * inputDepth + k) * rows + x) * cols + y];
+					if (transposed)
+						result.at(i * rows + x, y, k) = value;
+					else
+						result.at(k * rows + x, y, i) = value;
+				}
+}
+
+template<class T>
+void blockedConvolution(NonDeduced<LayoutView<T>> output, NonDeduced<ConstLayoutView<T>> input, const BasicTensor3D<T>& packedKernels, size_t stride) {
+	size_t inputDepth = input.getDepth();
+	size_t kernelRows = packedKernels.getRows() / inputDepth;
+	size_t kernelCols = packedKernels.getCols();
+	assert((output.getLayout() == Layout::Blocked && input.getLayout() == Layout::Blocked &&
+		packedKernels.getLayout() == Layout::Blocked && packedKernels.getDepth() == output.getDepth() &&
+		(output.getRows() - 1) * stride + kernelRows <= input.getRows() &&
+		(output.getCols() - 1) * stride + kernelCols <= input.getCols()) &&
+		"Parameters not match for blockedConvolution!");
+
+	size_t outputCols = output.getCols();
+	size_t step = stride * CHANNEL_BLOCK<T>;
+	size_t kernelLayerCount = kernelRows * kernelCols;
+	const std::vector<size_t>& offsets = patchOffsets<T>(kernelRows, kernelCols, input.getCols() * CHANNEL_BLOCK<T>);
+
+	for (size_t b = 0; b < blockedDepth<T>(output.getDepth()) / CHANNEL_BLOCK<T>; b++) {
+		const T* blockKernels = packedKernels.getData() + b * inputDepth * kernelLayerCount * CHANNEL_BLOCK<T>;
+
+		for (size_t i = 0; i < output.getRows(); i++) {
+			T* outputRow = &output(b * CHANNEL_BLOCK<T>, i, 0);
+
+			// TILE neighbouring positions of the row, the last tile repeats the last position.
+			for (size_t j = 0; j < outputCols; j += TILE) {
+				size_t count = std::min(TILE, outputCols - j);
+				T acc[TILE][CHANNEL_BLOCK<T>] = {};
+				const T* kernel = blockKernels;
+
+				for (size_t k = 0; k < inputDepth; k++) {
+					const T* patch = &input(k, i * stride, 0);
+					const T* position[TILE];
+					for (size_t t = 0; t < TILE; t++)
+						position[t] = patch + (j + std::min(t, count - 1)) * step;
+
+					for (size_t e = 0; e < kernelLayerCount; e++) {
+						size_t offset = offsets[e];
+						T values[TILE] = {
+							position[0][offset], position[1][offset], position[2][offset], position[3][offset] };
+						multiplyAddTile(acc, values, kernel);
+						kernel += CHANNEL_BLOCK<T>;
+					}
+				}
+
+				for (size_t t = 0; t < count; t++)
+					std::copy(acc[t], acc[t] + CHANNEL_BLOCK<T>, outputRow + (j + t) * CHANNEL_BLOCK<T>);
+			}
+		}
+	}
+}
+
+template<class T>
+void blockedKernelGradient(NonDeduced<TensorView<3, T>> kernelGradient, NonDeduced<ConstLayoutView<T>> input, NonDeduced<ConstLayoutView<T>> localGradient, size_t stride) {
+	size_t inputDepth = input.getDepth();
+	size_t outputDepth = localGradient.getDepth();
+	size_t kernelRows = kernelGradient.getRows();
+	size_t kernelCols = kernelGradient.getCols();
+	assert((input.getLayout() == Layout::Blocked && localGradient.getLayout() == Layout::Blocked &&
+		kernelGradient.getDepth() == outputDepth * inputDepth && kernelGradient.isContiguous()) &&
+		"Parameters not match for blockedKernelGradient!");
+
+	size_t outputRows = localGradient.getRows();
+	size_t outputCols = localGradient.getCols();
+	size_t outputBlocks = blockedDepth<T>(outputDepth) / CHANNEL_BLOCK<T>;
+	size_t kernelLayerCount = kernelRows * kernelCols;
+	size_t step = stride * CHANNEL_BLOCK<T>;
+	const std::vector<size_t>& offsets = patchOffsets<T>(kernelRows, kernelCols, input.getCols() * CHANNEL_BLOCK<T>);
+
+	// The gradients of a block of output depths are summed side by side, in the order of the packed kernels.
+	thread_local std::vector<T> gradient;
+	gradient.resize(outputBlocks * inputDepth * kernelLayerCount * CHANNEL_BLOCK<T>);
+
+	for (size_t b = 0; b < outputBlocks; b++) {
+		for (size_t k = 0; k < inputDepth; k++) {
+			T* blockGradient = gradient.data() + (b * inputDepth + k) * kernelLayerCount * CHANNEL_BLOCK<T>;
+
+			// TILE kernel elements at once, the last tile repeats the last element.
+			for (size_t e = 0; e < kernelLayerCount; e += TILE) {
+				size_t count = std::min(TILE, kernelLayerCount - e);
+				size_t offset[TILE];
+				for (size_t t = 0; t < TILE; t++)
+					offset[t] = offsets[e + std::min(t, count - 1)];
+
+				T acc[TILE][CHANNEL_BLOCK<T>] = {};
+				for (size_t i = 0; i < outputRows; i++) {
+					const T* patch = &input(k, i * stride, 0);
+					const T* g = &localGradient(b * CHANNEL_BLOCK<T>, i, 0);
+
+					for (size_t j = 0; j < outputCols; j++) {
+						T values[TILE] = { patch[offset[0]], patch[offset[1]], patch[offset[2]], patch[offset[3]] };
+						multiplyAddTile(acc, values, g);
+						patch += step;
+						g += CHANNEL_BLOCK<T>;
+					}
+				}
+
+				for (size_t t = 0; t < count; t++)
+					std::copy(acc[t], acc[t] + CHANNEL_BLOCK<T>, blockGradient + (e + t) * CHANNEL_BLOCK<T>);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < outputDepth; i++)
+		for (size_t k = 0; k < inputDepth; k++)
+			for (size_t e = 0; e < kernelLayerCount; e++)
+				kernelGradient.getData()[(i * inputDepth + k) * kernelLayerCount + e] =
+					gradient[((i / CHANNEL_BLOCK<T> * inputDepth + k) * kernelLayerCount + e) * CHANNEL_BLOCK<T> + i % CHANNEL_BLOCK<T>];
+}
+
+template<class T>
+void blockedInputGradient(NonDeduced<LayoutView<T>> costBefore, NonDeduced<ConstLayoutView<T>> localGradient, const BasicTensor3D<T>& transposedKernels, size_t stride) {
+	size_t outputDepth = localGradient.getDepth();
+	size_t kernelRows = transposedKernels.getRows() / outputDepth;
+	size_t kernelCols = transposedKernels.getCols();
+	assert((costBefore.getLayout() == Layout::Blocked && localGradient.getLayout() == Layout::Blocked &&
+		transposedKernels.getLayout() == Layout::Blocked && transposedKernels.getDepth() == costBefore.getDepth()) &&
+		"Parameters not match for blockedInputGradient!");
+
+	size_t outputCols = localGradient.getCols();
+	size_t kernelLayerCount = kernelRows * kernelCols;
+	size_t step = stride * CHANNEL_BLOCK<T>;
+	const std::vector<size_t>& offsets = patchOffsets<T>(kernelRows, kernelCols, costBefore.getCols() * CHANNEL_BLOCK<T>);
+
+	kernel::fill(costBefore.getData(), T(),
+		layoutCount<T>(Layout::Blocked, costBefore.getDepth(), costBefore.getRows(), costBefore.getCols()));
+
+	// Every local gradient value pushes its kernels back to the input positions it was calculated from.
+	// For TILE neighbouring positions and one kernel element the sum over the output depths is held in registers,
+	// a block of input depths at once.
+	for (size_t b = 0; b < blockedDepth<T>(costBefore.getDepth()) / CHANNEL_BLOCK<T>; b++) {
+		const T* blockKernels = transposedKernels.getData() + b * outputDepth * kernelLayerCount * CHANNEL_BLOCK<T>;
+
+		for (size_t i = 0; i < localGradient.getRows(); i++) {
+			T* patch = &costBefore(b * CHANNEL_BLOCK<T>, i * stride, 0);
+
+			for (size_t j = 0; j < outputCols; j += TILE) {
+				size_t count = std::min(TILE, outputCols - j);
+				const T* gradient[TILE];
+				for (size_t t = 0; t < TILE; t++)
+					gradient[t] = &localGradient(0, i, j + std::min(t, count - 1));
+
+				for (size_t e = 0; e < kernelLayerCount; e++) {
+					T acc[TILE][CHANNEL_BLOCK<T>] = {};
+					const T* kernel = blockKernels + e * CHANNEL_BLOCK<T>;
+
+					for (size_t o = 0; o < outputDepth; o++) {
+						size_t offset = (o / CHANNEL_BLOCK<T>) * localGradient.getRows() * outputCols * CHANNEL_BLOCK<T> + o % CHANNEL_BLOCK<T>;
+						T values[TILE] = {
+							gradient[0][offset], gradient[1][offset], gradient[2][offset], gradient[3][offset] };
+						multiplyAddTile(acc, values, kernel);
+						kernel += kernelLayerCount * CHANNEL_BLOCK<T>;
+					}
+
+					for (size_t t = 0; t < count; t++) {
+						T* cost = patch + (j + t) * step + offsets[e];
+						for (size_t l = 0; l < CHANNEL_BLOCK<T>; l++)
+							cost[l] += acc[t][l];
+					}
+				}
+			}
+		}
+	}
+}
+
+#define BLOCKED_CONVOLUTION_TEMPLATES(T) \
+	template DRAGON_API BasicTensor3D<T> blockedKernels(const BasicTensor3D<T>&, size_t, size_t, bool); \
+	template DRAGON_API void blockedKernels(BasicTensor3D<T>&, const BasicTensor3D<T>&, size_t, size_t, bool); \
+	template DRAGON_API void blockedConvolution<T>(LayoutView<T>, ConstLayoutView<T>, const BasicTensor3D<T>&, size_t); \
+	template DRAGON_API void blockedKernelGradient<T>(TensorView<3, T>, ConstLayoutView<T>, ConstLayoutView<T>, size_t); \
+	template DRAGON_API void blockedInputGradient<T>(LayoutView<T>, ConstLayoutView<T>, const BasicTensor3D<T>&, size_t);
+DRAGON_INSTANTIATE(BLOCKED_CONVOLUTION_TEMPLATES)
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include "../Core.h"
+
+#include "Tensor.h"
+#include "Tensor3D.h"
+#include "TensorView.h"
+
+/*
+Direct convolution of data in the blocked channel layout.
+The CHANNEL_BLOCK output depths of a position are next to each other, so every multiply add
+of the inner loops works on a whole block: one input value times a block of kernel values.
+*/
+
+DRAGON_BEGIN
+
+// Pack [output depth][input depth][rows][cols] kernels (Tensor3D with depth = outputDepth * inputDepth)
+// into a blocked Tensor3D of depth outputDepth, rows inputDepth * kernel rows and cols kernel cols,
+// that is [output depth / CHANNEL_BLOCK][input depth][rows][cols][CHANNEL_BLOCK], the padding depths are zero.
+// If transposed is true the input and output depths are swapped, that is the kernel set of the gradient respect to the input.
+template<class T> DRAGON_API BasicTensor3D<T> blockedKernels(const BasicTensor3D<T>& kernels, size_t outputDepth, size_t inputDepth, bool transposed);
+// Same as above into result, that is only reallocated if its shape doesn't match.
+template<class T> DRAGON_API void blockedKernels(BasicTensor3D<T>& result, const BasicTensor3D<T>& kernels, size_t outputDepth, size_t inputDepth, bool transposed);
+
+// Calculate the strided convolution of the blocked input with the packed kernels into the blocked output,
+// the results of the input depths are summed per output depth.
+template<class T> DRAGON_API void blockedConvolution(NonDeduced<LayoutView<T>> output, NonDeduced<ConstLayoutView<T>> input, const BasicTensor3D<T>& packedKernels, size_t stride);
+
+// Gradient of the convolution respect to the kernels, written in the [output depth][input depth][rows][cols] kernel order.
+template<class T = precision> DRAGON_API void blockedKernelGradient(NonDeduced<TensorView<3, T>> kernelGradient, NonDeduced<ConstLayoutView<T>> input, NonDeduced<ConstLayoutView<T>> localGradient, size_t stride);
+
+// Gradient of the convolution respect to the input, the kernels are the transposed packed kernels.
+template<class T> DRAGON_API void blockedInputGradient(NonDeduced<LayoutView<T>> costBefore, NonDeduced<ConstLayoutView<T>> localGradient, const BasicTensor3D<T>& transposedKernels, size_t stride);
+
+DRAGON_END
\ No newline at end of file
@@ -2,80 +2,117 @@
 
 DRAGON_BEGIN
 
-Tensor2D unit(size_t N) {
-	Tensor2D result(N, N, 0.0);
+template<class T>
+BasicTensor2D<T> unit(size_t N) {
+	BasicTensor2D<T> result(N, N, 0.0);
 	for (size_t i = 0; i < N; i++)
-		result.at(i, i) = (precision)(1.0);
+		result.at(i, i) = (T)(1.0);
 	return result;
 }
 
-Tensor2D random(size_t rows, size_t cols, precision min, precision max) {
+template<class T>
+BasicTensor2D<T> random(size_t rows, size_t cols, NonDeduced<T> min, NonDeduced<T> max) {
 	std::random_device rg;
 
-	Tensor2D result(rows, cols, min);
+	BasicTensor2D<T> result(rows, cols, min);
 	for (size_t i = 0; i < rows; i++)
 		for (size_t j = 0; j < cols; j++)
-			result.at(i, j) = min + ((precision)rg() / (precision)rg.max()) * (max - min);
+			result.at(i, j) = min + ((T)rg() / (T)rg.max()) * (max - min);
 	return result;
 }
 
-Tensor1D random(size_t count, precision min, precision max) {
+template<class T>
+BasicTensor1D<T> random(size_t count, NonDeduced<T> min, NonDeduced<T> max) {
 	std::random_device rg;
 
-	precision* assignData = new precision[count];
+	T* assignData = BasicTensor<T>::allocateData(count);
 	for (size_t i = 0; i < count; i++)
-		assignData[i] = min + ((precision)rg() / (precision)rg.max()) * (max - min);
+		assignData[i] = min + ((T)rg() / (T)rg.max()) * (max - min);
 
-	return Tensor1D(assignData, count);
+	return BasicTensor1D<T>(assignData, count);
 }
 
-Tensor2D randomInt(size_t rows, size_t cols, precision min, precision max) {
+template<class T>
+BasicTensor2D<T> randomInt(size_t rows, size_t cols, NonDeduced<T> min, NonDeduced<T> max) {
 	std::random_device rg;
 
-	Tensor2D result(rows, cols, min);
+	BasicTensor2D<T> result(rows, cols, min);
 	for (size_t i = 0; i < rows; i++)
 		for (size_t j = 0; j < cols; j++)
-			result.at(i, j) = floor(min + ((precision)rg() / (precision)rg.max()) * (max - min));
+			result.at(i, j) = floor(min + ((T)rg() / (T)rg.max()) * (max - min));
 	return result;
 }
 
-Tensor1D randomInt(size_t count, precision min, precision max) {
+template<class T>
+BasicTensor1D<T> randomInt(size_t count, NonDeduced<T> min, NonDeduced<T> max) {
 	std::random_device rg;
 
-	precision* assignData = new precision[count];
+	T* assignData = BasicTensor<T>::allocateData(count);
 	for (size_t i = 0; i < count; i++)
-		assignData[i] = floor(min + ((precision)rg() / (precision)rg.max()) * (max - min));
+		assignData[i] = floor(min + ((T)rg() / (T)rg.max()) * (max - min));
 
-	return Tensor1D(assignData, count);
+	return BasicTensor1D<T>(assignData, count);
 }
 
-Tensor2D randomD(size_t rows, size_t cols, precision mean, precision dev) {
+template<class T>
+BasicTensor2D<T> randomD(size_t rows, size_t cols, NonDeduced<T> mean, NonDeduced<T> dev) {
 	std::default_random_engine generator;
-	std::normal_distribution<precision> distribution(mean, dev);
-	Tensor2D result(rows, cols, precision());
+	std::normal_distribution<T> distribution(mean, dev);
+	BasicTensor2D<T> result(rows, cols, T());
 	for (size_t i = 0; i < result.getCount(); i++)
 		result.getData()[i] = distribution(generator);
 	return result;
 }
 
-Tensor1D randomD(size_t count, precision mean, precision dev) {
+template<class T>
+BasicTensor1D<T> randomD(size_t count, NonDeduced<T> mean, NonDeduced<T> dev) {
 	std::default_random_engine generator;
-	std::normal_distribution<precision> distribution(mean, dev);
+	std::normal_distribution<T> distribution(mean, dev);
 
-	precision* assignData = new precision[count];
+	T* assignData = BasicTensor<T>::allocateData(count);
 	for (size_t i = 0; i < count; i++)
 		assignData[i] = distribution(generator);
 
-	return Tensor1D(assignData, count);
+	return BasicTensor1D<T>(assignData, count);
 }
 
-Tensor1D initTensor(size_t count, std::function<precision()> initFunction) {
-	precision* assignData = new precision[count];
+template<class T>
+BasicTensor1D<T> emptyLike(const BasicTensor1D<T>& shape) {
+	return BasicTensor1D<T>(BasicTensor<T>::allocateData(shape.getCount()), shape.getCols());
+}
+
+template<class T>
+BasicTensor2D<T> emptyLike(const BasicTensor2D<T>& shape) {
+	return BasicTensor2D<T>(BasicTensor<T>::allocateData(shape.getCount()), shape.getRows(), shape.getCols());
+}
+
+template<class T>
+BasicTensor3D<T> emptyLike(const BasicTensor3D<T>& shape) {
+	return BasicTensor3D<T>(BasicTensor<T>::allocateData(shape.getCount()), shape.getDepth(), shape.getRows(), shape.getCols(), shape.getLayout());
+}
+
+template<class T>
+BasicTensor1D<T> initTensor(size_t count, NonDeduced<std::function<T()>> initFunction) {
+	T* assignData = BasicTensor<T>::allocateData(count);
 
 	for (size_t i = 0; i < count; i++)
 		assignData[i] = initFunction();
 
-	return Tensor1D(assignData, count);
+	return BasicTensor1D<T>(assignData, count);
 }
 
+#define BUILDERS_TEMPLATES(T) \
+	template DRAGON_API BasicTensor2D<T> unit<T>(size_t); \
+	template DRAGON_API BasicTensor2D<T> random<T>(size_t, size_t, T, T); \
+	template DRAGON_API BasicTensor1D<T> random<T>(size_t, T, T); \
+	template DRAGON_API BasicTensor2D<T> randomInt<T>(size_t, size_t, T, T); \
+	template DRAGON_API BasicTensor1D<T> randomInt<T>(size_t, T, T); \
+	template DRAGON_API BasicTensor2D<T> randomD<T>(size_t, size_t, T, T); \
+	template DRAGON_API BasicTensor1D<T> randomD<T>(size_t, T, T); \
+	template DRAGON_API BasicTensor1D<T> initTensor<T>(size_t, std::function<T()>); \
+	template DRAGON_API BasicTensor1D<T> emptyLike(const BasicTensor1D<T>&); \
+	template DRAGON_API BasicTensor2D<T> emptyLike(const BasicTensor2D<T>&); \
+	template DRAGON_API BasicTensor3D<T> emptyLike(const BasicTensor3D<T>&);
+DRAGON_INSTANTIATE(BUILDERS_TEMPLATES)
+
 DRAGON_END
\ No newline at end of file
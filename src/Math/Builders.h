@@ -8,54 +8,89 @@
 #include "Tensor.h"
 #include "Tensor1D.h"
 #include "Tensor2D.h"
+#include "Tensor3D.h"
+#include "Expression.h"
 
 DRAGON_BEGIN
 
+// The builders without a tensor parameter create tensors of the default element type, an other one is given explicitly.
+// [example] BasicTensor2D<float> weights = random<float>(3, 3, -1.0, 1.0);
+
 // Create a unit tensor(matrix)
-DRAGON_API Tensor2D unit(size_t N);
+template<class T = precision> DRAGON_API BasicTensor2D<T> unit(size_t N);
 // Create a tensor with random values
-DRAGON_API Tensor2D random(size_t rows, size_t cols, precision min, precision max);
-DRAGON_API Tensor1D random(size_t count, precision min, precision max);
+template<class T = precision> DRAGON_API BasicTensor2D<T> random(size_t rows, size_t cols, NonDeduced<T> min, NonDeduced<T> max);
+template<class T = precision> DRAGON_API BasicTensor1D<T> random(size_t count, NonDeduced<T> min, NonDeduced<T> max);
 // Create a tensor with random values converted to int
-DRAGON_API Tensor2D randomInt(size_t rows, size_t cols, precision min, precision max);
-DRAGON_API Tensor1D randomInt(size_t count, precision min, precision max);
+template<class T = precision> DRAGON_API BasicTensor2D<T> randomInt(size_t rows, size_t cols, NonDeduced<T> min, NonDeduced<T> max);
+template<class T = precision> DRAGON_API BasicTensor1D<T> randomInt(size_t count, NonDeduced<T> min, NonDeduced<T> max);
 // Create a tensor with gaussian distribution
 // mean: mean of the distribution, dev: deviation of the distribution
-DRAGON_API Tensor2D randomD(size_t rows, size_t cols, precision mean, precision dev);
-DRAGON_API Tensor1D randomD(size_t count, precision mean, precision dev);
+template<class T = precision> DRAGON_API BasicTensor2D<T> randomD(size_t rows, size_t cols, NonDeduced<T> mean, NonDeduced<T> dev);
+template<class T = precision> DRAGON_API BasicTensor1D<T> randomD(size_t count, NonDeduced<T> mean, NonDeduced<T> dev);
 
 // Create a Tensor with every element assign to the output of the InitFunction
-DRAGON_API Tensor1D initTensor(size_t count, std::function<precision()> initFunction);
+template<class T = precision> DRAGON_API BasicTensor1D<T> initTensor(size_t count, NonDeduced<std::function<T()>> initFunction);
+
+// Create a tensor with the same shape (and layout) as the given one, the elements hold junk.
+template<class T> DRAGON_API BasicTensor1D<T> emptyLike(const BasicTensor1D<T>& shape);
+template<class T> DRAGON_API BasicTensor2D<T> emptyLike(const BasicTensor2D<T>& shape);
+template<class T> DRAGON_API BasicTensor3D<T> emptyLike(const BasicTensor3D<T>& shape);
+
+// The builder functions below are lazy, they return an expression (see Expression.h).
+// A and B can be tensors or expressions, B can be a scalar too.
+// The expression converts to the tensor type of A and it's evaluated in one loop,
+// so chains like sub(output, target).mult(2.0) don't create temporary tensors.
+// [example] Tensor1D cost = sub(output, target).mult(2.0);
 
 // Create a tensor type by adding them together elementwise.
-template<class TensorType>
-TensorType add(const TensorType& A, const TensorType& B) {
-	TensorType result(A);
-	result.add(B);
-	return result;
+template<class A, class B, class = std::enable_if_t<expression::isShaped<A>>>
+expression::ExpressionOf<expression::Add, A, B> add(const A& a, const B& b) {
+	using Element = expression::ElementOf<A>;
+	return { expression::Operand<Element, A>::make(a), expression::Operand<Element, B>::make(b) };
 }
 
 // Create a tensor type by subtracting B from A elementwise.
-template<class TensorType>
-TensorType sub(const TensorType& A, const TensorType& B) {
-	TensorType result(A);
-	result.sub(B);
-	return result;
+template<class A, class B, class = std::enable_if_t<expression::isShaped<A>>>
+expression::ExpressionOf<expression::Sub, A, B> sub(const A& a, const B& b) {
+	using Element = expression::ElementOf<A>;
+	return { expression::Operand<Element, A>::make(a), expression::Operand<Element, B>::make(b) };
 }
 
 // Create a tensor type by multiplying them together elementwise.
-template<class TensorType>
-TensorType mult(const TensorType& A, const TensorType& B) {
-	TensorType result(A);
-	result.mult(B);
-	return result;
+template<class A, class B, class = std::enable_if_t<expression::isShaped<A>>>
+expression::ExpressionOf<expression::Mult, A, B> mult(const A& a, const B& b) {
+	using Element = expression::ElementOf<A>;
+	return { expression::Operand<Element, A>::make(a), expression::Operand<Element, B>::make(b) };
 }
 
 // Create a tensor type by dividing A by B elementwise.
-template<class TensorType>
-TensorType div(const TensorType& A, const TensorType& B) {
-	TensorType result(A);
-	result.div(B);
+template<class A, class B, class = std::enable_if_t<expression::isShaped<A>>>
+expression::ExpressionOf<expression::Div, A, B> div(const A& a, const B& b) {
+	using Element = expression::ElementOf<A>;
+	return { expression::Operand<Element, A>::make(a), expression::Operand<Element, B>::make(b) };
+}
+
+// Evaluate the expression into an existing tensor with the same element count, without allocation.
+// The destination can be an operand of the expression too.
+// [example] assign(gradient, sub(output, target).mult(2.0));
+template<class TensorType, class Operation, class Left, class Right>
+TensorType& assign(TensorType& destination, const expression::Expression<Operation, Left, Right>& expr) {
+	assert((destination.getCount() == expr.getCount()) && "Parameter count not match!");
+	assert((destination.getLayout() == expr.getShape().getLayout()) && "Parameter layout not match!");
+	size_t count = expr.getCount();
+	static_assert(std::is_same<typename TensorType::precision, expression::ElementOf<Left>>::value, "Parameter element type not match!");
+	typename TensorType::precision* data = destination.getData();
+	for (size_t i = 0; i < count; i++)
+		data[i] = expr[i];
+	return destination;
+}
+
+template<class Operation, class Left, class Right>
+typename expression::Expression<Operation, Left, Right>::TensorType
+expression::Expression<Operation, Left, Right>::eval() const {
+	TensorType result = emptyLike(getShape());
+	assign(result, *this);
 	return result;
 }
 
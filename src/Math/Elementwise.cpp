@@ -0,0 +1,257 @@
+#include "Elementwise.h"
+#include "InstructionSets.h"
+
+DRAGON_BEGIN
+
+namespace kernel {
+
+	namespace {
+
+		enum class Operation { Add, Sub, Mult, Div };
+
+		template<Operation Op, class T>
+		inline T applyScalar(T a, T b) {
+			if constexpr (Op == Operation::Add) return a + b;
+			else if constexpr (Op == Operation::Sub) return a - b;
+			else if constexpr (Op == Operation::Mult) return a * b;
+			else return a / b;
+		}
+
+		// Function table filled with the kernels of one instruction set for T elements.
+		template<class T>
+		struct KernelTable {
+			void (*add)(T*, const T*, size_t);
+			void (*sub)(T*, const T*, size_t);
+			void (*mult)(T*, const T*, size_t);
+			void (*div)(T*, const T*, size_t);
+			void (*addValue)(T*, T, size_t);
+			void (*subValue)(T*, T, size_t);
+			void (*multValue)(T*, T, size_t);
+			void (*divValue)(T*, T, size_t);
+			void (*fill)(T*, T, size_t);
+			void (*copy)(T*, const T*, size_t);
+			const char* name;
+		};
+
+#ifndef DRAGON_X86
+		// Portable fallback, one element per "register", left to the compiler to vectorize.
+		namespace scalar {
+			template<class T>
+			struct V {
+				using Reg = T;
+				static constexpr size_t width = 1;
+				static constexpr const char* name = "scalar";
+				static inline Reg load(const T* p) { return *p; }
+				static inline void store(T* p, Reg a) { *p = a; }
+				static inline Reg set(T value) { return value; }
+				static inline Reg add(Reg a, Reg b) { return a + b; }
+				static inline Reg sub(Reg a, Reg b) { return a - b; }
+				static inline Reg mult(Reg a, Reg b) { return a * b; }
+				static inline Reg div(Reg a, Reg b) { return a / b; }
+			};
+			#define DRAGON_KERNEL_TARGET
+			#include "ElementwiseKernels.inl"
+			#undef DRAGON_KERNEL_TARGET
+		}
+#else
+		namespace sse2 {
+			template<class T> struct Traits;
+			template<> struct Traits<double> {
+				using Reg = __m128d;
+				static constexpr size_t width = 2;
+				DRAGON_TARGET("sse2") static inline Reg load(const double* p) { return _mm_loadu_pd(p); }
+				DRAGON_TARGET("sse2") static inline void store(double* p, Reg a) { _mm_storeu_pd(p, a); }
+				DRAGON_TARGET("sse2") static inline Reg set(double value) { return _mm_set1_pd(value); }
+				DRAGON_TARGET("sse2") static inline Reg add(Reg a, Reg b) { return _mm_add_pd(a, b); }
+				DRAGON_TARGET("sse2") static inline Reg sub(Reg a, Reg b) { return _mm_sub_pd(a, b); }
+				DRAGON_TARGET("sse2") static inline Reg mult(Reg a, Reg b) { return _mm_mul_pd(a, b); }
+				DRAGON_TARGET("sse2") static inline Reg div(Reg a, Reg b) { return _mm_div_pd(a, b); }
+			};
+			template<> struct Traits<float> {
+				using Reg = __m128;
+				static constexpr size_t width = 4;
+				DRAGON_TARGET("sse2") static inline Reg load(const float* p) { return _mm_loadu_ps(p); }
+				DRAGON_TARGET("sse2") static inline void store(float* p, Reg a) { _mm_storeu_ps(p, a); }
+				DRAGON_TARGET("sse2") static inline Reg set(float value) { return _mm_set1_ps(value); }
+				DRAGON_TARGET("sse2") static inline Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+				DRAGON_TARGET("sse2") static inline Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+				DRAGON_TARGET("sse2") static inline Reg mult(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+				DRAGON_TARGET("sse2") static inline Reg div(Reg a, Reg b) { return _mm_div_ps(a, b); }
+			};
+			template<class T> struct V : Traits<T> { static constexpr const char* name = "SSE2"; };
+			#define DRAGON_KERNEL_TARGET DRAGON_TARGET("sse2")
+			#include "ElementwiseKernels.inl"
+			#undef DRAGON_KERNEL_TARGET
+		}
+
+		namespace avx2 {
+			template<class T> struct Traits;
+			template<> struct Traits<double> {
+				using Reg = __m256d;
+				static constexpr size_t width = 4;
+				DRAGON_TARGET("avx2") static inline Reg load(const double* p) { return _mm256_loadu_pd(p); }
+				DRAGON_TARGET("avx2") static inline void store(double* p, Reg a) { _mm256_storeu_pd(p, a); }
+				DRAGON_TARGET("avx2") static inline Reg set(double value) { return _mm256_set1_pd(value); }
+				DRAGON_TARGET("avx2") static inline Reg add(Reg a, Reg b) { return _mm256_add_pd(a, b); }
+				DRAGON_TARGET("avx2") static inline Reg sub(Reg a, Reg b) { return _mm256_sub_pd(a, b); }
+				DRAGON_TARGET("avx2") static inline Reg mult(Reg a, Reg b) { return _mm256_mul_pd(a, b); }
+				DRAGON_TARGET("avx2") static inline Reg div(Reg a, Reg b) { return _mm256_div_pd(a, b); }
+			};
+			template<> struct Traits<float> {
+				using Reg = __m256;
+				static constexpr size_t width = 8;
+				DRAGON_TARGET("avx2") static inline Reg load(const float* p) { return _mm256_loadu_ps(p); }
+				DRAGON_TARGET("avx2") static inline void store(float* p, Reg a) { _mm256_storeu_ps(p, a); }
+				DRAGON_TARGET("avx2") static inline Reg set(float value) { return _mm256_set1_ps(value); }
+				DRAGON_TARGET("avx2") static inline Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+				DRAGON_TARGET("avx2") static inline Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+				DRAGON_TARGET("avx2") static inline Reg mult(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+				DRAGON_TARGET("avx2") static inline Reg div(Reg a, Reg b) { return _mm256_div_ps(a, b); }
+			};
+			template<class T> struct V : Traits<T> { static constexpr const char* name = "AVX2"; };
+			#define DRAGON_KERNEL_TARGET DRAGON_TARGET("avx2")
+			#include "ElementwiseKernels.inl"
+			#undef DRAGON_KERNEL_TARGET
+		}
+
+		namespace avx512 {
+			template<class T> struct Traits;
+			template<> struct Traits<double> {
+				using Reg = __m512d;
+				static constexpr size_t width = 8;
+				DRAGON_TARGET("avx512f") static inline Reg load(const double* p) { return _mm512_loadu_pd(p); }
+				DRAGON_TARGET("avx512f") static inline void store(double* p, Reg a) { _mm512_storeu_pd(p, a); }
+				DRAGON_TARGET("avx512f") static inline Reg set(double value) { return _mm512_set1_pd(value); }
+				DRAGON_TARGET("avx512f") static inline Reg add(Reg a, Reg b) { return _mm512_add_pd(a, b); }
+				DRAGON_TARGET("avx512f") static inline Reg sub(Reg a, Reg b) { return _mm512_sub_pd(a, b); }
+				DRAGON_TARGET("avx512f") static inline Reg mult(Reg a, Reg b) { return _mm512_mul_pd(a, b); }
+				DRAGON_TARGET("avx512f") static inline Reg div(Reg a, Reg b) { return _mm512_div_pd(a, b); }
+			};
+			template<> struct Traits<float> {
+				using Reg = __m512;
+				static constexpr size_t width = 16;
+				DRAGON_TARGET("avx512f") static inline Reg load(const float* p) { return _mm512_loadu_ps(p); }
+				DRAGON_TARGET("avx512f") static inline void store(float* p, Reg a) { _mm512_storeu_ps(p, a); }
+				DRAGON_TARGET("avx512f") static inline Reg set(float value) { return _mm512_set1_ps(value); }
+				DRAGON_TARGET("avx512f") static inline Reg add(Reg a, Reg b) { return _mm512_add_ps(a, b); }
+				DRAGON_TARGET("avx512f") static inline Reg sub(Reg a, Reg b) { return _mm512_sub_ps(a, b); }
+				DRAGON_TARGET("avx512f") static inline Reg mult(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+				DRAGON_TARGET("avx512f") static inline Reg div(Reg a, Reg b) { return _mm512_div_ps(a, b); }
+			};
+			template<class T> struct V : Traits<T> { static constexpr const char* name = "AVX-512"; };
+			#define DRAGON_KERNEL_TARGET DRAGON_TARGET("avx512f")
+			#include "ElementwiseKernels.inl"
+			#undef DRAGON_KERNEL_TARGET
+		}
+
+		// Checks the CPU and the OS support (saved register state) of the wide instruction sets.
+		void detectInstructionSets(bool& hasAvx2, bool& hasAvx512) {
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			int maxLeaf = info[0];
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+			int ebx7 = 0;
+			if (maxLeaf >= 7) {
+				__cpuidex(info, 7, 0);
+				ebx7 = info[1];
+			}
+			hasAvx2 = (ebx7 & (1 << 5)) && (xcr0 & 0x6) == 0x6;
+			hasAvx512 = (ebx7 & (1 << 16)) && (xcr0 & 0xE6) == 0xE6;
+#else
+			__builtin_cpu_init();
+			hasAvx2 = __builtin_cpu_supports("avx2");
+			hasAvx512 = __builtin_cpu_supports("avx512f");
+#endif
+		}
+#endif
+
+		template<class T>
+		KernelTable<T> selectKernelTable() {
+#ifdef DRAGON_X86
+			bool hasAvx2 = false, hasAvx512 = false;
+			detectInstructionSets(hasAvx2, hasAvx512);
+			if (hasAvx512)
+				return avx512::getKernelTable<T>();
+			if (hasAvx2)
+				return avx2::getKernelTable<T>();
+			return sse2::getKernelTable<T>();
+#else
+			return scalar::getKernelTable<T>();
+#endif
+		}
+
+		// The table of every element type is selected on its first use, the initialization is thread safe.
+		template<class T>
+		inline const KernelTable<T>& table() {
+			static const KernelTable<T> selected = selectKernelTable<T>();
+			return selected;
+		}
+
+	}
+
+	template<class T> void add(T* dst, const T* src, size_t count) { table<T>().add(dst, src, count); }
+	template<class T> void sub(T* dst, const T* src, size_t count) { table<T>().sub(dst, src, count); }
+	template<class T> void mult(T* dst, const T* src, size_t count) { table<T>().mult(dst, src, count); }
+	template<class T> void div(T* dst, const T* src, size_t count) { table<T>().div(dst, src, count); }
+
+	template<class T> void add(T* dst, NonDeduced<T> value, size_t count) { table<T>().addValue(dst, value, count); }
+	template<class T> void sub(T* dst, NonDeduced<T> value, size_t count) { table<T>().subValue(dst, value, count); }
+	template<class T> void mult(T* dst, NonDeduced<T> value, size_t count) { table<T>().multValue(dst, value, count); }
+	template<class T> void div(T* dst, NonDeduced<T> value, size_t count) { table<T>().divValue(dst, value, count); }
+
+	template<class T> void fill(T* dst, NonDeduced<T> value, size_t count) { table<T>().fill(dst, value, count); }
+	template<class T> void copy(T* dst, const T* src, size_t count) { table<T>().copy(dst, src, count); }
+
+	const char* getInstructionSet() { return table<precision>().name; }
+
+	bool hasAvx2() {
+#ifdef DRAGON_X86
+		static const bool result = [] {
+			bool hasAvx2 = false, hasAvx512 = false;
+			detectInstructionSets(hasAvx2, hasAvx512);
+			return hasAvx2;
+		}();
+		return result;
+#else
+		return false;
+#endif
+	}
+
+	bool hasAvx2Fma16() {
+#ifdef DRAGON_X86
+		static const bool result = [] {
+			bool hasAvx2 = false, hasAvx512 = false;
+			detectInstructionSets(hasAvx2, hasAvx512);
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 1);
+			bool hasFma16 = (info[2] & (1 << 12)) && (info[2] & (1 << 29));
+#else
+			bool hasFma16 = __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+#endif
+			return hasAvx2 && hasFma16;
+		}();
+		return result;
+#else
+		return false;
+#endif
+	}
+
+#define ELEMENTWISE_TEMPLATES(T) \
+	template DRAGON_API void add<T>(T*, const T*, size_t); \
+	template DRAGON_API void sub<T>(T*, const T*, size_t); \
+	template DRAGON_API void mult<T>(T*, const T*, size_t); \
+	template DRAGON_API void div<T>(T*, const T*, size_t); \
+	template DRAGON_API void add<T>(T*, T, size_t); \
+	template DRAGON_API void sub<T>(T*, T, size_t); \
+	template DRAGON_API void mult<T>(T*, T, size_t); \
+	template DRAGON_API void div<T>(T*, T, size_t); \
+	template DRAGON_API void fill<T>(T*, T, size_t); \
+	template DRAGON_API void copy<T>(T*, const T*, size_t);
+	DRAGON_INSTANTIATE(ELEMENTWISE_TEMPLATES)
+}
+
+DRAGON_END
\ No newline at end of file
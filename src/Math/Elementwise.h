@@ -0,0 +1,36 @@
+#pragma once
+#include "../Core.h"
+
+#include "Tensor.h"
+
+/*
+Vectorized elementwise kernels on raw buffers.
+The kernels are built for float and double, the instruction set (SSE2, AVX2 or AVX-512 on x86) is selected once at runtime,
+the Tensor arithmetic methods are built on top of these.
+*/
+
+DRAGON_BEGIN
+
+namespace kernel {
+	// dst[i] = dst[i] (op) src[i] for every i < count. dst and src can be the same buffer.
+	template<class T> DRAGON_API void add(T* dst, const T* src, size_t count);
+	template<class T> DRAGON_API void sub(T* dst, const T* src, size_t count);
+	template<class T> DRAGON_API void mult(T* dst, const T* src, size_t count);
+	template<class T> DRAGON_API void div(T* dst, const T* src, size_t count);
+
+	// dst[i] = dst[i] (op) value for every i < count.
+	template<class T> DRAGON_API void add(T* dst, NonDeduced<T> value, size_t count);
+	template<class T> DRAGON_API void sub(T* dst, NonDeduced<T> value, size_t count);
+	template<class T> DRAGON_API void mult(T* dst, NonDeduced<T> value, size_t count);
+	template<class T> DRAGON_API void div(T* dst, NonDeduced<T> value, size_t count);
+
+	// Set every element of dst to value.
+	template<class T> DRAGON_API void fill(T* dst, NonDeduced<T> value, size_t count);
+	// Copy count elements from src to dst, the buffers can't overlap.
+	template<class T> DRAGON_API void copy(T* dst, const T* src, size_t count);
+
+	// Returns the name of the instruction set the kernels are running on.
+	DRAGON_API const char* getInstructionSet();
+}
+
+DRAGON_END
\ No newline at end of file
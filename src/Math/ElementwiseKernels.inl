@@ -0,0 +1,91 @@
+/*
+Instruction set specific elementwise kernels.
+Elementwise.cpp includes this file once per instruction set, inside a namespace
+that defines the vector traits V<T> of the element types and the DRAGON_KERNEL_TARGET function attribute.
+*/
+
+template<Operation Op, class T>
+DRAGON_KERNEL_TARGET inline typename V<T>::Reg apply(typename V<T>::Reg a, typename V<T>::Reg b) {
+	if constexpr (Op == Operation::Add) return V<T>::add(a, b);
+	else if constexpr (Op == Operation::Sub) return V<T>::sub(a, b);
+	else if constexpr (Op == Operation::Mult) return V<T>::mult(a, b);
+	else return V<T>::div(a, b);
+}
+
+// dst = dst (op) src, four registers per step, than one register per step, than the scalar tail.
+template<Operation Op, class T>
+DRAGON_KERNEL_TARGET void tensorKernel(T* dst, const T* src, size_t count) {
+	constexpr size_t W = V<T>::width;
+	size_t i = 0;
+	for (; i + 4 * W <= count; i += 4 * W) {
+		typename V<T>::Reg d0 = V<T>::load(dst + i);
+		typename V<T>::Reg d1 = V<T>::load(dst + i + W);
+		typename V<T>::Reg d2 = V<T>::load(dst + i + 2 * W);
+		typename V<T>::Reg d3 = V<T>::load(dst + i + 3 * W);
+		V<T>::store(dst + i, apply<Op, T>(d0, V<T>::load(src + i)));
+		V<T>::store(dst + i + W, apply<Op, T>(d1, V<T>::load(src + i + W)));
+		V<T>::store(dst + i + 2 * W, apply<Op, T>(d2, V<T>::load(src + i + 2 * W)));
+		V<T>::store(dst + i + 3 * W, apply<Op, T>(d3, V<T>::load(src + i + 3 * W)));
+	}
+	for (; i + W <= count; i += W)
+		V<T>::store(dst + i, apply<Op, T>(V<T>::load(dst + i), V<T>::load(src + i)));
+	for (; i < count; i++)
+		dst[i] = applyScalar<Op>(dst[i], src[i]);
+}
+
+// dst = dst (op) value.
+template<Operation Op, class T>
+DRAGON_KERNEL_TARGET void scalarKernel(T* dst, T value, size_t count) {
+	constexpr size_t W = V<T>::width;
+	typename V<T>::Reg v = V<T>::set(value);
+	size_t i = 0;
+	for (; i + 4 * W <= count; i += 4 * W) {
+		V<T>::store(dst + i, apply<Op, T>(V<T>::load(dst + i), v));
+		V<T>::store(dst + i + W, apply<Op, T>(V<T>::load(dst + i + W), v));
+		V<T>::store(dst + i + 2 * W, apply<Op, T>(V<T>::load(dst + i + 2 * W), v));
+		V<T>::store(dst + i + 3 * W, apply<Op, T>(V<T>::load(dst + i + 3 * W), v));
+	}
+	for (; i + W <= count; i += W)
+		V<T>::store(dst + i, apply<Op, T>(V<T>::load(dst + i), v));
+	for (; i < count; i++)
+		dst[i] = applyScalar<Op>(dst[i], value);
+}
+
+template<class T>
+DRAGON_KERNEL_TARGET void fillKernel(T* dst, T value, size_t count) {
+	constexpr size_t W = V<T>::width;
+	typename V<T>::Reg v = V<T>::set(value);
+	size_t i = 0;
+	for (; i + W <= count; i += W)
+		V<T>::store(dst + i, v);
+	for (; i < count; i++)
+		dst[i] = value;
+}
+
+template<class T>
+DRAGON_KERNEL_TARGET void copyKernel(T* dst, const T* src, size_t count) {
+	constexpr size_t W = V<T>::width;
+	size_t i = 0;
+	for (; i + 4 * W <= count; i += 4 * W) {
+		V<T>::store(dst + i, V<T>::load(src + i));
+		V<T>::store(dst + i + W, V<T>::load(src + i + W));
+		V<T>::store(dst + i + 2 * W, V<T>::load(src + i + 2 * W));
+		V<T>::store(dst + i + 3 * W, V<T>::load(src + i + 3 * W));
+	}
+	for (; i + W <= count; i += W)
+		V<T>::store(dst + i, V<T>::load(src + i));
+	for (; i < count; i++)
+		dst[i] = src[i];
+}
+
+template<class T>
+inline KernelTable<T> getKernelTable() {
+	return {
+		tensorKernel<Operation::Add, T>, tensorKernel<Operation::Sub, T>,
+		tensorKernel<Operation::Mult, T>, tensorKernel<Operation::Div, T>,
+		scalarKernel<Operation::Add, T>, scalarKernel<Operation::Sub, T>,
+		scalarKernel<Operation::Mult, T>, scalarKernel<Operation::Div, T>,
+		fillKernel<T>, copyKernel<T>,
+		V<T>::name
+	};
+}
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+#include "../Core.h"
+
+#include <type_traits>
+
+#include "Tensor.h"
+
+/*
+Expression templates for the elementwise builder functions (add, sub, mult, div).
+An expression only holds references to its tensor operands, nothing is computed until
+the expression is converted to a tensor or assigned into one, than the whole expression
+is evaluated in one loop without temporaries.
+*/
+
+DRAGON_BEGIN
+
+namespace expression {
+
+	// Elementwise operations of the expression nodes.
+	struct Add { template<class T> static inline T apply(T a, T b) { return a + b; } };
+	struct Sub { template<class T> static inline T apply(T a, T b) { return a - b; } };
+	struct Mult { template<class T> static inline T apply(T a, T b) { return a * b; } };
+	struct Div { template<class T> static inline T apply(T a, T b) { return a / b; } };
+
+	// Leaf of an expression, references a tensor.
+	template<class TensorT>
+	struct TensorOperand {
+		using TensorType = TensorT;
+		using precision = typename TensorT::precision;
+
+		const TensorType& tensor;
+
+		inline precision operator[](size_t i) const { return tensor.getData()[i]; }
+		inline size_t getCount() const { return tensor.getCount(); }
+		inline const TensorType& getShape() const { return tensor; }
+	};
+
+	// Leaf of an expression, the same value for every element.
+	template<class T>
+	struct ScalarOperand {
+		using precision = T;
+
+		T value;
+
+		inline T operator[](size_t) const { return value; }
+	};
+
+	template<class T>
+	struct IsScalarOperand : std::false_type { };
+	template<class T>
+	struct IsScalarOperand<ScalarOperand<T>> : std::true_type { };
+
+	template<class Operation, class Left, class Right>
+	class Expression;
+
+	template<class T>
+	struct IsExpression : std::false_type { };
+	template<class Operation, class Left, class Right>
+	struct IsExpression<Expression<Operation, Left, Right>> : std::true_type { };
+
+	template<class T>
+	std::true_type isTensorPointer(const BasicTensor<T>*);
+	std::false_type isTensorPointer(const void*);
+
+	// True for the types derived from a BasicTensor of any element type.
+	template<class T>
+	struct DerivesFromTensor : decltype(isTensorPointer(std::declval<T*>())) { };
+
+	// Expressions are checked first, they can be incomplete types when this is asked.
+	template<class T>
+	struct IsTensor : std::conjunction<std::negation<IsExpression<T>>, DerivesFromTensor<T>> { };
+
+	// True for tensor types and expressions, these can be operands with a shape.
+	template<class T>
+	constexpr bool isShaped = IsExpression<T>::value || IsTensor<T>::value;
+
+	// Convert a builder function parameter to the operand stored in the expression,
+	// Element is the element type of the expression, the scalars are converted to it.
+	template<class Element, class T, class Enable = void>
+	struct Operand;
+	template<class Element, class T>
+	struct Operand<Element, T, std::enable_if_t<IsTensor<T>::value>> {
+		using Type = TensorOperand<T>;
+		static inline Type make(const T& tensor) { return Type{ tensor }; }
+	};
+	template<class Element, class T>
+	struct Operand<Element, T, std::enable_if_t<IsExpression<T>::value>> {
+		using Type = T;
+		static inline const Type& make(const T& expression) { return expression; }
+	};
+	template<class Element, class T>
+	struct Operand<Element, T, std::enable_if_t<std::is_arithmetic<T>::value>> {
+		using Type = ScalarOperand<Element>;
+		static inline Type make(T value) { return Type{ Element(value) }; }
+	};
+
+	// The left operand is a tensor or an expression, it gives the element type.
+	template<class Left>
+	using ElementOf = typename Left::precision;
+
+	template<class Operation, class Left, class Right>
+	using ExpressionOf = Expression<Operation,
+		typename Operand<ElementOf<Left>, Left>::Type, typename Operand<ElementOf<Left>, Right>::Type>;
+
+	/// <summary>
+	/// Node of a lazy elementwise expression.
+	/// The left operand is always a tensor or an expression, it gives the shape of the result,
+	/// the right one can be a scalar too.
+	/// Converts to the tensor type of the left most tensor, or can be evaluated into an
+	/// existing tensor with assign. Don't keep expressions (auto) after the operands are gone.
+	/// The functions templated on the element type don't convert, pass them eval().
+	/// </summary>
+	template<class Operation, class Left, class Right>
+	class Expression {
+	public:
+		using TensorType = typename Left::TensorType;
+		using precision = typename Left::precision;
+
+		Expression(const Left& left, const Right& right) :
+			m_Left(left), m_Right(right) {
+			static_assert(std::is_same<precision, typename Right::precision>::value,
+				"Operand element type not match!");
+			if constexpr (!IsScalarOperand<Right>::value) {
+				assert((left.getCount() == right.getCount()) && "Parameter count not match!");
+				assert((left.getShape().getLayout() == right.getShape().getLayout()) && "Parameter layout not match!");
+			}
+		}
+
+		inline precision operator[](size_t i) const { return Operation::apply(m_Left[i], m_Right[i]); }
+		inline size_t getCount() const { return m_Left.getCount(); }
+		inline const TensorType& getShape() const { return m_Left.getShape(); }
+
+		// Evaluate the expression into a new tensor.
+		operator TensorType() const { return eval(); }
+		TensorType eval() const;
+
+		// Chain an other elementwise operation, it's still lazy.
+		template<class T> ExpressionOf<Add, Expression, T> add(const T& other) const { return { *this, Operand<precision, T>::make(other) }; }
+		template<class T> ExpressionOf<Sub, Expression, T> sub(const T& other) const { return { *this, Operand<precision, T>::make(other) }; }
+		template<class T> ExpressionOf<Mult, Expression, T> mult(const T& other) const { return { *this, Operand<precision, T>::make(other) }; }
+		template<class T> ExpressionOf<Div, Expression, T> div(const T& other) const { return { *this, Operand<precision, T>::make(other) }; }
+
+	private:
+		Left m_Left;
+		Right m_Right;
+	};
+
+}
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "FFT.h"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+DRAGON_BEGIN
+
+namespace {
+
+	// exp(-2 pi i k / size) for k < size / 2, built for the largest transform size seen by the thread.
+	// A smaller power of two transform uses every (size / count)-th value.
+	template<class T>
+	const std::complex<T>* twiddles(size_t count, size_t& step) {
+		thread_local std::vector<std::complex<T>> table;
+		thread_local size_t tableSize = 0;
+
+		if (count > tableSize) {
+			const double pi = 3.14159265358979323846;
+			table.resize(count / 2);
+			for (size_t k = 0; k < count / 2; k++) {
+				double angle = -2.0 * pi * double(k) / double(count);
+				table[k] = std::complex<T>(T(std::cos(angle)), T(std::sin(angle)));
+			}
+			tableSize = count;
+		}
+
+		step = tableSize / count;
+		return table.data();
+	}
+
+	// FFT along the first axis of a count x width grid, every element of the transform is a row of width values.
+	// With width = 1 it's the plain 1D transform, with width = cols it transforms all the columns of a grid at once,
+	// the inner loops go through the row, so they are contiguous.
+	template<class T>
+	void transform(std::complex<T>* data, size_t count, size_t width, bool inverse) {
+		assert((count != 0 && (count & (count - 1)) == 0) && "FFT size must be a power of two!");
+
+		// Bit reversal permutation.
+		for (size_t i = 1, j = 0; i < count; i++) {
+			size_t bit = count >> 1;
+			for (; j & bit; bit >>= 1)
+				j ^= bit;
+			j ^= bit;
+			if (i < j)
+				std::swap_ranges(data + i * width, data + (i + 1) * width, data + j * width);
+		}
+
+		size_t tableStep;
+		const std::complex<T>* table = twiddles<T>(count, tableStep);
+
+		// Butterflies, the complex products are written out, std::complex multiplication checks for infinities.
+		for (size_t length = 2; length <= count; length <<= 1) {
+			size_t half = length / 2;
+			size_t step = tableStep * (count / length);
+
+			for (size_t start = 0; start < count; start += length) {
+				for (size_t k = 0; k < half; k++) {
+					T wr = table[k * step].real();
+					T wi = inverse ? -table[k * step].imag() : table[k * step].imag();
+
+					T* a = reinterpret_cast<T*>(data + (start + k) * width);
+					T* b = reinterpret_cast<T*>(data + (start + k + half) * width);
+					for (size_t x = 0; x < 2 * width; x += 2) {
+						T tr = b[x] * wr - b[x + 1] * wi;
+						T ti = b[x] * wi + b[x + 1] * wr;
+						b[x] = a[x] - tr;
+						b[x + 1] = a[x + 1] - ti;
+						a[x] += tr;
+						a[x + 1] += ti;
+					}
+				}
+			}
+		}
+	}
+
+}
+
+size_t fftSize(size_t count) {
+	size_t size = 1;
+	while (size < count)
+		size <<= 1;
+	return size;
+}
+
+template<class T>
+void fft(std::complex<T>* data, size_t count, bool inverse) {
+	transform(data, count, 1, inverse);
+}
+
+template<class T>
+void fft2D(std::complex<T>* data, size_t rows, size_t cols, bool inverse) {
+	for (size_t i = 0; i < rows; i++)
+		transform(data + i * cols, cols, 1, inverse);
+	transform(data, rows, cols, inverse);
+}
+
+template<class T>
+void spectrum(std::complex<T>* result, NonDeduced<ConstTensorView<2, T>> signal, size_t fftRows, size_t fftCols, size_t spacing) {
+	assert(((signal.getRows() - 1) * spacing < fftRows && (signal.getCols() - 1) * spacing < fftCols) &&
+		"Signal does not fit into the FFT size!");
+
+	std::fill(result, result + fftRows * fftCols, std::complex<T>());
+	for (size_t i = 0; i < signal.getRows(); i++) {
+		std::complex<T>* row = result + i * spacing * fftCols;
+		for (size_t j = 0; j < signal.getCols(); j++)
+			row[j * spacing] = std::complex<T>(signal(i, j));
+	}
+
+	fft2D(result, fftRows, fftCols, false);
+}
+
+template<class T>
+void inverseSpectrum(NonDeduced<TensorView<2, T>> result, std::complex<T>* spectrum, size_t fftRows, size_t fftCols, size_t stride, bool accumulate) {
+	assert(((result.getRows() - 1) * stride < fftRows && (result.getCols() - 1) * stride < fftCols) &&
+		"Result does not fit into the FFT size!");
+
+	fft2D(spectrum, fftRows, fftCols, true);
+
+	T scale = T(1) / T(fftRows * fftCols);
+	for (size_t i = 0; i < result.getRows(); i++) {
+		const std::complex<T>* row = spectrum + i * stride * fftCols;
+		for (size_t j = 0; j < result.getCols(); j++) {
+			T value = row[j * stride].real() * scale;
+			result(i, j) = accumulate ? result(i, j) + value : value;
+		}
+	}
+}
+
+template<class T>
+void spectrumMultiplyAdd(std::complex<T>* result, const std::complex<T>* a, const std::complex<T>* b, size_t count, bool conjugate) {
+	T* r = reinterpret_cast<T*>(result);
+	const T* x = reinterpret_cast<const T*>(a);
+	const T* y = reinterpret_cast<const T*>(b);
+	T sign = conjugate ? T(-1) : T(1);
+
+	for (size_t i = 0; i < 2 * count; i += 2) {
+		T yi = sign * y[i + 1];
+		r[i] += x[i] * y[i] - x[i + 1] * yi;
+		r[i + 1] += x[i] * yi + x[i + 1] * y[i];
+	}
+}
+
+#define FFT_TEMPLATES(T) \
+	template DRAGON_API void fft<T>(std::complex<T>*, size_t, bool); \
+	template DRAGON_API void fft2D<T>(std::complex<T>*, size_t, size_t, bool); \
+	template DRAGON_API void spectrum<T>(std::complex<T>*, ConstTensorView<2, T>, size_t, size_t, size_t); \
+	template DRAGON_API void inverseSpectrum<T>(TensorView<2, T>, std::complex<T>*, size_t, size_t, size_t, bool); \
+	template DRAGON_API void spectrumMultiplyAdd<T>(std::complex<T>*, const std::complex<T>*, const std::complex<T>*, size_t, bool);
+DRAGON_INSTANTIATE(FFT_TEMPLATES)
+
+DRAGON_END
\ No newline at end of file
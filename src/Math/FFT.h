@@ -0,0 +1,41 @@
+#pragma once
+#include "../Core.h"
+
+#include <complex>
+
+#include "Tensor.h"
+#include "Tensor2D.h"
+#include "TensorView.h"
+
+/*
+Radix-2 fast fourier transform and the spectrum helpers of the FFT based 2D convolution.
+Every 2D signal is zero padded to a power of two grid, the correlation with a kernel is
+a pointwise product of the spectra (with the kernel spectrum conjugated),
+so a convolution costs O(N^2 log N) independently of the kernel size.
+*/
+
+DRAGON_BEGIN
+
+using Complex = std::complex<precision>;
+
+// Smallest power of two that is not less than count.
+DRAGON_API size_t fftSize(size_t count);
+
+// In place FFT of count (power of two) values. The inverse transform is not scaled by 1 / count.
+template<class T> DRAGON_API void fft(std::complex<T>* data, size_t count, bool inverse);
+// In place 2D FFT of a rows x cols (powers of two) row major grid. The inverse transform is not scaled.
+template<class T> DRAGON_API void fft2D(std::complex<T>* data, size_t rows, size_t cols, bool inverse);
+
+// Spectrum of signal zero padded to fftRows x fftCols. The signal values are placed spacing apart,
+// spacing > 1 is the zero inserted (upsampled) signal, that the strided convolution gradients need.
+template<class T> DRAGON_API void spectrum(std::complex<T>* result, NonDeduced<ConstTensorView<2, T>> signal, size_t fftRows, size_t fftCols, size_t spacing);
+// Inverse transform the spectrum in place, and write the real values at every stride-th position
+// of the first result rows x cols part into result, scaled by 1 / (fftRows * fftCols).
+// If accumulate is true the values are added to result.
+template<class T> DRAGON_API void inverseSpectrum(NonDeduced<TensorView<2, T>> result, std::complex<T>* spectrum, size_t fftRows, size_t fftCols, size_t stride, bool accumulate);
+
+// result[i] += a[i] * b[i] (or a[i] * conj(b[i])) for every i < count.
+// The product with the conjugate is the correlation, the plain product is the convolution.
+template<class T> DRAGON_API void spectrumMultiplyAdd(std::complex<T>* result, const std::complex<T>* a, const std::complex<T>* b, size_t count, bool conjugate);
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "HalfFloat.h"
+#include "InstructionSets.h"
+
+#include <algorithm>
+#include <cstring>
+
+DRAGON_BEGIN
+
+namespace {
+
+	// The A panel is MR floats of every K, the B panel is NR 16 bit floats of every K.
+	// The kernels are compiled for one weight format each.
+	template<class T>
+	using HalfMicroKernel = void(*)(size_t K, const float* a, const uint16_t* b,
+		T* C, size_t ldc, size_t mr, size_t nr);
+	// The same for an A panel with a single row.
+	template<class T>
+	using HalfRowKernel = void(*)(size_t K, const float* a, const uint16_t* b,
+		T* C, size_t ldc, size_t nr);
+
+	template<class T>
+	inline void storeHalfTile(const float* tile, T* C, size_t ldc, size_t mr, size_t nr) {
+		for (size_t r = 0; r < mr; r++)
+			for (size_t c = 0; c < nr; c++)
+				C[r * ldc + c] = T(tile[r * GEMM_HALF_NR + c]);
+	}
+
+	// Portable fallback, the values of a K are widened once and used by every row.
+	template<WeightFormat Format, class T>
+	void halfMicroKernel(size_t K, const float* a, const uint16_t* b,
+		T* C, size_t ldc, size_t mr, size_t nr) {
+		float acc[GEMM_HALF_MR][GEMM_HALF_NR] = {};
+		float widened[GEMM_HALF_NR];
+
+		for (size_t k = 0; k < K; k++) {
+			for (size_t c = 0; c < GEMM_HALF_NR; c++)
+				widened[c] = fromHalf(b[c], Format);
+			for (size_t r = 0; r < GEMM_HALF_MR; r++)
+				for (size_t c = 0; c < GEMM_HALF_NR; c++)
+					acc[r][c] += a[r] * widened[c];
+			a += GEMM_HALF_MR;
+			b += GEMM_HALF_NR;
+		}
+
+		storeHalfTile(&acc[0][0], C, ldc, mr, nr);
+	}
+
+	template<WeightFormat Format, class T>
+	void halfRowKernel(size_t K, const float* a, const uint16_t* b, T* C, size_t ldc, size_t nr) {
+		halfMicroKernel<Format>(K, a, b, C, ldc, 1, nr);
+	}
+
+#ifdef DRAGON_X86
+	// The 16 values of a K widened to two registers of 8 floats, F16C converts the IEEE halves.
+	DRAGON_TARGET("avx2,f16c")
+	inline void widenFloat16(const uint16_t* b, __m256& b0, __m256& b1) {
+		b0 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+		b1 = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 8)));
+	}
+
+	// A bfloat16 is the upper half of a float, it's only shifted up.
+	DRAGON_TARGET("avx2")
+	inline void widenBFloat16(const uint16_t* b, __m256& b0, __m256& b1) {
+		__m256i low = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+		__m256i high = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 8)));
+		b0 = _mm256_castsi256_ps(_mm256_slli_epi32(low, 16));
+		b1 = _mm256_castsi256_ps(_mm256_slli_epi32(high, 16));
+	}
+
+	// Every A value of a K is broadcasted and multiplied with the 16 widened B values.
+	template<WeightFormat Format, class T>
+	DRAGON_TARGET("avx2,fma,f16c")
+	void halfMicroKernelAvx2(size_t K, const float* a, const uint16_t* b,
+		T* C, size_t ldc, size_t mr, size_t nr) {
+		static_assert(GEMM_HALF_MR == 6 && GEMM_HALF_NR == 16, "The AVX2 microkernel is unrolled for 6 x 16 tiles!");
+		// The rows are written out, so the 12 accumulators stay in registers.
+		__m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+		__m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+		__m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+		__m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+		__m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+		__m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+
+		for (size_t k = 0; k < K; k++) {
+			__m256 b0, b1;
+			if constexpr (Format == WeightFormat::Float16)
+				widenFloat16(b, b0, b1);
+			else
+				widenBFloat16(b, b0, b1);
+
+			__m256 a0 = _mm256_broadcast_ss(a);
+			c00 = _mm256_fmadd_ps(a0, b0, c00);
+			c01 = _mm256_fmadd_ps(a0, b1, c01);
+			__m256 a1 = _mm256_broadcast_ss(a + 1);
+			c10 = _mm256_fmadd_ps(a1, b0, c10);
+			c11 = _mm256_fmadd_ps(a1, b1, c11);
+			__m256 a2 = _mm256_broadcast_ss(a + 2);
+			c20 = _mm256_fmadd_ps(a2, b0, c20);
+			c21 = _mm256_fmadd_ps(a2, b1, c21);
+			__m256 a3 = _mm256_broadcast_ss(a + 3);
+			c30 = _mm256_fmadd_ps(a3, b0, c30);
+			c31 = _mm256_fmadd_ps(a3, b1, c31);
+			__m256 a4 = _mm256_broadcast_ss(a + 4);
+			c40 = _mm256_fmadd_ps(a4, b0, c40);
+			c41 = _mm256_fmadd_ps(a4, b1, c41);
+			__m256 a5 = _mm256_broadcast_ss(a + 5);
+			c50 = _mm256_fmadd_ps(a5, b0, c50);
+			c51 = _mm256_fmadd_ps(a5, b1, c51);
+
+			a += GEMM_HALF_MR;
+			b += GEMM_HALF_NR;
+		}
+
+		alignas(32) float tile[GEMM_HALF_MR][GEMM_HALF_NR];
+		_mm256_store_ps(tile[0], c00);
+		_mm256_store_ps(tile[0] + 8, c01);
+		_mm256_store_ps(tile[1], c10);
+		_mm256_store_ps(tile[1] + 8, c11);
+		_mm256_store_ps(tile[2], c20);
+		_mm256_store_ps(tile[2] + 8, c21);
+		_mm256_store_ps(tile[3], c30);
+		_mm256_store_ps(tile[3] + 8, c31);
+		_mm256_store_ps(tile[4], c40);
+		_mm256_store_ps(tile[4] + 8, c41);
+		_mm256_store_ps(tile[5], c50);
+		_mm256_store_ps(tile[5] + 8, c51);
+		storeHalfTile(&tile[0][0], C, ldc, mr, nr);
+	}
+
+	// The panel of a single row (the gemv of a dense layer with one sample), the tile kernel would do 6 times
+	// more multiplications. 4 K values are summed into separate accumulators, so the additions don't wait on each other.
+	template<WeightFormat Format, class T>
+	DRAGON_TARGET("avx2,fma,f16c")
+	void halfRowKernelAvx2(size_t K, const float* a, const uint16_t* b,
+		T* C, size_t ldc, size_t nr) {
+		__m256 c[4][2] = {
+			{ _mm256_setzero_ps(), _mm256_setzero_ps() }, { _mm256_setzero_ps(), _mm256_setzero_ps() },
+			{ _mm256_setzero_ps(), _mm256_setzero_ps() }, { _mm256_setzero_ps(), _mm256_setzero_ps() } };
+
+		size_t k = 0;
+		for (; k + 4 <= K; k += 4) {
+			for (size_t u = 0; u < 4; u++) {
+				__m256 b0, b1;
+				if constexpr (Format == WeightFormat::Float16)
+					widenFloat16(b + u * GEMM_HALF_NR, b0, b1);
+				else
+					widenBFloat16(b + u * GEMM_HALF_NR, b0, b1);
+				__m256 a0 = _mm256_broadcast_ss(a + u * GEMM_HALF_MR);
+				c[u][0] = _mm256_fmadd_ps(a0, b0, c[u][0]);
+				c[u][1] = _mm256_fmadd_ps(a0, b1, c[u][1]);
+			}
+			a += 4 * GEMM_HALF_MR;
+			b += 4 * GEMM_HALF_NR;
+		}
+		for (; k < K; k++) {
+			__m256 b0, b1;
+			if constexpr (Format == WeightFormat::Float16)
+				widenFloat16(b, b0, b1);
+			else
+				widenBFloat16(b, b0, b1);
+			__m256 a0 = _mm256_broadcast_ss(a);
+			c[0][0] = _mm256_fmadd_ps(a0, b0, c[0][0]);
+			c[0][1] = _mm256_fmadd_ps(a0, b1, c[0][1]);
+			a += GEMM_HALF_MR;
+			b += GEMM_HALF_NR;
+		}
+
+		alignas(32) float tile[GEMM_HALF_NR];
+		_mm256_store_ps(tile, _mm256_add_ps(_mm256_add_ps(c[0][0], c[1][0]), _mm256_add_ps(c[2][0], c[3][0])));
+		_mm256_store_ps(tile + 8, _mm256_add_ps(_mm256_add_ps(c[0][1], c[1][1]), _mm256_add_ps(c[2][1], c[3][1])));
+		storeHalfTile(tile, C, ldc, 1, nr);
+	}
+#endif
+
+	// The kernel of the full tiles, and the one of the single row panels.
+	template<class T>
+	struct HalfKernels {
+		HalfMicroKernel<T> tile;
+		HalfRowKernel<T> row;
+	};
+
+	template<class T>
+	HalfKernels<T> selectHalfKernels(WeightFormat format) {
+		bool float16 = format == WeightFormat::Float16;
+		HalfKernels<T> kernels;
+		kernels.tile = float16 ? halfMicroKernel<WeightFormat::Float16, T> : halfMicroKernel<WeightFormat::BFloat16, T>;
+		kernels.row = float16 ? halfRowKernel<WeightFormat::Float16, T> : halfRowKernel<WeightFormat::BFloat16, T>;
+#ifdef DRAGON_X86
+		if (kernel::hasAvx2Fma16()) {
+			kernels.tile = float16 ? halfMicroKernelAvx2<WeightFormat::Float16, T> : halfMicroKernelAvx2<WeightFormat::BFloat16, T>;
+			kernels.row = float16 ? halfRowKernelAvx2<WeightFormat::Float16, T> : halfRowKernelAvx2<WeightFormat::BFloat16, T>;
+		}
+#endif
+		return kernels;
+	}
+
+	inline uint32_t floatBits(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	inline float bitsFloat(uint32_t bits) {
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+}
+
+uint16_t toHalf(float value, WeightFormat format) {
+	assert((format != WeightFormat::Precision) && "Not a 16 bit float format!");
+	uint32_t bits = floatBits(value);
+
+	if (format == WeightFormat::BFloat16) {
+		// The NaNs stay quiet NaNs, the others are rounded to even on the lower 16 bits.
+		if ((bits & 0x7fffffffu) > 0x7f800000u)
+			return uint16_t((bits >> 16) | 0x40u);
+		return uint16_t((bits + 0x7fffu + ((bits >> 16) & 1u)) >> 16);
+	}
+
+	uint32_t sign = (bits >> 16) & 0x8000u;
+	uint32_t magnitude = bits & 0x7fffffffu;
+	if (magnitude > 0x7f800000u)
+		return uint16_t(sign | 0x7e00u);
+	// 65520 and above round to the infinity.
+	if (magnitude >= 0x477ff000u)
+		return uint16_t(sign | 0x7c00u);
+	// Below the smallest normal half (2^-14): the subnormals are multiples of 2^-24, that's the ulp of 0.5,
+	// so adding 0.5 rounds to the subnormal (to even), its bits are the low bits of the float.
+	if (magnitude < 0x38800000u)
+		return uint16_t(sign | (floatBits(bitsFloat(magnitude) + 0.5f) - 0x3f000000u));
+	// The exponent is rebiased (127 to 15), the lower 13 bits of the mantissa are rounded to even.
+	magnitude += 0xc8000fffu + ((magnitude >> 13) & 1u);
+	return uint16_t(sign | (magnitude >> 13));
+}
+
+float fromHalf(uint16_t value, WeightFormat format) {
+	assert((format != WeightFormat::Precision) && "Not a 16 bit float format!");
+	if (format == WeightFormat::BFloat16)
+		return bitsFloat(uint32_t(value) << 16);
+
+	uint32_t sign = uint32_t(value & 0x8000u) << 16;
+	uint32_t exponent = (value >> 10) & 0x1fu;
+	uint32_t mantissa = value & 0x3ffu;
+	if (exponent == 0x1fu)
+		return bitsFloat(sign | 0x7f800000u | (mantissa << 13));
+	if (exponent == 0) {
+		// Zero or subnormal, mantissa * 2^-24.
+		float magnitude = float(mantissa) * (1.0f / 16777216.0f);
+		return sign ? -magnitude : magnitude;
+	}
+	return bitsFloat(sign | ((exponent + 112u) << 23) | (mantissa << 13));
+}
+
+void packHalf(std::vector<uint16_t>& packed, const uint16_t* B, size_t N, size_t K, size_t ldb) {
+	size_t panels = (N + GEMM_HALF_NR - 1) / GEMM_HALF_NR;
+	packed.assign(panels * GEMM_HALF_NR * K, uint16_t());
+
+	for (size_t panel = 0; panel < panels; panel++) {
+		uint16_t* destination = packed.data() + panel * GEMM_HALF_NR * K;
+		size_t nr = std::min(GEMM_HALF_NR, N - panel * GEMM_HALF_NR);
+		for (size_t c = 0; c < nr; c++) {
+			const uint16_t* row = B + (panel * GEMM_HALF_NR + c) * ldb;
+			for (size_t k = 0; k < K; k++)
+				destination[k * GEMM_HALF_NR + c] = row[k];
+		}
+	}
+}
+
+void unpackHalf(uint16_t* result, const HalfWeights& weights) {
+	for (size_t i = 0; i < weights.rows; i++) {
+		const uint16_t* panel = weights.packed.data() + i / GEMM_HALF_NR * GEMM_HALF_NR * weights.cols;
+		for (size_t k = 0; k < weights.cols; k++)
+			result[i * weights.cols + k] = panel[k * GEMM_HALF_NR + i % GEMM_HALF_NR];
+	}
+}
+
+template<class T>
+void toHalfWeights(HalfWeights& weights, const T* data, size_t rows, size_t cols, WeightFormat format) {
+	assert((format != WeightFormat::Precision) && "Not a 16 bit float format!");
+	weights.format = format;
+	weights.rows = rows;
+	weights.cols = cols;
+
+	// Rounded right into the packed panels, the precision matrix is not copied.
+	size_t panels = (rows + GEMM_HALF_NR - 1) / GEMM_HALF_NR;
+	weights.packed.assign(panels * GEMM_HALF_NR * cols, uint16_t());
+	for (size_t i = 0; i < rows; i++) {
+		uint16_t* panel = weights.packed.data() + i / GEMM_HALF_NR * GEMM_HALF_NR * cols;
+		for (size_t k = 0; k < cols; k++)
+			panel[k * GEMM_HALF_NR + i % GEMM_HALF_NR] = toHalf(float(data[i * cols + k]), format);
+	}
+}
+
+template<class T>
+void fromHalfWeights(T* result, const HalfWeights& weights) {
+	assert((weights.format != WeightFormat::Precision) && "The weights are not 16 bit floats!");
+	for (size_t i = 0; i < weights.rows; i++) {
+		const uint16_t* panel = weights.packed.data() + i / GEMM_HALF_NR * GEMM_HALF_NR * weights.cols;
+		for (size_t k = 0; k < weights.cols; k++)
+			result[i * weights.cols + k] = T(fromHalf(panel[k * GEMM_HALF_NR + i % GEMM_HALF_NR], weights.format));
+	}
+}
+
+template<class T>
+void gemmHalf(
+	bool transA,
+	size_t M, const T* A, size_t lda,
+	const HalfWeights& weights,
+	T* C, size_t ldc) {
+
+	assert((weights.format != WeightFormat::Precision) && "gemmHalf needs 16 bit float weights!");
+	static const HalfKernels<T> float16Kernels = selectHalfKernels<T>(WeightFormat::Float16);
+	static const HalfKernels<T> bfloat16Kernels = selectHalfKernels<T>(WeightFormat::BFloat16);
+	const HalfKernels<T>& kernels = weights.format == WeightFormat::Float16 ? float16Kernels : bfloat16Kernels;
+	size_t N = weights.rows;
+	size_t K = weights.cols;
+	size_t panels = (M + GEMM_HALF_MR - 1) / GEMM_HALF_MR;
+
+	// A is packed into float panels of MR rows, the missing rows are zero.
+	thread_local std::vector<float> packedA;
+	packedA.assign(panels * GEMM_HALF_MR * K, 0.0f);
+	for (size_t panel = 0; panel < panels; panel++) {
+		float* destination = packedA.data() + panel * GEMM_HALF_MR * K;
+		size_t ir = panel * GEMM_HALF_MR;
+		size_t mr = std::min(GEMM_HALF_MR, M - ir);
+		for (size_t k = 0; k < K; k++) {
+			for (size_t r = 0; r < mr; r++)
+				destination[k * GEMM_HALF_MR + r] = float(transA ? A[k * lda + ir + r] : A[(ir + r) * lda + k]);
+		}
+	}
+
+	// A B panel is used by every A panel while it's in the cache.
+	for (size_t jr = 0; jr < N; jr += GEMM_HALF_NR) {
+		const uint16_t* b = weights.packed.data() + jr * K;
+		size_t nr = std::min(GEMM_HALF_NR, N - jr);
+		for (size_t panel = 0; panel < panels; panel++) {
+			size_t ir = panel * GEMM_HALF_MR;
+			size_t mr = std::min(GEMM_HALF_MR, M - ir);
+			if (mr == 1)
+				kernels.row(K, packedA.data() + ir * K, b, C + ir * ldc + jr, ldc, nr);
+			else
+				kernels.tile(K, packedA.data() + ir * K, b, C + ir * ldc + jr, ldc, mr, nr);
+		}
+	}
+}
+
+#define HALF_FLOAT_TEMPLATES(T) \
+	template DRAGON_API void toHalfWeights<T>(HalfWeights&, const T*, size_t, size_t, WeightFormat); \
+	template DRAGON_API void fromHalfWeights<T>(T*, const HalfWeights&); \
+	template DRAGON_API void gemmHalf<T>(bool, size_t, const T*, size_t, const HalfWeights&, T*, size_t);
+DRAGON_INSTANTIATE(HALF_FLOAT_TEMPLATES)
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,65 @@
+#pragma once
+#include "../Core.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "Tensor.h"
+
+/*
+16 bit float weights (IEEE half and bfloat16) and their matrix multiplication.
+The weights are stored in 16 bits and widened to float in the registers of the kernel, they are multiplied with the
+float input and the products are summed in float. No scales and no calibration are needed (unlike the int8 quantization),
+a 16 bit weight takes half the memory of a float one and a quarter of a double one.
+Bfloat16 is the upper half of a float, it keeps the range of float with 8 bits of mantissa.
+The IEEE half has 11 bits of mantissa, but its largest value is 65504, larger weights become infinities.
+*/
+
+DRAGON_BEGIN
+
+// Register tile of the 16 bit float gemm (rows of A x rows of B).
+constexpr size_t GEMM_HALF_MR = 6;
+constexpr size_t GEMM_HALF_NR = 16;
+
+// How a layer stores its weights: in precision, as IEEE half precision or as bfloat16.
+enum class WeightFormat { Precision, Float16, BFloat16 };
+
+/// <summary>
+/// 16 bit float weights of a layer, rows (output channels) x cols (the inputs of one output).
+/// packed holds them as the B of gemmHalf (packHalf), the last panel is padded with zero rows.
+/// The format is Precision while the layer keeps its weights in precision, than packed is empty.
+/// </summary>
+struct HalfWeights {
+	WeightFormat format = WeightFormat::Precision;
+	size_t rows = 0;
+	size_t cols = 0;
+	std::vector<uint16_t> packed;
+};
+
+// The nearest 16 bit float (Float16 or BFloat16) of value, rounded to even, out of range values are infinities.
+DRAGON_API uint16_t toHalf(float value, WeightFormat format);
+// The float value of the 16 bit float, exact.
+DRAGON_API float fromHalf(uint16_t value, WeightFormat format);
+
+// Pack the N x K matrix B of 16 bit floats (row stride ldb) for gemmHalf: panels of GEMM_HALF_NR rows,
+// in every panel the GEMM_HALF_NR values of a K follow each other. The edges are zero padded.
+DRAGON_API void packHalf(std::vector<uint16_t>& packed, const uint16_t* B, size_t N, size_t K, size_t ldb);
+// The packed weights back as rows x cols 16 bit floats, row by row (the order of the saved files).
+DRAGON_API void unpackHalf(uint16_t* result, const HalfWeights& weights);
+
+// Round the rows x cols matrix to the 16 bit format (not Precision) right into the packed weights.
+template<class T> DRAGON_API void toHalfWeights(HalfWeights& weights, const T* data, size_t rows, size_t cols, WeightFormat format);
+// The 16 bit weights widened to rows x cols values, row by row.
+template<class T> DRAGON_API void fromHalfWeights(T* result, const HalfWeights& weights);
+
+// C = op(A) * trans(B) with the 16 bit float weights as B.
+// op(A) is A or the transponant of A if transA is true, op(A) is M x K, B is N x K (weights.rows x weights.cols)
+// and C is M x N, lda and ldc are the row strides. A is converted to float when it's packed,
+// a single row of A (the gemv of a dense layer) runs on its own kernel.
+template<class T> DRAGON_API void gemmHalf(
+	bool transA,
+	size_t M, const T* A, size_t lda,
+	const HalfWeights& weights,
+	T* C, size_t ldc);
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include "../Core.h"
+
+/*
+The instruction set macros of the runtime dispatched kernels (Elementwise, Quantization, HalfFloat).
+Not part of the public headers, only the kernel sources include it.
+*/
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define DRAGON_X86
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+// MSVC accepts every intrinsic without a target attribute, GCC and Clang need the attribute
+// to generate code for an instruction set the rest of the build doesn't assume.
+#if defined(__GNUC__) || defined(__clang__)
+	#define DRAGON_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define DRAGON_TARGET(isa)
+#endif
+
+DRAGON_BEGIN
+
+namespace kernel {
+	// True if the CPU and the OS support AVX2, checked once.
+	bool hasAvx2();
+	// True if the CPU and the OS support AVX2 with FMA and F16C (the half precision conversions), checked once.
+	bool hasAvx2Fma16();
+}
+
+DRAGON_END
\ No newline at end of file
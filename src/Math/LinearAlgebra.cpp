@@ -0,0 +1,402 @@
+#include "LinearAlgebra.h"
+
+#include <vector>
+#include <algorithm>
+
+DRAGON_BEGIN
+
+namespace {
+
+	// Products below this size are not worth the packing, they run on the plain loop.
+	// Depends only on N and K, so splitting a product by rows never changes the path (and the result).
+	constexpr size_t GEMM_SMALL_NK = 64 * 64;
+
+	// The epilogue of the rows x cols block of C, that starts at row i and column j of the whole C.
+	// The block was just written, so it's still in the cache.
+	template<class T>
+	void epilogueBlock(const BasicEpilogue<T>& epilogue, T* C, size_t ldc,
+		size_t i, size_t j, size_t rows, size_t cols) {
+		for (size_t r = 0; r < rows; r++) {
+			T* row = C + r * ldc;
+			if (epilogue.bias) {
+				const T* bias = epilogue.bias + (i + r) * epilogue.biasStride + j;
+				for (size_t c = 0; c < cols; c++)
+					row[c] += bias[c];
+			}
+			if (epilogue.sums) {
+				T* sums = epilogue.sums + (i + r) * epilogue.sumsStride + j;
+				for (size_t c = 0; c < cols; c++)
+					sums[c] = row[c];
+			}
+			if (epilogue.activation)
+				(*epilogue.activation)(row, cols);
+		}
+	}
+
+	// Pack the mc x kc block of op(A) into MR row high panels.
+	// Inside a panel the MR values of one column are next to each other, the rows out of range are zero.
+	template<class T>
+	void packA(bool transA, const T* A, size_t lda,
+		size_t mc, size_t kc, T* packed) {
+		for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+			size_t mr = std::min(GEMM_MR, mc - ir);
+			for (size_t p = 0; p < kc; p++) {
+				for (size_t r = 0; r < mr; r++)
+					packed[r] = transA ? A[p * lda + ir + r] : A[(ir + r) * lda + p];
+				for (size_t r = mr; r < GEMM_MR; r++)
+					packed[r] = T();
+				packed += GEMM_MR;
+			}
+		}
+	}
+
+	// Pack the kc x nc block of op(B) into NR column wide panels.
+	// Inside a panel the NR values of one row are next to each other, the columns out of range are zero.
+	template<class T>
+	void packB(bool transB, const T* B, size_t ldb,
+		size_t kc, size_t nc, T* packed) {
+		for (size_t jr = 0; jr < nc; jr += GEMM_NR<T>) {
+			size_t nr = std::min(GEMM_NR<T>, nc - jr);
+			for (size_t p = 0; p < kc; p++) {
+				if (transB) {
+					for (size_t c = 0; c < nr; c++)
+						packed[c] = B[(jr + c) * ldb + p];
+				}
+				else {
+					const T* row = B + p * ldb + jr;
+					for (size_t c = 0; c < nr; c++)
+						packed[c] = row[c];
+				}
+				for (size_t c = nr; c < GEMM_NR<T>; c++)
+					packed[c] = T();
+				packed += GEMM_NR<T>;
+			}
+		}
+	}
+
+	// Multiply an MR x kc packed panel of A with a kc x NR packed panel of B.
+	// The MR x NR accumulator tile has a compile time size, so it is held in vector registers.
+	// Only the mr x nr valid part of the tile is written back to C.
+	template<class T>
+	inline void microKernel(size_t kc, const T* a, const T* b,
+		T alpha, T beta, T* C, size_t ldc, size_t mr, size_t nr) {
+		static_assert(GEMM_MR == 4, "The microkernel is unrolled for 4 rows!");
+		T acc[GEMM_MR][GEMM_NR<T>] = {};
+
+		for (size_t p = 0; p < kc; p++) {
+			T a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+			for (size_t c = 0; c < GEMM_NR<T>; c++) {
+				T bc = b[c];
+				acc[0][c] += a0 * bc;
+				acc[1][c] += a1 * bc;
+				acc[2][c] += a2 * bc;
+				acc[3][c] += a3 * bc;
+			}
+			a += GEMM_MR;
+			b += GEMM_NR<T>;
+		}
+
+		for (size_t r = 0; r < mr; r++) {
+			T* row = C + r * ldc;
+			if (beta == T()) {
+				for (size_t c = 0; c < nr; c++)
+					row[c] = alpha * acc[r][c];
+			}
+			else {
+				for (size_t c = 0; c < nr; c++)
+					row[c] = alpha * acc[r][c] + beta * row[c];
+			}
+		}
+	}
+
+	// Width of the C tiles of the small product path.
+	template<class T>
+	constexpr size_t GEMM_SMALL_NR = 2 * GEMM_NR<T>;
+
+	// One tile of a small product, C rows with up to GEMM_MR rows and GEMM_SMALL_NR columns.
+	// The full tile has compile time bounds, so the accumulators stay in vector registers,
+	// the edge tiles use the runtime bounds. Both sum the products in the same order.
+	template<bool FullTile, class T>
+	inline void smallTile(
+		bool transA, bool transB,
+		size_t mr, size_t nr, size_t K,
+		T alpha,
+		const T* A, size_t lda,
+		const T* B, size_t ldb,
+		T beta,
+		T* C, size_t ldc) {
+		T acc[GEMM_MR][GEMM_SMALL_NR<T>] = {};
+		const size_t rows = FullTile ? GEMM_MR : mr;
+		const size_t cols = FullTile ? GEMM_SMALL_NR<T> : nr;
+
+		T gathered[GEMM_SMALL_NR<T>];
+		for (size_t p = 0; p < K; p++) {
+			const T* b = B + p * ldb;
+			if (transB) {
+				for (size_t c = 0; c < cols; c++)
+					gathered[c] = B[c * ldb + p];
+				b = gathered;
+			}
+			for (size_t r = 0; r < rows; r++) {
+				T a = transA ? A[p * lda + r] : A[r * lda + p];
+				for (size_t c = 0; c < cols; c++)
+					acc[r][c] += a * b[c];
+			}
+		}
+
+		for (size_t r = 0; r < rows; r++) {
+			T* row = C + r * ldc;
+			if (beta == T()) {
+				for (size_t c = 0; c < cols; c++)
+					row[c] = alpha * acc[r][c];
+			}
+			else {
+				for (size_t c = 0; c < cols; c++)
+					row[c] = alpha * acc[r][c] + beta * row[c];
+			}
+		}
+	}
+
+	// Small products without packing, C is calculated in register sized tiles straight from A and B.
+	template<class T>
+	void gemmSmall(
+		bool transA, bool transB,
+		size_t M, size_t N, size_t K,
+		T alpha,
+		const T* A, size_t lda,
+		const T* B, size_t ldb,
+		T beta,
+		T* C, size_t ldc,
+		const BasicEpilogue<T>* epilogue) {
+		for (size_t i = 0; i < M; i += GEMM_MR) {
+			size_t mr = std::min(GEMM_MR, M - i);
+			const T* a = transA ? A + i : A + i * lda;
+
+			for (size_t j = 0; j < N; j += GEMM_SMALL_NR<T>) {
+				size_t nr = std::min(GEMM_SMALL_NR<T>, N - j);
+				const T* b = transB ? B + j * ldb : B + j;
+
+				if (mr == GEMM_MR && nr == GEMM_SMALL_NR<T>)
+					smallTile<true>(transA, transB, mr, nr, K, alpha, a, lda, b, ldb, beta, C + i * ldc + j, ldc);
+				else
+					smallTile<false>(transA, transB, mr, nr, K, alpha, a, lda, b, ldb, beta, C + i * ldc + j, ldc);
+			}
+
+			// The finished rows of tiles.
+			if (epilogue)
+				epilogueBlock(*epilogue, C + i * ldc, ldc, i, 0, mr, N);
+		}
+	}
+
+}
+
+template<class T>
+void gemm(
+	bool transA, bool transB,
+	size_t M, size_t N, size_t K,
+	NonDeduced<T> alpha,
+	const T* A, size_t lda,
+	const T* B, size_t ldb,
+	NonDeduced<T> beta,
+	T* C, size_t ldc,
+	const NonDeduced<BasicEpilogue<T>>* epilogue) {
+	if (M == 0 || N == 0)
+		return;
+
+	if (K == 0 || alpha == T()) {
+		for (size_t i = 0; i < M; i++)
+			for (size_t j = 0; j < N; j++)
+				C[i * ldc + j] = (beta == T()) ? T() : beta * C[i * ldc + j];
+		if (epilogue)
+			applyEpilogue(*epilogue, M, N, C, ldc);
+		return;
+	}
+
+	if (N * K < GEMM_SMALL_NK) {
+		gemmSmall(transA, transB, M, N, K, alpha, A, lda, B, ldb, beta, C, ldc, epilogue);
+		return;
+	}
+
+	// Packing buffers are kept per thread, so the steady state does not allocate.
+	thread_local std::vector<T> packedA;
+	thread_local std::vector<T> packedB;
+	packedA.resize(GEMM_MC * GEMM_KC);
+	packedB.resize(GEMM_KC * ((GEMM_NC + GEMM_NR<T> - 1) / GEMM_NR<T>) * GEMM_NR<T>);
+
+	for (size_t jc = 0; jc < N; jc += GEMM_NC) {
+		size_t nc = std::min(GEMM_NC, N - jc);
+
+		for (size_t pc = 0; pc < K; pc += GEMM_KC) {
+			size_t kc = std::min(GEMM_KC, K - pc);
+			// The first K block scales C by beta, the later ones accumulate into it.
+			T blockBeta = (pc == 0) ? beta : T(1);
+			// The last K block finishes C, the epilogue runs on every mc x nc block after its last tile.
+			const BasicEpilogue<T>* blockEpilogue = (pc + kc == K) ? epilogue : nullptr;
+
+			packB(transB, transB ? B + jc * ldb + pc : B + pc * ldb + jc, ldb, kc, nc, packedB.data());
+
+			for (size_t ic = 0; ic < M; ic += GEMM_MC) {
+				size_t mc = std::min(GEMM_MC, M - ic);
+
+				packA(transA, transA ? A + pc * lda + ic : A + ic * lda + pc, lda, mc, kc, packedA.data());
+
+				for (size_t jr = 0; jr < nc; jr += GEMM_NR<T>) {
+					size_t nr = std::min(GEMM_NR<T>, nc - jr);
+					const T* b = packedB.data() + (jr / GEMM_NR<T>) * kc * GEMM_NR<T>;
+
+					for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+						size_t mr = std::min(GEMM_MR, mc - ir);
+						const T* a = packedA.data() + (ir / GEMM_MR) * kc * GEMM_MR;
+
+						microKernel(kc, a, b, alpha, blockBeta,
+							C + (ic + ir) * ldc + jc + jr, ldc, mr, nr);
+					}
+				}
+
+				if (blockEpilogue)
+					epilogueBlock(*blockEpilogue, C + ic * ldc + jc, ldc, ic, jc, mc, nc);
+			}
+		}
+	}
+}
+
+template<class T>
+void gemv(
+	size_t M, size_t N,
+	NonDeduced<T> alpha,
+	const T* A, size_t lda,
+	const T* x,
+	NonDeduced<T> beta,
+	T* y,
+	const NonDeduced<BasicEpilogue<T>>* epilogue) {
+	// The sums are split into parts like in gemm: in one part for the small products, in GEMM_KC long parts
+	// for the big ones. So y is the same to the last bit as the one row gemm(false, true, 1, M, N, ...),
+	// a sample gives the same output alone and in a batch.
+	size_t blockSize = (M * N < GEMM_SMALL_NK) ? std::max<size_t>(N, 1) : GEMM_KC;
+
+	// Runs once for N == 0 too, than y is only scaled by beta.
+	for (size_t jc = 0; jc == 0 || jc < N; jc += blockSize) {
+		size_t nc = std::min(blockSize, N - jc);
+		// The first part scales y by beta, the later ones accumulate into it.
+		T blockBeta = (jc == 0) ? beta : T(1);
+		const T* xc = x + jc;
+		size_t i = 0;
+
+		// Four rows at a time, every loaded x element is used four times.
+		for (; i + 4 <= M; i += 4) {
+			const T* a0 = A + i * lda + jc;
+			const T* a1 = a0 + lda;
+			const T* a2 = a1 + lda;
+			const T* a3 = a2 + lda;
+
+			T s0 = T(), s1 = T(), s2 = T(), s3 = T();
+			for (size_t j = 0; j < nc; j++) {
+				T xj = xc[j];
+				s0 += a0[j] * xj;
+				s1 += a1[j] * xj;
+				s2 += a2[j] * xj;
+				s3 += a3[j] * xj;
+			}
+
+			if (blockBeta == T()) {
+				y[i] = alpha * s0; y[i + 1] = alpha * s1; y[i + 2] = alpha * s2; y[i + 3] = alpha * s3;
+			}
+			else {
+				y[i] = alpha * s0 + blockBeta * y[i];
+				y[i + 1] = alpha * s1 + blockBeta * y[i + 1];
+				y[i + 2] = alpha * s2 + blockBeta * y[i + 2];
+				y[i + 3] = alpha * s3 + blockBeta * y[i + 3];
+			}
+		}
+
+		for (; i < M; i++) {
+			const T* a = A + i * lda + jc;
+			T s = T();
+			for (size_t j = 0; j < nc; j++)
+				s += a[j] * xc[j];
+			y[i] = (blockBeta == T()) ? alpha * s : alpha * s + blockBeta * y[i];
+		}
+	}
+
+	if (epilogue)
+		applyEpilogue(*epilogue, 1, M, y, M);
+}
+
+template<class T>
+void applyEpilogue(const BasicEpilogue<T>& epilogue, size_t M, size_t N, T* C, size_t ldc) {
+	epilogueBlock(epilogue, C, ldc, 0, 0, M, N);
+}
+
+template<class T>
+void gemvTrans(
+	size_t M, size_t N,
+	NonDeduced<T> alpha,
+	const T* A, size_t lda,
+	const T* x,
+	NonDeduced<T> beta,
+	T* y) {
+	if (beta == T()) {
+		for (size_t j = 0; j < N; j++)
+			y[j] = T();
+	}
+	else if (beta != T(1)) {
+		for (size_t j = 0; j < N; j++)
+			y[j] *= beta;
+	}
+
+	size_t i = 0;
+
+	// y += alpha * x[i] * A[i, :], four rows per sweep over y.
+	for (; i + 4 <= M; i += 4) {
+		const T* a0 = A + i * lda;
+		const T* a1 = a0 + lda;
+		const T* a2 = a1 + lda;
+		const T* a3 = a2 + lda;
+		T x0 = alpha * x[i], x1 = alpha * x[i + 1], x2 = alpha * x[i + 2], x3 = alpha * x[i + 3];
+
+		for (size_t j = 0; j < N; j++)
+			y[j] += x0 * a0[j] + x1 * a1[j] + x2 * a2[j] + x3 * a3[j];
+	}
+
+	for (; i < M; i++) {
+		const T* a = A + i * lda;
+		T xi = alpha * x[i];
+		for (size_t j = 0; j < N; j++)
+			y[j] += xi * a[j];
+	}
+}
+
+template<class T>
+void ger(
+	size_t M, size_t N,
+	NonDeduced<T> alpha,
+	const T* x,
+	const T* y,
+	T* A, size_t lda) {
+	for (size_t i = 0; i < M; i++) {
+		T xi = alpha * x[i];
+		if (xi == T())
+			continue;
+
+		T* a = A + i * lda;
+		for (size_t j = 0; j < N; j++)
+			a[j] += xi * y[j];
+	}
+}
+
+template<class T>
+void axpy(size_t N, NonDeduced<T> alpha, const T* x, T* y) {
+	for (size_t i = 0; i < N; i++)
+		y[i] += alpha * x[i];
+}
+
+#define LINEAR_ALGEBRA_TEMPLATES(T) \
+	template DRAGON_API void gemm<T>(bool, bool, size_t, size_t, size_t, T, const T*, size_t, const T*, size_t, T, T*, size_t, const BasicEpilogue<T>*); \
+	template DRAGON_API void gemv<T>(size_t, size_t, T, const T*, size_t, const T*, T, T*, const BasicEpilogue<T>*); \
+	template DRAGON_API void applyEpilogue<T>(const BasicEpilogue<T>&, size_t, size_t, T*, size_t); \
+	template DRAGON_API void gemvTrans<T>(size_t, size_t, T, const T*, size_t, const T*, T, T*); \
+	template DRAGON_API void ger<T>(size_t, size_t, T, const T*, const T*, T*, size_t); \
+	template DRAGON_API void axpy<T>(size_t, T, const T*, T*);
+DRAGON_INSTANTIATE(LINEAR_ALGEBRA_TEMPLATES)
+
+DRAGON_END
\ No newline at end of file
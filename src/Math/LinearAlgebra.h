@@ -0,0 +1,103 @@
+#pragma once
+#include "../Core.h"
+
+#include <functional>
+
+#include "Tensor.h"
+
+/*
+Low level linear algebra kernels working on raw row-major buffers.
+The tensor level functions (tensorDot, ...) and the layers are built on top of these.
+*/
+
+DRAGON_BEGIN
+
+// Register tile of the gemm microkernel (rows of A x columns of B).
+// The column count spans two SIMD registers of the widest vector unit.
+constexpr size_t GEMM_MR = 4;
+template<class T>
+constexpr size_t GEMM_NR = 64 / sizeof(T);
+// Cache blocking parameters of the gemm.
+// KC x NR panel of B stays in L1, MC x KC panel of A stays in L2, KC x NC panel of B stays in L3.
+constexpr size_t GEMM_KC = 256;
+constexpr size_t GEMM_MC = 96;
+constexpr size_t GEMM_NC = 2048;
+
+/// <summary>
+/// Epilogue is the work done on the result of a gemm or gemv while it's still in the cache, instead of extra passes over it:
+/// the bias is added to C, C is saved into sums (the pre-activations), than the activation is applied on C.
+/// The gemm runs it on every cache block of C right after the last K block of the block is written.
+/// The bias and sums are indexed like C with their own row strides, a zero bias stride adds the same row to every row of C.
+/// </summary>
+template<class T>
+struct BasicEpilogue {
+	using SpanFunction = std::function<void(T* data, size_t count)>;
+
+	const T* bias = nullptr;
+	size_t biasStride = 0;
+	T* sums = nullptr;
+	size_t sumsStride = 0;
+	const SpanFunction* activation = nullptr;
+};
+
+using Epilogue = BasicEpilogue<precision>;
+
+// General matrix multiplication on row-major buffers: C = alpha * op(A) * op(B) + beta * C.
+// op(X) is X or the transponant of X if the trans flag is true.
+// op(A) is M x K, op(B) is K x N and C is M x N, ld* are the row strides of the stored matrices.
+// If beta is zero C is not read, so it can hold junk.
+// The epilogue (if not null) is run on C after the product.
+template<class T> DRAGON_API void gemm(
+	bool transA, bool transB,
+	size_t M, size_t N, size_t K,
+	NonDeduced<T> alpha,
+	const T* A, size_t lda,
+	const T* B, size_t ldb,
+	NonDeduced<T> beta,
+	T* C, size_t ldc,
+	const NonDeduced<BasicEpilogue<T>>* epilogue = nullptr);
+
+// Matrix vector multiplication on a row-major buffer: y = alpha * A * x + beta * y.
+// A is M x N with row stride lda, x has N and y has M elements.
+// If beta is zero y is not read, so it can hold junk.
+// The result is bitwise the same as the one row gemm(false, true, 1, M, N, alpha, x, N, A, lda, beta, y, M),
+// if the compiler doesn't contract a * b + c into fma (gcc does with -march=native, unless -ffp-contract=off).
+// The epilogue (if not null) is run on y as a 1 x M matrix.
+template<class T> DRAGON_API void gemv(
+	size_t M, size_t N,
+	NonDeduced<T> alpha,
+	const T* A, size_t lda,
+	const T* x,
+	NonDeduced<T> beta,
+	T* y,
+	const NonDeduced<BasicEpilogue<T>>* epilogue = nullptr);
+
+// Run the epilogue on the M x N matrix C, for the kernels that don't take an epilogue.
+template<class T> DRAGON_API void applyEpilogue(const BasicEpilogue<T>& epilogue, size_t M, size_t N, T* C, size_t ldc);
+
+// Transponant matrix vector multiplication on a row-major buffer: y = alpha * trans(A) * x + beta * y.
+// A is M x N with row stride lda, x has M and y has N elements.
+// A is read in place row by row, the transponant is never built.
+// If beta is zero y is not read, so it can hold junk.
+template<class T> DRAGON_API void gemvTrans(
+	size_t M, size_t N,
+	NonDeduced<T> alpha,
+	const T* A, size_t lda,
+	const T* x,
+	NonDeduced<T> beta,
+	T* y);
+
+// Rank-1 update of a row-major buffer in place: A += alpha * x * trans(y).
+// A is M x N with row stride lda, x has M and y has N elements.
+// The outer product is never built, every element of A is read and written once.
+template<class T> DRAGON_API void ger(
+	size_t M, size_t N,
+	NonDeduced<T> alpha,
+	const T* x,
+	const T* y,
+	T* A, size_t lda);
+
+// Scaled vector addition in place: y += alpha * x, both have N elements.
+template<class T> DRAGON_API void axpy(size_t N, NonDeduced<T> alpha, const T* x, T* y);
+
+DRAGON_END
\ No newline at end of file
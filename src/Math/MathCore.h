@@ -1,8 +1,18 @@
 #pragma once
 
 #include "Tensor.h"
+#include "Elementwise.h"
 #include "Tensor1D.h"
 #include "Tensor2D.h"
 #include "Tensor3D.h"
+#include "TensorView.h"
+#include "Expression.h"
 #include "Builders.h"
-#include "UtilityFunctions.h"
\ No newline at end of file
+#include "LinearAlgebra.h"
+#include "Winograd.h"
+#include "FFT.h"
+#include "BlockedConvolution.h"
+#include "UtilityFunctions.h"
+#include "Quantization.h"
+#include "HalfFloat.h"
+#include "Sparse.h"
\ No newline at end of file
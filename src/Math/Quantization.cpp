@@ -0,0 +1,240 @@
+#include "Quantization.h"
+#include "InstructionSets.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#include "UtilityFunctions.h"
+
+DRAGON_BEGIN
+
+namespace {
+
+	// The A panel is MR rows of int16 K pairs, the B panel is NR rows of int8 K pairs.
+	// Every product of a pair is two multiplications summed into one int32,
+	// that's one instruction (madd) on x86 with AVX2.
+	using MicroKernel = void(*)(size_t kPairs, const int16_t* a, const int8_t* b, int32_t* C, size_t ldc, size_t mr, size_t nr);
+
+	// Only the mr x nr valid part of the tile is written into C.
+	inline void storeTile(const int32_t* tile, int32_t* C, size_t ldc, size_t mr, size_t nr) {
+		for (size_t r = 0; r < mr; r++)
+			std::memcpy(C + r * ldc, tile + r * GEMM_INT8_NR, nr * sizeof(int32_t));
+	}
+
+	// Portable fallback, left to the compiler to vectorize.
+	void microKernel(size_t kPairs, const int16_t* a, const int8_t* b, int32_t* C, size_t ldc, size_t mr, size_t nr) {
+		int32_t acc[GEMM_INT8_MR][GEMM_INT8_NR] = {};
+
+		for (size_t p = 0; p < kPairs; p++) {
+			for (size_t r = 0; r < GEMM_INT8_MR; r++) {
+				int32_t a0 = a[2 * r], a1 = a[2 * r + 1];
+				for (size_t c = 0; c < GEMM_INT8_NR; c++)
+					acc[r][c] += a0 * b[2 * c] + a1 * b[2 * c + 1];
+			}
+			a += 2 * GEMM_INT8_MR;
+			b += 2 * GEMM_INT8_NR;
+		}
+
+		storeTile(&acc[0][0], C, ldc, mr, nr);
+	}
+
+#ifdef DRAGON_X86
+	// The 16 B pairs of a K pair are sign extended to int16 in two registers,
+	// the A pair of a row is broadcasted as one int32, madd gives the pair sums of 8 columns.
+	DRAGON_TARGET("avx2")
+	void microKernelAvx2(size_t kPairs, const int16_t* a, const int8_t* b, int32_t* C, size_t ldc, size_t mr, size_t nr) {
+		static_assert(GEMM_INT8_MR == 4 && GEMM_INT8_NR == 16, "The AVX2 microkernel is unrolled for 4 x 16 tiles!");
+		// The rows are written out, so the 8 accumulators stay in registers.
+		__m256i c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256();
+		__m256i c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256();
+		__m256i c20 = _mm256_setzero_si256(), c21 = _mm256_setzero_si256();
+		__m256i c30 = _mm256_setzero_si256(), c31 = _mm256_setzero_si256();
+
+		for (size_t p = 0; p < kPairs; p++) {
+			__m256i pairs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+			__m256i b0 = _mm256_cvtepi8_epi16(_mm256_castsi256_si128(pairs));
+			__m256i b1 = _mm256_cvtepi8_epi16(_mm256_extracti128_si256(pairs, 1));
+			const int32_t* aPairs = reinterpret_cast<const int32_t*>(a);
+
+			__m256i a0 = _mm256_set1_epi32(aPairs[0]);
+			c00 = _mm256_add_epi32(c00, _mm256_madd_epi16(b0, a0));
+			c01 = _mm256_add_epi32(c01, _mm256_madd_epi16(b1, a0));
+			__m256i a1 = _mm256_set1_epi32(aPairs[1]);
+			c10 = _mm256_add_epi32(c10, _mm256_madd_epi16(b0, a1));
+			c11 = _mm256_add_epi32(c11, _mm256_madd_epi16(b1, a1));
+			__m256i a2 = _mm256_set1_epi32(aPairs[2]);
+			c20 = _mm256_add_epi32(c20, _mm256_madd_epi16(b0, a2));
+			c21 = _mm256_add_epi32(c21, _mm256_madd_epi16(b1, a2));
+			__m256i a3 = _mm256_set1_epi32(aPairs[3]);
+			c30 = _mm256_add_epi32(c30, _mm256_madd_epi16(b0, a3));
+			c31 = _mm256_add_epi32(c31, _mm256_madd_epi16(b1, a3));
+
+			a += 2 * GEMM_INT8_MR;
+			b += 2 * GEMM_INT8_NR;
+		}
+
+		alignas(32) int32_t tile[GEMM_INT8_MR][GEMM_INT8_NR];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(tile[0]), c00);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(tile[0] + 8), c01);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(tile[1]), c10);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(tile[1] + 8), c11);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(tile[2]), c20);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(tile[2] + 8), c21);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(tile[3]), c30);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(tile[3] + 8), c31);
+		storeTile(&tile[0][0], C, ldc, mr, nr);
+	}
+#endif
+
+	MicroKernel selectMicroKernel() {
+#ifdef DRAGON_X86
+		if (kernel::hasAvx2())
+			return microKernelAvx2;
+#endif
+		return microKernel;
+	}
+
+}
+
+template<class T>
+T quantizationScale(T maxAbs) {
+	// A zero range (all zero data) gets scale 1, so the quantized values are still zeros.
+	return maxAbs > T() ? maxAbs / T(127) : T(1);
+}
+
+template<class T>
+T maxAbs(const T* data, size_t count) {
+	T result = T();
+	for (size_t i = 0; i < count; i++)
+		result = std::max(result, data[i] < T() ? -data[i] : data[i]);
+	return result;
+}
+
+template<class T>
+void quantizeValues(int8_t* result, const T* data, size_t count, NonDeduced<T> scale) {
+	// The value is shifted to be positive, so the truncation is the rounding, nearbyint can be a library call.
+	T inverse = T(1) / scale;
+	for (size_t i = 0; i < count; i++) {
+		T shifted = std::min(std::max(data[i] * inverse + T(127.5), T(0.5)), T(254.5));
+		result[i] = int8_t(int(shifted) - 127);
+	}
+}
+
+template<class T>
+void quantizeRows(BasicQuantizedWeights<T>& weights, const T* data, size_t rows, size_t cols) {
+	weights.rows = rows;
+	weights.cols = cols;
+	weights.values.resize(rows * cols);
+	weights.scales.resize(rows);
+
+	for (size_t i = 0; i < rows; i++) {
+		weights.scales[i] = quantizationScale(maxAbs(data + i * cols, cols));
+		quantizeValues(weights.values.data() + i * cols, data + i * cols, cols, weights.scales[i]);
+	}
+	packInt8(weights.packed, false, weights.values.data(), rows, cols, cols);
+}
+
+void packInt8(std::vector<int8_t>& packed, bool transB, const int8_t* B, size_t N, size_t K, size_t ldb) {
+	size_t kPairs = (K + 1) / 2;
+	size_t panels = (N + GEMM_INT8_NR - 1) / GEMM_INT8_NR;
+	packed.assign(panels * GEMM_INT8_NR * 2 * kPairs, int8_t());
+
+	for (size_t panel = 0; panel < panels; panel++) {
+		int8_t* destination = packed.data() + panel * GEMM_INT8_NR * 2 * kPairs;
+		size_t nr = std::min(GEMM_INT8_NR, N - panel * GEMM_INT8_NR);
+		if (transB) {
+			// The K rows of the stored B are read along the panel, a pair of them is interleaved.
+			for (size_t k = 0; k < K; k++) {
+				const int8_t* row = B + k * ldb + panel * GEMM_INT8_NR;
+				int8_t* pairs = destination + (k / 2) * 2 * GEMM_INT8_NR + k % 2;
+				for (size_t c = 0; c < nr; c++)
+					pairs[2 * c] = row[c];
+			}
+			continue;
+		}
+		for (size_t c = 0; c < nr; c++) {
+			const int8_t* row = B + (panel * GEMM_INT8_NR + c) * ldb;
+			for (size_t k = 0; k < K; k++)
+				destination[(k / 2) * 2 * GEMM_INT8_NR + 2 * c + k % 2] = row[k];
+		}
+	}
+}
+
+void gemmInt8(
+	size_t M, size_t N, size_t K,
+	const int8_t* A, size_t lda,
+	const int8_t* packedB,
+	int32_t* C, size_t ldc) {
+
+	static const MicroKernel kernel = selectMicroKernel();
+	size_t kPairs = (K + 1) / 2;
+	size_t panels = (M + GEMM_INT8_MR - 1) / GEMM_INT8_MR;
+
+	// A is packed into int16 K pairs of MR rows, the missing rows and the odd K are zero.
+	thread_local std::vector<int16_t> packedA;
+	packedA.assign(panels * GEMM_INT8_MR * 2 * kPairs, int16_t());
+	for (size_t panel = 0; panel < panels; panel++) {
+		int16_t* destination = packedA.data() + panel * GEMM_INT8_MR * 2 * kPairs;
+		size_t ir = panel * GEMM_INT8_MR;
+		size_t mr = std::min(GEMM_INT8_MR, M - ir);
+		for (size_t r = 0; r < mr; r++) {
+			const int8_t* row = A + (ir + r) * lda;
+			int16_t* pairs = destination + 2 * r;
+			for (size_t k = 0; k + 1 < K; k += 2, pairs += 2 * GEMM_INT8_MR) {
+				pairs[0] = row[k];
+				pairs[1] = row[k + 1];
+			}
+			if (K % 2)
+				pairs[0] = row[K - 1];
+		}
+	}
+
+	// A B panel is used by every A panel while it's in the cache.
+	for (size_t jr = 0; jr < N; jr += GEMM_INT8_NR) {
+		const int8_t* b = packedB + jr * 2 * kPairs;
+		size_t nr = std::min(GEMM_INT8_NR, N - jr);
+		for (size_t panel = 0; panel < panels; panel++) {
+			size_t ir = panel * GEMM_INT8_MR;
+			kernel(kPairs, packedA.data() + ir * 2 * kPairs, b, C + ir * ldc + jr, ldc,
+				std::min(GEMM_INT8_MR, M - ir), nr);
+		}
+	}
+}
+
+void im2colInt8(
+	int8_t* result, const int8_t* input,
+	size_t depth, size_t rows, size_t cols,
+	size_t kernelRows, size_t kernelCols, size_t stride) {
+
+	size_t r = calcConvParamsAfter(rows, kernelRows, stride);
+	size_t c = calcConvParamsAfter(cols, kernelCols, stride);
+
+	for (size_t k = 0; k < depth; k++) {
+		for (size_t x = 0; x < kernelRows; x++) {
+			for (size_t y = 0; y < kernelCols; y++) {
+				int8_t* column = result + ((k * kernelRows + x) * kernelCols + y) * r * c;
+
+				for (size_t i = 0; i < r; i++) {
+					const int8_t* row = input + (k * rows + i * stride + x) * cols + y;
+					if (stride == 1) {
+						std::memcpy(column + i * c, row, c);
+					}
+					else {
+						for (size_t j = 0; j < c; j++)
+							column[i * c + j] = row[j * stride];
+					}
+				}
+			}
+		}
+	}
+}
+
+#define QUANTIZATION_TEMPLATES(T) \
+	template DRAGON_API T quantizationScale<T>(T); \
+	template DRAGON_API T maxAbs<T>(const T*, size_t); \
+	template DRAGON_API void quantizeValues<T>(int8_t*, const T*, size_t, T); \
+	template DRAGON_API void quantizeRows<T>(BasicQuantizedWeights<T>&, const T*, size_t, size_t);
+DRAGON_INSTANTIATE(QUANTIZATION_TEMPLATES)
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#include "../Core.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "Tensor.h"
+
+/*
+Int8 kernels of the quantized inference.
+The values are stored as int8 with a scale (value = q * scale), the symmetric range [-127, 127] is used,
+so the product of two values fits into int16 and the sums are done in int32.
+An int8 weight moves 8 times less memory than a double one (4 times less than a float), that's the most of the speed up of the
+memory bound layers (the dense layers with small batches).
+*/
+
+DRAGON_BEGIN
+
+// Register tile of the int8 gemm (rows of A x rows of B).
+constexpr size_t GEMM_INT8_MR = 4;
+constexpr size_t GEMM_INT8_NR = 16;
+
+/// <summary>
+/// Int8 weights of a layer, rows (output channels) x cols (the inputs of one output) with a scale per row,
+/// the weight is values[i * cols + j] * scales[i].
+/// inputScale is the scale of the int8 input of the layer, it's measured on calibration samples (Model::quantize).
+/// The biases are kept in T, in planar order.
+/// packed holds the values as the B of gemmInt8 (packInt8), it's filled by quantizeRows and by the loader.
+/// </summary>
+template<class T>
+struct BasicQuantizedWeights {
+	size_t rows = 0;
+	size_t cols = 0;
+	std::vector<int8_t> values;
+	std::vector<int8_t> packed;
+	std::vector<T> scales;
+	std::vector<T> biases;
+	T inputScale = T(1);
+};
+
+using QuantizedWeights = BasicQuantizedWeights<precision>;
+
+// Scale of the int8 values of data with the largest absolute value maxAbs.
+template<class T> DRAGON_API T quantizationScale(T maxAbs);
+// The largest absolute value of the count values.
+template<class T> DRAGON_API T maxAbs(const T* data, size_t count);
+// Round data / scale to the nearest int8, the values out of [-127, 127] are clamped.
+template<class T> DRAGON_API void quantizeValues(int8_t* result, const T* data, size_t count, NonDeduced<T> scale);
+// Quantize the rows x cols matrix with a scale per row into weights (and pack them).
+template<class T> DRAGON_API void quantizeRows(BasicQuantizedWeights<T>& weights, const T* data, size_t rows, size_t cols);
+
+// Pack the N x K matrix op(B) for gemmInt8: panels of GEMM_INT8_NR rows,
+// in every panel the pairs of neighbour K values of the rows follow each other. The edges are zero padded.
+// op(B) is B or the transponant of B (stored K x N) if transB is true, ldb is the row stride of the stored B.
+DRAGON_API void packInt8(std::vector<int8_t>& packed, bool transB, const int8_t* B, size_t N, size_t K, size_t ldb);
+
+// Int8 matrix multiplication with int32 results: C = A * trans(B), B is packed with packInt8.
+// A is M x K, B is N x K and C is M x N, lda and ldc are the row strides.
+// The products are summed in int32, that's exact for K < 133000.
+// A is packed by the call, so the operand that is used more times (the weights of a dense layer) is the B.
+DRAGON_API void gemmInt8(
+	size_t M, size_t N, size_t K,
+	const int8_t* A, size_t lda,
+	const int8_t* packedB,
+	int32_t* C, size_t ldc);
+
+// im2col of the planar int8 input, like im2col: a row for every [input depth][kernel row][kernel col]
+// and a column for every output position.
+DRAGON_API void im2colInt8(
+	int8_t* result, const int8_t* input,
+	size_t depth, size_t rows, size_t cols,
+	size_t kernelRows, size_t kernelCols, size_t stride);
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,248 @@
+#include "Sparse.h"
+
+#include <algorithm>
+
+DRAGON_BEGIN
+
+namespace {
+
+	// Pack the M x K matrix A (row stride lda) into panels of SPARSE_PANEL rows, the missing rows of the last panel are zero.
+	// The panels are packed in groups of at most group panels starting at [first panel * K * SPARSE_PANEL],
+	// in a group of count panels the count * SPARSE_PANEL values of column k follow each other.
+	template<class T>
+	void packPanels(std::vector<T>& packed, const T* A, size_t M, size_t K, size_t lda, size_t group = 1) {
+		size_t panels = (M + SPARSE_PANEL<T> - 1) / SPARSE_PANEL<T>;
+		packed.resize(panels * K * SPARSE_PANEL<T>);
+		for (size_t panel = 0; panel < panels; panel += group) {
+			T* destination = packed.data() + panel * K * SPARSE_PANEL<T>;
+			size_t width = std::min(group, panels - panel) * SPARSE_PANEL<T>;
+			size_t m0 = panel * SPARSE_PANEL<T>;
+			size_t mr = std::min(width, M - m0);
+			for (size_t k = 0; k < K; k++) {
+				for (size_t r = 0; r < mr; r++)
+					destination[k * width + r] = A[(m0 + r) * lda + k];
+				for (size_t r = mr; r < width; r++)
+					destination[k * width + r] = T();
+			}
+		}
+	}
+
+	// The N columns of the K x N matrix A (row stride lda) as rows of paddedK values, the padding is zero.
+	template<class T>
+	void packColumns(std::vector<T>& packed, const T* A, size_t K, size_t N, size_t lda, size_t paddedK) {
+		packed.assign(N * paddedK, T());
+		for (size_t m = 0; m < K; m++) {
+			const T* row = A + m * lda;
+			for (size_t j = 0; j < N; j++)
+				packed[j * paddedK + m] = row[j];
+		}
+	}
+
+	// Sum of the Count values as a tree, so the additions of a level don't wait for each other.
+	template<size_t Count, class T>
+	inline T treeSum(const T* values) {
+		if constexpr (Count == 1) {
+			return values[0];
+		}
+		else {
+			T half[Count / 2];
+			for (size_t r = 0; r < Count / 2; r++)
+				half[r] = values[r] + values[r + Count / 2];
+			return treeSum<Count / 2>(half);
+		}
+	}
+
+	// Panels of the dense operand that a nonzero is used for at once.
+	constexpr size_t SPARSE_GROUP = 2;
+
+	// The i-th row of S times a group of Count panels (packed by packPanels) into sums.
+	// A loaded nonzero is used for every panel, and the panels are independent chains of additions.
+	template<size_t Count, class T>
+	void rowTimesPanels(const BasicCsrMatrix<T>& S, size_t i, const T* a, T* sums) {
+		T local[Count * SPARSE_PANEL<T>] = {};
+		for (size_t k = S.rowStarts[i]; k < S.rowStarts[i + 1]; k++) {
+			T value = S.values[k];
+			const T* column = a + size_t(S.columns[k]) * Count * SPARSE_PANEL<T>;
+			for (size_t r = 0; r < Count * SPARSE_PANEL<T>; r++)
+				local[r] += value * column[r];
+		}
+		std::copy(local, local + Count * SPARSE_PANEL<T>, sums);
+	}
+
+	// C(:, j) += A(:, i) * S(i, j) for the nonzeros of the i-th row of S, on a group of Count panels
+	// of A (K columns) and C (N columns), both packed by packPanels.
+	template<size_t Count, class T>
+	void rowToPanels(const BasicCsrMatrix<T>& S, size_t i, const T* a, T* c) {
+		// A local copy, the compiler knows that the sums don't overwrite it.
+		T column[Count * SPARSE_PANEL<T>];
+		std::copy(a + i * Count * SPARSE_PANEL<T>, a + (i + 1) * Count * SPARSE_PANEL<T>, column);
+		for (size_t k = S.rowStarts[i]; k < S.rowStarts[i + 1]; k++) {
+			T value = S.values[k];
+			T* sums = c + size_t(S.columns[k]) * Count * SPARSE_PANEL<T>;
+			for (size_t r = 0; r < Count * SPARSE_PANEL<T>; r++)
+				sums[r] += value * column[r];
+		}
+	}
+
+	// Write C (N columns, packed like packPanels with the group) into the M x N matrix C.
+	template<class T>
+	void unpackPanels(T* C, size_t ldc, const T* packed, size_t M, size_t N, size_t group) {
+		size_t panels = (M + SPARSE_PANEL<T> - 1) / SPARSE_PANEL<T>;
+		for (size_t panel = 0; panel < panels; panel += group) {
+			const T* source = packed + panel * N * SPARSE_PANEL<T>;
+			size_t width = std::min(group, panels - panel) * SPARSE_PANEL<T>;
+			size_t m0 = panel * SPARSE_PANEL<T>;
+			size_t mr = std::min(width, M - m0);
+			for (size_t r = 0; r < mr; r++) {
+				T* row = C + (m0 + r) * ldc;
+				for (size_t j = 0; j < N; j++)
+					row[j] = source[j * width + r];
+			}
+		}
+	}
+
+}
+
+template<class T>
+void spmv(const BasicCsrMatrix<T>& S, const T* x, T* y, const NonDeduced<BasicEpilogue<T>>* epilogue) {
+	for (size_t i = 0; i < S.rows; i++) {
+		// One sum in the order of the nonzeros, like in rowTimesPanels.
+		T sum = T();
+		for (size_t k = S.rowStarts[i]; k < S.rowStarts[i + 1]; k++)
+			sum += S.values[k] * x[S.columns[k]];
+		y[i] = sum;
+	}
+
+	if (epilogue)
+		applyEpilogue(*epilogue, 1, S.rows, y, S.rows);
+}
+
+template<class T>
+void spmvTrans(const BasicCsrMatrix<T>& S, const T* x, T* y) {
+	std::fill(y, y + S.cols, T());
+	for (size_t i = 0; i < S.rows; i++) {
+		T xi = x[i];
+		if (xi == T())
+			continue;
+		for (size_t k = S.rowStarts[i]; k < S.rowStarts[i + 1]; k++)
+			y[S.columns[k]] += S.values[k] * xi;
+	}
+}
+
+template<class T>
+void spmm(
+	bool transS,
+	size_t M,
+	const T* A, size_t lda,
+	const BasicCsrMatrix<T>& S,
+	T* C, size_t ldc,
+	const NonDeduced<BasicEpilogue<T>>* epilogue) {
+	thread_local std::vector<T> packedA;
+	thread_local std::vector<T> packedC;
+	size_t panels = (M + SPARSE_PANEL<T> - 1) / SPARSE_PANEL<T>;
+	size_t N = transS ? S.rows : S.cols;
+
+	if (transS) {
+		// C(:, i) = A * S(i, :), a sparse row is a weighted sum of the columns of A.
+		// The row of S is used for every panel while it's in the cache.
+		size_t K = S.cols;
+		packPanels(packedA, A, M, K, lda, SPARSE_GROUP);
+		for (size_t i = 0; i < S.rows; i++) {
+			for (size_t panel = 0; panel < panels; panel += SPARSE_GROUP) {
+				const T* a = packedA.data() + panel * K * SPARSE_PANEL<T>;
+				T sums[SPARSE_GROUP * SPARSE_PANEL<T>];
+				if (panels - panel >= SPARSE_GROUP)
+					rowTimesPanels<SPARSE_GROUP>(S, i, a, sums);
+				else
+					rowTimesPanels<1>(S, i, a, sums);
+
+				size_t m0 = panel * SPARSE_PANEL<T>;
+				size_t mr = std::min(SPARSE_GROUP * SPARSE_PANEL<T>, M - m0);
+				for (size_t r = 0; r < mr; r++)
+					C[(m0 + r) * ldc + i] = sums[r];
+			}
+		}
+	}
+	else {
+		// C(:, j) += A(:, i) * S(i, j) for every nonzero, the columns of C are summed in panels too.
+		size_t K = S.rows;
+		packPanels(packedA, A, M, K, lda, SPARSE_GROUP);
+		packedC.assign(panels * N * SPARSE_PANEL<T>, T());
+		for (size_t panel = 0; panel < panels; panel += SPARSE_GROUP) {
+			const T* a = packedA.data() + panel * K * SPARSE_PANEL<T>;
+			T* c = packedC.data() + panel * N * SPARSE_PANEL<T>;
+			for (size_t i = 0; i < K; i++) {
+				if (panels - panel >= SPARSE_GROUP)
+					rowToPanels<SPARSE_GROUP>(S, i, a, c);
+				else
+					rowToPanels<1>(S, i, a, c);
+			}
+		}
+		unpackPanels(C, ldc, packedC.data(), M, N, SPARSE_GROUP);
+	}
+
+	if (epilogue)
+		applyEpilogue(*epilogue, M, N, C, ldc);
+}
+
+template<class T>
+void sparseGer(const BasicCsrMatrix<T>& S, NonDeduced<T> alpha, const T* x, const T* y, T* result) {
+	for (size_t i = 0; i < S.rows; i++) {
+		T xi = alpha * x[i];
+		if (xi == T())
+			continue;
+		for (size_t k = S.rowStarts[i]; k < S.rowStarts[i + 1]; k++)
+			result[k] += xi * y[S.columns[k]];
+	}
+}
+
+template<class T>
+void sparseGradient(
+	const BasicCsrMatrix<T>& S,
+	size_t K,
+	NonDeduced<T> alpha,
+	const T* A, size_t lda,
+	const T* B, size_t ldb,
+	T* result) {
+	// The columns of A and B are stored as rows of K values (padded with zeros), so every nonzero
+	// is a dot product of two contiguous rows.
+	thread_local std::vector<T> columnsA;
+	thread_local std::vector<T> columnsB;
+	size_t paddedK = (K + SPARSE_PANEL<T> - 1) / SPARSE_PANEL<T> * SPARSE_PANEL<T>;
+	packColumns(columnsA, A, K, S.rows, lda, paddedK);
+	packColumns(columnsB, B, K, S.cols, ldb, paddedK);
+
+	for (size_t i = 0; i < S.rows; i++) {
+		const T* a = columnsA.data() + i * paddedK;
+		for (size_t k = S.rowStarts[i]; k < S.rowStarts[i + 1]; k++) {
+			const T* b = columnsB.data() + size_t(S.columns[k]) * paddedK;
+			// The sums are kept for SPARSE_PANEL lanes in two independent chains, they are added together only at the end.
+			T sums0[SPARSE_PANEL<T>] = {};
+			T sums1[SPARSE_PANEL<T>] = {};
+			size_t m = 0;
+			for (; m + 2 * SPARSE_PANEL<T> <= paddedK; m += 2 * SPARSE_PANEL<T>) {
+				for (size_t r = 0; r < SPARSE_PANEL<T>; r++) {
+					sums0[r] += a[m + r] * b[m + r];
+					sums1[r] += a[m + SPARSE_PANEL<T> + r] * b[m + SPARSE_PANEL<T> + r];
+				}
+			}
+			if (m < paddedK) {
+				for (size_t r = 0; r < SPARSE_PANEL<T>; r++)
+					sums0[r] += a[m + r] * b[m + r];
+			}
+			for (size_t r = 0; r < SPARSE_PANEL<T>; r++)
+				sums0[r] += sums1[r];
+			result[k] += alpha * treeSum<SPARSE_PANEL<T>>(sums0);
+		}
+	}
+}
+
+#define SPARSE_TEMPLATES(T) \
+	template DRAGON_API void spmv<T>(const BasicCsrMatrix<T>&, const T*, T*, const BasicEpilogue<T>*); \
+	template DRAGON_API void spmvTrans<T>(const BasicCsrMatrix<T>&, const T*, T*); \
+	template DRAGON_API void spmm<T>(bool, size_t, const T*, size_t, const BasicCsrMatrix<T>&, T*, size_t, const BasicEpilogue<T>*); \
+	template DRAGON_API void sparseGer<T>(const BasicCsrMatrix<T>&, T, const T*, const T*, T*); \
+	template DRAGON_API void sparseGradient<T>(const BasicCsrMatrix<T>&, size_t, T, const T*, size_t, const T*, size_t, T*);
+DRAGON_INSTANTIATE(SPARSE_TEMPLATES)
+
+DRAGON_END
\ No newline at end of file
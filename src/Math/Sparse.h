@@ -0,0 +1,73 @@
+#pragma once
+#include "../Core.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "Tensor.h"
+#include "LinearAlgebra.h"
+
+/*
+Kernels of sparse matrices in compressed sparse row (CSR) format, for the pruned layers.
+Only the nonzeros are stored and multiplied, so at 90% sparsity a product reads about a tenth of the weights.
+The dense operand of the matrix products is packed into panels of SPARSE_PANEL rows first,
+so every nonzero multiplies SPARSE_PANEL neighbour values, and the inner loops are contiguous.
+*/
+
+DRAGON_BEGIN
+
+// Rows of the dense operand that a nonzero is multiplied with at once, the width of two SIMD registers.
+template<class T>
+constexpr size_t SPARSE_PANEL = 64 / sizeof(T);
+
+/// <summary>
+/// Rows x cols sparse matrix in compressed sparse row (CSR) format, it only points to the arrays.
+/// The nonzeros of the i-th row are values[rowStarts[i]] ... values[rowStarts[i + 1] - 1],
+/// columns holds their column indices, in increasing order in every row. rowStarts has rows + 1 elements.
+/// </summary>
+template<class T>
+struct BasicCsrMatrix {
+	size_t rows = 0;
+	size_t cols = 0;
+	const size_t* rowStarts = nullptr;
+	const uint32_t* columns = nullptr;
+	const T* values = nullptr;
+};
+
+using CsrMatrix = BasicCsrMatrix<precision>;
+
+// Sparse matrix vector multiplication: y = S * x, x has S.cols and y has S.rows elements.
+// The epilogue (if not null) is run on y as a 1 x rows matrix.
+// The nonzeros are summed in the order of spmm, so y is bitwise the same as a row of spmm(true, ...).
+template<class T> DRAGON_API void spmv(const BasicCsrMatrix<T>& S, const T* x, T* y, const NonDeduced<BasicEpilogue<T>>* epilogue = nullptr);
+
+// Transponant sparse matrix vector multiplication: y = trans(S) * x, x has S.rows and y has S.cols elements.
+template<class T> DRAGON_API void spmvTrans(const BasicCsrMatrix<T>& S, const T* x, T* y);
+
+// Dense times sparse matrix multiplication: C = A * op(S), op(S) is S or the transponant of S if transS is true.
+// A is M x K with row stride lda, op(S) is K x N and C is M x N with row stride ldc. C is not read.
+// The epilogue (if not null) is run on C after the product.
+template<class T> DRAGON_API void spmm(
+	bool transS,
+	size_t M,
+	const T* A, size_t lda,
+	const BasicCsrMatrix<T>& S,
+	T* C, size_t ldc,
+	const NonDeduced<BasicEpilogue<T>>* epilogue = nullptr);
+
+// Rank-1 update of the nonzeros of S: result[k] += alpha * x[i] * y[j] for the k-th nonzero at (i, j).
+// result has a value for every nonzero (like S.values), x has S.rows and y has S.cols elements.
+template<class T> DRAGON_API void sparseGer(const BasicCsrMatrix<T>& S, NonDeduced<T> alpha, const T* x, const T* y, T* result);
+
+// The product trans(A) * B only at the nonzeros of S: result[k] += alpha * (trans(A) * B)(i, j) for the k-th nonzero at (i, j).
+// A is K x S.rows and B is K x S.cols with row strides lda and ldb. It's the weight gradient of a sparse layer,
+// the dense gradient matrix is never built.
+template<class T> DRAGON_API void sparseGradient(
+	const BasicCsrMatrix<T>& S,
+	size_t K,
+	NonDeduced<T> alpha,
+	const T* A, size_t lda,
+	const T* B, size_t ldb,
+	T* result);
+
+DRAGON_END
\ No newline at end of file
@@ -1,125 +1,168 @@
 #include "Tensor.h"
+#include "Elementwise.h"
+
+#include <cstdint>
+#include <new>
+#include <utility>
 
 DRAGON_BEGIN
 
-Tensor::Tensor(precision* assignPointer, bool watcher /* = false*/) :
-	m_Data(assignPointer), m_Watcher(watcher) { }
+template<class T>
+BasicTensor<T>::BasicTensor(precision* assignPointer, bool watcher /* = false*/) :
+	m_Data(assignPointer), m_Watcher(watcher) {
+	// A new[] buffer would be freed with the aligned delete, most of them are caught by their alignment.
+	assert((watcher || reinterpret_cast<uintptr_t>(assignPointer) % DATA_ALIGNMENT == 0) &&
+		"An owned pointer has to be allocated with Tensor::allocateData!");
+}
+
+template<class T>
+void BasicTensor<T>::watch(precision* data) {
+	_clear();
+	m_Data = data;
+	m_Watcher = true;
+}
 
-Tensor::Tensor(const precision* copyPointer, size_t count) {
+template<class T>
+BasicTensor<T>::BasicTensor(const precision* copyPointer, size_t count) {
 	_copy(copyPointer, count);
 }
 
-Tensor::Tensor(const Tensor& other) {
+template<class T>
+BasicTensor<T>::BasicTensor(const Tensor& other) {
 	_copy(other.m_Data, other.getCount());
 }
 
-Tensor::Tensor(Tensor&& other) noexcept :
+template<class T>
+BasicTensor<T>::BasicTensor(Tensor&& other) noexcept :
 	m_Data(other.m_Data), m_Watcher(other.m_Watcher) {
 	other.m_Data = nullptr;
 	other.m_Watcher = false;
 	//other._deleteParams();
 }
 
-Tensor::~Tensor() {
+template<class T>
+BasicTensor<T>::~BasicTensor() {
 	_clear();
 }
 
-Tensor::Tensor(size_t count, precision value) {
+template<class T>
+BasicTensor<T>::BasicTensor(size_t count, precision value) {
 	_allocate(count);
-	for (size_t i = 0; i < count; i++)
-		m_Data[i] = value;
-	//memcpy(m_Data, &value, count * sizeof(precision));
+	kernel::fill(m_Data, value, count);
 }
 
-void Tensor::_clear() {
+template<class T>
+T* BasicTensor<T>::allocateData(size_t count) {
+	return static_cast<precision*>(
+		::operator new[](count * sizeof(precision), std::align_val_t(DATA_ALIGNMENT)));
+}
+
+template<class T>
+void BasicTensor<T>::freeData(precision* data) {
+	::operator delete[](data, std::align_val_t(DATA_ALIGNMENT));
+}
+
+template<class T>
+void BasicTensor<T>::_clear() {
 	if (m_Data && !m_Watcher)
-		delete[] m_Data;
+		freeData(m_Data);
 }
 
-void Tensor::_copy(const precision* other, size_t count) {
+template<class T>
+void BasicTensor<T>::_copy(const precision* other, size_t count) {
 	_allocate(count);
-	for (size_t i = 0; i < count; i++)
-		m_Data[i] = other[i];
+	kernel::copy(m_Data, other, count);
 }
 
-void Tensor::_allocate() {
-	assert((m_Watcher == false) && "You can't allocate memory in a watcher tensor!");
+template<class T>
+void BasicTensor<T>::_allocate() {
 	_clear();
-	m_Data = new precision[getCount()];
+	m_Watcher = false;
+	m_Data = allocateData(getCount());
 }
 
-void Tensor::_allocate(size_t count) {
-	assert((m_Watcher == false) && "You can't allocate memory in a watcher tensor!");
+template<class T>
+void BasicTensor<T>::_allocate(size_t count) {
 	_clear();
-	m_Data = new precision[count];
+	m_Watcher = false;
+	m_Data = allocateData(count);
 }
 
-void Tensor::_swap(precision*&& data) {
-	assert((m_Watcher == false) && "You can't swap in a watcher tensor!");
-	precision* temp = m_Data;
-	m_Data = data;
-	data = temp;
+template<class T>
+void BasicTensor<T>::_swap(Tensor& other) {
+	std::swap(m_Data, other.m_Data);
+	std::swap(m_Watcher, other.m_Watcher);
 }
 
-void Tensor::_deleteParams() { }
+template<class T>
+void BasicTensor<T>::_deleteParams() { }
 
-Tensor& Tensor::add(const Tensor& other) {
+template<class T>
+BasicTensor<T>& BasicTensor<T>::add(const Tensor& other) {
 	assert((getCount() == other.getCount()) && "Parameter count not match!");
-		for (size_t i = 0; i < getCount(); i++)
-			m_Data[i] += other.m_Data[i];
+	assert((getLayout() == other.getLayout()) && "Parameter layout not match!");
+	kernel::add(m_Data, other.m_Data, getCount());
 	return *this;
 }
 
-Tensor& Tensor::sub(const Tensor& other) {
+template<class T>
+BasicTensor<T>& BasicTensor<T>::sub(const Tensor& other) {
 	assert((getCount() == other.getCount()) && "Parameter count not match!");
-	for (size_t i = 0; i < getCount(); i++)
-			m_Data[i] -= other.m_Data[i];
+	assert((getLayout() == other.getLayout()) && "Parameter layout not match!");
+	kernel::sub(m_Data, other.m_Data, getCount());
 	return *this;
 }
 
-Tensor& Tensor::mult(const Tensor& other) {
+template<class T>
+BasicTensor<T>& BasicTensor<T>::mult(const Tensor& other) {
 	assert((getCount() == other.getCount()) && "Parameter count not match!");
-		for (size_t i = 0; i < getCount(); i++)
-			m_Data[i] *= other.m_Data[i];
+	assert((getLayout() == other.getLayout()) && "Parameter layout not match!");
+	kernel::mult(m_Data, other.m_Data, getCount());
 	return *this;
 }
 
-Tensor& Tensor::div(const Tensor& other) {
+template<class T>
+BasicTensor<T>& BasicTensor<T>::div(const Tensor& other) {
 	assert((getCount() == other.getCount()) && "Parameter count not match!");
-	for (size_t i = 0; i < getCount(); i++)
-			m_Data[i] /= other.m_Data[i];
+	assert((getLayout() == other.getLayout()) && "Parameter layout not match!");
+	kernel::div(m_Data, other.m_Data, getCount());
 	return *this;
 }
 
-Tensor& Tensor::add(precision value) {
-	for (size_t i = 0; i < getCount(); i++)
-		m_Data[i] += value;
+template<class T>
+BasicTensor<T>& BasicTensor<T>::add(precision value) {
+	kernel::add(m_Data, value, getCount());
 	return *this;
 }
 
-Tensor& Tensor::sub(precision value) {
-	for (size_t i = 0; i < getCount(); i++)
-		m_Data[i] -= value;
+template<class T>
+BasicTensor<T>& BasicTensor<T>::sub(precision value) {
+	kernel::sub(m_Data, value, getCount());
 	return *this;
 }
 
-Tensor& Tensor::mult(precision value) {
-	for (size_t i = 0; i < getCount(); i++)
-		m_Data[i] *= value;
+template<class T>
+BasicTensor<T>& BasicTensor<T>::mult(precision value) {
+	kernel::mult(m_Data, value, getCount());
 	return *this;
 }
 
-Tensor& Tensor::div(precision value) {
-	for (size_t i = 0; i < getCount(); i++)
-		m_Data[i] /= value;
+template<class T>
+BasicTensor<T>& BasicTensor<T>::div(precision value) {
+	kernel::div(m_Data, value, getCount());
 	return *this;
 }
 
-Tensor& Tensor::manipul(const std::function<void(precision&)>& function) {
-	for (size_t i = 0; i < getCount(); i++)
+template<class T>
+BasicTensor<T>& BasicTensor<T>::manipul(const std::function<void(precision&)>& function) {
+	size_t count = getCount();
+	for (size_t i = 0; i < count; i++)
 		function(m_Data[i]);
 
 	return *this;
 }
 
+template class DRAGON_API BasicTensor<float>;
+template class DRAGON_API BasicTensor<double>;
+
 DRAGON_END
\ No newline at end of file
@@ -9,42 +9,96 @@
 Base class for the tensor objects
 */
 
-#ifndef precision
-#define precision double
-#endif // !precision
-
 DRAGON_BEGIN
 
+// The tensors, the kernels, the layers and the models are templates of the element type (BasicTensor2D<T>, BasicModel<T>, ...),
+// the library is built for float and double, so float and double models can be used side by side.
+// The names without Basic (Tensor2D, DenseLayer, Model, ...) are the types with the default element type precision,
+// that is float if DRAGON_FLOAT32 is defined and double otherwise.
+// Float halves the memory of the models and the kernels process twice as many values per instruction.
+// [example] BasicModel<float> fast; Model exact;
+#ifdef DRAGON_FLOAT32
+using precision = float;
+#else
+using precision = double;
+#endif
+
+// T in a parameter that is not used to deduce T, so the argument can be anything that converts to T.
+// [example] kernel::fill(data, 0.0, count) fills float data too.
+template<class T> struct NonDeducedType { using Type = T; };
+template<class T> using NonDeduced = typename NonDeducedType<T>::Type;
+
+template<class T> class BasicTensor;
+template<class T> class BasicTensor1D;
+template<class T> class BasicTensor2D;
+template<class T> class BasicTensor3D;
+
+// The names of the tensor types with the element type T inside a class template,
+// so the members are written the same way as the code using the default types.
+#define DRAGON_TENSOR_TYPES(T) \
+	using precision = T; \
+	using Tensor = BasicTensor<T>; \
+	using Tensor1D = BasicTensor1D<T>; \
+	using Tensor2D = BasicTensor2D<T>; \
+	using Tensor3D = BasicTensor3D<T>;
+
+// Memory order of the values of a Tensor3D, the other tensors are always planar.
+enum class Layout {
+	Planar,			// [depth][rows][cols], every depth is a contiguous matrix.
+	ChannelsLast,	// [rows][cols][depth], the depths of a position are next to each other.
+	Blocked			// [depth / CHANNEL_BLOCK][rows][cols][CHANNEL_BLOCK], the depth is padded to whole blocks.
+};
+
 /// <summary>
 /// Tensor class is the base class for all types of tensor,
 /// types like 2D or 3D or higher, these types only needs to care about the data layout.
-/// Has a member variable a pointer to precision data array, 
+/// Has a member variable a pointer to the data array of T elements, 
 /// and a bool if the object is just a watcher.
 /// Basic methods are manipulations. (Add, subbtract, multiply, divide, lambda funciton)
 /// these are element wise operations.
 ///	If the m_Watcher member(bool) is false the tensor works the same, but if its ture
 /// the Tensor destuctor wont delete the pointer.
 /// </summary>
-class DRAGON_API Tensor {
+template<class T>
+class BasicTensor {
 public:
-	Tensor() = default;
-	virtual ~Tensor();
-	Tensor(const Tensor& other);
-	Tensor(Tensor&& other) noexcept;
+	DRAGON_TENSOR_TYPES(T)
 
-	Tensor(size_t count, precision value);
-	Tensor(const precision* copyPointer, size_t count);
+	BasicTensor() = default;
+	virtual ~BasicTensor();
+	BasicTensor(const Tensor& other);
+	BasicTensor(Tensor&& other) noexcept;
+
+	BasicTensor(size_t count, precision value);
+	BasicTensor(const precision* copyPointer, size_t count);
 
 public:
 	// For watcher classes
 	// Get the pointer from the watcher tensor getData function and use bool wathcer as true
 	// than cast this Tensor to the tensor type where you get the data
 	// [example] Tensor2D watcher = Tensor2D(3, 3, Tensor(aTensor3DType.getData() + offset, true));
-	Tensor(precision* assignPointer, bool watcher = false);
+	// If the tensor is not a watcher it takes the ownership of the pointer,
+	// than the pointer has to be allocated with Tensor::allocateData (not with new[]), debug builds check its alignment.
+	BasicTensor(precision* assignPointer, bool watcher = false);
+	// Make the tensor a watcher of data, that has to hold getCount elements. The owned data is freed.
+	// [example] The parameters of a model loaded from a binary file watch the mapped file.
+	void watch(precision* data);
+
+public:
+	// Allocate memory for count elements aligned to DATA_ALIGNMENT bytes, the elements hold junk.
+	// Every buffer that is given to a tensor with ownership has to be allocated with this function.
+	static precision* allocateData(size_t count);
+	// Free the memory allocated by allocateData.
+	static void freeData(precision* data);
+
+	// Alignment of the tensor data in bytes (the width of an AVX-512 register and a cache line).
+	static constexpr size_t DATA_ALIGNMENT = 64;
 	
 public:
 	// Rerturns the number of elements that the tensor store.
 	virtual size_t getCount() const { assert((false) && "Never use this function in this type!"); return 0; };
+	// Memory order of the values, the elementwise operations need the same layout on both sides.
+	virtual Layout getLayout() const { return Layout::Planar; }
 
 public:
 
@@ -58,7 +112,7 @@ public:
 	Tensor& div(precision value);
 
 	// Apply the function to every element of the tensor.
-	// The function is void and takes a precision reference as parameter(the tensor element).
+	// The function is void and takes an element reference as parameter(the tensor element).
 	Tensor& manipul(const std::function<void(precision&)>& function);
 
 public:
@@ -72,7 +126,8 @@ protected:
 	void _copy(const precision* other, size_t count);
 	void _allocate();
 	void _allocate(size_t count);
-	void _swap(precision*&& data);
+	// Swap the data and the watcher flags, so a moved watcher never frees the memory it watches.
+	void _swap(Tensor& other);
 	virtual void _deleteParams();
 protected:
 	precision* m_Data = nullptr;
@@ -84,4 +139,9 @@ protected:
 
 };
 
+extern template class DRAGON_API BasicTensor<float>;
+extern template class DRAGON_API BasicTensor<double>;
+
+using Tensor = BasicTensor<precision>;
+
 DRAGON_END
\ No newline at end of file
@@ -2,48 +2,60 @@
 
 DRAGON_BEGIN
 
-Tensor1D::Tensor1D() { }
+template<class T>
+BasicTensor1D<T>::BasicTensor1D() { }
 
-Tensor1D::Tensor1D(const Tensor1D& other) :
+template<class T>
+BasicTensor1D<T>::BasicTensor1D(const Tensor1D& other) :
 	m_Cols(other.m_Cols), Tensor(other) { }
 
-Tensor1D::Tensor1D(Tensor1D&& other) noexcept :
+template<class T>
+BasicTensor1D<T>::BasicTensor1D(Tensor1D&& other) noexcept :
 	m_Cols(other.m_Cols), Tensor(std::move(other)) { }
 
-Tensor1D* Tensor1D::operator=(const Tensor1D& other) {
+template<class T>
+BasicTensor1D<T>* BasicTensor1D<T>::operator=(const Tensor1D& other) {
 	m_Cols = other.m_Cols;
 	_copy(other.m_Data, getCount());
 	return this;
 }
 
-Tensor1D* Tensor1D::operator=(Tensor1D&& other) noexcept {
+template<class T>
+BasicTensor1D<T>* BasicTensor1D<T>::operator=(Tensor1D&& other) noexcept {
 	std::swap(m_Cols, other.m_Cols);
-	_swap(std::move(other.m_Data));
+	_swap(other);
 	return this;
 }
 
-Tensor1D::~Tensor1D() { }
+template<class T>
+BasicTensor1D<T>::~BasicTensor1D() { }
 
-Tensor1D::Tensor1D(size_t cols, precision value) :
+template<class T>
+BasicTensor1D<T>::BasicTensor1D(size_t cols, precision value) :
 	m_Cols(cols), Tensor(cols, value) { }
 
-Tensor1D::Tensor1D(size_t cols, const precision* copyPointer) :
+template<class T>
+BasicTensor1D<T>::BasicTensor1D(size_t cols, const precision* copyPointer) :
 	m_Cols(cols), Tensor(copyPointer, cols) { }
 
-Tensor1D::Tensor1D(precision* assignPointer, size_t cols) :
+template<class T>
+BasicTensor1D<T>::BasicTensor1D(precision* assignPointer, size_t cols) :
 	m_Cols(cols), Tensor(assignPointer) { }
 
-Tensor1D::Tensor1D(size_t cols, Tensor&& dataTensor) :
+template<class T>
+BasicTensor1D<T>::BasicTensor1D(size_t cols, Tensor&& dataTensor) :
 	m_Cols(cols), Tensor(std::move(dataTensor)) { }
 
-Tensor1D::Tensor1D(size_t cols, const Tensor& dataTensor) :
+template<class T>
+BasicTensor1D<T>::BasicTensor1D(size_t cols, const Tensor& dataTensor) :
 	m_Cols(cols), Tensor(dataTensor) {
 	assert((getCount() == dataTensor.getCount()) && "Parameter count not match!");
 }
 
-Tensor1D::Tensor1D(const std::initializer_list<precision>& initList) :
+template<class T>
+BasicTensor1D<T>::BasicTensor1D(const std::initializer_list<precision>& initList) :
 	m_Cols(initList.size()) {
-	m_Data = new precision[m_Cols];
+	m_Data = allocateData(m_Cols);
 	auto it = initList.begin();
 	for (size_t i = 0; i < m_Cols; i++) {
 		m_Data[i] = *it;
@@ -51,6 +63,10 @@ Tensor1D::Tensor1D(const std::initializer_list<precision>& initList) :
 	}
 }
 
-void Tensor1D::_deleteParams() { m_Cols = 0; }
+template<class T>
+void BasicTensor1D<T>::_deleteParams() { m_Cols = 0; }
+
+template class DRAGON_API BasicTensor1D<float>;
+template class DRAGON_API BasicTensor1D<double>;
 
 DRAGON_END
\ No newline at end of file
@@ -9,24 +9,32 @@ DRAGON_BEGIN
 /// This is basicly a mathematical Vector.
 /// Member variables is columns.
 /// </summary>
-class DRAGON_API Tensor1D : public Tensor {
+template<class T>
+class BasicTensor1D : public BasicTensor<T> {
+public:
+	DRAGON_TENSOR_TYPES(T)
+
 protected:
+	using Tensor::m_Data;
+	using Tensor::allocateData;
+	using Tensor::_copy;
+	using Tensor::_swap;
 	size_t m_Cols = 0;
 
 public:
-	Tensor1D();
-	Tensor1D(const Tensor1D& other);
-	Tensor1D(Tensor1D&& other) noexcept;
+	BasicTensor1D();
+	BasicTensor1D(const Tensor1D& other);
+	BasicTensor1D(Tensor1D&& other) noexcept;
 	Tensor1D* operator=(const Tensor1D& other);
 	Tensor1D* operator=(Tensor1D&& other) noexcept;
-	~Tensor1D();
+	~BasicTensor1D();
 
-	Tensor1D(const std::initializer_list<precision>& initList);
-	Tensor1D(size_t cols, precision value);
-	Tensor1D(size_t cols, const precision* copyPointer);
-	Tensor1D(precision* assignPointer, size_t cols);
-	Tensor1D(size_t cols, Tensor&& dataTensor);
-	Tensor1D(size_t cols, const Tensor& dataTensor);
+	BasicTensor1D(const std::initializer_list<precision>& initList);
+	BasicTensor1D(size_t cols, precision value);
+	BasicTensor1D(size_t cols, const precision* copyPointer);
+	BasicTensor1D(precision* assignPointer, size_t cols);
+	BasicTensor1D(size_t cols, Tensor&& dataTensor);
+	BasicTensor1D(size_t cols, const Tensor& dataTensor);
 
 
 	inline size_t getCount() const override { return m_Cols; }
@@ -40,4 +48,9 @@ public:
 	inline precision& at(size_t i) { return m_Data[i]; }
 };
 
+extern template class DRAGON_API BasicTensor1D<float>;
+extern template class DRAGON_API BasicTensor1D<double>;
+
+using Tensor1D = BasicTensor1D<precision>;
+
 DRAGON_END
\ No newline at end of file
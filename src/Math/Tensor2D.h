@@ -10,24 +10,32 @@ DRAGON_BEGIN
 /// This class is good for 2D signal and image processing (in a toy sense).
 /// Member variables are the rows and columns.
 /// </summary>
-class DRAGON_API Tensor2D : public Tensor {
+template<class T>
+class BasicTensor2D : public BasicTensor<T> {
+public:
+	DRAGON_TENSOR_TYPES(T)
+
 protected:
+	using Tensor::m_Data;
+	using Tensor::allocateData;
+	using Tensor::_copy;
+	using Tensor::_swap;
 	size_t m_Rows = 0;
 	size_t m_Cols = 0;
 
 public:
-	Tensor2D();
-	Tensor2D(const Tensor2D& other);
-	Tensor2D(Tensor2D&& other) noexcept;
+	BasicTensor2D();
+	BasicTensor2D(const Tensor2D& other);
+	BasicTensor2D(Tensor2D&& other) noexcept;
 	Tensor2D* operator=(const Tensor2D& other);
 	Tensor2D* operator=(Tensor2D&& other) noexcept;
-	~Tensor2D();
+	~BasicTensor2D();
 
-	Tensor2D(size_t rows, size_t cols, precision value);
-	Tensor2D(size_t rows, size_t cols, const precision* copyPointer);
-	Tensor2D(precision* assignPointer, size_t rows, size_t cols);
-	Tensor2D(size_t rows, size_t cols, Tensor&& dataTensor);
-	Tensor2D(size_t rows, size_t cols, const Tensor& dataTensor);
+	BasicTensor2D(size_t rows, size_t cols, precision value);
+	BasicTensor2D(size_t rows, size_t cols, const precision* copyPointer);
+	BasicTensor2D(precision* assignPointer, size_t rows, size_t cols);
+	BasicTensor2D(size_t rows, size_t cols, Tensor&& dataTensor);
+	BasicTensor2D(size_t rows, size_t cols, const Tensor& dataTensor);
 
 	inline size_t getCount() const override { return m_Rows * m_Cols; }
 
@@ -42,4 +50,9 @@ public:
 	inline precision& at(size_t i, size_t j) { return m_Data[i * m_Cols + j]; }
 };
 
+extern template class DRAGON_API BasicTensor2D<float>;
+extern template class DRAGON_API BasicTensor2D<double>;
+
+using Tensor2D = BasicTensor2D<precision>;
+
 DRAGON_END
\ No newline at end of file
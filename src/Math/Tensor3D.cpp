@@ -1,50 +1,98 @@
 #include "Tensor3D.h"
+#include "Elementwise.h"
 
 DRAGON_BEGIN
 
-Tensor3D::Tensor3D() { }
+template<class T>
+void convertLayout(
+	const T* source, Layout sourceLayout,
+	T* destination, Layout destinationLayout,
+	size_t depth, size_t rows, size_t cols) {
+	if (sourceLayout == destinationLayout) {
+		kernel::copy(destination, source, layoutCount<T>(sourceLayout, depth, rows, cols));
+		return;
+	}
+	if (destinationLayout == Layout::Blocked && depth % CHANNEL_BLOCK<T> != 0)
+		kernel::fill(destination, T(), layoutCount<T>(Layout::Blocked, depth, rows, cols));
 
-Tensor3D::Tensor3D(const Tensor3D& other) :
-	m_Depth(other.m_Depth), m_Rows(other.m_Rows), m_Cols(other.m_Cols), Tensor(other) { }
+	// The destination is written in its own order, the source is gathered.
+	for (size_t k = 0; k < depth; k++)
+		for (size_t i = 0; i < rows; i++)
+			for (size_t j = 0; j < cols; j++)
+				destination[layoutOffset<T>(destinationLayout, depth, rows, cols, i, j, k)] =
+					source[layoutOffset<T>(sourceLayout, depth, rows, cols, i, j, k)];
+}
+
+
+template<class T>
+BasicTensor3D<T>::BasicTensor3D() { }
+
+template<class T>
+BasicTensor3D<T>::BasicTensor3D(const Tensor3D& other) :
+	Tensor(other), m_Depth(other.m_Depth), m_Rows(other.m_Rows), m_Cols(other.m_Cols), m_Layout(other.m_Layout) { }
 
-Tensor3D::Tensor3D(Tensor3D&& other) noexcept :
-	m_Depth(other.m_Depth), m_Rows(other.m_Rows), m_Cols(other.m_Cols), Tensor(std::move(other)) { }
+template<class T>
+BasicTensor3D<T>::BasicTensor3D(Tensor3D&& other) noexcept :
+	Tensor(std::move(other)), m_Depth(other.m_Depth), m_Rows(other.m_Rows), m_Cols(other.m_Cols), m_Layout(other.m_Layout) { }
 
-Tensor3D* Tensor3D::operator=(const Tensor3D& other) {
+template<class T>
+BasicTensor3D<T>* BasicTensor3D<T>::operator=(const Tensor3D& other) {
 	m_Depth = other.m_Depth;
 	m_Rows = other.m_Rows;
 	m_Cols = other.m_Cols;
+	m_Layout = other.m_Layout;
 	_copy(other.m_Data, getCount());
 	return this;
 }
 
-Tensor3D* Tensor3D::operator=(Tensor3D&& other) noexcept {
+template<class T>
+BasicTensor3D<T>* BasicTensor3D<T>::operator=(Tensor3D&& other) noexcept {
 	std::swap(m_Depth, other.m_Depth);
 	std::swap(m_Rows, other.m_Rows);
 	std::swap(m_Cols, other.m_Cols);
-	_swap(std::move(other.m_Data));
+	std::swap(m_Layout, other.m_Layout);
+	_swap(other);
 	return this;
 }
 
-Tensor3D::~Tensor3D() { }
+template<class T>
+BasicTensor3D<T>::~BasicTensor3D() { }
 
-Tensor3D::Tensor3D(size_t depth, size_t rows, size_t cols, precision value) :
-	m_Depth(depth), m_Rows(rows), m_Cols(cols), Tensor(depth * rows* cols, value) { }
+template<class T>
+BasicTensor3D<T>::BasicTensor3D(size_t depth, size_t rows, size_t cols, precision value, Layout layout /* = Layout::Planar*/) :
+	Tensor(layoutCount<T>(layout, depth, rows, cols), value), m_Depth(depth), m_Rows(rows), m_Cols(cols), m_Layout(layout) { }
 
-Tensor3D::Tensor3D(size_t depth, size_t rows, size_t cols, const precision* copyPointer) :
-	m_Depth(depth), m_Rows(rows), m_Cols(cols), Tensor(copyPointer, rows* cols) { }
+template<class T>
+BasicTensor3D<T>::BasicTensor3D(size_t depth, size_t rows, size_t cols, const precision* copyPointer, Layout layout /* = Layout::Planar*/) :
+	Tensor(copyPointer, layoutCount<T>(layout, depth, rows, cols)), m_Depth(depth), m_Rows(rows), m_Cols(cols), m_Layout(layout) { }
 
-Tensor3D::Tensor3D(precision* assignPointer, size_t depth, size_t rows, size_t cols) :
-	m_Depth(depth), m_Rows(rows), m_Cols(cols), Tensor(assignPointer) { }
+template<class T>
+BasicTensor3D<T>::BasicTensor3D(precision* assignPointer, size_t depth, size_t rows, size_t cols, Layout layout /* = Layout::Planar*/) :
+	Tensor(assignPointer), m_Depth(depth), m_Rows(rows), m_Cols(cols), m_Layout(layout) { }
 
-Tensor3D::Tensor3D(size_t depth, size_t rows, size_t cols, Tensor&& dataTensor) :
-	m_Depth(depth), m_Rows(rows), m_Cols(cols), Tensor(std::move(dataTensor)) { }
+template<class T>
+BasicTensor3D<T>::BasicTensor3D(size_t depth, size_t rows, size_t cols, Tensor&& dataTensor, Layout layout /* = Layout::Planar*/) :
+	Tensor(std::move(dataTensor)), m_Depth(depth), m_Rows(rows), m_Cols(cols), m_Layout(layout) { }
 
-Tensor3D::Tensor3D(size_t depth, size_t rows, size_t cols, const Tensor& dataTensor) :
-	m_Depth(depth), m_Rows(rows), m_Cols(cols), Tensor(dataTensor) {
+template<class T>
+BasicTensor3D<T>::BasicTensor3D(size_t depth, size_t rows, size_t cols, const Tensor& dataTensor, Layout layout /* = Layout::Planar*/) :
+	Tensor(dataTensor), m_Depth(depth), m_Rows(rows), m_Cols(cols), m_Layout(layout) {
 	assert((getCount() == dataTensor.getCount()) && "Parameter count not match!");
 }
 
-void Tensor3D::_deleteParams() { m_Depth = 0; m_Rows = 0; m_Cols = 0; }
+template<class T>
+BasicTensor3D<T> BasicTensor3D<T>::toLayout(Layout layout) const {
+	Tensor3D result(Tensor::allocateData(layoutCount<T>(layout, m_Depth, m_Rows, m_Cols)), m_Depth, m_Rows, m_Cols, layout);
+	convertLayout(m_Data, m_Layout, result.m_Data, layout, m_Depth, m_Rows, m_Cols);
+	return result;
+}
+
+template<class T>
+void BasicTensor3D<T>::_deleteParams() { m_Depth = 0; m_Rows = 0; m_Cols = 0; m_Layout = Layout::Planar; }
+
+#define TENSOR3D_TEMPLATES(T) \
+	template class DRAGON_API BasicTensor3D<T>; \
+	template DRAGON_API void convertLayout(const T*, Layout, T*, Layout, size_t, size_t, size_t);
+DRAGON_INSTANTIATE(TENSOR3D_TEMPLATES)
 
 DRAGON_END
\ No newline at end of file
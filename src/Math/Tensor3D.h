@@ -4,33 +4,77 @@
 
 DRAGON_BEGIN
 
+// Depths in one block of the blocked layout, the values of a block fill one AVX-512 register.
+template<class T = precision>
+constexpr size_t CHANNEL_BLOCK = 64 / sizeof(T);
+
+// The depth rounded up to whole channel blocks of T values.
+template<class T = precision>
+inline size_t blockedDepth(size_t depth) { return (depth + CHANNEL_BLOCK<T> - 1) / CHANNEL_BLOCK<T> * CHANNEL_BLOCK<T>; }
+
+// Number of stored values of depth x rows x cols data of T values, the blocked layout stores the padding too.
+template<class T = precision>
+inline size_t layoutCount(Layout layout, size_t depth, size_t rows, size_t cols) {
+	return (layout == Layout::Blocked ? blockedDepth<T>(depth) : depth) * rows * cols;
+}
+
+// Position of the value at row i, col j and depth k in depth x rows x cols data of T values.
+template<class T = precision>
+inline size_t layoutOffset(Layout layout, size_t depth, size_t rows, size_t cols, size_t i, size_t j, size_t k) {
+	switch (layout) {
+	case Layout::ChannelsLast:
+		return (i * cols + j) * depth + k;
+	case Layout::Blocked:
+		return ((k / CHANNEL_BLOCK<T> * rows + i) * cols + j) * CHANNEL_BLOCK<T> + k % CHANNEL_BLOCK<T>;
+	default:
+		return (k * rows + i) * cols + j;
+	}
+}
+
+// Copy depth x rows x cols values from one layout to an other, the padding of the blocked layout is filled with zeros.
+// The source and the destination can't overlap.
+template<class T>
+DRAGON_API void convertLayout(
+	const T* source, Layout sourceLayout,
+	T* destination, Layout destinationLayout,
+	size_t depth, size_t rows, size_t cols);
+
 /// <summary>
 /// Derived class from Tensor.
 /// Create a 3D Grid like container, Voxel.
 /// This class is good for 3D signal and voxel processing (in a toy sense).
-/// Member variables are the rows, columns and depths.
+/// Member variables are the rows, columns and depths, and the layout of the values in the memory.
 /// </summary>
-class DRAGON_API Tensor3D : public Tensor {
+template<class T>
+class BasicTensor3D : public BasicTensor<T> {
+public:
+	DRAGON_TENSOR_TYPES(T)
+
 protected:
+	using Tensor::m_Data;
+	using Tensor::allocateData;
+	using Tensor::_copy;
+	using Tensor::_swap;
 	size_t m_Depth = 0;
 	size_t m_Rows = 0;
 	size_t m_Cols = 0;
+	Layout m_Layout = Layout::Planar;
 
 public:
-	Tensor3D();
-	Tensor3D(const Tensor3D& other);
-	Tensor3D(Tensor3D&& other) noexcept;
+	BasicTensor3D();
+	BasicTensor3D(const Tensor3D& other);
+	BasicTensor3D(Tensor3D&& other) noexcept;
 	Tensor3D* operator=(const Tensor3D& other);
 	Tensor3D* operator=(Tensor3D&& other) noexcept;
-	~Tensor3D();
+	~BasicTensor3D();
 
-	Tensor3D(size_t depth, size_t rows, size_t cols, precision value);
-	Tensor3D(size_t depth, size_t rows, size_t cols, const precision* copyPointer);
-	Tensor3D(precision* assignPointer, size_t depth, size_t rows, size_t cols);
-	Tensor3D(size_t depth, size_t rows, size_t cols, Tensor&& dataTensor);
-	Tensor3D(size_t depth, size_t rows, size_t cols, const Tensor& dataTensor);
+	BasicTensor3D(size_t depth, size_t rows, size_t cols, precision value, Layout layout = Layout::Planar);
+	BasicTensor3D(size_t depth, size_t rows, size_t cols, const precision* copyPointer, Layout layout = Layout::Planar);
+	BasicTensor3D(precision* assignPointer, size_t depth, size_t rows, size_t cols, Layout layout = Layout::Planar);
+	BasicTensor3D(size_t depth, size_t rows, size_t cols, Tensor&& dataTensor, Layout layout = Layout::Planar);
+	BasicTensor3D(size_t depth, size_t rows, size_t cols, const Tensor& dataTensor, Layout layout = Layout::Planar);
 
-	inline size_t getCount() const override { return m_Rows * m_Cols * m_Depth; }
+	inline size_t getCount() const override { return layoutCount<T>(m_Layout, m_Depth, m_Rows, m_Cols); }
 
 private:
 	void _deleteParams() override;
@@ -39,9 +83,18 @@ public:
 	inline size_t getRows() const { return m_Rows; }
 	inline size_t getCols() const { return m_Cols; }
 	inline size_t getDepth() const { return m_Depth; }
+	inline Layout getLayout() const override { return m_Layout; }
+
+	// Copy of the tensor with the values in the given layout.
+	Tensor3D toLayout(Layout layout) const;
 
-	inline const precision& at(size_t i, size_t j, size_t k) const { return m_Data[k * m_Rows * m_Cols + i * m_Rows + j]; }
-	inline precision& at(size_t i, size_t j, size_t k) { return m_Data[k * m_Rows * m_Cols + i * m_Rows + j]; }
+	inline const precision& at(size_t i, size_t j, size_t k) const { return m_Data[layoutOffset<T>(m_Layout, m_Depth, m_Rows, m_Cols, i, j, k)]; }
+	inline precision& at(size_t i, size_t j, size_t k) { return m_Data[layoutOffset<T>(m_Layout, m_Depth, m_Rows, m_Cols, i, j, k)]; }
 };
 
+extern template class DRAGON_API BasicTensor3D<float>;
+extern template class DRAGON_API BasicTensor3D<double>;
+
+using Tensor3D = BasicTensor3D<precision>;
+
 DRAGON_END
\ No newline at end of file
@@ -0,0 +1,246 @@
+#pragma once
+#include "../Core.h"
+
+#include <array>
+#include <type_traits>
+
+#include "Tensor.h"
+#include "Tensor1D.h"
+#include "Tensor2D.h"
+#include "Tensor3D.h"
+
+/*
+Non owning, strided views of tensor data.
+A view is only a pointer, a shape and the strides, so reshaping, slicing, transposing
+or selecting a channel of a tensor never copies the data.
+*/
+
+DRAGON_BEGIN
+
+namespace view {
+
+	// Rank of the tensor types, the tensor types can be viewed with a view of the same rank.
+	template<class T> struct TensorRank : std::integral_constant<size_t, 0> { };
+	template<class T> struct TensorRank<BasicTensor1D<T>> : std::integral_constant<size_t, 1> { };
+	template<class T> struct TensorRank<BasicTensor2D<T>> : std::integral_constant<size_t, 2> { };
+	template<class T> struct TensorRank<BasicTensor3D<T>> : std::integral_constant<size_t, 3> { };
+
+	template<class T> inline std::array<size_t, 1> shapeOf(const BasicTensor1D<T>& tensor) { return { tensor.getCols() }; }
+	template<class T> inline std::array<size_t, 2> shapeOf(const BasicTensor2D<T>& tensor) { return { tensor.getRows(), tensor.getCols() }; }
+	template<class T> inline std::array<size_t, 3> shapeOf(const BasicTensor3D<T>& tensor) { return { tensor.getDepth(), tensor.getRows(), tensor.getCols() }; }
+
+	// Strides of (depth, rows, cols) data in the layout. The blocked layout has no single stride for the depth.
+	inline std::array<size_t, 3> layoutStrides(Layout layout, size_t depth, size_t rows, size_t cols) {
+		assert((layout != Layout::Blocked) && "The blocked layout can't be viewed as a 3D view, use LayoutView!");
+		if (layout == Layout::ChannelsLast)
+			return { 1, cols * depth, depth };
+		return { rows * cols, cols, 1 };
+	}
+
+	template<class T> inline std::array<size_t, 1> stridesOf(const BasicTensor1D<T>&) { return { 1 }; }
+	template<class T> inline std::array<size_t, 2> stridesOf(const BasicTensor2D<T>& tensor) { return { tensor.getCols(), 1 }; }
+	template<class T> inline std::array<size_t, 3> stridesOf(const BasicTensor3D<T>& tensor) {
+		return layoutStrides(tensor.getLayout(), tensor.getDepth(), tensor.getRows(), tensor.getCols());
+	}
+
+}
+
+/// <summary>
+/// View of Rank dimensional data, the element (i0, i1, ...) is at data[i0 * stride0 + i1 * stride1 + ...].
+/// T is the element type for a writable view and the const element type for a read only one.
+/// The shape of a Tensor3D view is (depth, rows, cols), a Tensor2D view is (rows, cols).
+/// Tensors convert to views implicitly, so every function that takes a view takes the tensor too.
+/// The function templates take the views as NonDeduced parameters for the conversion, if the element type
+/// is not deduced from an other parameter, it's the default precision or it's given explicitly (convolution<float>(...)).
+/// The view doesn't own the data, don't keep it after the tensor is gone.
+/// </summary>
+template<size_t Rank, class T = precision>
+class TensorView {
+	static_assert(Rank > 0, "A view has at least one dimension!");
+
+public:
+	using Shape = std::array<size_t, Rank>;
+
+	TensorView() = default;
+
+	// Contiguous row major view of the data.
+	TensorView(T* data, const Shape& shape) : m_Data(data), m_Shape(shape) {
+		size_t stride = 1;
+		for (size_t axis = Rank; axis-- > 0;) {
+			m_Strides[axis] = stride;
+			stride *= m_Shape[axis];
+		}
+	}
+	TensorView(T* data, const Shape& shape, const Shape& strides) :
+		m_Data(data), m_Shape(shape), m_Strides(strides) { }
+
+	// View of a whole tensor with its own shape (and layout).
+	template<class TensorT, class = std::enable_if_t<
+		view::TensorRank<std::remove_const_t<TensorT>>::value == Rank &&
+		std::is_same<typename TensorT::precision, std::remove_const_t<T>>::value &&
+		(std::is_const<T>::value || !std::is_const<TensorT>::value)>>
+	TensorView(TensorT& tensor) : TensorView(tensor.getData(), view::shapeOf(tensor), view::stridesOf(tensor)) { }
+
+	// Writable views convert to read only ones.
+	template<class U, class = std::enable_if_t<std::is_const<T>::value && std::is_same<const U, T>::value>>
+	TensorView(const TensorView<Rank, U>& other) :
+		m_Data(other.getData()), m_Shape(other.getShape()), m_Strides(other.getStrides()) { }
+
+public:
+	inline T* getData() const { return m_Data; }
+	inline const Shape& getShape() const { return m_Shape; }
+	inline const Shape& getStrides() const { return m_Strides; }
+	inline size_t getShape(size_t axis) const { return m_Shape[axis]; }
+	inline size_t getStride(size_t axis) const { return m_Strides[axis]; }
+
+	// The last two axes are the rows and cols, the one before them is the depth.
+	inline size_t getCols() const { return m_Shape[Rank - 1]; }
+	inline size_t getRows() const { static_assert(Rank >= 2, "No rows in the view!"); return m_Shape[Rank - 2]; }
+	inline size_t getDepth() const { static_assert(Rank >= 3, "No depth in the view!"); return m_Shape[Rank - 3]; }
+
+	inline size_t getCount() const {
+		size_t count = 1;
+		for (size_t axis = 0; axis < Rank; axis++)
+			count *= m_Shape[axis];
+		return count;
+	}
+
+	// True if the elements are next to each other in row major order.
+	inline bool isContiguous() const {
+		size_t stride = 1;
+		for (size_t axis = Rank; axis-- > 0;) {
+			if (m_Shape[axis] != 1 && m_Strides[axis] != stride)
+				return false;
+			stride *= m_Shape[axis];
+		}
+		return true;
+	}
+
+	template<class... Index>
+	inline T& operator()(Index... index) const {
+		static_assert(sizeof...(Index) == Rank, "Number of indices not match with the rank!");
+		size_t offset = 0, axis = 0;
+		((offset += size_t(index) * m_Strides[axis++]), ...);
+		return m_Data[offset];
+	}
+
+public:
+	// Same data with an other shape, only contiguous views can be reshaped.
+	template<size_t NewRank>
+	TensorView<NewRank, T> reshape(const std::array<size_t, NewRank>& shape) const {
+		assert((isContiguous()) && "Only contiguous views can be reshaped!");
+		size_t count = 1;
+		for (size_t axis = 0; axis < NewRank; axis++)
+			count *= shape[axis];
+		assert((count == getCount()) && "Reshape has to keep the number of elements!");
+		return TensorView<NewRank, T>(m_Data, shape);
+	}
+
+	// The [begin, end) part of the axis.
+	TensorView slice(size_t axis, size_t begin, size_t end) const {
+		assert((axis < Rank && begin <= end && end <= m_Shape[axis]) && "Invalid slice!");
+		Shape shape = m_Shape;
+		shape[axis] = end - begin;
+		return TensorView(m_Data + begin * m_Strides[axis], shape, m_Strides);
+	}
+
+	// The index-th element of the axis, one dimension less. select(0, k) is the k-th channel of a 3D view.
+	template<size_t R = Rank, class = std::enable_if_t<(R > 1)>>
+	TensorView<Rank - 1, T> select(size_t axis, size_t index) const {
+		assert((axis < Rank && index < m_Shape[axis]) && "Invalid select!");
+		std::array<size_t, Rank - 1> shape, strides;
+		for (size_t i = 0, j = 0; i < Rank; i++) {
+			if (i == axis)
+				continue;
+			shape[j] = m_Shape[i];
+			strides[j] = m_Strides[i];
+			j++;
+		}
+		return TensorView<Rank - 1, T>(m_Data + index * m_Strides[axis], shape, strides);
+	}
+
+	// Swap two axes, transpose(0, 1) of a 2D view is the transposed matrix.
+	TensorView transpose(size_t first, size_t second) const {
+		assert((first < Rank && second < Rank) && "Invalid transpose!");
+		Shape shape = m_Shape, strides = m_Strides;
+		std::swap(shape[first], shape[second]);
+		std::swap(strides[first], strides[second]);
+		return TensorView(m_Data, shape, strides);
+	}
+
+private:
+	T* m_Data = nullptr;
+	Shape m_Shape = {};
+	Shape m_Strides = {};
+};
+
+template<size_t Rank, class T = precision>
+using ConstTensorView = TensorView<Rank, const T>;
+
+using TensorView1D = TensorView<1>;
+using TensorView2D = TensorView<2>;
+using TensorView3D = TensorView<3>;
+using ConstTensorView1D = ConstTensorView<1>;
+using ConstTensorView2D = ConstTensorView<2>;
+using ConstTensorView3D = ConstTensorView<3>;
+
+/// <summary>
+/// Depth x rows x cols data in any of the Tensor3D layouts.
+/// The blocked layout has no single stride for the depth, so it can't be a TensorView3D,
+/// but every depth of every layout is a strided 2D view, that the 2D kernels take.
+/// </summary>
+template<class T = precision>
+class LayoutView {
+public:
+	LayoutView() = default;
+	LayoutView(T* data, Layout layout, size_t depth, size_t rows, size_t cols) :
+		m_Data(data), m_Layout(layout), m_Depth(depth), m_Rows(rows), m_Cols(cols) { }
+
+	template<class TensorT, class = std::enable_if_t<
+		std::is_same<std::remove_const_t<TensorT>, BasicTensor3D<std::remove_const_t<T>>>::value &&
+		(std::is_const<T>::value || !std::is_const<TensorT>::value)>>
+	LayoutView(TensorT& tensor) :
+		LayoutView(tensor.getData(), tensor.getLayout(), tensor.getDepth(), tensor.getRows(), tensor.getCols()) { }
+
+	template<class U, class = std::enable_if_t<std::is_const<T>::value && std::is_same<const U, T>::value>>
+	LayoutView(const LayoutView<U>& other) :
+		LayoutView(other.getData(), other.getLayout(), other.getDepth(), other.getRows(), other.getCols()) { }
+
+public:
+	inline T* getData() const { return m_Data; }
+	inline Layout getLayout() const { return m_Layout; }
+	inline size_t getDepth() const { return m_Depth; }
+	inline size_t getRows() const { return m_Rows; }
+	inline size_t getCols() const { return m_Cols; }
+
+	inline T& operator()(size_t k, size_t i, size_t j) const {
+		return m_Data[layoutOffset<std::remove_const_t<T>>(m_Layout, m_Depth, m_Rows, m_Cols, i, j, k)];
+	}
+
+	// The k-th depth as a rows x cols view.
+	TensorView<2, T> channel(size_t k) const {
+		assert((k < m_Depth) && "Invalid depth!");
+		size_t colStride = m_Layout == Layout::Planar ? 1 : (m_Layout == Layout::Blocked ? CHANNEL_BLOCK<std::remove_const_t<T>> : m_Depth);
+		return TensorView<2, T>(&(*this)(k, 0, 0), { m_Rows, m_Cols }, { m_Cols * colStride, colStride });
+	}
+
+	// The whole data as a (depth, rows, cols) view, only for the planar and channels last layouts.
+	TensorView<3, T> view() const {
+		return TensorView<3, T>(m_Data, { m_Depth, m_Rows, m_Cols }, view::layoutStrides(m_Layout, m_Depth, m_Rows, m_Cols));
+	}
+
+private:
+	T* m_Data = nullptr;
+	Layout m_Layout = Layout::Planar;
+	size_t m_Depth = 0;
+	size_t m_Rows = 0;
+	size_t m_Cols = 0;
+};
+
+template<class T = precision>
+using ConstLayoutView = LayoutView<const T>;
+
+using LayoutView3D = LayoutView<precision>;
+using ConstLayoutView3D = LayoutView<const precision>;
+
+DRAGON_END
\ No newline at end of file
@@ -2,15 +2,18 @@
 
 DRAGON_BEGIN
 
-Tensor1D convertTo(const Tensor& tensor, size_t cols) {
-	return Tensor1D(cols, tensor.getData());
+template<class T>
+BasicTensor1D<T> convertTo(const BasicTensor<T>& tensor, size_t cols) {
+	return BasicTensor1D<T>(cols, tensor.getData());
 }
 
-Tensor1D convertTo(Tensor&& tensor, size_t cols) {
-	return Tensor1D(cols, std::move(tensor));
+template<class T>
+BasicTensor1D<T> convertTo(BasicTensor<T>&& tensor, size_t cols) {
+	return BasicTensor1D<T>(cols, std::move(tensor));
 }
 
-void print(const Tensor3D& tensor) {
+template<class T>
+void print(const BasicTensor3D<T>& tensor) {
 	for (size_t k = 0; k < tensor.getDepth(); k++) {
 		for (size_t i = 0; i < tensor.getRows(); i++) {
 			for (size_t j = 0; j < tensor.getCols(); j++) {
@@ -23,7 +26,8 @@ void print(const Tensor3D& tensor) {
 	std::cout << "\n";
 }
 
-void print(const Tensor2D& tensor) {
+template<class T>
+void print(const BasicTensor2D<T>& tensor) {
 	for (size_t i = 0; i < tensor.getRows(); i++) {
 		for (size_t j = 0; j < tensor.getCols(); j++) {
 			std::cout << tensor.at(i, j) << "\t";
@@ -33,81 +37,78 @@ void print(const Tensor2D& tensor) {
 	std::cout << "\n";
 }
 
-void print(const Tensor& tensor) {
+template<class T>
+void print(const BasicTensor<T>& tensor) {
 	for (size_t i = 0; i < tensor.getCount(); i++)
 		std::cout << tensor.getData()[i] << " ";
 	std::cout << "\n\n";
 }
 
-Tensor2D trans(const Tensor2D& tensor) {
-	Tensor2D result(tensor.getCols(), tensor.getRows(), precision());
+template<class T>
+BasicTensor2D<T> trans(const BasicTensor2D<T>& tensor) {
+	BasicTensor2D<T> result(tensor.getCols(), tensor.getRows(), T());
 	for (size_t i = 0; i < result.getRows(); i++)
 		for (size_t j = 0; j < result.getCols(); j++)
 			result.at(i, j) = tensor.at(j, i);
 	return result;
 }
 
-Tensor2D trans(const Tensor1D& tensor) {
-	return Tensor2D(1, tensor.getCols(), tensor);
+template<class T>
+BasicTensor2D<T> trans(const BasicTensor1D<T>& tensor) {
+	return BasicTensor2D<T>(1, tensor.getCols(), tensor);
 }
 
-Tensor2D optrans(const Tensor2D& tensor) {
-	Tensor2D result(tensor.getCols(), tensor.getRows(), precision());
+template<class T>
+BasicTensor2D<T> optrans(const BasicTensor2D<T>& tensor) {
+	BasicTensor2D<T> result(tensor.getCols(), tensor.getRows(), T());
 	for (size_t i = 0; i < result.getRows(); i++)
 		for (size_t j = 0; j < result.getCols(); j++)
 			result.at(i, j) = tensor.at(tensor.getRows() - j - 1, tensor.getCols() - i - 1);
 	return result;
 }
 
-Tensor2D reverse(const Tensor2D& tensor) {
-	precision* assingPointer = new precision[tensor.getRows() * tensor.getCols()];
+template<class T>
+BasicTensor2D<T> reverse(const BasicTensor2D<T>& tensor) {
+	T* assingPointer = BasicTensor<T>::allocateData(tensor.getRows() * tensor.getCols());
 
 	for (size_t i = 0; i < tensor.getRows(); i++)
 		for (size_t j = 0; j < tensor.getCols(); j++)
 			assingPointer[(tensor.getRows() - i - 1) * tensor.getCols() + tensor.getCols() - j - 1] = tensor.at(i, j);
 
-	return Tensor2D(assingPointer, tensor.getRows(), tensor.getCols());
+	return BasicTensor2D<T>(assingPointer, tensor.getRows(), tensor.getCols());
 }
 
-Tensor2D tensorDot(const Tensor2D& left, const Tensor2D& right) {
-	Tensor2D result(left.getRows(), right.getCols(), precision());
+template<class T>
+BasicTensor2D<T> tensorDot(const BasicTensor2D<T>& left, const BasicTensor2D<T>& right) {
 	assert((left.getCols() == right.getRows()) && "Parameters not match for tensorDot!");
+	// Allocate only, gemm doesn't read the result when beta is zero.
+	BasicTensor2D<T> result(BasicTensor<T>::allocateData(left.getRows() * right.getCols()), left.getRows(), right.getCols());
 
-		for (size_t i = 0; i < result.getRows(); i++) {
-			for (size_t j = 0; j < result.getCols(); j++) {
-
-				precision prod = precision();
-				for (size_t t = 0; t < left.getCols(); t++) {
-					prod += left.at(i, t) * right.at(t, j);
-				}
-
-				result.at(i, j) = prod;
-
-			}
-		}
+	gemm(false, false,
+		left.getRows(), right.getCols(), left.getCols(),
+		T(1), left.getData(), left.getCols(),
+		right.getData(), right.getCols(),
+		T(), result.getData(), result.getCols());
 
 	return result;
 }
 
-Tensor2D tensorDot(const Tensor2D& left, const Tensor1D& right) {
-	Tensor2D result(left.getRows(), 1, precision());
+template<class T>
+BasicTensor2D<T> tensorDot(const BasicTensor2D<T>& left, const BasicTensor1D<T>& right) {
 	assert((left.getCols() == right.getCols()) && "Parameters not match for tensorDot!");
+	BasicTensor2D<T> result(BasicTensor<T>::allocateData(left.getRows()), left.getRows(), 1);
 
-	for (size_t i = 0; i < result.getRows(); i++) {
-
-		precision prod = precision();
-		for (size_t t = 0; t < left.getCols(); t++)
-			prod += left.at(i, t) * right.at(t);
-
-
-		result.at(i, 0) = prod;
-	}
+	gemv(left.getRows(), left.getCols(),
+		T(1), left.getData(), left.getCols(),
+		right.getData(),
+		T(), result.getData());
 	
 	return result;
 }
 
-Tensor2D tensorDot(const Tensor1D& left, const Tensor2D& right) {
-	Tensor2D result(left.getCols(), right.getCols(), precision());
+template<class T>
+BasicTensor2D<T> tensorDot(const BasicTensor1D<T>& left, const BasicTensor2D<T>& right) {
+	BasicTensor2D<T> result(left.getCols(), right.getCols(), T());
 	assert((right.getRows() == 1) && "Parameters not match for tensorDot!");
 
 	for (size_t i = 0; i < result.getRows(); i++)
@@ -117,16 +118,18 @@ Tensor2D tensorDot(const Tensor1D& left, const Tensor2D& right) {
 	return result;
 }
 
-precision tensorDot(const Tensor1D& left, const Tensor1D& right) {
+template<class T>
+T tensorDot(const BasicTensor1D<T>& left, const BasicTensor1D<T>& right) {
 	assert((right.getCols() == left.getCols()) && "Parameters not match for tensorDot! Two vector has different sizez.");
-	precision prod = precision();
+	T prod = T();
 	for (size_t i = 0; i < right.getCols(); i++)
 		prod += right.at(i) * left.at(i);
 	return prod;
 }
 
-Tensor2D padding(const Tensor2D& tensor, size_t size, precision value) {
-	Tensor2D result(tensor.getRows() + 2 * size, tensor.getCols() + 2 * size, value);
+template<class T>
+BasicTensor2D<T> padding(const BasicTensor2D<T>& tensor, size_t size, NonDeduced<T> value) {
+	BasicTensor2D<T> result(tensor.getRows() + 2 * size, tensor.getCols() + 2 * size, value);
 
 	for (size_t i = 0; i < tensor.getRows(); i++)
 		for (size_t j = 0; j < tensor.getCols(); j++)
@@ -135,11 +138,12 @@ Tensor2D padding(const Tensor2D& tensor, size_t size, precision value) {
 	return result;
 }
 
-Tensor2D convolution(const Tensor2D& signal, const Tensor2D& kernel, size_t stride) {
+template<class T>
+BasicTensor2D<T> convolution(const BasicTensor2D<T>& signal, const BasicTensor2D<T>& kernel, size_t stride) {
 	size_t r = size_t((signal.getRows() - kernel.getRows()) / stride) + 1;
 	size_t c = size_t((signal.getCols() - kernel.getCols()) / stride) + 1;
 
-	double* assignPointer = new double[r * c];
+	T* assignPointer = BasicTensor<T>::allocateData(r * c);
 
 	for (size_t i = 0; i < r; i++) {
 		for (size_t j = 0; j < c; j++) {
@@ -147,7 +151,7 @@ Tensor2D convolution(const Tensor2D& signal, const Tensor2D& kernel, size_t stri
 			size_t sr = i * stride;
 			size_t sc = j * stride;
 
-			double product = 0.0;
+			T product = T();
 			for (size_t x = 0; x < kernel.getRows(); x++)
 				for (size_t y = 0; y < kernel.getCols(); y++)
 					product += signal.at(sr + x, sc + y) * kernel.at(x, y);
@@ -156,10 +160,11 @@ Tensor2D convolution(const Tensor2D& signal, const Tensor2D& kernel, size_t stri
 
 		}
 	}
-	return Tensor2D(assignPointer, r, c);
+	return BasicTensor2D<T>(assignPointer, r, c);
 }
 
-void convolution(Tensor2D& result, const Tensor2D& signal, const Tensor2D& kernel, size_t stride) {
+template<class T>
+void convolution(NonDeduced<TensorView<2, T>> result, NonDeduced<ConstTensorView<2, T>> signal, NonDeduced<ConstTensorView<2, T>> kernel, size_t stride) {
 	size_t r = size_t((signal.getRows() - kernel.getRows()) / stride) + 1;
 	size_t c = size_t((signal.getCols() - kernel.getCols()) / stride) + 1;
 	assert(r == result.getRows() && c == result.getCols());
@@ -171,21 +176,22 @@ void convolution(Tensor2D& result, const Tensor2D& signal, const Tensor2D& kerne
 			size_t sr = i * stride;
 			size_t sc = j * stride;
 
-			double product = 0.0;
+			T product = T();
 			for (size_t x = 0; x < kernel.getRows(); x++)
 				for (size_t y = 0; y < kernel.getCols(); y++)
-					product += signal.at(sr + x, sc + y) * kernel.at(x, y);
+					product += signal(sr + x, sc + y) * kernel(x, y);
 
-			result.at(i, j) = product;
+			result(i, j) = product;
 		}
 	}
 }
 
-Tensor2D scaleByStride(const Tensor2D& signal, size_t stride) {
+template<class T>
+BasicTensor2D<T> scaleByStride(const BasicTensor2D<T>& signal, size_t stride) {
 	size_t row = (signal.getRows() - 1) * stride + 1;
 	size_t col = (signal.getCols() - 1) * stride + 1;
 	
-	Tensor2D result(row, col, 0.0);
+	BasicTensor2D<T> result(row, col, 0.0);
 
 	for (size_t i = 0; i < signal.getRows(); i++)
 		for (size_t j = 0; j < signal.getCols(); j++)
@@ -194,8 +200,148 @@ Tensor2D scaleByStride(const Tensor2D& signal, size_t stride) {
 	return result;
 }
 
+template<class T>
+void convolutionKernelGradient(NonDeduced<TensorView<2, T>> result, NonDeduced<ConstTensorView<2, T>> signal, NonDeduced<ConstTensorView<2, T>> cost, size_t stride) {
+	assert((calcConvParamsAfter(signal.getRows(), result.getRows(), stride) == cost.getRows() &&
+		calcConvParamsAfter(signal.getCols(), result.getCols(), stride) == cost.getCols()) &&
+		"Parameters not match for convolutionKernelGradient!");
+
+	size_t signalStep = stride * signal.getStride(1);
+	size_t costStep = cost.getStride(1);
+
+	for (size_t x = 0; x < result.getRows(); x++) {
+		for (size_t y = 0; y < result.getCols(); y++) {
+
+			T product = T();
+			for (size_t i = 0; i < cost.getRows(); i++) {
+				const T* signalRow = &signal(i * stride + x, y);
+				const T* costRow = &cost(i, 0);
+				for (size_t j = 0; j < cost.getCols(); j++)
+					product += signalRow[j * signalStep] * costRow[j * costStep];
+			}
+
+			result(x, y) = product;
+		}
+	}
+}
+
+template<class T>
+void convolutionTransposed(NonDeduced<TensorView<2, T>> result, NonDeduced<ConstTensorView<2, T>> cost, NonDeduced<ConstTensorView<2, T>> kernel, size_t stride) {
+	assert((calcConvParamsAfter(result.getRows(), kernel.getRows(), stride) == cost.getRows() &&
+		calcConvParamsAfter(result.getCols(), kernel.getCols(), stride) == cost.getCols()) &&
+		"Parameters not match for convolutionTransposed!");
+
+	size_t resultStep = result.getStride(1);
+	size_t kernelStep = kernel.getStride(1);
+
+	// Every cost element is spread back to the signal positions that its kernel window covered.
+	for (size_t i = 0; i < cost.getRows(); i++) {
+		for (size_t x = 0; x < kernel.getRows(); x++) {
+			const T* kernelRow = &kernel(x, 0);
+
+			for (size_t j = 0; j < cost.getCols(); j++) {
+				T value = cost(i, j);
+				T* window = &result(i * stride + x, j * stride);
+				for (size_t y = 0; y < kernel.getCols(); y++)
+					window[y * resultStep] += value * kernelRow[y * kernelStep];
+			}
+		}
+	}
+}
+
+template<class T>
+BasicTensor2D<T> im2col(NonDeduced<ConstTensorView<3, T>> input, size_t kernelRows, size_t kernelCols, size_t stride) {
+	size_t r = calcConvParamsAfter(input.getRows(), kernelRows, stride);
+	size_t c = calcConvParamsAfter(input.getCols(), kernelCols, stride);
+
+	BasicTensor2D<T> result(BasicTensor<T>::allocateData(input.getDepth() * kernelRows * kernelCols * r * c),
+		input.getDepth() * kernelRows * kernelCols, r * c);
+	im2col(result, input, kernelRows, kernelCols, stride);
+	return result;
+}
+
+template<class T>
+void im2col(BasicTensor2D<T>& result, NonDeduced<ConstTensorView<3, T>> input, size_t kernelRows, size_t kernelCols, size_t stride) {
+	size_t r = calcConvParamsAfter(input.getRows(), kernelRows, stride);
+	size_t c = calcConvParamsAfter(input.getCols(), kernelCols, stride);
+	assert((result.getRows() == input.getDepth() * kernelRows * kernelCols && result.getCols() == r * c) &&
+		"Parameters not match for im2col!");
+
+	// Distance of the neighbour output positions in the input.
+	size_t step = stride * input.getStride(2);
+
+	for (size_t k = 0; k < input.getDepth(); k++) {
+		for (size_t x = 0; x < kernelRows; x++) {
+			for (size_t y = 0; y < kernelCols; y++) {
+				T* column = result.getData() + ((k * kernelRows + x) * kernelCols + y) * r * c;
+
+				for (size_t i = 0; i < r; i++) {
+					const T* row = &input(k, i * stride + x, y);
+					if (step == 1) {
+						for (size_t j = 0; j < c; j++)
+							column[i * c + j] = row[j];
+					}
+					else {
+						for (size_t j = 0; j < c; j++)
+							column[i * c + j] = row[j * step];
+					}
+				}
+			}
+		}
+	}
+}
+
+template<class T>
+void col2im(NonDeduced<TensorView<3, T>> result, const BasicTensor2D<T>& columns, size_t kernelRows, size_t kernelCols, size_t stride) {
+	size_t r = calcConvParamsAfter(result.getRows(), kernelRows, stride);
+	size_t c = calcConvParamsAfter(result.getCols(), kernelCols, stride);
+	assert((columns.getRows() == result.getDepth() * kernelRows * kernelCols && columns.getCols() == r * c) &&
+		"Parameters not match for col2im!");
+
+	size_t step = stride * result.getStride(2);
+
+	for (size_t k = 0; k < result.getDepth(); k++) {
+		for (size_t x = 0; x < kernelRows; x++) {
+			for (size_t y = 0; y < kernelCols; y++) {
+				const T* column = columns.getData() + ((k * kernelRows + x) * kernelCols + y) * r * c;
+
+				for (size_t i = 0; i < r; i++) {
+					T* row = &result(k, i * stride + x, y);
+					for (size_t j = 0; j < c; j++)
+						row[j * step] += column[i * c + j];
+				}
+			}
+		}
+	}
+}
+
 size_t calcConvParamsAfter(size_t inputPar, size_t kernelPar, size_t stride) {
 	return size_t((inputPar - kernelPar) / stride) + 1;
 }
 
+#define UTILITY_TEMPLATES(T) \
+	template DRAGON_API BasicTensor1D<T> convertTo(const BasicTensor<T>&, size_t); \
+	template DRAGON_API BasicTensor1D<T> convertTo(BasicTensor<T>&&, size_t); \
+	template DRAGON_API void print(const BasicTensor3D<T>&); \
+	template DRAGON_API void print(const BasicTensor2D<T>&); \
+	template DRAGON_API void print(const BasicTensor<T>&); \
+	template DRAGON_API BasicTensor2D<T> trans(const BasicTensor2D<T>&); \
+	template DRAGON_API BasicTensor2D<T> trans(const BasicTensor1D<T>&); \
+	template DRAGON_API BasicTensor2D<T> optrans(const BasicTensor2D<T>&); \
+	template DRAGON_API BasicTensor2D<T> reverse(const BasicTensor2D<T>&); \
+	template DRAGON_API BasicTensor2D<T> tensorDot(const BasicTensor2D<T>&, const BasicTensor2D<T>&); \
+	template DRAGON_API BasicTensor2D<T> tensorDot(const BasicTensor2D<T>&, const BasicTensor1D<T>&); \
+	template DRAGON_API BasicTensor2D<T> tensorDot(const BasicTensor1D<T>&, const BasicTensor2D<T>&); \
+	template DRAGON_API T tensorDot(const BasicTensor1D<T>&, const BasicTensor1D<T>&); \
+	template DRAGON_API BasicTensor2D<T> padding<T>(const BasicTensor2D<T>&, size_t, T); \
+	template DRAGON_API BasicTensor2D<T> convolution(const BasicTensor2D<T>&, const BasicTensor2D<T>&, size_t); \
+	template DRAGON_API void convolution<T>(TensorView<2, T>, ConstTensorView<2, T>, ConstTensorView<2, T>, size_t); \
+	template DRAGON_API BasicTensor2D<T> scaleByStride(const BasicTensor2D<T>&, size_t); \
+	template DRAGON_API void convolutionKernelGradient<T>(TensorView<2, T>, ConstTensorView<2, T>, ConstTensorView<2, T>, size_t); \
+	template DRAGON_API void convolutionTransposed<T>(TensorView<2, T>, ConstTensorView<2, T>, ConstTensorView<2, T>, size_t); \
+	template DRAGON_API BasicTensor2D<T> im2col<T>(ConstTensorView<3, T>, size_t, size_t, size_t); \
+	template DRAGON_API void im2col<T>(BasicTensor2D<T>&, ConstTensorView<3, T>, size_t, size_t, size_t); \
+	template DRAGON_API void col2im<T>(TensorView<3, T>, const BasicTensor2D<T>&, size_t, size_t, size_t);
+DRAGON_INSTANTIATE(UTILITY_TEMPLATES)
+
 DRAGON_END
\ No newline at end of file
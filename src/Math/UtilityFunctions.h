@@ -6,45 +6,67 @@
 #include "Tensor1D.h"
 #include "Tensor2D.h"
 #include "Tensor3D.h"
+#include "TensorView.h"
+#include "Expression.h"
+#include "LinearAlgebra.h"
 
 DRAGON_BEGIN
 
 // Converts tensors to each other
-DRAGON_API Tensor1D convertTo(const Tensor& tensor, size_t cols);
-DRAGON_API Tensor1D convertTo(Tensor&& tensor, size_t cols);
+template<class T> DRAGON_API BasicTensor1D<T> convertTo(const BasicTensor<T>& tensor, size_t cols);
+template<class T> DRAGON_API BasicTensor1D<T> convertTo(BasicTensor<T>&& tensor, size_t cols);
 
 // Prints The 2D tensor to the consol
-DRAGON_API void print(const Tensor3D& tensor);
-DRAGON_API void print(const Tensor2D& tensor);
-DRAGON_API void print(const Tensor& tensor);
+template<class T> DRAGON_API void print(const BasicTensor3D<T>& tensor);
+template<class T> DRAGON_API void print(const BasicTensor2D<T>& tensor);
+template<class T> DRAGON_API void print(const BasicTensor<T>& tensor);
+template<class Operation, class Left, class Right>
+inline void print(const expression::Expression<Operation, Left, Right>& expression) { print(expression.eval()); }
 //void print(Tensor&& tensor);
 // Calculate the transponant of the 2D tensor
-DRAGON_API Tensor2D trans(const Tensor2D& tensor);
-DRAGON_API Tensor2D trans(const Tensor1D& tensor);
+template<class T> DRAGON_API BasicTensor2D<T> trans(const BasicTensor2D<T>& tensor);
+template<class T> DRAGON_API BasicTensor2D<T> trans(const BasicTensor1D<T>& tensor);
 // Calulate the opponent transponant of the 2D tensor
 // Rotating the tensor at the axis of the 2nd axis
-DRAGON_API Tensor2D optrans(const Tensor2D& tensor);
+template<class T> DRAGON_API BasicTensor2D<T> optrans(const BasicTensor2D<T>& tensor);
 // Create a tnesor with rows and cols swaped at the middle point
 // Or calculate the trans of the tensor and than the optrans of the resulted tensor.
-DRAGON_API Tensor2D reverse(const Tensor2D& tensor);
+template<class T> DRAGON_API BasicTensor2D<T> reverse(const BasicTensor2D<T>& tensor);
 // Calculate the Matrix multiplication between two tensor
-DRAGON_API Tensor2D tensorDot(const Tensor2D& left, const Tensor2D& right);
+template<class T> DRAGON_API BasicTensor2D<T> tensorDot(const BasicTensor2D<T>& left, const BasicTensor2D<T>& right);
 // Calculate the Matrix multiplication between two tensor the right tensor handled as a column vector
-DRAGON_API Tensor2D tensorDot(const Tensor2D& left, const Tensor1D& right);
+template<class T> DRAGON_API BasicTensor2D<T> tensorDot(const BasicTensor2D<T>& left, const BasicTensor1D<T>& right);
 // Calculate the Matrix multiplication between two tensor the left tensor handled as a column vector
-DRAGON_API Tensor2D tensorDot(const Tensor1D& left, const Tensor2D& right);
+template<class T> DRAGON_API BasicTensor2D<T> tensorDot(const BasicTensor1D<T>& left, const BasicTensor2D<T>& right);
 // Calucuate the matematical scalar vector prouduct
-DRAGON_API precision tensorDot(const Tensor1D& left, const Tensor1D& right);
+template<class T> DRAGON_API T tensorDot(const BasicTensor1D<T>& left, const BasicTensor1D<T>& right);
 // Creating a tensor but adds extra elements to the side
-DRAGON_API Tensor2D padding(const Tensor2D& tensor, size_t size, precision value);
+template<class T> DRAGON_API BasicTensor2D<T> padding(const BasicTensor2D<T>& tensor, size_t size, NonDeduced<T> value);
 // Calculate the convolution between two tensor.
 // The Kernel tensor goes through the single tensor with stirde steps and calculate the 
 // product between the subsignal with size of kernel and the kenrnel.
-DRAGON_API Tensor2D convolution(const Tensor2D& signal, const Tensor2D& kernel, size_t stride);
+template<class T> DRAGON_API BasicTensor2D<T> convolution(const BasicTensor2D<T>& signal, const BasicTensor2D<T>& kernel, size_t stride);
 //Tensor2D convolution(Tensor2D&& signal, const Tensor2D& kernel, size_t stride).
-DRAGON_API void convolution(Tensor2D& result, const Tensor2D& signal, const Tensor2D& kernel, size_t stride);
+template<class T = precision> DRAGON_API void convolution(NonDeduced<TensorView<2, T>> result, NonDeduced<ConstTensorView<2, T>> signal, NonDeduced<ConstTensorView<2, T>> kernel, size_t stride);
 // Scale the tensor by stride (function needed for convolutional layer backprop).
-DRAGON_API Tensor2D scaleByStride(const Tensor2D& signal, size_t stride);
+template<class T> DRAGON_API BasicTensor2D<T> scaleByStride(const BasicTensor2D<T>& signal, size_t stride);
+// Calculate the kernel gradient of a convolution(signal, kernel, stride) from the cost respect to its result.
+// result(x, y) = sum of signal(i * stride + x, j * stride + y) * cost(i, j), the result has the kernel size.
+// Same as convolution(signal, scaleByStride(cost, stride), 1) without the scaled temporary.
+template<class T = precision> DRAGON_API void convolutionKernelGradient(NonDeduced<TensorView<2, T>> result, NonDeduced<ConstTensorView<2, T>> signal, NonDeduced<ConstTensorView<2, T>> cost, size_t stride);
+// Calculate the gradient of a convolution(signal, kernel, stride) respect to the signal (transposed convolution)
+// and add it to the result, the result has the signal size.
+// Same as convolution(padding(scaleByStride(cost, stride), kernelSize - 1, 0), reverse(kernel), 1)
+// without the padded, reversed and scaled temporaries, the positions that no kernel covers get nothing.
+template<class T = precision> DRAGON_API void convolutionTransposed(NonDeduced<TensorView<2, T>> result, NonDeduced<ConstTensorView<2, T>> cost, NonDeduced<ConstTensorView<2, T>> kernel, size_t stride);
+// Unfold the input for a convolution into a matrix, so the convolution becomes a matrix multiplication.
+// Every column holds the input values under one kernel position (for every input depth),
+// the result has (depth * kernelRows * kernelCols) rows and (outputRows * outputCols) columns.
+template<class T = precision> DRAGON_API BasicTensor2D<T> im2col(NonDeduced<ConstTensorView<3, T>> input, size_t kernelRows, size_t kernelCols, size_t stride);
+template<class T> DRAGON_API void im2col(BasicTensor2D<T>& result, NonDeduced<ConstTensorView<3, T>> input, size_t kernelRows, size_t kernelCols, size_t stride);
+// Fold the columns back to the input shape, the inverse of im2col for the gradients.
+// The values of the overlapping kernel positions are added to the result.
+template<class T> DRAGON_API void col2im(NonDeduced<TensorView<3, T>> result, const BasicTensor2D<T>& columns, size_t kernelRows, size_t kernelCols, size_t stride);
 
 // calculate the resulted parameter after a convolutional operation occur on the input by the kernel
 // inputPar = inputRow,Col... kernelPar = kernelRow, Col...
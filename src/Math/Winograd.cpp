@@ -0,0 +1,198 @@
+#include "Winograd.h"
+#include "LinearAlgebra.h"
+
+#include <vector>
+#include <algorithm>
+
+DRAGON_BEGIN
+
+namespace {
+
+	// U = G * g * trans(G), g is 3x3, U is 4x4.
+	template<class T>
+	void transformKernel(const T* g, T* u) {
+		T t[4][3];
+		for (size_t j = 0; j < 3; j++) {
+			t[0][j] = g[j];
+			t[1][j] = (g[j] + g[3 + j] + g[6 + j]) * T(0.5);
+			t[2][j] = (g[j] - g[3 + j] + g[6 + j]) * T(0.5);
+			t[3][j] = g[6 + j];
+		}
+		for (size_t i = 0; i < 4; i++) {
+			u[i * 4 + 0] = t[i][0];
+			u[i * 4 + 1] = (t[i][0] + t[i][1] + t[i][2]) * T(0.5);
+			u[i * 4 + 2] = (t[i][0] - t[i][1] + t[i][2]) * T(0.5);
+			u[i * 4 + 3] = t[i][2];
+		}
+	}
+
+}
+
+template<class T>
+BasicTensor3D<T> winogradKernels(const BasicTensor3D<T>& kernels, size_t outputDepth, size_t inputDepth, bool transposed) {
+	BasicTensor3D<T> result;
+	winogradKernels(result, kernels, outputDepth, inputDepth, transposed);
+	return result;
+}
+
+template<class T>
+void winogradKernels(BasicTensor3D<T>& result, const BasicTensor3D<T>& kernels, size_t outputDepth, size_t inputDepth, bool transposed) {
+	assert((kernels.getRows() == 3 && kernels.getCols() == 3 && kernels.getDepth() == outputDepth * inputDepth) &&
+		"Winograd convolution needs 3x3 kernels!");
+
+	size_t resultOutputDepth = transposed ? inputDepth : outputDepth;
+	size_t resultInputDepth = transposed ? outputDepth : inputDepth;
+	if (result.getDepth() != 16 || result.getRows() != resultOutputDepth || result.getCols() != resultInputDepth ||
+		result.getLayout() != Layout::Planar)
+		result = BasicTensor3D<T>(BasicTensor<T>::allocateData(16 * outputDepth * inputDepth), 16, resultOutputDepth, resultInputDepth);
+
+	for (size_t i = 0; i < outputDepth; i++) {
+		for (size_t k = 0; k < inputDepth; k++) {
+			const T* kernel = kernels.getData() + (i * inputDepth + k) * 9;
+
+			T g[9];
+			for (size_t t = 0; t < 9; t++)
+				g[t] = transposed ? kernel[8 - t] : kernel[t];
+
+			T u[16];
+			transformKernel(g, u);
+
+			size_t row = transposed ? k : i;
+			size_t col = transposed ? i : k;
+			for (size_t e = 0; e < 16; e++)
+				result.getData()[(e * resultOutputDepth + row) * resultInputDepth + col] = u[e];
+		}
+	}
+}
+
+template<class T>
+void winogradConvolution(NonDeduced<TensorView<3, T>> output, NonDeduced<ConstTensorView<3, T>> input, const BasicTensor3D<T>& transformedKernels, size_t padding) {
+	size_t outputDepth = transformedKernels.getRows();
+	size_t inputDepth = transformedKernels.getCols();
+	assert((transformedKernels.getDepth() == 16 && input.getDepth() == inputDepth && output.getDepth() == outputDepth &&
+		output.getRows() == input.getRows() + 2 * padding - 2 && output.getCols() == input.getCols() + 2 * padding - 2) &&
+		"Parameters not match for winogradConvolution!");
+
+	size_t tileRows = (output.getRows() + 1) / 2;
+	size_t tileCols = (output.getCols() + 1) / 2;
+	size_t tileCount = tileRows * tileCols;
+
+	// Transformed input tiles [16][input depth][tile] and their products [16][output depth][tile].
+	thread_local std::vector<T> transformedInput;
+	thread_local std::vector<T> products;
+	transformedInput.resize(16 * inputDepth * tileCount);
+	products.resize(16 * outputDepth * tileCount);
+
+	size_t inputRows = input.getRows();
+	size_t inputCols = input.getCols();
+
+	// The transforms are separable, they are done for a whole row of tiles at once:
+	// first between the rows of the tile row, than between the columns of every tile.
+	// So the inner loops go through the tiles and can be vectorized.
+	size_t paddedCols = 2 * tileCols + 2;
+	size_t copiedCols = std::min(inputCols, paddedCols - padding);
+	size_t inputStep = input.getStride(2);
+	thread_local std::vector<T> rowBuffer;
+	rowBuffer.resize(4 * paddedCols);
+
+	for (size_t k = 0; k < inputDepth; k++) {
+		for (size_t ti = 0; ti < tileRows; ti++) {
+			// Copy the 4 input rows of the tile row with the virtual zero padding.
+			T* d[4];
+			for (size_t a = 0; a < 4; a++) {
+				d[a] = rowBuffer.data() + a * paddedCols;
+				std::fill(d[a], d[a] + paddedCols, T());
+
+				size_t r = 2 * ti + a;
+				if (r >= padding && r - padding < inputRows) {
+					const T* source = &input(k, r - padding, 0);
+					for (size_t c = 0; c < copiedCols; c++)
+						d[a][padding + c] = source[c * inputStep];
+				}
+			}
+
+			// t = trans(B) * d, the result is written over the rows.
+			for (size_t c = 0; c < paddedCols; c++) {
+				T d0 = d[0][c], d1 = d[1][c], d2 = d[2][c], d3 = d[3][c];
+				d[0][c] = d0 - d2;
+				d[1][c] = d1 + d2;
+				d[2][c] = d2 - d1;
+				d[3][c] = d1 - d3;
+			}
+
+			// V = t * B, every tile element goes to its own matrix.
+			for (size_t a = 0; a < 4; a++) {
+				const T* t = d[a];
+				T* v0 = transformedInput.data() + ((a * 4 + 0) * inputDepth + k) * tileCount + ti * tileCols;
+				T* v1 = v0 + inputDepth * tileCount;
+				T* v2 = v1 + inputDepth * tileCount;
+				T* v3 = v2 + inputDepth * tileCount;
+				for (size_t tj = 0; tj < tileCols; tj++) {
+					T t0 = t[2 * tj], t1 = t[2 * tj + 1], t2 = t[2 * tj + 2], t3 = t[2 * tj + 3];
+					v0[tj] = t0 - t2;
+					v1[tj] = t1 + t2;
+					v2[tj] = t2 - t1;
+					v3[tj] = t1 - t3;
+				}
+			}
+		}
+	}
+
+	// The elementwise products of the tiles summed over the input depth, one gemm per tile element.
+	for (size_t e = 0; e < 16; e++) {
+		gemm(false, false,
+			outputDepth, tileCount, inputDepth,
+			T(1), transformedKernels.getData() + e * outputDepth * inputDepth, inputDepth,
+			transformedInput.data() + e * inputDepth * tileCount, tileCount,
+			T(), products.data() + e * outputDepth * tileCount, tileCount);
+	}
+
+	size_t outputRows = output.getRows();
+	size_t outputCols = output.getCols();
+
+	size_t outputStep = output.getStride(2);
+
+	for (size_t i = 0; i < outputDepth; i++) {
+		for (size_t ti = 0; ti < tileRows; ti++) {
+			// t = trans(A) * m, two rows of 4 values for every tile.
+			T* t[2][4];
+			for (size_t b = 0; b < 4; b++) {
+				t[0][b] = rowBuffer.data() + b * tileCols;
+				t[1][b] = rowBuffer.data() + (4 + b) * tileCols;
+				const T* m0 = products.data() + ((0 * 4 + b) * outputDepth + i) * tileCount + ti * tileCols;
+				const T* m1 = m0 + 4 * outputDepth * tileCount;
+				const T* m2 = m1 + 4 * outputDepth * tileCount;
+				const T* m3 = m2 + 4 * outputDepth * tileCount;
+				for (size_t tj = 0; tj < tileCols; tj++) {
+					t[0][b][tj] = m0[tj] + m1[tj] + m2[tj];
+					t[1][b][tj] = m1[tj] - m2[tj] - m3[tj];
+				}
+			}
+
+			// Y = t * A, the two output rows of the tile row.
+			// Odd output sizes: the last tile is only partly inside the output.
+			for (size_t a = 0; a < 2 && 2 * ti + a < outputRows; a++) {
+				T* row = &output(i, 2 * ti + a, 0);
+				const T* t0 = t[a][0];
+				const T* t1 = t[a][1];
+				const T* t2 = t[a][2];
+				const T* t3 = t[a][3];
+				size_t fullTiles = outputCols / 2;
+				for (size_t tj = 0; tj < fullTiles; tj++) {
+					row[2 * tj * outputStep] = t0[tj] + t1[tj] + t2[tj];
+					row[(2 * tj + 1) * outputStep] = t1[tj] - t2[tj] - t3[tj];
+				}
+				if (fullTiles < tileCols)
+					row[2 * fullTiles * outputStep] = t0[fullTiles] + t1[fullTiles] + t2[fullTiles];
+			}
+		}
+	}
+}
+
+#define WINOGRAD_TEMPLATES(T) \
+	template DRAGON_API BasicTensor3D<T> winogradKernels(const BasicTensor3D<T>&, size_t, size_t, bool); \
+	template DRAGON_API void winogradKernels(BasicTensor3D<T>&, const BasicTensor3D<T>&, size_t, size_t, bool); \
+	template DRAGON_API void winogradConvolution<T>(TensorView<3, T>, ConstTensorView<3, T>, const BasicTensor3D<T>&, size_t);
+DRAGON_INSTANTIATE(WINOGRAD_TEMPLATES)
+
+DRAGON_END
\ No newline at end of file
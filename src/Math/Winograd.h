@@ -0,0 +1,31 @@
+#pragma once
+#include "../Core.h"
+
+#include "Tensor.h"
+#include "Tensor3D.h"
+#include "TensorView.h"
+
+/*
+Winograd F(2x2, 3x3) convolution for stride 1 convolutions with 3x3 kernels.
+Every 2x2 output tile is calculated from a 4x4 input tile with 16 multiplications
+instead of 36, the products over the input depths are done as 16 matrix multiplications.
+*/
+
+DRAGON_BEGIN
+
+// Transform 3x3 kernels stored as [output depth][input depth][3][3] (Tensor3D with depth = outputDepth * inputDepth).
+// The result is 16 x outputDepth x inputDepth, one outputDepth x inputDepth matrix for every element of the 4x4 tile.
+// If transposed is true the kernels are rotated by 180 degree and the input and output depths are swapped,
+// that is the kernel set of the convolution that gives the gradient respect to the input.
+template<class T> DRAGON_API BasicTensor3D<T> winogradKernels(const BasicTensor3D<T>& kernels, size_t outputDepth, size_t inputDepth, bool transposed);
+// Same as above, the transformed kernels are written into result. The result is only reallocated
+// if its shape doesn't match, so a kernel cache can be rebuilt after every update without allocation.
+template<class T> DRAGON_API void winogradKernels(BasicTensor3D<T>& result, const BasicTensor3D<T>& kernels, size_t outputDepth, size_t inputDepth, bool transposed);
+
+// Calculate the stride 1 convolution of the input with the transformed 3x3 kernels
+// and sum the results of the input depths per output depth.
+// The input is virtually padded with padding zeros on every side,
+// the output has the depth of the kernels and inputRows + 2 * padding - 2 rows (same for the cols).
+template<class T> DRAGON_API void winogradConvolution(NonDeduced<TensorView<3, T>> output, NonDeduced<ConstTensorView<3, T>> input, const BasicTensor3D<T>& transformedKernels, size_t padding);
+
+DRAGON_END
\ No newline at end of file
@@ -2,12 +2,28 @@
 
 DRAGON_BEGIN
 
-ActivationFunction::ActivationFunction(
-	const std::function<void(double& x)>& activation,
-	const std::function<void(double& x)>& activationDiff,
+template<class T>
+BasicActivationFunction<T>::BasicActivationFunction(
+	const ElementFunction& activation,
+	const ElementFunction& activationDiff,
+	const std::string& name) :
+	BasicActivationFunction(
+		activation, activationDiff,
+		[activation](precision* data, size_t count) { for (size_t i = 0; i < count; i++) activation(data[i]); },
+		[activationDiff](precision* data, size_t count) { for (size_t i = 0; i < count; i++) activationDiff(data[i]); },
+		name) { }
+
+template<class T>
+BasicActivationFunction<T>::BasicActivationFunction(
+	const ElementFunction& activation,
+	const ElementFunction& activationDiff,
+	const SpanFunction& activationSpan,
+	const SpanFunction& activationDiffSpan,
 	const std::string& name) :
 	m_Activation(activation),
 	m_ActivationDiff(activationDiff),
+	m_ActivationSpan(activationSpan),
+	m_ActivationDiffSpan(activationDiffSpan),
 	m_Name(name) {
 	assert((!m_Name.empty()) &&
 	"Activation function name cannot be empty!");
@@ -16,14 +32,25 @@ ActivationFunction::ActivationFunction(
 }
 
 namespace activation {
-	void sigmoid(double& x) { x = 1.0 / (1.0 + exp(-x)); }
-	void sigmoidDiff(double& x) { double tmp = x; sigmoid(tmp); x = tmp * (1.0 - tmp); }
+	template<class T> void sigmoid(T& x) { x = T(1) / (T(1) + std::exp(-x)); }
+	template<class T> void sigmoidDiff(T& x) { T tmp = x; sigmoid(tmp); x = tmp * (T(1) - tmp); }
 }
 
-ActivationFunction sigmoid()	{ return ActivationFunction(activation::sigmoid, activation::sigmoidDiff, "sigmoid"); }
-ActivationFunction relU()		{ return ActivationFunction(activation::relU<0>, activation::relUDiff<0>, "relU"); }
-ActivationFunction relU10()		{ return ActivationFunction(activation::relU<10>, activation::relUDiff<10>, "relU10"); }
-ActivationFunction relU100()	{ return ActivationFunction(activation::relU<100>, activation::relUDiff<100>, "relU100"); }
-ActivationFunction relU500()	{ return ActivationFunction(activation::relU<500>, activation::relUDiff<500>, "relU500"); }
+template<class T> BasicActivationFunction<T> sigmoid()	{ return makeActivation<activation::sigmoid<T>, activation::sigmoidDiff<T>>("sigmoid"); }
+template<class T> BasicActivationFunction<T> relU()		{ return makeActivation<activation::relU<0, T>, activation::relUDiff<0, T>>("relU"); }
+template<class T> BasicActivationFunction<T> relU10()		{ return makeActivation<activation::relU<10, T>, activation::relUDiff<10, T>>("relU10"); }
+template<class T> BasicActivationFunction<T> relU100()	{ return makeActivation<activation::relU<100, T>, activation::relUDiff<100, T>>("relU100"); }
+template<class T> BasicActivationFunction<T> relU500()	{ return makeActivation<activation::relU<500, T>, activation::relUDiff<500, T>>("relU500"); }
+
+#define ACTIVATION_TEMPLATES(T) \
+	template class DRAGON_API BasicActivationFunction<T>; \
+	template DRAGON_API void activation::sigmoid(T&); \
+	template DRAGON_API void activation::sigmoidDiff(T&); \
+	template DRAGON_API BasicActivationFunction<T> sigmoid(); \
+	template DRAGON_API BasicActivationFunction<T> relU(); \
+	template DRAGON_API BasicActivationFunction<T> relU10(); \
+	template DRAGON_API BasicActivationFunction<T> relU100(); \
+	template DRAGON_API BasicActivationFunction<T> relU500();
+DRAGON_INSTANTIATE(ACTIVATION_TEMPLATES)
 
 DRAGON_END
\ No newline at end of file
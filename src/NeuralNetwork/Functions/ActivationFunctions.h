@@ -1,64 +1,119 @@
 #pragma once
-#include <math.h>
+#include <cmath>
 #include <functional>
 #include <string>
 
 #include "../../Core.h"
+#include "../../Math/Tensor.h"
 
 DRAGON_BEGIN
 
 // Define a structure of an activation function and it's derivative.
 // The getName funciton needed for the model to load and save the model.
-class DRAGON_API ActivationFunction {
+// The layers apply the functions to a whole tensor at once with apply and applyDiff,
+// these call the span functions, so there is one indirect call per tensor and not per element.
+// If the activation is created with the element functions only, the span functions call them
+// element by element, use makeActivation to get span functions with the element function inlined.
+template<class T>
+class BasicActivationFunction {
 public:
-	ActivationFunction() = default;
-	ActivationFunction(
-		const std::function<void(double& x)>& activation,
-		const std::function<void(double& x)>& activationDiff,
+	DRAGON_TENSOR_TYPES(T)
+	using ElementFunction = std::function<void(precision& x)>;
+	using SpanFunction = std::function<void(precision* data, size_t count)>;
+
+	BasicActivationFunction() = default;
+	BasicActivationFunction(
+		const ElementFunction& activation,
+		const ElementFunction& activationDiff,
+		const std::string& name);
+	BasicActivationFunction(
+		const ElementFunction& activation,
+		const ElementFunction& activationDiff,
+		const SpanFunction& activationSpan,
+		const SpanFunction& activationDiffSpan,
 		const std::string& name);
 public:
 
-	inline const std::function<void(double& x)>& getActivation() const { return m_Activation; }
-	inline const std::function<void(double& x)>& getActivationDiff() const { return m_ActivationDiff; }
+	inline const ElementFunction& getActivation() const { return m_Activation; }
+	inline const ElementFunction& getActivationDiff() const { return m_ActivationDiff; }
 	inline const std::string& getName() const { return m_Name; }
+	// The span functions, for the kernels that apply the activation themselves (like the gemm epilogue).
+	inline const SpanFunction& getActivationSpan() const { return m_ActivationSpan; }
+	inline const SpanFunction& getActivationDiffSpan() const { return m_ActivationDiffSpan; }
+
+	// Apply the activation function to every element of the tensor.
+	inline Tensor& apply(Tensor& tensor) const { m_ActivationSpan(tensor.getData(), tensor.getCount()); return tensor; }
+	// Apply the derivative of the activation function to every element of the tensor.
+	inline Tensor& applyDiff(Tensor& tensor) const { m_ActivationDiffSpan(tensor.getData(), tensor.getCount()); return tensor; }
 
 private:
-	std::function<void(double& x)> m_Activation;
-	std::function<void(double& x)> m_ActivationDiff;
+	ElementFunction m_Activation;
+	ElementFunction m_ActivationDiff;
+	SpanFunction m_ActivationSpan;
+	SpanFunction m_ActivationDiffSpan;
 	std::string m_Name;
 };
 
+extern template class DRAGON_API BasicActivationFunction<float>;
+extern template class DRAGON_API BasicActivationFunction<double>;
+using ActivationFunction = BasicActivationFunction<precision>;
 
-// Built in activation functions.
-DRAGON_API ActivationFunction sigmoid();
+
+// Built in activation functions, sigmoid<float>() is the activation of a float layer.
+template<class T = precision> DRAGON_API BasicActivationFunction<T> sigmoid();
 // Returns the normal relU function.
-DRAGON_API ActivationFunction relU();
+template<class T = precision> DRAGON_API BasicActivationFunction<T> relU();
 // Returns the relU function with an offset tangent of 1/10.
-DRAGON_API ActivationFunction relU10();
+template<class T = precision> DRAGON_API BasicActivationFunction<T> relU10();
 // Returns the relU function with an offset tangent of 1/100.
-DRAGON_API ActivationFunction relU100();
+template<class T = precision> DRAGON_API BasicActivationFunction<T> relU100();
 // Returns the relU function with an offset tangent of 1/500.
-DRAGON_API ActivationFunction relU500();
+template<class T = precision> DRAGON_API BasicActivationFunction<T> relU500();
 
 namespace activation {
 	// Common Neurla Net activation function.
 	// Clips the values betwen -1 and 1. If x <<< -1 -> 0 , x >>> 1 -> 1.
 	// Values that are close to 0 are become closly linear.
-	DRAGON_API void sigmoid(double& x);
+	template<class T> DRAGON_API void sigmoid(T& x);
 	// Common Neurla Net activation function, the derivative of sigmoid.
 	// The values are closly 0 where x <<< -1 or x >>> 1, and if x == 0 it's 1.
-	DRAGON_API void sigmoidDiff(double& x);
+	template<class T> DRAGON_API void sigmoidDiff(T& x);
 
 	// Commont Neural Net activation function.
 	// Template parameter ratio is the reciprocal of the function tangent "m"
 	// The values x < 0 are multiplied with m, and where x >= 0 are multiplied with 1 + m.
-	template<int ratio>
-	void relU(double& x) { double m = (ratio) ? 1.0 / (double)ratio : 0.0; x = (x >= 0.0) ? (1.0 + m) * x : m * x; }
+	template<int ratio, class T>
+	void relU(T& x) { T m = (ratio) ? T(1) / T(ratio) : T(); x = (x >= T()) ? (1 + m) * x : m * x; }
 	// Commont Neural Net activation function, the derivative of relU.
 	// Template parameter ratio is the reciprocal of the function tangent "m"
 	// The values x < 0 are become m, else they become 1 + m.
-	template<int ratio>
-	void relUDiff(double& x) { double m = (ratio) ? 1.0 / (double)ratio : 0.0; x = (x >= 0.0) ? 1.0 + m : m; }
+	template<int ratio, class T>
+	void relUDiff(T& x) { T m = (ratio) ? T(1) / T(ratio) : T(); x = (x >= T()) ? 1 + m : m; }
+
+	// Apply the element function to every element of the span.
+	// The function is a template parameter, so it's inlined into the loop.
+	template<class T, void(*Function)(T& x)>
+	void applyToSpan(T* data, size_t count) {
+		for (size_t i = 0; i < count; i++)
+			Function(data[i]);
+	}
+}
+
+namespace activation {
+	// The element type of an element function.
+	template<class Function> struct ElementOf;
+	template<class T> struct ElementOf<void(*)(T& x)> { using Type = T; };
+}
+
+// Create an activation function with span functions that have the element functions inlined,
+// the element type of the activation is the type the element functions take.
+// [example] ActivationFunction myActivation = makeActivation<myFunction, myFunctionDiff>("myActivation");
+template<auto Activation, auto ActivationDiff, class T = typename activation::ElementOf<decltype(Activation)>::Type>
+BasicActivationFunction<T> makeActivation(const std::string& name) {
+	return BasicActivationFunction<T>(
+		Activation, ActivationDiff,
+		activation::applyToSpan<T, Activation>, activation::applyToSpan<T, ActivationDiff>,
+		name);
 }
 
 DRAGON_END
\ No newline at end of file
@@ -1,8 +1,10 @@
 #pragma once
 
 #include <random>
+#include <cmath>
 
 #include "../../Core.h"
+#include "../../Math/Tensor.h"
 
 /*
 	Containes some usefull Neural Network layer initializer functions.
@@ -10,25 +12,25 @@
 
 DRAGON_BEGIN
 
-template<size_t nInputNodes, size_t nOutputNodes>
-double initXavier() {
+template<size_t nInputNodes, size_t nOutputNodes, class T = precision>
+T initXavier() {
 	std::random_device rg;
 	double min = -1.0 / sqrt(nInputNodes), max = 1.0 / sqrt(nInputNodes);
-	return min + ((double)rg() / (double)rg.max()) * (max - min);
+	return T(min + ((double)rg() / (double)rg.max()) * (max - min));
 }
 
-template<size_t nInputNodes, size_t nOutputNodes>
-double initNormXavier() {
+template<size_t nInputNodes, size_t nOutputNodes, class T = precision>
+T initNormXavier() {
 	std::random_device rg;
 	double min = -sqrt(6.0 / double(nInputNodes + nOutputNodes)), max = sqrt(6.0 / double(nInputNodes + nOutputNodes));
-	return min + ((double)rg() / (double)rg.max()) * (max - min);
+	return T(min + ((double)rg() / (double)rg.max()) * (max - min));
 }
 
-template<size_t nInputNodes, size_t nOutputNodes>
-double initHe() {
+template<size_t nInputNodes, size_t nOutputNodes, class T = precision>
+T initHe() {
 	std::random_device rg;
 	double min = -sqrt(2.0 / nInputNodes), max = sqrt(2.0 / nInputNodes);
-	return min + ((double)rg() / (double)rg.max()) * (max - min);
+	return T(min + ((double)rg() / (double)rg.max()) * (max - min));
 }
 
 DRAGON_END
\ No newline at end of file
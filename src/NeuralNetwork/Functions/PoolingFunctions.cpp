@@ -2,7 +2,8 @@
 
 DRAGON_BEGIN
 
-double maxPool(const std::vector<double>& values) {
+template<class T>
+T MaxPool::operator()(const std::vector<T>& values) const {
 	size_t index = 0;
 	for (size_t i = 1; i < values.size(); i++)
 		if (values[i] > values[index])
@@ -10,8 +11,9 @@ double maxPool(const std::vector<double>& values) {
 	return values[index];
 }
 
-std::vector<double> maxPoolDiff(const std::vector<double>& values, double value) {
-	std::vector<double> result(values.size(), 0.0);
+template<class T>
+std::vector<T> MaxPoolDiff::operator()(const std::vector<T>& values, NonDeduced<T> value) const {
+	std::vector<T> result(values.size(), T());
 	size_t index = 0;
 	for (size_t i = 1; i < values.size(); i++)
 		if (values[i] > values[index])
@@ -20,4 +22,9 @@ std::vector<double> maxPoolDiff(const std::vector<double>& values, double value)
 	return result;
 }
 
+#define POOLING_FUNCTION_TEMPLATES(T) \
+	template DRAGON_API T MaxPool::operator()(const std::vector<T>&) const; \
+	template DRAGON_API std::vector<T> MaxPoolDiff::operator()(const std::vector<T>&, T) const;
+DRAGON_INSTANTIATE(POOLING_FUNCTION_TEMPLATES)
+
 DRAGON_END
\ No newline at end of file
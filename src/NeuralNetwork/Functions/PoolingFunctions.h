@@ -2,11 +2,23 @@
 #include <vector>
 
 #include "../../Core.h"
+#include "../../Math/Tensor.h"
 
 DRAGON_BEGIN
 
-DRAGON_API double maxPool(const std::vector<double>& values);
+// The pooling functions are function objects, so maxPool is the pooling function of a PoolingLayer of any element type.
+struct DRAGON_API MaxPool {
+	template<class T>
+	T operator()(const std::vector<T>& values) const;
+};
 
-DRAGON_API std::vector<double> maxPoolDiff(const std::vector<double>& values, double value);
+struct DRAGON_API MaxPoolDiff {
+	template<class T>
+	std::vector<T> operator()(const std::vector<T>& values, NonDeduced<T> value) const;
+};
+
+inline constexpr MaxPool maxPool{};
+
+inline constexpr MaxPoolDiff maxPoolDiff{};
 
 DRAGON_END
\ No newline at end of file
@@ -3,8 +3,123 @@
 
 DRAGON_BEGIN
 
-BaseLayer::BaseLayer(
+template<class T>
+BasicBaseLayer<T>::BasicBaseLayer(
 	const ActivationFunction& activation) :
 	m_Activation(activation) { }
 
+namespace {
+
+	// Copy of the index-th sample of the batch.
+	template<class T>
+	BasicTensor1D<T> batchRow(const BasicTensor2D<T>& batch, size_t index) {
+		return BasicTensor1D<T>(batch.getCols(), batch.getData() + index * batch.getCols());
+	}
+
+	// Copy the whole batch into result, that has the same size.
+	template<class T>
+	void copyBatch(BasicTensor2D<T>& result, const BasicTensor2D<T>& batch) {
+		assert((result.getRows() == batch.getRows() && result.getCols() == batch.getCols()) && "Batch parameters not match!");
+		kernel::copy(result.getData(), batch.getData(), batch.getCount());
+	}
+
+	// Copy the sample into the index-th row of the batch, the batch is allocated with the first sample.
+	template<class T>
+	void setBatchRow(BasicTensor2D<T>& batch, size_t batchSize, size_t index, const BasicTensor1D<T>& sample) {
+		if (index == 0)
+			batch = BasicTensor2D<T>(BasicTensor<T>::allocateData(batchSize * sample.getCount()), batchSize, sample.getCount());
+		assert((batch.getCols() == sample.getCount()) && "Samples of the batch not match!");
+		kernel::copy(batch.getData() + index * batch.getCols(), sample.getData(), sample.getCount());
+	}
+
+}
+
+template<class T>
+BasicTensor2D<T> BasicBaseLayer<T>::feedForwardBatch(const Tensor2D& input) const {
+	assert((input.getRows() > 0) && "Empty batch!");
+
+	Tensor2D result;
+	for (size_t n = 0; n < input.getRows(); n++)
+		setBatchRow(result, input.getRows(), n, feedForward(batchRow(input, n)));
+	return result;
+}
+
+template<class T>
+void BasicBaseLayer<T>::feedForwardBatch(const Tensor2D& input, Tensor2D& output) const {
+	copyBatch(output, feedForwardBatch(input));
+}
+
+template<class T>
+BasicTensor2D<T> BasicBaseLayer<T>::backPropagateBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	double learningRate) {
+	size_t batchSize = sumsAfter.getRows();
+	assert((batchSize > 0 && costAfter.getRows() == batchSize && activationsBefore.getRows() == batchSize) &&
+		"Invalid batch parameters!");
+
+	Tensor2D costBefore;
+	for (size_t n = 0; n < batchSize; n++) {
+		Tensor1D sums = batchRow(sumsAfter, n);
+		Tensor1D cost = batchRow(costAfter, n);
+		Tensor1D activations = batchRow(activationsBefore, n);
+		setBatchRow(costBefore, batchSize, n, backPropagate(sums, cost, activations, learningRate / double(batchSize)));
+	}
+	return costBefore;
+}
+
+template<class T>
+BasicTensor2D<T> BasicBaseLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision*) {
+	assert((getParameters().empty()) && "Layers with parameters have to override gradientsBatch!");
+	return backPropagateBatch(sumsAfter, costAfter, activationsBefore, 0.0);
+}
+
+template<class T>
+void BasicBaseLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision* gradients,
+	Tensor2D& costBefore) {
+	copyBatch(costBefore, gradientsBatch(sumsAfter, costAfter, activationsBefore, gradients));
+}
+
+template<class T>
+size_t BasicBaseLayer<T>::getParameterCount() {
+	size_t count = 0;
+	std::vector<Tensor*> parameters = getParameters();
+	for (size_t i = 0; i < parameters.size(); i++)
+		count += parameters[i]->getCount();
+	return count;
+}
+
+template<class T>
+BasicPreparePropagateBatchData<T> BasicBaseLayer<T>::preparePropagateBatch(const Tensor2D& input) const {
+	assert((input.getRows() > 0) && "Empty batch!");
+
+	PreparePropagateBatchData bData;
+	bData.input = input;
+	for (size_t n = 0; n < input.getRows(); n++) {
+		PreparePropagateData pData = preparePropagate(batchRow(input, n));
+		setBatchRow(bData.sum, input.getRows(), n, pData.sum);
+		setBatchRow(bData.output, input.getRows(), n, pData.output);
+	}
+	return bData;
+}
+
+template<class T>
+void BasicBaseLayer<T>::preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const {
+	PreparePropagateBatchData bData = preparePropagateBatch(input);
+	copyBatch(sum, bData.sum);
+	copyBatch(output, bData.output);
+}
+
+template class DRAGON_API BasicBaseLayer<float>;
+template class DRAGON_API BasicBaseLayer<double>;
+
 DRAGON_END
\ No newline at end of file
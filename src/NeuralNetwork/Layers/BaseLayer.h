@@ -11,6 +11,7 @@
 
 #include "../../Math/MathCore.h"
 #include "../Functions/Functions.h"
+#include "../TextReader.h"
 
 DRAGON_BEGIN
 
@@ -32,6 +33,23 @@ struct ParameterType {
 };
 
 
+/// <summary>
+/// DataLayout describes how a layer keeps its 3D input or output data in the flat Tensor1D.
+/// Layers working on flat data (like DenseLayer) are planar, their shape is not needed.
+/// </summary>
+template<class T>
+struct BasicDataLayout {
+	Layout layout = Layout::Planar;
+	size_t rows = 0;
+	size_t cols = 0;
+	size_t depth = 0;
+
+	// Number of values in the flat data, with the padding of the blocked layout.
+	size_t getCount() const { return layoutCount<T>(layout, depth, rows, cols); }
+};
+using DataLayout = BasicDataLayout<precision>;
+
+
 /// <summary>
 /// PreparaPropagateData holds the data for the backPropagate algorithm.
 /// For training the model firts we need to push through the training data in the model and
@@ -39,17 +57,54 @@ struct ParameterType {
 /// At the end of the mondel we calculate a cost, and propagate backward with that cost 
 /// and tha saved data.
 /// </summary>
-struct DRAGON_API PreparePropagateData {
-	Tensor1D input;
-	Tensor1D sum;
-	Tensor1D output;
+template<class T>
+struct BasicPreparePropagateData {
+	BasicTensor1D<T> input;
+	BasicTensor1D<T> sum;
+	BasicTensor1D<T> output;
+
+	BasicPreparePropagateData() = default;
+	BasicPreparePropagateData(BasicPreparePropagateData&& other) noexcept :
+		input(std::move(other.input)),
+		sum(std::move(other.sum)),
+		output(std::move(other.output)) { }
+};
+using PreparePropagateData = BasicPreparePropagateData<precision>;
 
-	PreparePropagateData() = default;
-	PreparePropagateData(PreparePropagateData&& other) noexcept :
+
+/// <summary>
+/// PreparePropagateBatchData is the PreparePropagateData of a mini-batch,
+/// every row of the tensors belongs to one sample.
+/// </summary>
+template<class T>
+struct BasicPreparePropagateBatchData {
+	BasicTensor2D<T> input;
+	BasicTensor2D<T> sum;
+	BasicTensor2D<T> output;
+
+	BasicPreparePropagateBatchData() = default;
+	BasicPreparePropagateBatchData(BasicPreparePropagateBatchData&& other) noexcept :
 		input(std::move(other.input)),
 		sum(std::move(other.sum)),
 		output(std::move(other.output)) { }
 };
+using PreparePropagateBatchData = BasicPreparePropagateBatchData<precision>;
+
+
+template<class T> class BasicBaseLayer;
+
+// The names of the layer types with the element type T inside the layer class templates, like DRAGON_TENSOR_TYPES.
+#define DRAGON_LAYER_TYPES(T) \
+	DRAGON_TENSOR_TYPES(T) \
+	using ActivationFunction = BasicActivationFunction<T>; \
+	using QuantizedWeights = BasicQuantizedWeights<T>; \
+	using CsrMatrix = BasicCsrMatrix<T>; \
+	using Epilogue = BasicEpilogue<T>; \
+	using DataLayout = BasicDataLayout<T>; \
+	using PreparePropagateData = BasicPreparePropagateData<T>; \
+	using PreparePropagateBatchData = BasicPreparePropagateBatchData<T>; \
+	using BaseLayer = BasicBaseLayer<T>; \
+	using Complex = std::complex<T>;
 
 
 /// <summary>
@@ -58,13 +113,19 @@ struct DRAGON_API PreparePropagateData {
 ///	m_Activation is need for the feedForward algorithm to calculate the layer activations.
 /// m_ActivationDiff is need for the backPropagete algorithm to calulate the gradients.
 /// </summary>
-class DRAGON_API BaseLayer {
+template<class T>
+class BasicBaseLayer {
+public:
+	DRAGON_LAYER_TYPES(T)
+
 protected:
 	ActivationFunction m_Activation;
 
 public:
-	BaseLayer() = default;
-	BaseLayer(const ActivationFunction& activation);
+	BasicBaseLayer() = default;
+	BasicBaseLayer(const ActivationFunction& activation);
+	// The model deletes the layers it created through BaseLayer pointers.
+	virtual ~BasicBaseLayer() = default;
 
 	inline ActivationFunction& getActivation() { return m_Activation; }
 	inline const ActivationFunction& getActivation() const { return m_Activation; }
@@ -87,14 +148,97 @@ public:
 	// Push the data forward and save the layer calculations.
 	virtual PreparePropagateData preparePropagate(const Tensor1D& input) const = 0;
 
+	// Mini-batch versions of the functions above, every row of the tensors is one sample.
+	// The default implementations run the single sample functions row by row.
+	virtual Tensor2D feedForwardBatch(const Tensor2D& input) const;
+	// feedForwardBatch into output, that has one row per sample and the size of the layer's output, for the InferencePlan.
+	// The built in layers don't allocate in it, the default implementation calls feedForwardBatch and copies the result.
+	virtual void feedForwardBatch(const Tensor2D& input, Tensor2D& output) const;
+	// The gradients of the samples are averaged and the parameters are updated once.
+	// The default implementation backpropagates the samples one by one with learningRate / batch size,
+	// that is the same only for layers without parameters, so layers with parameters override it.
+	virtual Tensor2D backPropagateBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		double learningRate);
+	virtual PreparePropagateBatchData preparePropagateBatch(const Tensor2D& input) const;
+
+	// The trainable parameter tensors of the layer, layers without parameters return an empty list.
+	virtual std::vector<Tensor*> getParameters() { return {}; }
+	// Same as backPropagateBatch, but the parameters are not updated: the gradients summed over the batch are
+	// added to gradients, that holds the gradients of getParameters packed one after the other (getParameterCount values).
+	// It doesn't change the layer, so it can run on different batches from several threads at once.
+	// The default implementation is for layers without parameters, layers with parameters override it.
+	virtual Tensor2D gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients);
+	// Versions of preparePropagateBatch and gradientsBatch writing into the given tensors, for the TrainingSession
+	// that plans the buffers once. The tensors have one row per sample, sum and output have the size of the layer's sums
+	// and outputs, costBefore has the size of the input. The built in layers don't allocate in these in the steady state,
+	// the default implementations call the allocating versions and copy the results.
+	virtual void preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const;
+	virtual void gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients,
+		Tensor2D& costBefore);
+	// Called after the parameters were changed from outside (like after an update from summed gradients),
+	// the layers with cached parameter transforms rebuild them here.
+	virtual void parametersChanged() { }
+
+	// Int8 quantization for the quantized InferencePlan (Model::quantize).
+	// quantize fills weights with the int8 weights (a scale per output channel) and the biases of the layer,
+	// layers without weights return false, they run feedForwardBatch in the quantized plan.
+	virtual bool quantize(QuantizedWeights&) const { return false; }
+	// feedForwardBatch with the quantized weights: the input is rounded to int8 with weights.inputScale,
+	// the products are summed in int32 and scaled back before the bias and the activation.
+	virtual void feedForwardQuantized(const Tensor2D& input, Tensor2D& output, const QuantizedWeights&) const {
+		feedForwardBatch(input, output);
+	}
+
+	// Store the weights in the format: Float16 and BFloat16 replace the precision weights of the layer with 16 bit ones
+	// (widened to float in the kernels), Precision widens them back. The 16 bit weights are only for inference,
+	// train the layer in Precision. Layers without weights return false, they stay in precision.
+	virtual bool setWeightFormat(WeightFormat) { return false; }
+	virtual WeightFormat getWeightFormat() const { return WeightFormat::Precision; }
+	// The 16 bit weights of the layer for the binary model file, nullptr if it has none.
+	// The loader packs the saved weights into them after fromDescription.
+	virtual HalfWeights* getHalfWeights() { return nullptr; }
+
+	// Number of values in the getParameters tensors.
+	size_t getParameterCount();
+
+	// Set the memory layout of the layer's 3D data, layers working on flat data ignore it.
+	virtual void setLayout(Layout) { }
+	// Layout of the layer's input and output data.
+	// The model converts the data between neighbouring layers of different layouts.
+	virtual DataLayout getInputLayout() const { return DataLayout(); }
+	virtual DataLayout getOutputLayout() const { return DataLayout(); }
+
 
 	// Save the layer's parameters into a string, wich can be saved into a file.
 	// The weight are rounded to 8 decimal digits.
 	virtual std::string toString() const = 0;
 	// Load the layer's parameters from a string, wich can be loaded from a file.
 	virtual void fromString(const std::string& rawString) = 0;
+	// Load the layer from its part of the text model file, the text is not copied.
+	// The built in layers read it with a TextReader, the default implementation calls fromString.
+	virtual void fromText(std::string_view text) { fromString(std::string(text)); }
+	// The binary model file keeps the description of the layer (its shapes and settings, everything but the parameters)
+	// and the raw values of getParameters. fromDescription sets up the layer with parameters of the right size,
+	// their values are set by the loader. The defaults use toString and fromString, so every layer can be saved.
+	virtual std::string getDescription() const { return toString(); }
+	virtual void fromDescription(const std::string& description) { fromString(description); }
 	// Get the layer's name(class name) as a string.
 	virtual std::string getName() const = 0;
 };
 
+extern template class DRAGON_API BasicBaseLayer<float>;
+extern template class DRAGON_API BasicBaseLayer<double>;
+using BaseLayer = BasicBaseLayer<precision>;
+
 DRAGON_END
\ No newline at end of file
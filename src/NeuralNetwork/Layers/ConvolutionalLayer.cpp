@@ -2,14 +2,28 @@
 
 DRAGON_BEGIN
 
-ConvolutionalLayer::ConvolutionalLayer() :
+namespace {
+
+	// The im2col columns of one sample, kept per thread, so the steady state does not allocate.
+	template<class T>
+	BasicTensor2D<T> columnBuffer(size_t rows, size_t cols) {
+		thread_local std::vector<T> buffer;
+		buffer.resize(rows * cols);
+		return BasicTensor2D<T>(rows, cols, BasicTensor<T>(buffer.data(), true));
+	}
+
+}
+
+template<class T>
+BasicConvolutionalLayer<T>::BasicConvolutionalLayer() :
 	m_InputType({ 0, 0, 0 }), m_OutputType({ 0, 0, 0 }), m_KernelStride(0) { }
 
-ConvolutionalLayer::ConvolutionalLayer(
+template<class T>
+BasicConvolutionalLayer<T>::BasicConvolutionalLayer(
 	size_t inputRows, size_t inputCols, size_t inputDepth,
 	size_t kernelRows, size_t kernelCols, size_t kernelCount,
 	size_t kernelStride,
-	const std::function<double()>& initFunction,
+	const std::function<precision()>& initFunction,
 	const ActivationFunction& activation)
 	:
 	m_InputType({ inputRows, inputCols, inputDepth }),
@@ -26,186 +40,706 @@ ConvolutionalLayer::ConvolutionalLayer(
 	assert((kernelRows == kernelCols) &&
 		"Not supported different kernel parameters!");	// TODO: add different kernel and stride parameter support (backpropagate)
 
-	m_Kernels = Tensor3D(kernelCount * inputDepth, kernelRows, kernelCols, initTensor(
+	m_Kernels = Tensor3D(kernelCount * inputDepth, kernelRows, kernelCols, initTensor<precision>(
 		kernelCount * inputDepth * kernelRows * kernelCols, initFunction));
 
 	m_Biases = Tensor3D(
 		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1],
-		initTensor(m_OutputType.getParameterCount(), initFunction));
+		initTensor<precision>(m_OutputType.getParameterCount(), initFunction));
+
+	updateKernelCache();
 }
 
-ConvolutionalLayer::ConvolutionalLayer(const ConvolutionalLayer& other) :
+template<class T>
+BasicConvolutionalLayer<T>::BasicConvolutionalLayer(const BasicConvolutionalLayer& other) :
+	BaseLayer(other.m_Activation),
 	m_InputType(other.m_InputType), m_OutputType(other.m_OutputType),
 	m_KernelStride(other.m_KernelStride),
 	m_Kernels(other.m_Kernels),
 	m_Biases(other.m_Biases),
-	BaseLayer(other.m_Activation) { }
-
-ConvolutionalLayer::ConvolutionalLayer(ConvolutionalLayer&& other) noexcept :
+	m_HalfWeights(other.m_HalfWeights),
+	m_Layout(other.m_Layout),
+	m_WinogradKernels(other.m_WinogradKernels),
+	m_WinogradKernelsTransposed(other.m_WinogradKernelsTransposed),
+	m_KernelSpectra(other.m_KernelSpectra),
+	m_FFTRows(other.m_FFTRows), m_FFTCols(other.m_FFTCols),
+	m_BlockedKernels(other.m_BlockedKernels),
+	m_BlockedKernelsTransposed(other.m_BlockedKernelsTransposed),
+	m_KernelCacheValid(other.m_KernelCacheValid) { }
+
+template<class T>
+BasicConvolutionalLayer<T>::BasicConvolutionalLayer(BasicConvolutionalLayer&& other) noexcept :
+	BaseLayer(other.m_Activation),
 	m_InputType(other.m_InputType), m_OutputType(other.m_OutputType),
 	m_KernelStride(other.m_KernelStride),
 	m_Kernels(std::move(other.m_Kernels)),
 	m_Biases(std::move(other.m_Biases)),
-	BaseLayer(other.m_Activation) { }
+	m_HalfWeights(std::move(other.m_HalfWeights)),
+	m_Layout(other.m_Layout),
+	m_WinogradKernels(std::move(other.m_WinogradKernels)),
+	m_WinogradKernelsTransposed(std::move(other.m_WinogradKernelsTransposed)),
+	m_KernelSpectra(std::move(other.m_KernelSpectra)),
+	m_FFTRows(other.m_FFTRows), m_FFTCols(other.m_FFTCols),
+	m_BlockedKernels(std::move(other.m_BlockedKernels)),
+	m_BlockedKernelsTransposed(std::move(other.m_BlockedKernelsTransposed)),
+	m_KernelCacheValid(other.m_KernelCacheValid) {
+	other.m_KernelCacheValid = false;
+}
 
-Tensor1D ConvolutionalLayer::feedForward(const Tensor1D& input) const {
-	assert((input.getCount() == m_InputType.getParameterCount()) &&
+template<class T>
+BasicTensor1D<T> BasicConvolutionalLayer<T>::feedForward(const Tensor1D& input) const {
+	assert((input.getCount() == getInputLayout().getCount()) &&
 		"Invalid input parameters!");
-	// Convert input into formated input.
-	Tensor3D working = Tensor3D(
-		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], input);
 
-	// Create a output Tensor3D.
-	Tensor3D output = Tensor3D(m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1], 0.0);
+	size_t outputCount = getOutputLayout().getCount();
+	Tensor3D output = Tensor3D(Tensor::allocateData(outputCount),
+		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1], m_Layout);
+	_forward(input.getData(), nullptr, output.getData());
+	return Tensor1D(outputCount, std::move(output));
+}
+
+template<class T>
+BasicTensor1D<T> BasicConvolutionalLayer<T>::backPropagate(
+	Tensor1D& sumsAfter,
+	Tensor1D& costAfter,
+	Tensor1D& activationsBefore,
+	double learningRate) {
+	size_t inputCount = getInputLayout().getCount();
+	assert((m_HalfWeights.format == WeightFormat::Precision) && "The 16 bit kernels can't be trained, set the weight format to Precision!");
+	assert((sumsAfter.getCount() == costAfter.getCount() &&
+		sumsAfter.getCount() == getOutputLayout().getCount()) &&
+		"Invalid cost and sums parameters!");
+	assert((activationsBefore.getCount() == inputCount) &&
+		"Invalid before activation parameters!");
+
+	// Local gradient respect to the output
+	m_Activation.applyDiff(sumsAfter).mult(costAfter);
+
+	Tensor3D kernelGradient = Tensor3D(Tensor::allocateData(m_Kernels.getCount()),
+		m_Kernels.getDepth(), m_Kernels.getRows(), m_Kernels.getCols());
+	Tensor3D costBefore = Tensor3D(m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], 0.0, m_Layout);
+	_gradients(sumsAfter.getData(), activationsBefore.getData(), kernelGradient, costBefore);
+
+	axpy(m_Kernels.getCount(), -precision(learningRate), kernelGradient.getData(), m_Kernels.getData());
+	axpy(m_Biases.getCount(), -precision(learningRate), sumsAfter.getData(), m_Biases.getData());
+	updateKernelCache();
+	return Tensor1D(inputCount, std::move(costBefore));
+}
+
+template<class T>
+BasicTensor2D<T> BasicConvolutionalLayer<T>::backPropagateBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	double learningRate) {
+	// The gradients of the samples are summed, the parameters are updated once with the average.
+	std::vector<precision> gradients(getParameterCount(), precision());
+	Tensor2D costBefore = gradientsBatch(sumsAfter, costAfter, activationsBefore, gradients.data());
+
+	precision rate = precision(learningRate / double(sumsAfter.getRows()));
+	axpy(m_Kernels.getCount(), -rate, gradients.data(), m_Kernels.getData());
+	axpy(m_Biases.getCount(), -rate, gradients.data() + m_Kernels.getCount(), m_Biases.getData());
+	updateKernelCache();
+	return costBefore;
+}
+
+template<class T>
+BasicTensor2D<T> BasicConvolutionalLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision* gradients) {
+	size_t batchSize = sumsAfter.getRows();
+	size_t inputCount = getInputLayout().getCount();
+	Tensor2D costBefore = Tensor2D(Tensor::allocateData(batchSize * inputCount), batchSize, inputCount);
+	gradientsBatch(sumsAfter, costAfter, activationsBefore, gradients, costBefore);
+	return costBefore;
+}
+
+template<class T>
+void BasicConvolutionalLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision* gradients,
+	Tensor2D& costBefore) {
+	size_t batchSize = sumsAfter.getRows();
+	size_t inputCount = getInputLayout().getCount();
+	size_t outputCount = getOutputLayout().getCount();
+	assert((m_HalfWeights.format == WeightFormat::Precision) && "The 16 bit kernels can't be trained, set the weight format to Precision!");
+	assert((costAfter.getRows() == batchSize && sumsAfter.getCols() == outputCount && costAfter.getCols() == outputCount) &&
+		"Invalid cost and sums parameters!");
+	assert((activationsBefore.getRows() == batchSize && activationsBefore.getCols() == inputCount) &&
+		"Invalid before activation parameters!");
+	assert((costBefore.getRows() == batchSize && costBefore.getCols() == inputCount) &&
+		"Invalid cost before parameters!");
+
+	// Local gradients of the samples.
+	m_Activation.applyDiff(sumsAfter).mult(costAfter);
+
+	// The kernel gradient of one sample, kept per thread.
+	thread_local std::vector<precision> kernelGradient;
+	kernelGradient.resize(m_Kernels.getCount());
+	TensorView<3, T> kernelGradientView(kernelGradient.data(), { m_Kernels.getDepth(), m_Kernels.getRows(), m_Kernels.getCols() });
+
+	// The kernel gradients are followed by the bias gradients, in the order of getParameters.
+	// The cost respect to the input of every sample is calculated right in its row.
+	precision* biasGradient = gradients + m_Kernels.getCount();
+	kernel::fill(costBefore.getData(), precision(), costBefore.getCount());
+	for (size_t n = 0; n < batchSize; n++) {
+		const precision* localGradient = sumsAfter.getData() + n * outputCount;
+		_gradients(localGradient, activationsBefore.getData() + n * inputCount, kernelGradientView,
+			LayoutView<T>(costBefore.getData() + n * inputCount, m_Layout,
+				m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1]));
+
+		kernel::add(gradients, kernelGradient.data(), m_Kernels.getCount());
+		kernel::add(biasGradient, localGradient, m_Biases.getCount());
+	}
+}
 
-	// Calculate the layer offsets.
-	size_t inputLayerCount = m_InputType.parameters[0] * m_InputType.parameters[1];
+template<class T>
+void BasicConvolutionalLayer<T>::_gradients(
+	const precision* localGradient,
+	const precision* activationsBefore,
+	TensorView<3, T> kernelGradient,
+	LayoutView<T> costBefore) const {
+	// The sizes of the convolution as a matrix multiplication.
+	// kernels: outputDepth x patchSize, columns: patchSize x outputLayerCount.
+	size_t outputDepth = m_OutputType.parameters[2];
 	size_t outputLayerCount = m_OutputType.parameters[0] * m_OutputType.parameters[1];
-	size_t kernelLayerCount = m_Kernels.getRows() * m_Kernels.getCols();
+	size_t patchSize = m_InputType.parameters[2] * m_Kernels.getRows() * m_Kernels.getCols();
 
-	// Go through the output depth
-	for (size_t i = 0; i < m_OutputType.parameters[2]; i++) {
+	// The flat activations and local gradients seen with the shape of the input and output.
+	ConstLayoutView<T> inputView(activationsBefore, m_Layout,
+		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1]);
+	ConstLayoutView<T> localGradientView(localGradient, m_Layout,
+		outputDepth, m_OutputType.parameters[0], m_OutputType.parameters[1]);
 
-		// Create the output watcher.
-		Tensor2D outputWatcher = Tensor2D(m_OutputType.parameters[0], m_OutputType.parameters[1],
-			Tensor(output.getData() + i * outputLayerCount, true));
+	if (_isFFTConvolution() && m_KernelCacheValid) {
+		_fftGradients(inputView, localGradientView, kernelGradient, costBefore);
+	}
+	else if (m_Layout == Layout::Blocked) {
+		Tensor3D temporary;
+		blockedKernelGradient<precision>(kernelGradient, inputView, localGradientView, m_KernelStride);
+		blockedInputGradient(costBefore, localGradientView, _blockedKernels(true, temporary), m_KernelStride);
+	}
+	else {
+		// In the channels last layout the local gradient is stored as outputLayerCount x outputDepth,
+		// the transposed of the planar local gradient matrix.
+		bool channelsLast = m_Layout == Layout::ChannelsLast;
+		size_t gradientStride = channelsLast ? outputDepth : outputLayerCount;
+
+		// Unfold the input of the layer, same as in the feed forward.
+		Tensor2D columns = columnBuffer<precision>(patchSize, outputLayerCount);
+		im2col(columns, inputView.view(), m_Kernels.getRows(), m_Kernels.getCols(), m_KernelStride);
+
+		// Kernel gradient = local gradient * trans(columns), for every output and input depth at once.
+		gemm(channelsLast, true,
+			outputDepth, patchSize, outputLayerCount,
+			precision(1), localGradient, gradientStride,
+			columns.getData(), outputLayerCount,
+			precision(), kernelGradient.getData(), patchSize);
+
+		if (_isWinogradConvolution() && m_KernelCacheValid) {
+			// Gradient respect to the input is the full convolution of the local gradient with the rotated kernels,
+			// the local gradient is padded by kernel size - 1.
+			winogradConvolution(costBefore.view(), localGradientView.view(), m_WinogradKernelsTransposed, 2);
+		}
+		else {
+			// Gradient respect to the columns = trans(kernels) * local gradient (the columns buffer is reused),
+			// than it's folded back to the input shape.
+			gemm(true, channelsLast,
+				patchSize, outputLayerCount, outputDepth,
+				precision(1), m_Kernels.getData(), patchSize,
+				localGradient, gradientStride,
+				precision(), columns.getData(), outputLayerCount);
+
+			col2im(costBefore.view(), columns, m_Kernels.getRows(), m_Kernels.getCols(), m_KernelStride);
+		}
+	}
+}
+
+template<class T>
+BasicPreparePropagateData<T> BasicConvolutionalLayer<T>::preparePropagate(const Tensor1D& input) const {
+	assert((input.getCount() == getInputLayout().getCount()) &&
+		"Invalid input parameters!");
+	PreparePropagateData pData;
+
+	size_t outputCount = getOutputLayout().getCount();
+	pData.input = input;
+	pData.sum = Tensor1D(Tensor::allocateData(outputCount), outputCount);
+	pData.output = Tensor1D(Tensor::allocateData(outputCount), outputCount);
+	_forward(input.getData(), pData.sum.getData(), pData.output.getData());
+	
+	return pData;
+}
 
-		// Go through the input depth and calculate the sum weighted sums.
-		for (size_t k = 0; k < m_InputType.parameters[2]; k++) {
+template<class T>
+BasicTensor2D<T> BasicConvolutionalLayer<T>::feedForwardBatch(const Tensor2D& input) const {
+	size_t outputCount = getOutputLayout().getCount();
+	Tensor2D output = Tensor2D(Tensor::allocateData(input.getRows() * outputCount), input.getRows(), outputCount);
+	feedForwardBatch(input, output);
+	return output;
+}
 
-			// Create the input and kernel watchers.
-			Tensor2D inputWatcher = Tensor2D(m_InputType.parameters[0], m_InputType.parameters[1],
-				Tensor(working.getData() + k * inputLayerCount, true));
-			Tensor2D kernelWatcher = Tensor2D(m_Kernels.getRows(), m_Kernels.getCols(),
-				Tensor((double*)(m_Kernels.getData() + (i * m_InputType.parameters[2] + k) * kernelLayerCount), true));
+template<class T>
+void BasicConvolutionalLayer<T>::feedForwardBatch(const Tensor2D& input, Tensor2D& output) const {
+	_forwardBatch(input, nullptr, output);
+}
 
-			// Calculate the convolution between the input and the kernel watcher and adds to the output tensor.
-			outputWatcher.add(std::move(convolution(inputWatcher, kernelWatcher, m_KernelStride)));
+template<class T>
+std::vector<BasicTensor<T>*> BasicConvolutionalLayer<T>::getParameters() {
+	if (m_HalfWeights.format != WeightFormat::Precision)
+		return { &m_Biases };
+	return { &m_Kernels, &m_Biases };
+}
+
+template<class T>
+bool BasicConvolutionalLayer<T>::setWeightFormat(WeightFormat format) {
+	// The kernels are stored as [output depth][input depth][row][col], a row for every output depth.
+	size_t rows = m_OutputType.parameters[2];
+	size_t cols = m_InputType.parameters[2] * _kernelRows() * _kernelCols();
+	if (format == m_HalfWeights.format)
+		return true;
+
+	if (format == WeightFormat::Precision) {
+		m_Kernels = Tensor3D(Tensor::allocateData(rows * cols), rows * m_InputType.parameters[2], _kernelRows(), _kernelCols());
+		fromHalfWeights(m_Kernels.getData(), m_HalfWeights);
+		m_HalfWeights = HalfWeights();
+	}
+	else if (m_HalfWeights.format == WeightFormat::Precision) {
+		// The precision kernels are freed, only the 16 bit ones stay in memory.
+		toHalfWeights(m_HalfWeights, m_Kernels.getData(), rows, cols, format);
+		m_Kernels = Tensor3D();
+	}
+	else {
+		// From one 16 bit format to the other through float, that holds both exactly.
+		std::vector<float> widened(rows * cols);
+		fromHalfWeights(widened.data(), m_HalfWeights);
+		toHalfWeights(m_HalfWeights, widened.data(), rows, cols, format);
+	}
+	updateKernelCache();
+	return true;
+}
+
+template<class T>
+bool BasicConvolutionalLayer<T>::quantize(QuantizedWeights& weights) const {
+	if (m_HalfWeights.format != WeightFormat::Precision)
+		return false;
+
+	// The kernels are stored as [output depth][input depth][row][col], a row for every output depth.
+	size_t outputDepth = m_OutputType.parameters[2];
+	quantizeRows(weights, m_Kernels.getData(), outputDepth, m_Kernels.getCount() / outputDepth);
+	Tensor3D biases = m_Biases.toLayout(Layout::Planar);
+	weights.biases.assign(biases.getData(), biases.getData() + biases.getCount());
+	return true;
+}
+
+template<class T>
+void BasicConvolutionalLayer<T>::feedForwardQuantized(const Tensor2D& input, Tensor2D& output, const QuantizedWeights& weights) const {
+	size_t batchSize = input.getRows();
+	size_t inputCount = getInputLayout().getCount();
+	size_t outputCount = getOutputLayout().getCount();
+	assert((input.getCols() == inputCount && output.getRows() == batchSize && output.getCols() == outputCount) &&
+		"Invalid input or output parameters!");
+
+	size_t inputDepth = m_InputType.parameters[2];
+	size_t outputDepth = m_OutputType.parameters[2];
+	size_t planarInputCount = inputDepth * m_InputType.parameters[0] * m_InputType.parameters[1];
+	size_t outputLayerCount = m_OutputType.parameters[0] * m_OutputType.parameters[1];
+	size_t patchSize = inputDepth * m_Kernels.getRows() * m_Kernels.getCols();
+	assert((weights.rows == outputDepth && weights.cols == patchSize) && "The quantized weights not match with the layer!");
+
+	// The quantized convolution works on planar data, the other layouts are converted around it.
+	thread_local std::vector<precision> planarInput;
+	thread_local std::vector<precision> planarOutput;
+	thread_local std::vector<int8_t> quantizedInput;
+	thread_local std::vector<int8_t> columns;
+	thread_local std::vector<int8_t> packedColumns;
+	thread_local std::vector<int32_t> sums;
+	quantizedInput.resize(planarInputCount);
+	columns.resize(patchSize * outputLayerCount);
+	sums.resize(outputDepth * outputLayerCount);
+	if (m_Layout != Layout::Planar) {
+		planarInput.resize(planarInputCount);
+		planarOutput.resize(outputDepth * outputLayerCount);
+	}
+
+	for (size_t n = 0; n < batchSize; n++) {
+		const precision* x = input.getData() + n * inputCount;
+		precision* y = output.getData() + n * outputCount;
+		if (m_Layout != Layout::Planar) {
+			convertLayout(x, m_Layout, planarInput.data(), Layout::Planar,
+				inputDepth, m_InputType.parameters[0], m_InputType.parameters[1]);
+			x = planarInput.data();
+			y = planarOutput.data();
+		}
+
+		// The output positions are many more than the kernels, so the columns are the packed B
+		// and the kernels are the A, that is packed by gemmInt8. The sums are planar.
+		quantizeValues(quantizedInput.data(), x, planarInputCount, weights.inputScale);
+		im2colInt8(columns.data(), quantizedInput.data(), inputDepth, m_InputType.parameters[0], m_InputType.parameters[1],
+			m_Kernels.getRows(), m_Kernels.getCols(), m_KernelStride);
+		packInt8(packedColumns, true, columns.data(), outputLayerCount, patchSize, outputLayerCount);
+		gemmInt8(outputDepth, outputLayerCount, patchSize, weights.values.data(), patchSize,
+			packedColumns.data(), sums.data(), outputLayerCount);
+
+		for (size_t k = 0; k < outputDepth; k++) {
+			precision scale = weights.inputScale * weights.scales[k];
+			precision* layer = y + k * outputLayerCount;
+			const int32_t* sum = sums.data() + k * outputLayerCount;
+			const precision* bias = weights.biases.data() + k * outputLayerCount;
+			for (size_t p = 0; p < outputLayerCount; p++)
+				layer[p] = precision(sum[p]) * scale + bias[p];
+		}
+		m_Activation.getActivationSpan()(y, outputDepth * outputLayerCount);
+
+		if (m_Layout != Layout::Planar) {
+			convertLayout(y, Layout::Planar, output.getData() + n * outputCount, m_Layout,
+				outputDepth, m_OutputType.parameters[0], m_OutputType.parameters[1]);
 		}
 	}
+}
 
-	output.add(m_Biases);
-	output.manipul(m_Activation.getActivation());
-	return Tensor1D(m_OutputType.getParameterCount(), std::move(output));
+template<class T>
+BasicPreparePropagateBatchData<T> BasicConvolutionalLayer<T>::preparePropagateBatch(const Tensor2D& input) const {
+	size_t batchSize = input.getRows();
+	size_t outputCount = getOutputLayout().getCount();
+
+	PreparePropagateBatchData bData;
+	bData.input = input;
+	bData.sum = Tensor2D(Tensor::allocateData(batchSize * outputCount), batchSize, outputCount);
+	bData.output = Tensor2D(Tensor::allocateData(batchSize * outputCount), batchSize, outputCount);
+	preparePropagateBatch(input, bData.sum, bData.output);
+	return bData;
 }
 
-Tensor1D ConvolutionalLayer::backPropagate(
-	Tensor1D& sumsAfter,
-	Tensor1D& costAfter,
-	Tensor1D& activationsBefore,
-	double learningRate) {
-	assert((sumsAfter.getCount() == costAfter.getCount() &&
-		sumsAfter.getCount() == m_OutputType.getParameterCount()) &&
-		"Invalid cost and sums parameters!");
-	assert((activationsBefore.getCount() == m_InputType.getParameterCount()) &&
-		"Invalid before activation parameters!");
+template<class T>
+void BasicConvolutionalLayer<T>::preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const {
+	assert((output.getRows() == sum.getRows() && output.getCols() == sum.getCols()) && "Invalid output parameters!");
+	_forwardBatch(input, sum.getData(), output);
+}
 
-	// Local gradient respect to the output
-	sumsAfter.manipul(m_Activation.getActivationDiff()).mult(costAfter);
+template<class T>
+void BasicConvolutionalLayer<T>::_forwardBatch(const Tensor2D& input, precision* sums, Tensor2D& output) const {
+	size_t batchSize = input.getRows();
+	size_t inputCount = getInputLayout().getCount();
+	size_t outputCount = getOutputLayout().getCount();
+	assert((batchSize > 0 && input.getCols() == inputCount) && "Invalid input parameters!");
+	assert((output.getRows() == batchSize && output.getCols() == outputCount) && "Invalid output parameters!");
 
-	// Calculate the memory need for the local gradient respect to the input and the kernel gradient.
-	Tensor3D costBefore = Tensor3D(m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], 0.0);
+	for (size_t n = 0; n < batchSize; n++)
+		_forward(input.getData() + n * inputCount, sums ? sums + n * outputCount : nullptr, output.getData() + n * outputCount);
+}
 
-	Tensor3D kernelGradient = Tensor3D(new double[m_Kernels.getDepth() * m_Kernels.getRows() * m_Kernels.getCols()],
-		m_Kernels.getDepth(), m_Kernels.getRows(), m_Kernels.getCols());
+template<class T>
+void BasicConvolutionalLayer<T>::setLayout(Layout layout) {
+	m_Layout = layout;
+	m_Biases = m_Biases.toLayout(layout);
+	updateKernelCache();
+}
+
+template<class T>
+BasicDataLayout<T> BasicConvolutionalLayer<T>::getInputLayout() const {
+	return { m_Layout, m_InputType.parameters[0], m_InputType.parameters[1], m_InputType.parameters[2] };
+}
+
+template<class T>
+BasicDataLayout<T> BasicConvolutionalLayer<T>::getOutputLayout() const {
+	return { m_Layout, m_OutputType.parameters[0], m_OutputType.parameters[1], m_OutputType.parameters[2] };
+}
+
+template<class T>
+void BasicConvolutionalLayer<T>::updateKernelCache() {
+	m_KernelCacheValid = false;
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		// The caches are transforms of the precision kernels, the 16 bit kernels run without them.
+		m_WinogradKernels = Tensor3D();
+		m_WinogradKernelsTransposed = Tensor3D();
+		std::vector<Complex>().swap(m_KernelSpectra);
+		m_BlockedKernels = Tensor3D();
+		m_BlockedKernelsTransposed = Tensor3D();
+		return;
+	}
+	if (_isWinogradConvolution()) {
+		// The caches are rebuilt in place, updating the kernels every step does not allocate.
+		winogradKernels(m_WinogradKernels, m_Kernels, m_OutputType.parameters[2], m_InputType.parameters[2], false);
+		winogradKernels(m_WinogradKernelsTransposed, m_Kernels, m_OutputType.parameters[2], m_InputType.parameters[2], true);
+		m_KernelCacheValid = true;
+	}
+	else if (_isFFTConvolution()) {
+		// The input fits into the FFT grid, the correlations never wrap around into the valid part.
+		m_FFTRows = fftSize(m_InputType.parameters[0]);
+		m_FFTCols = fftSize(m_InputType.parameters[1]);
+		size_t spectrumSize = m_FFTRows * m_FFTCols;
+		ConstTensorView<3, T> kernels(m_Kernels);
+
+		m_KernelSpectra.resize(m_Kernels.getDepth() * spectrumSize);
+		for (size_t i = 0; i < m_Kernels.getDepth(); i++)
+			spectrum(m_KernelSpectra.data() + i * spectrumSize, kernels.select(0, i), m_FFTRows, m_FFTCols, 1);
+		m_KernelCacheValid = true;
+	}
+	else if (m_Layout == Layout::Blocked) {
+		blockedKernels(m_BlockedKernels, m_Kernels, m_OutputType.parameters[2], m_InputType.parameters[2], false);
+		blockedKernels(m_BlockedKernelsTransposed, m_Kernels, m_OutputType.parameters[2], m_InputType.parameters[2], true);
+		m_KernelCacheValid = true;
+	}
+}
+
+template<class T>
+const BasicTensor3D<T>& BasicConvolutionalLayer<T>::_blockedKernels(bool transposed, Tensor3D& temporary) const {
+	if (m_KernelCacheValid && !_isFFTConvolution())
+		return transposed ? m_BlockedKernelsTransposed : m_BlockedKernels;
 
-	// Calculate the layer offsets.
-	size_t inputLayerCount = m_InputType.parameters[0] * m_InputType.parameters[1];
-	size_t costLayerCount = m_OutputType.parameters[0] * m_OutputType.parameters[1];
-	size_t kernelLayerCount = m_Kernels.getRows() * m_Kernels.getCols();
+	temporary = blockedKernels(m_Kernels, m_OutputType.parameters[2], m_InputType.parameters[2], transposed);
+	return temporary;
+}
+
+template<class T>
+void BasicConvolutionalLayer<T>::_fftConvolve(ConstLayoutView<T> input, LayoutView<T> output) const {
+	size_t inputDepth = m_InputType.parameters[2];
+	size_t spectrumSize = m_FFTRows * m_FFTCols;
+
+	thread_local std::vector<Complex> inputSpectra;
+	thread_local std::vector<Complex> outputSpectrum;
+	inputSpectra.resize(inputDepth * spectrumSize);
+	outputSpectrum.resize(spectrumSize);
 
-	// Go through the cost depth.
+	for (size_t k = 0; k < inputDepth; k++)
+		spectrum(inputSpectra.data() + k * spectrumSize, input.channel(k), m_FFTRows, m_FFTCols, 1);
+
+	// Sum the correlations of the input depths in the frequency domain, than one inverse transform per output depth.
 	for (size_t i = 0; i < m_OutputType.parameters[2]; i++) {
-		
-		// Create the cost watcher.
-		Tensor2D costWatcher = Tensor2D(m_OutputType.parameters[0], m_OutputType.parameters[1],
-			Tensor(sumsAfter.getData() + i * costLayerCount, true));
-		
-		// Create the formated cost if needed.(if we use stide other than 1)
-		Tensor2D formatedCost;
-		if (m_KernelStride > 1)
-			formatedCost = scaleByStride(costWatcher, m_KernelStride);
-
-		// Go throuth the input depth.
-		for (size_t k = 0; k < m_InputType.parameters[2]; k++) {
-
-			// Kernel, input and gradients watcher
-			Tensor2D kernelGradientWatcher = Tensor2D(m_Kernels.getRows(), m_Kernels.getCols(),
-				Tensor(kernelGradient.getData() + (i * m_InputType.parameters[2] + k) * kernelLayerCount, true));
-
-			Tensor2D kernelWathcer = Tensor2D(m_Kernels.getRows(), m_Kernels.getCols(),
-				Tensor(m_Kernels.getData() + (i * m_InputType.parameters[2] + k) * kernelLayerCount, true));	
-			
-			Tensor2D inputWatcher = Tensor2D(m_InputType.parameters[0], m_InputType.parameters[1],
-				Tensor(activationsBefore.getData() + k * inputLayerCount, true));
-			
-			Tensor2D costBeforeWatcher = Tensor2D(m_InputType.parameters[0], m_InputType.parameters[1],
-				Tensor(costBefore.getData() + k * inputLayerCount, true));
-			
-
-			// Calculate the kernel gradient tensor, It's the convolution between the input and the formated cost.
-			convolution(
-				kernelGradientWatcher,
-				inputWatcher,
-				(m_KernelStride > 1) ? formatedCost : costWatcher,
-				1);
-
-			costBeforeWatcher.add(convolution(
-				padding((m_KernelStride > 1) ? formatedCost : costWatcher, m_Kernels.getRows() - 1, 0.0),
-				reverse(kernelWathcer),
-				1));
+		std::fill(outputSpectrum.begin(), outputSpectrum.end(), Complex());
+		for (size_t k = 0; k < inputDepth; k++)
+			spectrumMultiplyAdd(outputSpectrum.data(), inputSpectra.data() + k * spectrumSize,
+				m_KernelSpectra.data() + (i * inputDepth + k) * spectrumSize, spectrumSize, true);
+
+		inverseSpectrum(output.channel(i), outputSpectrum.data(), m_FFTRows, m_FFTCols, m_KernelStride, false);
+	}
+}
+
+template<class T>
+void BasicConvolutionalLayer<T>::_fftGradients(
+	ConstLayoutView<T> input, ConstLayoutView<T> localGradient, TensorView<3, T> kernelGradient, LayoutView<T> costBefore) const {
+	size_t inputDepth = m_InputType.parameters[2];
+	size_t outputDepth = m_OutputType.parameters[2];
+	size_t spectrumSize = m_FFTRows * m_FFTCols;
+
+	thread_local std::vector<Complex> inputSpectra;
+	thread_local std::vector<Complex> gradientSpectra;
+	thread_local std::vector<Complex> buffer;
+	inputSpectra.resize(inputDepth * spectrumSize);
+	gradientSpectra.resize(outputDepth * spectrumSize);
+	buffer.resize(spectrumSize);
+
+	for (size_t k = 0; k < inputDepth; k++)
+		spectrum(inputSpectra.data() + k * spectrumSize, input.channel(k), m_FFTRows, m_FFTCols, 1);
+
+	// The local gradient is upsampled by the stride, so the strided convolution becomes a stride 1 one.
+	for (size_t i = 0; i < outputDepth; i++)
+		spectrum(gradientSpectra.data() + i * spectrumSize, localGradient.channel(i), m_FFTRows, m_FFTCols, m_KernelStride);
+
+	// The kernels are [output depth][input depth], the view gives the pairs as two axes.
+	TensorView<4, precision> kernelGradientPairs = kernelGradient.template reshape<4>(
+		{ outputDepth, inputDepth, m_Kernels.getRows(), m_Kernels.getCols() });
+
+	// Kernel gradient = correlation of the input with the local gradient, cut to the kernel size.
+	for (size_t i = 0; i < outputDepth; i++) {
+		for (size_t k = 0; k < inputDepth; k++) {
+			std::fill(buffer.begin(), buffer.end(), Complex());
+			spectrumMultiplyAdd(buffer.data(), inputSpectra.data() + k * spectrumSize,
+				gradientSpectra.data() + i * spectrumSize, spectrumSize, true);
+
+			inverseSpectrum(kernelGradientPairs.select(0, i).select(0, k), buffer.data(), m_FFTRows, m_FFTCols, 1, false);
 		}
 	}
 
-	m_Kernels.sub(kernelGradient.mult(learningRate));
-	m_Biases.sub(sumsAfter.mult(learningRate));
-	return Tensor1D(m_InputType.getParameterCount(), std::move(costBefore));
+	// Gradient respect to the input = sum of the full convolutions of the local gradients with the kernels.
+	for (size_t k = 0; k < inputDepth; k++) {
+		std::fill(buffer.begin(), buffer.end(), Complex());
+		for (size_t i = 0; i < outputDepth; i++)
+			spectrumMultiplyAdd(buffer.data(), gradientSpectra.data() + i * spectrumSize,
+				m_KernelSpectra.data() + (i * inputDepth + k) * spectrumSize, spectrumSize, false);
+
+		inverseSpectrum(costBefore.channel(k), buffer.data(), m_FFTRows, m_FFTCols, 1, false);
+	}
 }
 
-PreparePropagateData ConvolutionalLayer::preparePropagate(const Tensor1D& input) const {
-	assert((input.getCount() == m_InputType.getParameterCount()) &&
-		"Invalid input parameters!");
-	PreparePropagateData pData;
+template<class T>
+void BasicConvolutionalLayer<T>::_forward(const precision* input, precision* sums, precision* output) const {
+	Epilogue epilogue;
+	epilogue.bias = m_Biases.getData();
+	epilogue.sums = sums;
+	epilogue.activation = &m_Activation.getActivationSpan();
+	_convolve(input, LayoutView<T>(output, m_Layout,
+		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1]), &epilogue);
+}
 
-	Tensor3D working = Tensor3D(
-		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], input);
+template<class T>
+void BasicConvolutionalLayer<T>::_convolve(const precision* input, LayoutView<T> output, const Epilogue* epilogue) const {
+	ConstLayoutView<T> inputView(input, m_Layout,
+		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1]);
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		_halfConvolve(inputView, output, epilogue);
+		return;
+	}
 
-	Tensor3D output = Tensor3D(m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1], 0.0);
+	// The whole output as one row for the paths without gemm.
+	size_t outputCount = getOutputLayout().getCount();
+	auto finish = [&]() {
+		if (epilogue)
+			applyEpilogue(*epilogue, 1, outputCount, output.getData(), outputCount);
+	};
+
+	if (_isFFTConvolution() && m_KernelCacheValid) {
+		// Only the real depths are written, the padding of the blocked layout is cleared.
+		if (m_Layout == Layout::Blocked)
+			kernel::fill(output.getData(), precision(), outputCount);
+		_fftConvolve(inputView, output);
+		finish();
+		return;
+	}
+	if (m_Layout == Layout::Blocked) {
+		Tensor3D temporary;
+		blockedConvolution(output, inputView, _blockedKernels(false, temporary), m_KernelStride);
+		finish();
+		return;
+	}
+	if (_isWinogradConvolution() && m_KernelCacheValid) {
+		winogradConvolution(output.view(), inputView.view(), m_WinogradKernels, 0);
+		finish();
+		return;
+	}
 
-	size_t inputLayerCount = m_InputType.parameters[0] * m_InputType.parameters[1];
+	// The convolution of every input depth with every kernel is one matrix multiplication:
+	// output(outputDepth x outputLayerCount) = kernels(outputDepth x patchSize) * columns(patchSize x outputLayerCount).
+	// The kernels are stored as [output depth][input depth][row][col], so they are already that matrix.
+	size_t outputDepth = m_OutputType.parameters[2];
 	size_t outputLayerCount = m_OutputType.parameters[0] * m_OutputType.parameters[1];
-	size_t kernelLayerCount = m_Kernels.getRows() * m_Kernels.getCols();
+	size_t patchSize = m_InputType.parameters[2] * m_Kernels.getRows() * m_Kernels.getCols();
 
-	for (size_t i = 0; i < m_OutputType.parameters[2]; i++) {
+	Tensor2D columns = columnBuffer<precision>(patchSize, outputLayerCount);
+	im2col(columns, inputView.view(), m_Kernels.getRows(), m_Kernels.getCols(), m_KernelStride);
 
-		Tensor2D outputWatcher = Tensor2D(m_OutputType.parameters[0], m_OutputType.parameters[1],
-			Tensor(output.getData() + i * outputLayerCount, true));
+	// The bias and the sums are stored like the output, so they have its row stride.
+	Epilogue rowEpilogue;
+	if (epilogue) {
+		rowEpilogue = *epilogue;
+		rowEpilogue.biasStride = m_Layout == Layout::ChannelsLast ? outputDepth : outputLayerCount;
+		rowEpilogue.sumsStride = rowEpilogue.biasStride;
+	}
 
-		for (size_t k = 0; k < m_InputType.parameters[2]; k++) {
+	if (m_Layout == Layout::ChannelsLast) {
+		// The channels last output is the transposed: trans(columns) * trans(kernels).
+		gemm(true, true,
+			outputLayerCount, outputDepth, patchSize,
+			precision(1), columns.getData(), outputLayerCount,
+			m_Kernels.getData(), patchSize,
+			precision(), output.getData(), outputDepth, epilogue ? &rowEpilogue : nullptr);
+		return;
+	}
 
-			Tensor2D inputWatcher = Tensor2D(m_InputType.parameters[0], m_InputType.parameters[1],
-				Tensor(working.getData() + k * inputLayerCount, true));
-			Tensor2D kernelWatcher = Tensor2D(m_Kernels.getRows(), m_Kernels.getCols(),
-				Tensor((double*)(m_Kernels.getData() + (i * m_InputType.parameters[2] + k) * kernelLayerCount), true));
+	gemm(false, false,
+		outputDepth, outputLayerCount, patchSize,
+		precision(1), m_Kernels.getData(), patchSize,
+		columns.getData(), outputLayerCount,
+		precision(), output.getData(), outputLayerCount, epilogue ? &rowEpilogue : nullptr);
+}
 
-			outputWatcher.add(std::move(convolution(inputWatcher, kernelWatcher, m_KernelStride)));
-		}
+template<class T>
+void BasicConvolutionalLayer<T>::_halfConvolve(ConstLayoutView<T> input, LayoutView<T> output, const Epilogue* epilogue) const {
+	size_t inputDepth = m_InputType.parameters[2];
+	size_t outputDepth = m_OutputType.parameters[2];
+	size_t outputLayerCount = m_OutputType.parameters[0] * m_OutputType.parameters[1];
+	size_t outputCount = getOutputLayout().getCount();
+
+	// im2col reads a 3D view, the blocked input is converted to planar first.
+	thread_local std::vector<precision> planarInput;
+	if (m_Layout == Layout::Blocked) {
+		planarInput.resize(inputDepth * m_InputType.parameters[0] * m_InputType.parameters[1]);
+		convertLayout(input.getData(), m_Layout, planarInput.data(), Layout::Planar,
+			inputDepth, m_InputType.parameters[0], m_InputType.parameters[1]);
+		input = ConstLayoutView<T>(planarInput.data(), Layout::Planar, inputDepth, m_InputType.parameters[0], m_InputType.parameters[1]);
 	}
+	Tensor2D columns = columnBuffer<precision>(m_HalfWeights.cols, outputLayerCount);
+	im2col(columns, input.view(), _kernelRows(), _kernelCols(), m_KernelStride);
 
-	pData.input = input;
-	output.add(m_Biases);
-	pData.sum = Tensor1D(m_OutputType.getParameterCount(), output);
-	output.manipul(m_Activation.getActivation());
-	pData.output = Tensor1D(m_OutputType.getParameterCount(), std::move(output));
-	
-	return pData;
+	// The kernels are the B of gemmHalf: output(outputLayerCount x outputDepth) = trans(columns) * trans(kernels),
+	// that is the channels last output, the other layouts are converted from it.
+	if (m_Layout == Layout::ChannelsLast) {
+		gemmHalf(true, outputLayerCount, columns.getData(), outputLayerCount, m_HalfWeights, output.getData(), outputDepth);
+	}
+	else {
+		thread_local std::vector<precision> channelsLast;
+		channelsLast.resize(outputLayerCount * outputDepth);
+		gemmHalf(true, outputLayerCount, columns.getData(), outputLayerCount, m_HalfWeights, channelsLast.data(), outputDepth);
+		convertLayout(channelsLast.data(), Layout::ChannelsLast, output.getData(), m_Layout,
+			outputDepth, m_OutputType.parameters[0], m_OutputType.parameters[1]);
+	}
+
+	// The bias and the sums have the layout of the output, the whole output is one row.
+	if (epilogue)
+		applyEpilogue(*epilogue, 1, outputCount, output.getData(), outputCount);
 }
 
-std::string ConvolutionalLayer::toString() const {
+template<class T>
+std::string BasicConvolutionalLayer<T>::toString() const {
 	std::stringstream ss;
 	ss << std::fixed << std::setprecision(8);
 	
-	// Put input/output dimensions
+	// Put input/output dimensions and the kernel stride.
+	ss << getDescription();
+
+	// Put kernel data, the 16 bit kernels widened.
+	const precision* kernels = m_Kernels.getData();
+	size_t kernelCount = m_OutputType.parameters[2] * m_InputType.parameters[2] * _kernelRows() * _kernelCols();
+	std::vector<precision> widened;
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		widened.resize(kernelCount);
+		fromHalfWeights(widened.data(), m_HalfWeights);
+		kernels = widened.data();
+	}
+	for (size_t i = 0; i < kernelCount; i++) {
+		ss << kernels[i] << " ";
+	}
+	// Put bias data, always in planar order.
+	Tensor3D biases = m_Biases.toLayout(Layout::Planar);
+	for (size_t i = 0; i < biases.getCount(); i++) {
+		ss << biases.getData()[i] << " ";
+	}
+
+	return ss.str();
+}
+
+template<class T>
+void BasicConvolutionalLayer<T>::fromString(const std::string& rawString) {
+	fromText(rawString);
+}
+
+template<class T>
+void BasicConvolutionalLayer<T>::fromText(std::string_view text) {
+	TextReader reader(text);
+	_readDescription(reader);
+
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		std::vector<precision> kernels(m_HalfWeights.rows * m_HalfWeights.cols);
+		reader.read(kernels.data(), kernels.size());
+		toHalfWeights(m_HalfWeights, kernels.data(), m_HalfWeights.rows, m_HalfWeights.cols, m_HalfWeights.format);
+	}
+	else {
+		reader.read(m_Kernels.getData(), m_Kernels.getCount());
+	}
+	reader.read(m_Biases.getData(), m_Biases.getCount());
+	m_Biases = m_Biases.toLayout(m_Layout);
+
+	updateKernelCache();
+}
+
+template<class T>
+std::string BasicConvolutionalLayer<T>::getDescription() const {
+	std::stringstream ss;
+
 	ss << m_InputType.parameters[0] << " ";
 	ss << m_InputType.parameters[1] << " ";
 	ss << m_InputType.parameters[2] << " ";
@@ -214,48 +748,48 @@ std::string ConvolutionalLayer::toString() const {
 	ss << m_OutputType.parameters[1] << " ";
 	ss << m_OutputType.parameters[2] << " ";
 
-	// Put kernel stride.
 	ss << m_KernelStride << " ";
 
-	// Put kernel data.
-	for (size_t i = 0; i < m_Kernels.getCount(); i++) {
-		ss << m_Kernels.getData()[i] << " ";
-	}
-	// Put bias data.
-	for (size_t i = 0; i < m_Biases.getCount(); i++) {
-		ss << m_Biases.getData()[i] << " ";
-	}
-
 	return ss.str();
 }
 
-void ConvolutionalLayer::fromString(const std::string& rawString) {
-	std::stringstream ss(rawString);
-
-	ss >> m_InputType.parameters[0];
-	ss >> m_InputType.parameters[1];
-	ss >> m_InputType.parameters[2];
-
-	ss >> m_OutputType.parameters[0];
-	ss >> m_OutputType.parameters[1];
-	ss >> m_OutputType.parameters[2];
+template<class T>
+void BasicConvolutionalLayer<T>::fromDescription(const std::string& description) {
+	TextReader reader(description);
+	_readDescription(reader);
+	m_Biases = m_Biases.toLayout(m_Layout);
+}
 
-	ss >> m_KernelStride;
+template<class T>
+void BasicConvolutionalLayer<T>::_readDescription(TextReader& reader) {
+	reader.read(m_InputType.parameters[0]);
+	reader.read(m_InputType.parameters[1]);
+	reader.read(m_InputType.parameters[2]);
 
-	size_t rows = m_InputType.parameters[0] - (m_OutputType.parameters[0] - 1) * m_KernelStride;
-	size_t cols = m_InputType.parameters[1] - (m_OutputType.parameters[1] - 1) * m_KernelStride;
+	reader.read(m_OutputType.parameters[0]);
+	reader.read(m_OutputType.parameters[1]);
+	reader.read(m_OutputType.parameters[2]);
 
-	m_Kernels = Tensor3D(m_OutputType.parameters[2] * m_InputType.parameters[2], rows, cols, 0.0);
+	reader.read(m_KernelStride);
 
-	m_Biases = Tensor3D(m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1], 0.0);
+	size_t rows = _kernelRows();
+	size_t cols = _kernelCols();
+	size_t kernelDepth = m_OutputType.parameters[2] * m_InputType.parameters[2];
 
-	for (size_t i = 0; i < m_Kernels.getCount(); i++) {
-		ss >> m_Kernels.getData()[i];
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		m_HalfWeights.rows = m_OutputType.parameters[2];
+		m_HalfWeights.cols = m_InputType.parameters[2] * rows * cols;
+		m_HalfWeights.packed.clear();
 	}
-	for (size_t i = 0; i < m_Biases.getCount(); i++) {
-		ss >> m_Biases.getData()[i];
+	else {
+		m_Kernels = Tensor3D(Tensor::allocateData(kernelDepth * rows * cols), kernelDepth, rows, cols);
 	}
 
+	m_Biases = Tensor3D(Tensor::allocateData(m_OutputType.getParameterCount()),
+		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1]);
 }
 
+template class DRAGON_API BasicConvolutionalLayer<float>;
+template class DRAGON_API BasicConvolutionalLayer<double>;
+
 DRAGON_END
\ No newline at end of file
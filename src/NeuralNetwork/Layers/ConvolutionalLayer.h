@@ -4,21 +4,28 @@
 
 DRAGON_BEGIN
 
-class DRAGON_API ConvolutionalLayer : public BaseLayer {
+template<class T>
+class BasicConvolutionalLayer : public BasicBaseLayer<T> {
 public:
-	ConvolutionalLayer();
-	ConvolutionalLayer(
+	DRAGON_LAYER_TYPES(T)
+	using BaseLayer::getParameterCount;
+
+	BasicConvolutionalLayer();
+	BasicConvolutionalLayer(
 		size_t inputRows, size_t inputCols, size_t inputDepth,
 		size_t kernelRows, size_t kernelCols, size_t kernelCount,
 		size_t kernelStride,
-		const std::function<double()>& initFunction,
+		const std::function<precision()>& initFunction,
 		const ActivationFunction& activation);
-	ConvolutionalLayer(const ConvolutionalLayer& other);
-	ConvolutionalLayer(ConvolutionalLayer&& other) noexcept;
+	BasicConvolutionalLayer(const BasicConvolutionalLayer& other);
+	BasicConvolutionalLayer(BasicConvolutionalLayer&& other) noexcept;
 
 
+	// The kernels are empty while the layer keeps them in 16 bits.
 	inline const Tensor3D& getKernels() const { return m_Kernels; }
-	inline Tensor3D& getKernels() { return m_Kernels; }
+	// The kernels can be changed through this, the cached kernel transforms are dropped until updateKernelCache is called.
+	inline Tensor3D& getKernels() { m_KernelCacheValid = false; return m_Kernels; }
+	// The biases are stored in the layout of the layer.
 	inline const Tensor3D& getBiases() const { return m_Biases; }
 	inline Tensor3D& getBiases() { return m_Biases; }
 	inline const size_t& getKernelStride() const { return m_KernelStride; }
@@ -36,11 +43,99 @@ public:
 
 	PreparePropagateData preparePropagate(const Tensor1D& input) const override;
 
+	// The kernel gradients of the samples are summed and applied once.
+	Tensor2D backPropagateBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		double learningRate) override;
+	Tensor2D feedForwardBatch(const Tensor2D& input) const override;
+	void feedForwardBatch(const Tensor2D& input, Tensor2D& output) const override;
+	// The layer with 16 bit kernels is not quantized, it runs with them in the quantized plan too.
+	bool quantize(QuantizedWeights& weights) const override;
+	void feedForwardQuantized(const Tensor2D& input, Tensor2D& output, const QuantizedWeights& weights) const override;
+	PreparePropagateBatchData preparePropagateBatch(const Tensor2D& input) const override;
+	void preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const override;
+
+	// The kernels and the biases (in the layout of the layer), only the biases with 16 bit kernels.
+	std::vector<Tensor*> getParameters() override;
+	Tensor2D gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients) override;
+	void gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients,
+		Tensor2D& costBefore) override;
+	void parametersChanged() override { updateKernelCache(); }
+	// The 16 bit kernels are a row of patch size values for every output depth, the cached transforms are dropped.
+	bool setWeightFormat(WeightFormat format) override;
+	WeightFormat getWeightFormat() const override { return m_HalfWeights.format; }
+	HalfWeights* getHalfWeights() override { return &m_HalfWeights; }
+
+	void setLayout(Layout layout) override;
+	DataLayout getInputLayout() const override;
+	DataLayout getOutputLayout() const override;
+
 	std::string toString() const override;
 	void fromString(const std::string& rawString) override;
+	void fromText(std::string_view text) override;
+	std::string getDescription() const override;
+	void fromDescription(const std::string& description) override;
 	std::string getName() const override { return "ConvolutionalLayer"; }
 
+	// Recalculate the transformed kernels used by the fast convolution paths.
+	// Call it after the kernels are modified from outside of the layer.
+	void updateKernelCache();
+
 private:
+	// Calculate the weighted sums (without the biases) of the input into the output, using im2col and gemm.
+	// The blocked layout uses the direct blocked convolution instead of im2col and winograd.
+	// The epilogue (if not null) is run on the output, its bias and sums have the layout of the output,
+	// their row strides are set here. The im2col paths run it in the gemm, the others after the convolution.
+	void _convolve(const precision* input, LayoutView<T> output, const Epilogue* epilogue = nullptr) const;
+	// The convolution with the 16 bit kernels, im2col and gemmHalf, the epilogue is run after it.
+	void _halfConvolve(ConstLayoutView<T> input, LayoutView<T> output, const Epilogue* epilogue) const;
+	// Read the shapes and the stride, and allocate the kernels and the planar biases, their values are junk.
+	// The 16 bit kernels only get their size, they are filled by the caller.
+	void _readDescription(TextReader& reader);
+	// The kernel size from the shapes and the stride, the kernels are empty while they are kept in 16 bits.
+	inline size_t _kernelRows() const { return m_InputType.parameters[0] - (m_OutputType.parameters[0] - 1) * m_KernelStride; }
+	inline size_t _kernelCols() const { return m_InputType.parameters[1] - (m_OutputType.parameters[1] - 1) * m_KernelStride; }
+	// Output of one sample, the weighted sums (with the biases) are saved into sums if it's not null.
+	void _forward(const precision* input, precision* sums, precision* output) const;
+	// Outputs of every sample of the batch, like _forward.
+	void _forwardBatch(const Tensor2D& input, precision* sums, Tensor2D& output) const;
+	// Calculate the kernel gradient and the gradient respect to the input (costBefore, has to be zero)
+	// of one sample from its local gradient and input, without updating the parameters.
+	void _gradients(const precision* localGradient, const precision* activationsBefore,
+		TensorView<3, T> kernelGradient, LayoutView<T> costBefore) const;
+	// Stride 1 convolution with 3x3 kernels runs with the winograd transform.
+	// With few channels the tile transforms cost more than the saved multiplications, those stay on im2col.
+	inline bool _isWinogradConvolution() const {
+		return m_Layout != Layout::Blocked && m_KernelStride == 1 && m_Kernels.getRows() == 3 && m_Kernels.getCols() == 3 &&
+			m_InputType.parameters[2] * m_OutputType.parameters[2] >= WINOGRAD_MIN_DEPTH_PRODUCT;
+	}
+	// Large kernels run in the frequency domain. The FFT calculates every position,
+	// the direct convolution only every stride-th, so the threshold grows with the stride.
+	inline bool _isFFTConvolution() const { return m_Kernels.getRows() >= FFT_MIN_KERNEL_SIZE * m_KernelStride; }
+	// Feed forward and backpropagation through the cached kernel spectra.
+	void _fftConvolve(ConstLayoutView<T> input, LayoutView<T> output) const;
+	void _fftGradients(ConstLayoutView<T> input, ConstLayoutView<T> localGradient, TensorView<3, T> kernelGradient, LayoutView<T> costBefore) const;
+	// The packed kernels of the blocked convolution, from the cache or packed into temporary if the cache is outdated.
+	const Tensor3D& _blockedKernels(bool transposed, Tensor3D& temporary) const;
+
+private:
+	using BaseLayer::m_Activation;
+
+	// Input depth * output depth from where the winograd convolution is faster than im2col.
+	static constexpr size_t WINOGRAD_MIN_DEPTH_PRODUCT = 32 * 32;
+	// Kernel size from where the FFT convolution is faster than im2col.
+	static constexpr size_t FFT_MIN_KERNEL_SIZE = 9;
+
 	// [0] = input rows, [1] = input cols, [2] = input depth
 	ParameterType<3> m_InputType;
 	// [0] = output rows, [1] = output cols [2] = output depth = kernel count
@@ -49,6 +144,26 @@ private:
 	size_t m_KernelStride;
 	Tensor3D m_Kernels;
 	Tensor3D m_Biases;
+	// The kernels in 16 bits, m_Kernels is empty while they are used (setWeightFormat).
+	HalfWeights m_HalfWeights;
+	// Layout of the input, output and biases.
+	Layout m_Layout = Layout::Planar;
+
+	// Winograd transforms of the kernels, for the feed forward and for the gradient respect to the input.
+	Tensor3D m_WinogradKernels;
+	Tensor3D m_WinogradKernelsTransposed;
+	// Spectra of the kernels [output depth][input depth][fft rows * fft cols], for the FFT convolution.
+	std::vector<Complex> m_KernelSpectra;
+	size_t m_FFTRows = 0;
+	size_t m_FFTCols = 0;
+	// Packed kernels of the blocked convolution, for the feed forward and for the gradient respect to the input.
+	Tensor3D m_BlockedKernels;
+	Tensor3D m_BlockedKernelsTransposed;
+	bool m_KernelCacheValid = false;
 };
 
+extern template class DRAGON_API BasicConvolutionalLayer<float>;
+extern template class DRAGON_API BasicConvolutionalLayer<double>;
+using ConvolutionalLayer = BasicConvolutionalLayer<precision>;
+
 DRAGON_END
\ No newline at end of file
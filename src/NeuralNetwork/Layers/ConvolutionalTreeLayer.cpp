@@ -2,14 +2,16 @@
 
 DRAGON_BEGIN
 
-ConvolutionalTreeLayer::ConvolutionalTreeLayer() :
+template<class T>
+BasicConvolutionalTreeLayer<T>::BasicConvolutionalTreeLayer() :
 	m_InputType({ 0, 0, 0 }), m_OutputType({ 0, 0 }), m_KernelStride(0) { }
 
-ConvolutionalTreeLayer::ConvolutionalTreeLayer(
+template<class T>
+BasicConvolutionalTreeLayer<T>::BasicConvolutionalTreeLayer(
 	size_t inputRows, size_t inputCols, size_t inputDepth,
 	size_t kernelRows, size_t kernelCols, size_t kernelCountPerInput,
 	size_t kernelStride,
-	const std::function<double()>& initFunction,
+	const std::function<precision()>& initFunction,
 	const ActivationFunction& activation)
 	:
 	m_InputType({ inputRows, inputCols, inputDepth }),
@@ -26,233 +28,468 @@ ConvolutionalTreeLayer::ConvolutionalTreeLayer(
 	assert((kernelRows == kernelCols) &&
 		"Not supported different kernel parameters!");	// TODO: add different kernel and stride parameter support (backpropagate)
 
-	m_Kernels = Tensor3D(kernelCountPerInput * inputDepth, kernelRows, kernelCols, initTensor(
+	m_Kernels = Tensor3D(kernelCountPerInput * inputDepth, kernelRows, kernelCols, initTensor<precision>(
 		kernelCountPerInput * inputDepth * kernelRows * kernelCols, initFunction));
 
 	m_Biases = Tensor3D(
 		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1],
-		initTensor(m_OutputType.getParameterCount(), initFunction));
+		initTensor<precision>(m_OutputType.getParameterCount(), initFunction));
+
+	updateKernelCache();
 }
 
-ConvolutionalTreeLayer::ConvolutionalTreeLayer(const ConvolutionalTreeLayer& other) :
+template<class T>
+BasicConvolutionalTreeLayer<T>::BasicConvolutionalTreeLayer(const BasicConvolutionalTreeLayer& other) :
+	BaseLayer(other.m_Activation),
 	m_InputType(other.m_InputType), m_OutputType(other.m_OutputType),
 	m_KernelStride(other.m_KernelStride),
 	m_Kernels(other.m_Kernels),
 	m_Biases(other.m_Biases),
-	BaseLayer(other.m_Activation) { }
-
-ConvolutionalTreeLayer::ConvolutionalTreeLayer(ConvolutionalTreeLayer&& other) noexcept :
+	m_Layout(other.m_Layout),
+	m_KernelSpectra(other.m_KernelSpectra),
+	m_FFTRows(other.m_FFTRows), m_FFTCols(other.m_FFTCols),
+	m_KernelCacheValid(other.m_KernelCacheValid) { }
+
+template<class T>
+BasicConvolutionalTreeLayer<T>::BasicConvolutionalTreeLayer(BasicConvolutionalTreeLayer&& other) noexcept :
+	BaseLayer(other.m_Activation),
 	m_InputType(other.m_InputType), m_OutputType(other.m_OutputType),
 	m_KernelStride(other.m_KernelStride),
 	m_Kernels(std::move(other.m_Kernels)),
 	m_Biases(std::move(other.m_Biases)),
-	BaseLayer(other.m_Activation) { }
+	m_Layout(other.m_Layout),
+	m_KernelSpectra(std::move(other.m_KernelSpectra)),
+	m_FFTRows(other.m_FFTRows), m_FFTCols(other.m_FFTCols),
+	m_KernelCacheValid(other.m_KernelCacheValid) {
+	other.m_KernelCacheValid = false;
+}
 
-Tensor1D ConvolutionalTreeLayer::feedForward(const Tensor1D& input) const {
-	assert((input.getCount() == m_InputType.getParameterCount()) && 
+template<class T>
+BasicTensor1D<T> BasicConvolutionalTreeLayer<T>::feedForward(const Tensor1D& input) const {
+	assert((input.getCount() == getInputLayout().getCount()) && 
 		"Invalid input parameters!");
-	// Convert input into formated input.
-	Tensor3D working = Tensor3D(
-		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], input);
 
 	// Create a Tensor3D with an allocated memory with the size of the outputtype count,
 	// it's just allocate the memory, still hold junk.
-	Tensor3D output = Tensor3D(new double[m_OutputType.getParameterCount()], 
-		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1]);
-
-
-	// Calculate the number of output per input.
-	size_t kernelCountPerInput = m_OutputType.parameters[2] / m_InputType.parameters[2];
-
-	// Calculate the layer offsets.
-	size_t inputLayerCount = m_InputType.parameters[0] * m_InputType.parameters[1];
-	size_t outputLayerCount = m_OutputType.parameters[0] * m_OutputType.parameters[1];
-	size_t kernelLayerCount = m_Kernels.getRows() * m_Kernels.getCols();
-
-	// Go through the kernel depth and output depth.
-	for (size_t i = 0; i < m_OutputType.parameters[2]; i++) {
-
-		size_t inputIndex = size_t(i / kernelCountPerInput);
-		
-		// Create watcher tensors for inputs, outputs and kernels, initially they are Tensor3D,
-		// to calculate the convolution we need Tensor2D.
-		Tensor2D inputWatcher = Tensor2D(m_InputType.parameters[0], m_InputType.parameters[1],
-			Tensor(working.getData() + inputIndex * inputLayerCount, true));
-		Tensor2D outputWatcher = Tensor2D(m_OutputType.parameters[0], m_OutputType.parameters[1],
-			Tensor(output.getData() + i * outputLayerCount, true));
-		Tensor2D kernelWatcher = Tensor2D(m_Kernels.getRows(), m_Kernels.getCols(),
-			Tensor((double*)(m_Kernels.getData() + i * kernelLayerCount), true));
-
-		convolution(outputWatcher, inputWatcher, kernelWatcher, m_KernelStride);
-	}
-
-	output.add(m_Biases);
-	output.manipul(m_Activation.getActivation());
-	return Tensor1D(m_OutputType.getParameterCount(), std::move(output));
+	size_t outputCount = getOutputLayout().getCount();
+	Tensor3D output = Tensor3D(Tensor::allocateData(outputCount), 
+		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1], m_Layout);
+	_forward(input.getData(), nullptr, output.getData());
+	return Tensor1D(outputCount, std::move(output));
 }
 
-Tensor1D ConvolutionalTreeLayer::backPropagate(
+template<class T>
+BasicTensor1D<T> BasicConvolutionalTreeLayer<T>::backPropagate(
 	Tensor1D& sumsAfter,
 	Tensor1D& costAfter,
 	Tensor1D& activationsBefore,
 	double learningRate) {
+	size_t inputCount = getInputLayout().getCount();
 	assert((sumsAfter.getCount() == costAfter.getCount() &&
-		sumsAfter.getCount() == m_OutputType.getParameterCount()) &&
+		sumsAfter.getCount() == getOutputLayout().getCount()) &&
 		"Invalid cost and sums parameters!");
-	assert((activationsBefore.getCount() == m_InputType.getParameterCount()) &&
+	assert((activationsBefore.getCount() == inputCount) &&
 		"Invalid before activation parameters!");
 
 	// Local gradient respect to the output
-	sumsAfter.manipul(m_Activation.getActivationDiff()).mult(costAfter);
+	m_Activation.applyDiff(sumsAfter).mult(costAfter);
 
 	// Calculate the memory need for the local gradient respect to the input and the kernel gradient.
-	Tensor3D costBefore = Tensor3D(m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], 0.0);
+	Tensor3D costBefore = Tensor3D(m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], 0.0, m_Layout);
 
-	Tensor3D kernelGradient = Tensor3D(new double[m_Kernels.getDepth() * m_Kernels.getRows() * m_Kernels.getCols()],
+	Tensor3D kernelGradient = Tensor3D(Tensor::allocateData(m_Kernels.getDepth() * m_Kernels.getRows() * m_Kernels.getCols()),
 		m_Kernels.getDepth(), m_Kernels.getRows(), m_Kernels.getCols());
 
+	_gradients(sumsAfter.getData(), activationsBefore.getData(), kernelGradient, costBefore);
+
+	axpy(m_Kernels.getCount(), -precision(learningRate), kernelGradient.getData(), m_Kernels.getData());
+	axpy(m_Biases.getCount(), -precision(learningRate), sumsAfter.getData(), m_Biases.getData());
+	updateKernelCache();
+	return Tensor1D(inputCount, std::move(costBefore));
+}
+
+template<class T>
+BasicTensor2D<T> BasicConvolutionalTreeLayer<T>::backPropagateBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	double learningRate) {
+	// The gradients of the samples are summed, the parameters are updated once with the average.
+	std::vector<precision> gradients(getParameterCount(), precision());
+	Tensor2D costBefore = gradientsBatch(sumsAfter, costAfter, activationsBefore, gradients.data());
+
+	precision rate = precision(learningRate / double(sumsAfter.getRows()));
+	axpy(m_Kernels.getCount(), -rate, gradients.data(), m_Kernels.getData());
+	axpy(m_Biases.getCount(), -rate, gradients.data() + m_Kernels.getCount(), m_Biases.getData());
+	updateKernelCache();
+	return costBefore;
+}
+
+template<class T>
+BasicTensor2D<T> BasicConvolutionalTreeLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision* gradients) {
+	size_t batchSize = sumsAfter.getRows();
+	size_t inputCount = getInputLayout().getCount();
+	Tensor2D costBefore = Tensor2D(Tensor::allocateData(batchSize * inputCount), batchSize, inputCount);
+	gradientsBatch(sumsAfter, costAfter, activationsBefore, gradients, costBefore);
+	return costBefore;
+}
+
+template<class T>
+void BasicConvolutionalTreeLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision* gradients,
+	Tensor2D& costBefore) {
+	size_t batchSize = sumsAfter.getRows();
+	size_t inputCount = getInputLayout().getCount();
+	size_t outputCount = getOutputLayout().getCount();
+	assert((costAfter.getRows() == batchSize && sumsAfter.getCols() == outputCount && costAfter.getCols() == outputCount) &&
+		"Invalid cost and sums parameters!");
+	assert((activationsBefore.getRows() == batchSize && activationsBefore.getCols() == inputCount) &&
+		"Invalid before activation parameters!");
+	assert((costBefore.getRows() == batchSize && costBefore.getCols() == inputCount) &&
+		"Invalid cost before parameters!");
+
+	// Local gradients of the samples.
+	m_Activation.applyDiff(sumsAfter).mult(costAfter);
+
+	// The kernel gradient of one sample, kept per thread.
+	thread_local std::vector<precision> kernelGradient;
+	kernelGradient.resize(m_Kernels.getCount());
+	TensorView<3, T> kernelGradientView(kernelGradient.data(), { m_Kernels.getDepth(), m_Kernels.getRows(), m_Kernels.getCols() });
+
+	// The kernel gradients are followed by the bias gradients, in the order of getParameters.
+	// The cost respect to the input of every sample is calculated right in its row.
+	precision* biasGradient = gradients + m_Kernels.getCount();
+	kernel::fill(costBefore.getData(), precision(), costBefore.getCount());
+	for (size_t n = 0; n < batchSize; n++) {
+		const precision* localGradient = sumsAfter.getData() + n * outputCount;
+		_gradients(localGradient, activationsBefore.getData() + n * inputCount, kernelGradientView,
+			LayoutView<T>(costBefore.getData() + n * inputCount, m_Layout,
+				m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1]));
+
+		kernel::add(gradients, kernelGradient.data(), m_Kernels.getCount());
+		kernel::add(biasGradient, localGradient, m_Biases.getCount());
+	}
+}
+
+template<class T>
+void BasicConvolutionalTreeLayer<T>::_gradients(
+	const precision* localGradient,
+	const precision* activationsBefore,
+	TensorView<3, T> kernelGradient,
+	LayoutView<T> costBefore) const {
+	// The flat activations and local gradients seen with the shape of the input and output.
+	ConstLayoutView<T> inputView(activationsBefore, m_Layout,
+		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1]);
+	ConstLayoutView<T> costView(localGradient, m_Layout,
+		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1]);
+
+	if (_isFFTConvolution() && m_KernelCacheValid) {
+		_fftGradients(inputView, costView, kernelGradient, costBefore);
+		return;
+	}
+
 	// Calculate the number of output per input.
 	size_t kernelCountPerInput = m_OutputType.parameters[2] / m_InputType.parameters[2];
 
-	// Calculate the layer offsets.
-	size_t inputLayerCount = m_InputType.parameters[0] * m_InputType.parameters[1];
-	size_t costLayerCount = m_OutputType.parameters[0] * m_OutputType.parameters[1];
-	size_t kernelLayerCount = m_Kernels.getRows() * m_Kernels.getCols();
-
 	// Go through the cost depth.
 	for (size_t i = 0; i < m_OutputType.parameters[2]; i++) {
 
 		size_t inputIndex = size_t(i / kernelCountPerInput);
 
-		// Create watcher tensors for kernel, cost, input and localcostbefore, initially they are Tensor3D,
-		// to calculate the convolution we need Tensor2D.
-		Tensor2D kernelGradientWatcher = Tensor2D(m_Kernels.getRows(), m_Kernels.getCols(),
-			Tensor(kernelGradient.getData() + i * kernelLayerCount, true));
+		// Calculate the kernel gradient tensor, It's the convolution between the input and the cost scaled by stride.
+		convolutionKernelGradient<precision>(kernelGradient.select(0, i), inputView.channel(inputIndex),
+			costView.channel(i), m_KernelStride);
+
+		// Push the cost back through the kernel to the input (transposed convolution).
+		convolutionTransposed<precision>(costBefore.channel(inputIndex), costView.channel(i),
+			ConstTensorView<3, T>(m_Kernels).select(0, i), m_KernelStride);
+	}
+}
+
+template<class T>
+BasicPreparePropagateData<T> BasicConvolutionalTreeLayer<T>::preparePropagate(const Tensor1D& input) const {
+	assert((input.getCount() == getInputLayout().getCount()) && 
+		"Invalid input parameters!");
+	PreparePropagateData pData;
 
-		Tensor2D kernelWathcer = Tensor2D(m_Kernels.getRows(), m_Kernels.getCols(),
-			Tensor(m_Kernels.getData() + i * kernelLayerCount, true));
+	size_t outputCount = getOutputLayout().getCount();
+	pData.input = input;
+	pData.sum = Tensor1D(Tensor::allocateData(outputCount), outputCount);
+	pData.output = Tensor1D(Tensor::allocateData(outputCount), outputCount);
+	_forward(input.getData(), pData.sum.getData(), pData.output.getData());
 
-		Tensor2D costWatcher = Tensor2D(m_OutputType.parameters[0], m_OutputType.parameters[1],
-			Tensor(sumsAfter.getData() + i * costLayerCount, true));
+	return pData;
+}
 
-		Tensor2D inputWatcher = Tensor2D(m_InputType.parameters[0], m_InputType.parameters[1],
-			Tensor(activationsBefore.getData() + inputIndex * inputLayerCount, true));
+template<class T>
+BasicTensor2D<T> BasicConvolutionalTreeLayer<T>::feedForwardBatch(const Tensor2D& input) const {
+	size_t outputCount = getOutputLayout().getCount();
+	Tensor2D output = Tensor2D(Tensor::allocateData(input.getRows() * outputCount), input.getRows(), outputCount);
+	feedForwardBatch(input, output);
+	return output;
+}
 
-		Tensor2D costBeforeWatcher = Tensor2D(m_InputType.parameters[0], m_InputType.parameters[1],
-			Tensor(costBefore.getData() + inputIndex * inputLayerCount, true));
+template<class T>
+void BasicConvolutionalTreeLayer<T>::feedForwardBatch(const Tensor2D& input, Tensor2D& output) const {
+	_forwardBatch(input, nullptr, output);
+}
 
-		Tensor2D formatedCost;
-		if (m_KernelStride > 1)
-			formatedCost = scaleByStride(costWatcher, m_KernelStride);
+template<class T>
+BasicPreparePropagateBatchData<T> BasicConvolutionalTreeLayer<T>::preparePropagateBatch(const Tensor2D& input) const {
+	size_t batchSize = input.getRows();
+	size_t outputCount = getOutputLayout().getCount();
+
+	PreparePropagateBatchData bData;
+	bData.input = input;
+	bData.sum = Tensor2D(Tensor::allocateData(batchSize * outputCount), batchSize, outputCount);
+	bData.output = Tensor2D(Tensor::allocateData(batchSize * outputCount), batchSize, outputCount);
+	preparePropagateBatch(input, bData.sum, bData.output);
+	return bData;
+}
 
-		// Calculate the kernel gradient tensor, It's the convolution between the input and the formated cost.
-		convolution(
-			kernelGradientWatcher,
-			inputWatcher, 
-			(m_KernelStride > 1) ? formatedCost : costWatcher,
-			1);
+template<class T>
+void BasicConvolutionalTreeLayer<T>::preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const {
+	assert((output.getRows() == sum.getRows() && output.getCols() == sum.getCols()) && "Invalid output parameters!");
+	_forwardBatch(input, sum.getData(), output);
+}
 
-		costBeforeWatcher.add(convolution(
-				padding((m_KernelStride > 1) ? formatedCost : costWatcher, m_Kernels.getRows() - 1, 0.0),
-				reverse(kernelWathcer), 
-				1));
-	}
+template<class T>
+void BasicConvolutionalTreeLayer<T>::_forwardBatch(const Tensor2D& input, precision* sums, Tensor2D& output) const {
+	size_t batchSize = input.getRows();
+	size_t inputCount = getInputLayout().getCount();
+	size_t outputCount = getOutputLayout().getCount();
+	assert((batchSize > 0 && input.getCols() == inputCount) && "Invalid input parameters!");
+	assert((output.getRows() == batchSize && output.getCols() == outputCount) && "Invalid output parameters!");
 
-	m_Kernels.sub(kernelGradient.mult(learningRate));
-	m_Biases.sub(sumsAfter.mult(learningRate));
-	return Tensor1D(m_InputType.getParameterCount(), std::move(costBefore));
+	for (size_t n = 0; n < batchSize; n++)
+		_forward(input.getData() + n * inputCount, sums ? sums + n * outputCount : nullptr, output.getData() + n * outputCount);
 }
 
-PreparePropagateData ConvolutionalTreeLayer::preparePropagate(const Tensor1D& input) const {
-	assert((input.getCount() == m_InputType.getParameterCount()) && 
-		"Invalid input parameters!");
-	PreparePropagateData pData;
+template<class T>
+void BasicConvolutionalTreeLayer<T>::setLayout(Layout layout) {
+	m_Layout = layout;
+	m_Biases = m_Biases.toLayout(layout);
+}
 
-	Tensor3D working = Tensor3D(
-		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], input);
+template<class T>
+BasicDataLayout<T> BasicConvolutionalTreeLayer<T>::getInputLayout() const {
+	return { m_Layout, m_InputType.parameters[0], m_InputType.parameters[1], m_InputType.parameters[2] };
+}
 
-	Tensor3D output = Tensor3D(new double[m_OutputType.getParameterCount()],
-		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1]);
+template<class T>
+BasicDataLayout<T> BasicConvolutionalTreeLayer<T>::getOutputLayout() const {
+	return { m_Layout, m_OutputType.parameters[0], m_OutputType.parameters[1], m_OutputType.parameters[2] };
+}
+
+template<class T>
+void BasicConvolutionalTreeLayer<T>::updateKernelCache() {
+	m_KernelCacheValid = false;
+	if (_isFFTConvolution()) {
+		// The input fits into the FFT grid, the correlations never wrap around into the valid part.
+		m_FFTRows = fftSize(m_InputType.parameters[0]);
+		m_FFTCols = fftSize(m_InputType.parameters[1]);
+		size_t spectrumSize = m_FFTRows * m_FFTCols;
+		ConstTensorView<3, T> kernels(m_Kernels);
+
+		m_KernelSpectra.resize(m_Kernels.getDepth() * spectrumSize);
+		for (size_t i = 0; i < m_Kernels.getDepth(); i++)
+			spectrum(m_KernelSpectra.data() + i * spectrumSize, kernels.select(0, i), m_FFTRows, m_FFTCols, 1);
+		m_KernelCacheValid = true;
+	}
+}
+
+template<class T>
+void BasicConvolutionalTreeLayer<T>::_forward(const precision* input, precision* sums, precision* output) const {
+	_convolve(input, LayoutView<T>(output, m_Layout,
+		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1]));
+
+	// The biases, the sums and the activation in one pass over the output.
+	Epilogue epilogue;
+	epilogue.bias = m_Biases.getData();
+	epilogue.sums = sums;
+	epilogue.activation = &m_Activation.getActivationSpan();
+	size_t outputCount = getOutputLayout().getCount();
+	applyEpilogue(epilogue, 1, outputCount, output, outputCount);
+}
+
+template<class T>
+void BasicConvolutionalTreeLayer<T>::_convolve(const precision* input, LayoutView<T> output) const {
+	// The flat input seen with the shape of the input.
+	ConstLayoutView<T> inputView(input, m_Layout,
+		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1]);
 
+	// Only the real depths are written, the padding of the blocked layout is cleared.
+	if (m_Layout == Layout::Blocked)
+		kernel::fill(output.getData(), precision(), getOutputLayout().getCount());
 
+	if (_isFFTConvolution() && m_KernelCacheValid) {
+		_fftConvolve(inputView, output);
+		return;
+	}
+
+	// Calculate the number of output per input.
 	size_t kernelCountPerInput = m_OutputType.parameters[2] / m_InputType.parameters[2];
 
-	size_t inputLayerCount = m_InputType.parameters[0] * m_InputType.parameters[1];
-	size_t outputLayerCount = m_OutputType.parameters[0] * m_OutputType.parameters[1];
-	size_t kernelLayerCount = m_Kernels.getRows() * m_Kernels.getCols();
+	ConstTensorView<3, T> kernels(m_Kernels);
 
+	// Go through the kernel depth and output depth.
 	for (size_t i = 0; i < m_OutputType.parameters[2]; i++) {
 
 		size_t inputIndex = size_t(i / kernelCountPerInput);
 
-		Tensor2D inputWatcher = Tensor2D(m_InputType.parameters[0], m_InputType.parameters[1],
-			Tensor(working.getData() + inputIndex * inputLayerCount, true));
-		Tensor2D outputWatcher = Tensor2D(m_OutputType.parameters[0], m_OutputType.parameters[1],
-			Tensor(output.getData() + i * outputLayerCount, true));
-		Tensor2D kernelWatcher = Tensor2D(m_Kernels.getRows(), m_Kernels.getCols(),
-			Tensor((double*)(m_Kernels.getData() + i * kernelLayerCount), true));
-
-		convolution(outputWatcher, inputWatcher, kernelWatcher, m_KernelStride);
+		convolution<precision>(output.channel(i), inputView.channel(inputIndex), kernels.select(0, i), m_KernelStride);
 	}
+}
 
-	pData.input = input;
-	output.add(m_Biases);
-	pData.sum = Tensor1D(m_OutputType.getParameterCount(), output);
-	output.manipul(m_Activation.getActivation());
-	pData.output = Tensor1D(m_OutputType.getParameterCount(), std::move(output));
+template<class T>
+void BasicConvolutionalTreeLayer<T>::_fftConvolve(ConstLayoutView<T> input, LayoutView<T> output) const {
+	size_t kernelCountPerInput = m_OutputType.parameters[2] / m_InputType.parameters[2];
+	size_t spectrumSize = m_FFTRows * m_FFTCols;
 
-	return pData;
+	thread_local std::vector<Complex> inputSpectrum;
+	thread_local std::vector<Complex> outputSpectrum;
+	inputSpectrum.resize(spectrumSize);
+	outputSpectrum.resize(spectrumSize);
+
+	// Every input depth is transformed once, and correlated with its kernels in the frequency domain.
+	for (size_t k = 0; k < m_InputType.parameters[2]; k++) {
+		spectrum(inputSpectrum.data(), input.channel(k), m_FFTRows, m_FFTCols, 1);
+
+		for (size_t i = k * kernelCountPerInput; i < (k + 1) * kernelCountPerInput; i++) {
+			std::fill(outputSpectrum.begin(), outputSpectrum.end(), Complex());
+			spectrumMultiplyAdd(outputSpectrum.data(), inputSpectrum.data(),
+				m_KernelSpectra.data() + i * spectrumSize, spectrumSize, true);
+
+			inverseSpectrum(output.channel(i), outputSpectrum.data(), m_FFTRows, m_FFTCols, m_KernelStride, false);
+		}
+	}
 }
 
-std::string ConvolutionalTreeLayer::toString() const {
+template<class T>
+void BasicConvolutionalTreeLayer<T>::_fftGradients(
+	ConstLayoutView<T> input, ConstLayoutView<T> localGradient, TensorView<3, T> kernelGradient, LayoutView<T> costBefore) const {
+	size_t kernelCountPerInput = m_OutputType.parameters[2] / m_InputType.parameters[2];
+	size_t spectrumSize = m_FFTRows * m_FFTCols;
+
+	thread_local std::vector<Complex> inputSpectrum;
+	thread_local std::vector<Complex> gradientSpectrum;
+	thread_local std::vector<Complex> costSpectrum;
+	thread_local std::vector<Complex> buffer;
+	inputSpectrum.resize(spectrumSize);
+	gradientSpectrum.resize(spectrumSize);
+	costSpectrum.resize(spectrumSize);
+	buffer.resize(spectrumSize);
+
+	for (size_t k = 0; k < m_InputType.parameters[2]; k++) {
+		spectrum(inputSpectrum.data(), input.channel(k), m_FFTRows, m_FFTCols, 1);
+		std::fill(costSpectrum.begin(), costSpectrum.end(), Complex());
+
+		for (size_t i = k * kernelCountPerInput; i < (k + 1) * kernelCountPerInput; i++) {
+			// The local gradient is upsampled by the stride, so the strided convolution becomes a stride 1 one.
+			spectrum(gradientSpectrum.data(), localGradient.channel(i), m_FFTRows, m_FFTCols, m_KernelStride);
+
+			// Kernel gradient = correlation of the input with the local gradient, cut to the kernel size.
+			std::fill(buffer.begin(), buffer.end(), Complex());
+			spectrumMultiplyAdd(buffer.data(), inputSpectrum.data(), gradientSpectrum.data(), spectrumSize, true);
+			inverseSpectrum(kernelGradient.select(0, i), buffer.data(), m_FFTRows, m_FFTCols, 1, false);
+
+			// The full convolutions of the local gradients with the kernels are summed in the frequency domain.
+			spectrumMultiplyAdd(costSpectrum.data(), gradientSpectrum.data(),
+				m_KernelSpectra.data() + i * spectrumSize, spectrumSize, false);
+		}
+
+		inverseSpectrum(costBefore.channel(k), costSpectrum.data(), m_FFTRows, m_FFTCols, 1, false);
+	}
+}
+
+template<class T>
+std::string BasicConvolutionalTreeLayer<T>::toString() const {
 	// Create a string stream. 
 	std::stringstream ss;
 
+	ss << getDescription();
+
+	for (size_t i = 0; i < m_Kernels.getCount(); i++)
+		ss << m_Kernels.getData()[i] << " ";
+
+	// The biases are always saved in planar order.
+	Tensor3D biases = m_Biases.toLayout(Layout::Planar);
+	for (size_t i = 0; i < biases.getCount(); i++)
+		ss << biases.getData()[i] << " ";
+
+	return ss.str();
+}
+
+template<class T>
+void BasicConvolutionalTreeLayer<T>::fromString(const std::string& rawString) {
+	fromText(rawString);
+}
+
+template<class T>
+void BasicConvolutionalTreeLayer<T>::fromText(std::string_view text) {
+	TextReader reader(text);
+	_readDescription(reader);
+
+	reader.read(m_Kernels.getData(), m_Kernels.getCount());
+	reader.read(m_Biases.getData(), m_Biases.getCount());
+	m_Biases = m_Biases.toLayout(m_Layout);
+
+	updateKernelCache();
+}
+
+template<class T>
+std::string BasicConvolutionalTreeLayer<T>::getDescription() const {
+	std::stringstream ss;
+
 	ss << m_InputType.parameters[0] << " ";
 	ss << m_InputType.parameters[1] << " ";
 	ss << m_InputType.parameters[2] << " ";
 
 	ss << m_OutputType.parameters[0] << " ";
-	ss << m_OutputType.parameters[0] << " ";
-	ss << m_OutputType.parameters[0] << " ";
+	ss << m_OutputType.parameters[1] << " ";
+	ss << m_OutputType.parameters[2] << " ";
 
 	ss << m_KernelStride << " ";
 
-	for (size_t i = 0; i < m_Kernels.getCount(); i++)
-		ss << m_Kernels.getData()[i] << " ";
-
-	for (size_t i = 0; i < m_Biases.getCount(); i++)
-		ss << m_Biases.getData()[i] << " ";
-
 	return ss.str();
 }
 
-void ConvolutionalTreeLayer::fromString(const std::string& rawString) {
-	std::stringstream ss(rawString);
+template<class T>
+void BasicConvolutionalTreeLayer<T>::fromDescription(const std::string& description) {
+	TextReader reader(description);
+	_readDescription(reader);
+	m_Biases = m_Biases.toLayout(m_Layout);
+}
 
-	ss >> m_InputType.parameters[0];
-	ss >> m_InputType.parameters[1];
-	ss >> m_InputType.parameters[2];
+template<class T>
+void BasicConvolutionalTreeLayer<T>::_readDescription(TextReader& reader) {
+	reader.read(m_InputType.parameters[0]);
+	reader.read(m_InputType.parameters[1]);
+	reader.read(m_InputType.parameters[2]);
 
-	ss >> m_OutputType.parameters[0];
-	ss >> m_OutputType.parameters[1];
-	ss >> m_OutputType.parameters[2];
+	reader.read(m_OutputType.parameters[0]);
+	reader.read(m_OutputType.parameters[1]);
+	reader.read(m_OutputType.parameters[2]);
 
-	ss >> m_KernelStride;
+	reader.read(m_KernelStride);
 
 	size_t rows = m_InputType.parameters[0] - (m_OutputType.parameters[0] - 1) * m_KernelStride;
 	size_t cols = m_InputType.parameters[1] - (m_OutputType.parameters[1] - 1) * m_KernelStride;
 
-	m_Kernels = Tensor3D(m_OutputType.parameters[2], rows, cols, 0.0);
-
-	m_Biases = Tensor3D(m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1], 0.0);
-
-	for (size_t i = 0; i < m_Kernels.getCount(); i++)
-		ss >> m_Kernels.getData()[i];
-
-	for (size_t i = 0; i < m_Biases.getCount(); i++)
-		ss >> m_Biases.getData()[i];
+	m_Kernels = Tensor3D(Tensor::allocateData(m_OutputType.parameters[2] * rows * cols), m_OutputType.parameters[2], rows, cols);
 
+	m_Biases = Tensor3D(Tensor::allocateData(m_OutputType.getParameterCount()),
+		m_OutputType.parameters[2], m_OutputType.parameters[0], m_OutputType.parameters[1]);
 }
 
+template class DRAGON_API BasicConvolutionalTreeLayer<float>;
+template class DRAGON_API BasicConvolutionalTreeLayer<double>;
+
 DRAGON_END
\ No newline at end of file
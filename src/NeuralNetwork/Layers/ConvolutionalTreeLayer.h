@@ -4,21 +4,27 @@
 
 DRAGON_BEGIN
 
-class DRAGON_API ConvolutionalTreeLayer : public BaseLayer {
+template<class T>
+class BasicConvolutionalTreeLayer : public BasicBaseLayer<T> {
 public:
-	ConvolutionalTreeLayer();
-	ConvolutionalTreeLayer(
+	DRAGON_LAYER_TYPES(T)
+	using BaseLayer::getParameterCount;
+
+	BasicConvolutionalTreeLayer();
+	BasicConvolutionalTreeLayer(
 		size_t inputRows, size_t inputCols, size_t inputDepth,
 		size_t kernelRows, size_t kernelCols, size_t kernelCountPerInput,
 		size_t kernelStride,
-		const std::function<double()>& initFunction,
+		const std::function<precision()>& initFunction,
 		const ActivationFunction& activation);
-	ConvolutionalTreeLayer(const ConvolutionalTreeLayer& other);
-	ConvolutionalTreeLayer(ConvolutionalTreeLayer&& other) noexcept;
+	BasicConvolutionalTreeLayer(const BasicConvolutionalTreeLayer& other);
+	BasicConvolutionalTreeLayer(BasicConvolutionalTreeLayer&& other) noexcept;
 
 
 	inline const Tensor3D& getKernels() const { return m_Kernels; }
-	inline Tensor3D& getKernels() { return m_Kernels; }
+	// The kernels can be changed through this, the cached kernel spectra are dropped until updateKernelCache is called.
+	inline Tensor3D& getKernels() { m_KernelCacheValid = false; return m_Kernels; }
+	// The biases are stored in the layout of the layer.
 	inline const Tensor3D& getBiases() const { return m_Biases; }
 	inline Tensor3D& getBiases() { return m_Biases; }
 	inline const size_t& getKernelStride() const { return m_KernelStride; }
@@ -36,11 +42,74 @@ public:
 
 	PreparePropagateData preparePropagate(const Tensor1D& input) const override;
 
+	// The kernel gradients of the samples are summed and applied once.
+	Tensor2D backPropagateBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		double learningRate) override;
+	Tensor2D feedForwardBatch(const Tensor2D& input) const override;
+	void feedForwardBatch(const Tensor2D& input, Tensor2D& output) const override;
+	PreparePropagateBatchData preparePropagateBatch(const Tensor2D& input) const override;
+	void preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const override;
+
+	// The kernels and the biases (in the layout of the layer).
+	std::vector<Tensor*> getParameters() override { return { &m_Kernels, &m_Biases }; }
+	Tensor2D gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients) override;
+	void gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients,
+		Tensor2D& costBefore) override;
+	void parametersChanged() override { updateKernelCache(); }
+
+	void setLayout(Layout layout) override;
+	DataLayout getInputLayout() const override;
+	DataLayout getOutputLayout() const override;
+
 	std::string toString() const override;
 	void fromString(const std::string& rawString) override;
+	void fromText(std::string_view text) override;
+	std::string getDescription() const override;
+	void fromDescription(const std::string& description) override;
 	std::string getName() const override { return "ConvolutionalTreeLayer"; }
 
+	// Recalculate the kernel spectra used by the FFT convolution.
+	// Call it after the kernels are modified from outside of the layer.
+	void updateKernelCache();
+
 private:
+	// Calculate the weighted sums (without the biases) of the input into the output.
+	// Every depth is convolved on its own, through the strided depth views of the layout.
+	void _convolve(const precision* input, LayoutView<T> output) const;
+	// Read the shapes and the stride, and allocate the kernels and the planar biases, their values are junk.
+	void _readDescription(TextReader& reader);
+	// Output of one sample, the weighted sums (with the biases) are saved into sums if it's not null.
+	void _forward(const precision* input, precision* sums, precision* output) const;
+	// Outputs of every sample of the batch, like _forward.
+	void _forwardBatch(const Tensor2D& input, precision* sums, Tensor2D& output) const;
+	// Calculate the kernel gradient and the gradient respect to the input (costBefore, has to be zero)
+	// of one sample from its local gradient and input, without updating the parameters.
+	void _gradients(const precision* localGradient, const precision* activationsBefore,
+		TensorView<3, T> kernelGradient, LayoutView<T> costBefore) const;
+	// Large kernels run in the frequency domain. The FFT calculates every position,
+	// the direct convolution only every stride-th, so the threshold grows with the stride.
+	inline bool _isFFTConvolution() const { return m_Kernels.getRows() >= FFT_MIN_KERNEL_SIZE * m_KernelStride; }
+	// Feed forward and backpropagation through the cached kernel spectra.
+	void _fftConvolve(ConstLayoutView<T> input, LayoutView<T> output) const;
+	void _fftGradients(ConstLayoutView<T> input, ConstLayoutView<T> localGradient, TensorView<3, T> kernelGradient, LayoutView<T> costBefore) const;
+
+private:
+	using BaseLayer::m_Activation;
+
+	// Kernel size from where the FFT convolution is faster than the direct one.
+	static constexpr size_t FFT_MIN_KERNEL_SIZE = 8;
+
 	// [0] = input rows, [1] = input cols, [2] = input depth
 	ParameterType<3> m_InputType;
 	// [0] = output rows, [1] = output cols [2] = output depth = inputDept * kernelCountPerInput
@@ -49,6 +118,18 @@ private:
 	size_t m_KernelStride;
 	Tensor3D m_Kernels;
 	Tensor3D m_Biases;
+	// Layout of the input, output and biases.
+	Layout m_Layout = Layout::Planar;
+
+	// Spectra of the kernels [output depth][fft rows * fft cols], for the FFT convolution.
+	std::vector<Complex> m_KernelSpectra;
+	size_t m_FFTRows = 0;
+	size_t m_FFTCols = 0;
+	bool m_KernelCacheValid = false;
 };
 
+extern template class DRAGON_API BasicConvolutionalTreeLayer<float>;
+extern template class DRAGON_API BasicConvolutionalTreeLayer<double>;
+using ConvolutionalTreeLayer = BasicConvolutionalTreeLayer<precision>;
+
 DRAGON_END
\ No newline at end of file
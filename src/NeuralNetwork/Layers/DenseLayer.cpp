@@ -2,89 +2,357 @@
 
 DRAGON_BEGIN
 
-DenseLayer::DenseLayer() : m_InputType({ 0, 0 }) { }
+template<class T>
+BasicDenseLayer<T>::BasicDenseLayer() : m_InputType({ 0, 0 }) { }
 
-DenseLayer::DenseLayer(
+template<class T>
+BasicDenseLayer<T>::BasicDenseLayer(
 	size_t numInputNodes, size_t numOutputNodes,
-	const std::function<double()>& initFunction,
+	const std::function<precision()>& initFunction,
 	const ActivationFunction& activation) :
 	m_InputType({ numInputNodes, numOutputNodes }), 
 	BaseLayer(activation) {
 
-	m_Weights = Tensor2D(numOutputNodes, numInputNodes, initTensor(m_InputType.getParameterCount(), initFunction));
-	m_Biases = initTensor(numOutputNodes, initFunction);
+	m_Weights = Tensor2D(numOutputNodes, numInputNodes, initTensor<precision>(m_InputType.getParameterCount(), initFunction));
+	m_Biases = initTensor<precision>(numOutputNodes, initFunction);
 }
 
-DenseLayer::DenseLayer(const DenseLayer& other) :
+template<class T>
+BasicDenseLayer<T>::BasicDenseLayer(const BasicDenseLayer& other) :
+	BaseLayer(other.m_Activation),
 	m_InputType(other.m_InputType),
 	m_Weights(other.m_Weights),
 	m_Biases(other.m_Biases),
-	BaseLayer(other.m_Activation) { }
+	m_HalfWeights(other.m_HalfWeights) { }
 
-DenseLayer::DenseLayer(DenseLayer&& other) noexcept :
+template<class T>
+BasicDenseLayer<T>::BasicDenseLayer(BasicDenseLayer&& other) noexcept :
+	BaseLayer(other.m_Activation),
 	m_InputType(other.m_InputType),
 	m_Weights(std::move(other.m_Weights)),
 	m_Biases(std::move(other.m_Biases)),
-	BaseLayer(other.m_Activation) { }
+	m_HalfWeights(std::move(other.m_HalfWeights)) { }
 
-Tensor1D DenseLayer::feedForward(const Tensor1D& input) const {
+template<class T>
+BasicTensor1D<T> BasicDenseLayer<T>::feedForward(const Tensor1D& input) const {
 	assert((input.getCount() == m_InputType.parameters[0]) && "Invalid input parameters!");
 
-	Tensor2D working = tensorDot(m_Weights, input);
-	working.add(m_Biases);
-	working.manipul(m_Activation.getActivation());
-	return Tensor1D(m_InputType.parameters[1], std::move(working));
+	Tensor1D working = Tensor1D(Tensor::allocateData(m_InputType.parameters[1]), m_InputType.parameters[1]);
+	Epilogue epilogue = _epilogue(nullptr);
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		_forwardHalf(1, input.getData(), working.getData(), epilogue);
+		return working;
+	}
+	gemv(m_InputType.parameters[1], m_InputType.parameters[0],
+		precision(1), m_Weights.getData(), m_Weights.getCols(),
+		input.getData(),
+		precision(), working.getData(), &epilogue);
+	return working;
 }
 
-Tensor1D DenseLayer::backPropagate(
+template<class T>
+BasicTensor1D<T> BasicDenseLayer<T>::backPropagate(
 	Tensor1D& sumsAfter,
 	Tensor1D& costAfter, 
 	Tensor1D& activationBefore, 
 	double learningRate) {
 
+	assert((m_HalfWeights.format == WeightFormat::Precision) && "The 16 bit weights can't be trained, set the weight format to Precision!");
 	assert((activationBefore.getCount() == m_InputType.parameters[0]) && "Invalid before activation parameters!");
 	assert((sumsAfter.getCount() == costAfter.getCount() && sumsAfter.getCount() == m_InputType.parameters[1]) &&
 		"Invalid cost and sums parameters!");
 
-	sumsAfter.manipul(m_Activation.getActivationDiff()).mult(costAfter);
-	Tensor2D gradientWeight = tensorDot(sumsAfter, trans(activationBefore));
-	Tensor1D gradientBiases = sumsAfter;
-	Tensor1D costBefore = Tensor1D(m_InputType.parameters[0], 
-		tensorDot(trans(m_Weights), Tensor2D(m_InputType.parameters[1], 1, std::move(sumsAfter))));
+	m_Activation.applyDiff(sumsAfter).mult(costAfter);
+
+	// Cost respect to the input, the weights are read in place as transponant.
+	// It has to be calculated with the weights before the update.
+	Tensor1D costBefore = Tensor1D(Tensor::allocateData(m_InputType.parameters[0]), m_InputType.parameters[0]);
+	gemvTrans(m_InputType.parameters[1], m_InputType.parameters[0],
+		precision(1), m_Weights.getData(), m_Weights.getCols(),
+		sumsAfter.getData(),
+		precision(), costBefore.getData());
 
-	m_Weights.sub(gradientWeight.mult(learningRate));
-	m_Biases.sub(gradientBiases.mult(learningRate));
+	// The weight gradient is the outer product of the local gradient and the input,
+	// it's applied in place without building the gradient matrix.
+	ger(m_InputType.parameters[1], m_InputType.parameters[0],
+		-precision(learningRate), sumsAfter.getData(), activationBefore.getData(),
+		m_Weights.getData(), m_Weights.getCols());
+	axpy(m_InputType.parameters[1], -precision(learningRate), sumsAfter.getData(), m_Biases.getData());
 	return costBefore;
 }
 
-PreparePropagateData DenseLayer::preparePropagate(const Tensor1D& input) const {
+template<class T>
+BasicPreparePropagateData<T> BasicDenseLayer<T>::preparePropagate(const Tensor1D& input) const {
 	assert((input.getCount() == m_InputType.parameters[0]) && "Invalid input parameters!");
 	PreparePropagateData pData;
 	
-	Tensor2D working = tensorDot(m_Weights, input);
-	working.add(m_Biases);
-
 	pData.input = Tensor1D(input);
-	pData.sum = Tensor1D(m_InputType.parameters[1], working);
-	pData.output = Tensor1D(m_InputType.parameters[1], std::move(working.manipul(m_Activation.getActivation())));
+	pData.sum = Tensor1D(Tensor::allocateData(m_InputType.parameters[1]), m_InputType.parameters[1]);
+	pData.output = Tensor1D(Tensor::allocateData(m_InputType.parameters[1]), m_InputType.parameters[1]);
+	Epilogue epilogue = _epilogue(pData.sum.getData());
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		_forwardHalf(1, input.getData(), pData.output.getData(), epilogue);
+		return pData;
+	}
+	gemv(m_InputType.parameters[1], m_InputType.parameters[0],
+		precision(1), m_Weights.getData(), m_Weights.getCols(),
+		input.getData(),
+		precision(), pData.output.getData(), &epilogue);
 
 	return pData;
 }
 
-std::string DenseLayer::toString() const {
+template<class T>
+BasicTensor2D<T> BasicDenseLayer<T>::feedForwardBatch(const Tensor2D& input) const {
+	Tensor2D working = Tensor2D(Tensor::allocateData(input.getRows() * m_InputType.parameters[1]),
+		input.getRows(), m_InputType.parameters[1]);
+	_forwardBatch(input, nullptr, working);
+	return working;
+}
+
+template<class T>
+void BasicDenseLayer<T>::feedForwardBatch(const Tensor2D& input, Tensor2D& output) const {
+	_forwardBatch(input, nullptr, output);
+}
+
+template<class T>
+std::vector<BasicTensor<T>*> BasicDenseLayer<T>::getParameters() {
+	if (m_HalfWeights.format != WeightFormat::Precision)
+		return { &m_Biases };
+	return { &m_Weights, &m_Biases };
+}
+
+template<class T>
+bool BasicDenseLayer<T>::setWeightFormat(WeightFormat format) {
+	size_t rows = m_InputType.parameters[1];
+	size_t cols = m_InputType.parameters[0];
+	if (format == m_HalfWeights.format)
+		return true;
+
+	if (format == WeightFormat::Precision) {
+		m_Weights = Tensor2D(Tensor::allocateData(rows * cols), rows, cols);
+		fromHalfWeights(m_Weights.getData(), m_HalfWeights);
+		m_HalfWeights = HalfWeights();
+		return true;
+	}
+	if (m_HalfWeights.format == WeightFormat::Precision) {
+		// The precision weights are freed, only the 16 bit ones stay in memory.
+		toHalfWeights(m_HalfWeights, m_Weights.getData(), rows, cols, format);
+		m_Weights = Tensor2D();
+		return true;
+	}
+	// From one 16 bit format to the other through float, that holds both exactly.
+	std::vector<float> widened(rows * cols);
+	fromHalfWeights(widened.data(), m_HalfWeights);
+	toHalfWeights(m_HalfWeights, widened.data(), rows, cols, format);
+	return true;
+}
+
+template<class T>
+bool BasicDenseLayer<T>::quantize(QuantizedWeights& weights) const {
+	if (m_HalfWeights.format != WeightFormat::Precision)
+		return false;
+
+	// The rows of the weights are the output nodes.
+	quantizeRows(weights, m_Weights.getData(), m_InputType.parameters[1], m_InputType.parameters[0]);
+	weights.biases.assign(m_Biases.getData(), m_Biases.getData() + m_Biases.getCount());
+	return true;
+}
+
+template<class T>
+void BasicDenseLayer<T>::feedForwardQuantized(const Tensor2D& input, Tensor2D& output, const QuantizedWeights& weights) const {
+	size_t batchSize = input.getRows();
+	size_t inputCount = m_InputType.parameters[0];
+	size_t outputCount = m_InputType.parameters[1];
+	assert((input.getCols() == inputCount && output.getRows() == batchSize && output.getCols() == outputCount) &&
+		"Invalid input or output parameters!");
+	assert((weights.rows == outputCount && weights.cols == inputCount) && "The quantized weights not match with the layer!");
+
+	thread_local std::vector<int8_t> quantizedInput;
+	thread_local std::vector<int32_t> sums;
+	quantizedInput.resize(batchSize * inputCount);
+	sums.resize(batchSize * outputCount);
+
+	quantizeValues(quantizedInput.data(), input.getData(), batchSize * inputCount, weights.inputScale);
+	gemmInt8(batchSize, outputCount, inputCount, quantizedInput.data(), inputCount, weights.packed.data(), sums.data(), outputCount);
+
+	for (size_t n = 0; n < batchSize; n++) {
+		precision* row = output.getData() + n * outputCount;
+		const int32_t* sumRow = sums.data() + n * outputCount;
+		for (size_t j = 0; j < outputCount; j++)
+			row[j] = precision(sumRow[j]) * (weights.inputScale * weights.scales[j]) + weights.biases[j];
+	}
+	m_Activation.getActivationSpan()(output.getData(), batchSize * outputCount);
+}
+
+template<class T>
+BasicTensor2D<T> BasicDenseLayer<T>::backPropagateBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	double learningRate) {
+	size_t batchSize = sumsAfter.getRows();
+	Tensor2D costBefore = Tensor2D(Tensor::allocateData(batchSize * m_InputType.parameters[0]), batchSize, m_InputType.parameters[0]);
+	_costBeforeBatch(sumsAfter, costAfter, activationsBefore, costBefore);
+
+	// The summed weight gradient is trans(local gradients) * inputs, the average is applied in place in the same gemm.
+	precision rate = precision(learningRate / double(batchSize));
+	gemm(true, false,
+		m_InputType.parameters[1], m_InputType.parameters[0], batchSize,
+		-rate, sumsAfter.getData(), sumsAfter.getCols(),
+		activationsBefore.getData(), activationsBefore.getCols(),
+		precision(1), m_Weights.getData(), m_Weights.getCols());
+	for (size_t n = 0; n < batchSize; n++)
+		axpy(m_InputType.parameters[1], -rate, sumsAfter.getData() + n * sumsAfter.getCols(), m_Biases.getData());
+
+	return costBefore;
+}
+
+template<class T>
+BasicTensor2D<T> BasicDenseLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision* gradients) {
+	size_t batchSize = sumsAfter.getRows();
+	Tensor2D costBefore = Tensor2D(Tensor::allocateData(batchSize * m_InputType.parameters[0]), batchSize, m_InputType.parameters[0]);
+	gradientsBatch(sumsAfter, costAfter, activationsBefore, gradients, costBefore);
+	return costBefore;
+}
+
+template<class T>
+void BasicDenseLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision* gradients,
+	Tensor2D& costBefore) {
+	_costBeforeBatch(sumsAfter, costAfter, activationsBefore, costBefore);
+	_addGradients(sumsAfter, activationsBefore, gradients);
+}
+
+template<class T>
+BasicPreparePropagateBatchData<T> BasicDenseLayer<T>::preparePropagateBatch(const Tensor2D& input) const {
+	PreparePropagateBatchData bData;
+	size_t batchSize = input.getRows();
+
+	bData.input = input;
+	bData.sum = Tensor2D(Tensor::allocateData(batchSize * m_InputType.parameters[1]), batchSize, m_InputType.parameters[1]);
+	bData.output = Tensor2D(Tensor::allocateData(batchSize * m_InputType.parameters[1]), batchSize, m_InputType.parameters[1]);
+	_forwardBatch(input, bData.sum.getData(), bData.output);
+
+	return bData;
+}
+
+template<class T>
+void BasicDenseLayer<T>::preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const {
+	assert((output.getRows() == sum.getRows() && output.getCols() == sum.getCols()) && "Invalid output parameters!");
+	_forwardBatch(input, sum.getData(), output);
+}
+
+template<class T>
+void BasicDenseLayer<T>::_forwardBatch(const Tensor2D& input, precision* sums, Tensor2D& output) const {
+	assert((input.getRows() > 0 && input.getCols() == m_InputType.parameters[0]) && "Invalid input parameters!");
+	assert((output.getRows() == input.getRows() && output.getCols() == m_InputType.parameters[1]) && "Invalid output parameters!");
+	size_t batchSize = input.getRows();
+	Epilogue epilogue = _epilogue(sums);
+
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		_forwardHalf(batchSize, input.getData(), output.getData(), epilogue);
+		return;
+	}
+
+	// A single sample is a matrix vector product, like in feedForward.
+	if (batchSize == 1) {
+		gemv(m_InputType.parameters[1], m_InputType.parameters[0],
+			precision(1), m_Weights.getData(), m_Weights.getCols(),
+			input.getData(),
+			precision(), output.getData(), &epilogue);
+		return;
+	}
+
+	// outputs = activation(inputs * trans(weights) + biases), the gemm adds the biases and applies the activation on its tiles.
+	gemm(false, true,
+		batchSize, m_InputType.parameters[1], m_InputType.parameters[0],
+		precision(1), input.getData(), input.getCols(),
+		m_Weights.getData(), m_Weights.getCols(),
+		precision(), output.getData(), output.getCols(), &epilogue);
+}
+
+template<class T>
+BasicEpilogue<T> BasicDenseLayer<T>::_epilogue(precision* sums) const {
+	Epilogue epilogue;
+	epilogue.bias = m_Biases.getData();
+	epilogue.sums = sums;
+	epilogue.sumsStride = m_InputType.parameters[1];
+	epilogue.activation = &m_Activation.getActivationSpan();
+	return epilogue;
+}
+
+template<class T>
+void BasicDenseLayer<T>::_forwardHalf(size_t batchSize, const precision* input, precision* output, const Epilogue& epilogue) const {
+	gemmHalf(false, batchSize, input, m_InputType.parameters[0], m_HalfWeights, output, m_InputType.parameters[1]);
+	applyEpilogue(epilogue, batchSize, m_InputType.parameters[1], output, m_InputType.parameters[1]);
+}
+
+template<class T>
+void BasicDenseLayer<T>::_costBeforeBatch(Tensor2D& sumsAfter, const Tensor2D& costAfter, const Tensor2D& activationsBefore,
+	Tensor2D& costBefore) const {
+	size_t batchSize = sumsAfter.getRows();
+	assert((m_HalfWeights.format == WeightFormat::Precision) && "The 16 bit weights can't be trained, set the weight format to Precision!");
+	assert((activationsBefore.getRows() == batchSize && activationsBefore.getCols() == m_InputType.parameters[0]) &&
+		"Invalid before activation parameters!");
+	assert((costAfter.getRows() == batchSize && sumsAfter.getCols() == m_InputType.parameters[1] &&
+		costAfter.getCols() == m_InputType.parameters[1]) &&
+		"Invalid cost and sums parameters!");
+	assert((costBefore.getRows() == batchSize && costBefore.getCols() == m_InputType.parameters[0]) &&
+		"Invalid cost before parameters!");
+
+	// Local gradients of the samples, batch size x output nodes.
+	m_Activation.applyDiff(sumsAfter).mult(costAfter);
+
+	// Cost respect to the inputs = local gradients * weights, before the update.
+	gemm(false, false,
+		batchSize, m_InputType.parameters[0], m_InputType.parameters[1],
+		precision(1), sumsAfter.getData(), sumsAfter.getCols(),
+		m_Weights.getData(), m_Weights.getCols(),
+		precision(), costBefore.getData(), costBefore.getCols());
+}
+
+template<class T>
+void BasicDenseLayer<T>::_addGradients(const Tensor2D& localGradients, const Tensor2D& activationsBefore, precision* gradients) const {
+	size_t batchSize = localGradients.getRows();
+
+	// Weight gradient += trans(local gradients) * inputs, than the bias gradient.
+	gemm(true, false,
+		m_InputType.parameters[1], m_InputType.parameters[0], batchSize,
+		precision(1), localGradients.getData(), localGradients.getCols(),
+		activationsBefore.getData(), activationsBefore.getCols(),
+		precision(1), gradients, m_Weights.getCols());
+	precision* biasGradient = gradients + m_Weights.getCount();
+	for (size_t n = 0; n < batchSize; n++)
+		kernel::add(biasGradient, localGradients.getData() + n * localGradients.getCols(), m_Biases.getCount());
+}
+
+template<class T>
+std::string BasicDenseLayer<T>::toString() const {
 	// Create a string stream. 
 	std::stringstream ss;
 	ss << std::fixed << std::setprecision(8);
 
 	// Put the dense layer parameter dimensions.
-	// Input nodes.
-	ss << std::to_string(m_InputType.parameters[0]) << " ";
-	// Output nodes.
-	ss << std::to_string(m_InputType.parameters[1]) << " ";
-
-	// Put the weights.
-	for (size_t i = 0; i < m_Weights.getCount(); i++) {
-		ss << m_Weights.getData()[i] << " ";
+	ss << getDescription();
+
+	// Put the weights, the 16 bit weights widened.
+	const precision* weights = m_Weights.getData();
+	std::vector<precision> widened;
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		widened.resize(m_InputType.getParameterCount());
+		fromHalfWeights(widened.data(), m_HalfWeights);
+		weights = widened.data();
+	}
+	for (size_t i = 0; i < m_InputType.getParameterCount(); i++) {
+		ss << weights[i] << " ";
 	}
 	// Put the biases.
 	for (size_t i = 0; i < m_Biases.getCount(); i++) {
@@ -94,25 +362,61 @@ std::string DenseLayer::toString() const {
 	return ss.str();
 }
 
-void DenseLayer::fromString(const std::string& rawString) {
-	std::stringstream ss(rawString);
+template<class T>
+void BasicDenseLayer<T>::fromString(const std::string& rawString) {
+	fromText(rawString);
+}
+
+template<class T>
+void BasicDenseLayer<T>::fromText(std::string_view text) {
+	TextReader reader(text);
+	_readDescription(reader);
 
+	// Get the weights, they are rounded if the layer keeps them in 16 bits.
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		std::vector<precision> weights(m_InputType.getParameterCount());
+		reader.read(weights.data(), weights.size());
+		toHalfWeights(m_HalfWeights, weights.data(), m_InputType.parameters[1], m_InputType.parameters[0], m_HalfWeights.format);
+	}
+	else {
+		reader.read(m_Weights.getData(), m_Weights.getCount());
+	}
+	// Get the biases.
+	reader.read(m_Biases.getData(), m_Biases.getCount());
+}
+
+template<class T>
+std::string BasicDenseLayer<T>::getDescription() const {
+	// Input nodes and output nodes.
+	return std::to_string(m_InputType.parameters[0]) + " " + std::to_string(m_InputType.parameters[1]) + " ";
+}
+
+template<class T>
+void BasicDenseLayer<T>::fromDescription(const std::string& description) {
+	TextReader reader(description);
+	_readDescription(reader);
+}
+
+template<class T>
+void BasicDenseLayer<T>::_readDescription(TextReader& reader) {
 	// Get the input nodes.
-	ss >> m_InputType.parameters[0];
+	reader.read(m_InputType.parameters[0]);
 	// Get the output nodes.
-	ss >> m_InputType.parameters[1];
-
-	// Create the weight and biases matrces.
-	m_Weights = Tensor2D(m_InputType.parameters[1], m_InputType.parameters[0], 0.0);
-	m_Biases = Tensor1D(m_InputType.parameters[1], 0.0);
-	// Get the weights.
-	for (size_t i = 0; i < m_Weights.getCount(); i++) {
-		ss >> m_Weights.getData()[i];
+	reader.read(m_InputType.parameters[1]);
+
+	// Create the weight and biases matrces, the 16 bit weights are filled by the caller.
+	if (m_HalfWeights.format != WeightFormat::Precision) {
+		m_HalfWeights.rows = m_InputType.parameters[1];
+		m_HalfWeights.cols = m_InputType.parameters[0];
+		m_HalfWeights.packed.clear();
 	}
-	// Get the biases.
-	for (size_t i = 0; i < m_Biases.getCount(); i++) {
-		ss >> m_Biases.getData()[i];
+	else {
+		m_Weights = Tensor2D(Tensor::allocateData(m_InputType.getParameterCount()), m_InputType.parameters[1], m_InputType.parameters[0]);
 	}
+	m_Biases = Tensor1D(Tensor::allocateData(m_InputType.parameters[1]), m_InputType.parameters[1]);
 }
 
+template class DRAGON_API BasicDenseLayer<float>;
+template class DRAGON_API BasicDenseLayer<double>;
+
 DRAGON_END
\ No newline at end of file
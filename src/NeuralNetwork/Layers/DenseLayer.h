@@ -10,23 +10,32 @@ DRAGON_BEGIN
 /// Member variables are Weight tensor, Biases tensor and the InputType stucture.
 /// InputType contains the number of input nodes and the number of output nodes.
 /// </summary>
-class DRAGON_API DenseLayer : public BaseLayer {
+template<class T>
+class BasicDenseLayer : public BasicBaseLayer<T> {
+public:
+	DRAGON_LAYER_TYPES(T)
+
 private:
+	using BaseLayer::m_Activation;
+
 	// m_InputType.parameters[0] = numInputNodes, m_inputType.parameters[1] = numOutputNodes
 	ParameterType<2> m_InputType;
 
 	Tensor2D m_Weights;
 	Tensor1D m_Biases;
+	// The weights in 16 bits, m_Weights is empty while they are used (setWeightFormat).
+	HalfWeights m_HalfWeights;
 public:
-	DenseLayer();
-	DenseLayer(
+	BasicDenseLayer();
+	BasicDenseLayer(
 		size_t numInputNodes, size_t numOutputNodes,
-		const std::function<double()>& initFunction,
+		const std::function<precision()>& initFunction,
 		const ActivationFunction& activation);
-	DenseLayer(const DenseLayer& other);
-	DenseLayer(DenseLayer&& other) noexcept;
+	BasicDenseLayer(const BasicDenseLayer& other);
+	BasicDenseLayer(BasicDenseLayer&& other) noexcept;
 
 
+	// The weights are empty while the layer keeps them in 16 bits.
 	inline const Tensor2D& getWeights() const { return m_Weights; }
 	inline const Tensor1D& getBiases() const { return m_Biases; }
 	inline Tensor2D& getWeights() { return m_Weights; }
@@ -44,9 +53,67 @@ public:
 
 	PreparePropagateData preparePropagate(const Tensor1D& input) const override;
 
+	// The batched functions are matrix-matrix products over the whole batch.
+	Tensor2D feedForwardBatch(const Tensor2D& input) const override;
+	void feedForwardBatch(const Tensor2D& input, Tensor2D& output) const override;
+	// The layer with 16 bit weights is not quantized, it runs with them in the quantized plan too.
+	bool quantize(QuantizedWeights& weights) const override;
+	void feedForwardQuantized(const Tensor2D& input, Tensor2D& output, const QuantizedWeights& weights) const override;
+	Tensor2D backPropagateBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		double learningRate) override;
+	PreparePropagateBatchData preparePropagateBatch(const Tensor2D& input) const override;
+	void preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const override;
+
+	// The weights and the biases, only the biases with 16 bit weights.
+	std::vector<Tensor*> getParameters() override;
+	Tensor2D gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients) override;
+	void gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients,
+		Tensor2D& costBefore) override;
+
+	bool setWeightFormat(WeightFormat format) override;
+	WeightFormat getWeightFormat() const override { return m_HalfWeights.format; }
+	HalfWeights* getHalfWeights() override { return &m_HalfWeights; }
+
+	// The flat input and output, as one row of values.
+	DataLayout getInputLayout() const override { return { Layout::Planar, 1, m_InputType.parameters[0], 1 }; }
+	DataLayout getOutputLayout() const override { return { Layout::Planar, 1, m_InputType.parameters[1], 1 }; }
+
 	std::string toString() const override;
 	void fromString(const std::string& rawString) override;
+	void fromText(std::string_view text) override;
+	std::string getDescription() const override;
+	void fromDescription(const std::string& description) override;
 	std::string getName() const override { return "DenseLayer"; }
+
+private:
+	// Read the node counts and allocate the weights and biases, their values are junk.
+	void _readDescription(TextReader& reader);
+	// Outputs of the batch, batch size x output nodes. The weighted sums are saved into sums if it's not null.
+	void _forwardBatch(const Tensor2D& input, precision* sums, Tensor2D& output) const;
+	// The biases, the saving of the sums and the activation, done by the matrix product on its result.
+	Epilogue _epilogue(precision* sums) const;
+	// Outputs of batchSize samples with the 16 bit weights, the epilogue is run on the result of the product.
+	void _forwardHalf(size_t batchSize, const precision* input, precision* output, const Epilogue& epilogue) const;
+	// Turn the sums into the local gradients and calculate the cost respect to the inputs into costBefore.
+	void _costBeforeBatch(Tensor2D& sumsAfter, const Tensor2D& costAfter, const Tensor2D& activationsBefore,
+		Tensor2D& costBefore) const;
+	// Add the weight and bias gradients of the local gradients to gradients.
+	void _addGradients(const Tensor2D& localGradients, const Tensor2D& activationsBefore, precision* gradients) const;
 };
 
+extern template class DRAGON_API BasicDenseLayer<float>;
+extern template class DRAGON_API BasicDenseLayer<double>;
+using DenseLayer = BasicDenseLayer<precision>;
+
 DRAGON_END
\ No newline at end of file
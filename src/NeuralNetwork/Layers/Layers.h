@@ -1,6 +1,7 @@
 #pragma once
 #include "BaseLayer.h"
 #include "DenseLayer.h"
+#include "SparseDenseLayer.h"
 #include "ConvolutionalTreeLayer.h"
 #include "ConvolutionalLayer.h"
 #include "PoolingLayer.h"
@@ -2,148 +2,208 @@
 
 DRAGON_BEGIN
 
-PoolingLayer::PoolingLayer() : m_InputType({ 0, 0, 0 }) { }
+template<class T>
+BasicPoolingLayer<T>::BasicPoolingLayer() : m_InputType({ 0, 0, 0 }) { }
 
-PoolingLayer::PoolingLayer(
+template<class T>
+BasicPoolingLayer<T>::BasicPoolingLayer(
 	size_t inputRows, size_t inputCols, size_t inputDepth,
 	size_t kernelRows, size_t kernelCols,
-	const std::function<double(const std::vector<double>& values)> poolingFunc,
-	const std::function<std::vector<double>(const std::vector<double>& values, double value)> poolingFuncDiff) 
+	const std::function<precision(const std::vector<precision>& values)> poolingFunc,
+	const std::function<std::vector<precision>(const std::vector<precision>& values, precision value)> poolingFuncDiff) 
 	: 
 	m_InputType({ inputRows, inputCols, inputDepth }),
 	m_KernelRows(kernelRows), m_KernelCols(kernelCols),
 	m_PoolingFunction(poolingFunc),
 	m_PoolingFunctionDiff(poolingFuncDiff),
-	BaseLayer(sigmoid()) {
+	BaseLayer(sigmoid<precision>()) {
 	assert((m_InputType.parameters[0] % kernelRows == 0 && m_InputType.parameters[1] % kernelCols == 0) &&
 		"Kernel parameters not match with input parameters, loses some information, not supported yet! \
 		It make unexcepted behaviour at backpropagation!");	// TODO: support information loss.
 }
 
-PoolingLayer::PoolingLayer(const PoolingLayer& other) :
+template<class T>
+BasicPoolingLayer<T>::BasicPoolingLayer(const BasicPoolingLayer& other) :
 	m_InputType(other.m_InputType),
 	m_KernelRows(other.m_KernelRows), m_KernelCols(other.m_KernelCols),
+	m_Layout(other.m_Layout),
 	m_PoolingFunction(other.m_PoolingFunction), m_PoolingFunctionDiff(other.m_PoolingFunctionDiff),
-	BaseLayer(sigmoid()) { }
+	BaseLayer(sigmoid<precision>()) { }
 
-PoolingLayer::PoolingLayer(PoolingLayer&& other) noexcept:
+template<class T>
+BasicPoolingLayer<T>::BasicPoolingLayer(BasicPoolingLayer&& other) noexcept:
 	m_InputType(other.m_InputType),
 	m_KernelRows(other.m_KernelRows), m_KernelCols(other.m_KernelCols),
+	m_Layout(other.m_Layout),
 	m_PoolingFunction(other.m_PoolingFunction), m_PoolingFunctionDiff(other.m_PoolingFunctionDiff),
-	BaseLayer(sigmoid()) { }
+	BaseLayer(sigmoid<precision>()) { }
 
-Tensor1D PoolingLayer::feedForward(const Tensor1D& input) const {
-	assert((input.getCount() == m_InputType.getParameterCount()) && "Invalid input parameters!");
+template<class T>
+BasicTensor1D<T> BasicPoolingLayer<T>::feedForward(const Tensor1D& input) const {
+	assert((input.getCount() == getInputLayout().getCount()) && "Invalid input parameters!");
 
-	Tensor3D working = Tensor3D(
-		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], input);
-
-	// Calculate the output parameters.
-	size_t row = calcConvParamsAfter(m_InputType.parameters[0], m_KernelRows, m_KernelRows);
-	size_t col = calcConvParamsAfter(m_InputType.parameters[1], m_KernelCols, m_KernelCols);
-
-	// Make empty output tensor.
-	Tensor3D output = Tensor3D(new double[row * col * m_InputType.parameters[2]],
-		m_InputType.parameters[2], row, col);
-
-	// Go throuth the output depth.
-	for (size_t k = 0; k < m_InputType.parameters[2]; k++) {
-
-		// Go throuth the output tensor2D.
-		for (size_t i = 0; i < row; i++)
-			for (size_t j = 0; j < col; j++) {
-
-				// Get the values from the kernel space span.
-				std::vector<double> values;
-				values.reserve(m_KernelRows * m_KernelCols);
-				for (size_t x = 0; x < m_KernelRows; x++)
-					for (size_t y = 0; y < m_KernelCols; y++)
-						values.emplace_back(working.at(i * m_KernelRows + x, j * m_KernelCols + y, k));
-
-				// Calculate the output value.
-				output.at(i, j, k) = m_PoolingFunction(values);
-			}
-	}
-
-	return Tensor1D(row * col * m_InputType.parameters[2], std::move(output));
+	size_t outputCount = getOutputLayout().getCount();
+	Tensor1D output(Tensor::allocateData(outputCount), outputCount);
+	_pool(input.getData(), output.getData());
+	return output;
 }
 
-Tensor1D PoolingLayer::backPropagate(
+template<class T>
+BasicTensor1D<T> BasicPoolingLayer<T>::backPropagate(
 	Tensor1D& sumsAfter,
 	Tensor1D& costAfter,
 	Tensor1D& activationsBefore,
 	double learningRate) {
+	assert((costAfter.getCount() == getOutputLayout().getCount() && activationsBefore.getCount() == getInputLayout().getCount()) &&
+		"Invalid cost and activation parameters!");
 
-	// TODO: make it cleaner.
+	size_t inputCount = getInputLayout().getCount();
+	Tensor1D costBefore(Tensor::allocateData(inputCount), inputCount);
+	_poolDiff(costAfter.getData(), activationsBefore.getData(), costBefore.getData());
+	return costBefore;
+}
 
-	size_t row = calcConvParamsAfter(m_InputType.parameters[0], m_KernelRows, m_KernelRows);
-	size_t col = calcConvParamsAfter(m_InputType.parameters[1], m_KernelCols, m_KernelCols);
+template<class T>
+BasicPreparePropagateData<T> BasicPoolingLayer<T>::preparePropagate(const Tensor1D& input) const {
+	PreparePropagateData pData;
+	pData.input = input;
+	pData.output = feedForward(input);
+	return pData;
+}
 
-	Tensor3D workingInput = Tensor3D(m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1],
-		activationsBefore);
-	Tensor3D workingCostAfter = Tensor3D(m_InputType.parameters[2], row, col, costAfter);
+template<class T>
+void BasicPoolingLayer<T>::preparePropagateBatch(const Tensor2D& input, Tensor2D&, Tensor2D& output) const {
+	feedForwardBatch(input, output);
+}
 
-	Tensor3D costBefore = Tensor3D(m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], 0.0);
+template<class T>
+void BasicPoolingLayer<T>::feedForwardBatch(const Tensor2D& input, Tensor2D& output) const {
+	size_t inputCount = getInputLayout().getCount();
+	size_t outputCount = getOutputLayout().getCount();
+	assert((input.getCols() == inputCount && output.getRows() == input.getRows() && output.getCols() == outputCount) &&
+		"Invalid input and output parameters!");
 
-	for (size_t k = 0; k < m_InputType.parameters[2]; k++) {
+	for (size_t n = 0; n < input.getRows(); n++)
+		_pool(input.getData() + n * inputCount, output.getData() + n * outputCount);
+}
 
-		for (size_t i = 0; i < row; i++)
-			for (size_t j = 0; j < col; j++) {
+template<class T>
+void BasicPoolingLayer<T>::gradientsBatch(
+	Tensor2D&,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision*,
+	Tensor2D& costBefore) {
+	size_t inputCount = getInputLayout().getCount();
+	size_t outputCount = getOutputLayout().getCount();
+	size_t batchSize = costAfter.getRows();
+	assert((costAfter.getCols() == outputCount && activationsBefore.getRows() == batchSize &&
+		activationsBefore.getCols() == inputCount && costBefore.getRows() == batchSize && costBefore.getCols() == inputCount) &&
+		"Invalid cost and activation parameters!");
+
+	for (size_t n = 0; n < batchSize; n++)
+		_poolDiff(costAfter.getData() + n * outputCount, activationsBefore.getData() + n * inputCount,
+			costBefore.getData() + n * inputCount);
+}
 
-				// Get the values from the kernel space span.
-				std::vector<double> values;
-				values.reserve(m_KernelRows * m_KernelCols);
-				for (size_t x = 0; x < m_KernelRows; x++)
-					for (size_t y = 0; y < m_KernelCols; y++)
-						values.emplace_back(workingInput.at(i * m_KernelRows + x, j * m_KernelCols + y, k));
+template<class T>
+void BasicPoolingLayer<T>::_pool(const precision* input, precision* output) const {
+	// The flat input and output seen with their shape, no copy.
+	DataLayout outputLayout = getOutputLayout();
+	ConstLayoutView<T> working(input, m_Layout,
+		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1]);
+	LayoutView<T> outputView(output, m_Layout, outputLayout.depth, outputLayout.rows, outputLayout.cols);
+
+	// The padding of the blocked layout stays zero.
+	kernel::fill(output, precision(), outputLayout.getCount());
+
+	// The values of a kernel span, kept per thread, so the steady state does not allocate.
+	thread_local std::vector<precision> values;
 
-				std::vector<double> result = m_PoolingFunctionDiff(values, workingCostAfter.at(i, j, k));
+	// Go throuth the output depth.
+	for (size_t k = 0; k < outputLayout.depth; k++) {
+
+		// Go throuth the output tensor2D.
+		for (size_t i = 0; i < outputLayout.rows; i++)
+			for (size_t j = 0; j < outputLayout.cols; j++) {
 
+				// Get the values from the kernel space span.
+				values.clear();
 				for (size_t x = 0; x < m_KernelRows; x++)
 					for (size_t y = 0; y < m_KernelCols; y++)
-						costBefore.at(i * m_KernelRows + x, j * m_KernelCols + y, k) = result.at(x * m_KernelCols + y);
+						values.emplace_back(working(k, i * m_KernelRows + x, j * m_KernelCols + y));
 
+				// Calculate the output value.
+				outputView(k, i, j) = m_PoolingFunction(values);
 			}
 	}
-	return Tensor1D(m_InputType.getParameterCount(), std::move(costBefore));
 }
 
-PreparePropagateData PoolingLayer::preparePropagate(const Tensor1D& input) const {
-	assert((input.getCount() == m_InputType.getParameterCount()) && "Invalid input parameters!");
+template<class T>
+void BasicPoolingLayer<T>::_poolDiff(const precision* costAfter, const precision* activationsBefore, precision* costBefore) const {
+	DataLayout outputLayout = getOutputLayout();
+	ConstLayoutView<T> workingInput(activationsBefore, m_Layout,
+		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1]);
+	ConstLayoutView<T> workingCostAfter(costAfter, m_Layout, outputLayout.depth, outputLayout.rows, outputLayout.cols);
+	LayoutView<T> costBeforeView(costBefore, m_Layout,
+		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1]);
 
-	PreparePropagateData pData;
+	kernel::fill(costBefore, precision(), getInputLayout().getCount());
 
-	Tensor3D working = Tensor3D(
-		m_InputType.parameters[2], m_InputType.parameters[0], m_InputType.parameters[1], input);
+	bool maxPooling = _isMaxPool();
+	thread_local std::vector<precision> values;
 
-	size_t row = calcConvParamsAfter(m_InputType.parameters[0], m_KernelRows, m_KernelRows);
-	size_t col = calcConvParamsAfter(m_InputType.parameters[1], m_KernelCols, m_KernelCols);
+	for (size_t k = 0; k < outputLayout.depth; k++) {
 
-	Tensor3D output = Tensor3D(new double[row * col * m_InputType.parameters[2]],
-		m_InputType.parameters[2], row, col);
+		for (size_t i = 0; i < outputLayout.rows; i++)
+			for (size_t j = 0; j < outputLayout.cols; j++) {
 
-	for (size_t k = 0; k < m_InputType.parameters[2]; k++) {
+				// Get the values from the kernel space span.
+				values.clear();
+				for (size_t x = 0; x < m_KernelRows; x++)
+					for (size_t y = 0; y < m_KernelCols; y++)
+						values.emplace_back(workingInput(k, i * m_KernelRows + x, j * m_KernelCols + y));
 
-		Tensor2D outputWatcher(row, col, Tensor(output.getData() + k * row * col, true));
+				if (maxPooling) {
+					// The cost goes to the first maximum, same as maxPoolDiff.
+					size_t index = 0;
+					for (size_t e = 1; e < values.size(); e++)
+						if (values[e] > values[index])
+							index = e;
+					costBeforeView(k, i * m_KernelRows + index / m_KernelCols, j * m_KernelCols + index % m_KernelCols) =
+						workingCostAfter(k, i, j);
+					continue;
+				}
 
-		for (size_t i = 0; i < row; i++)
-			for (size_t j = 0; j < col; j++) {
+				std::vector<precision> result = m_PoolingFunctionDiff(values, workingCostAfter(k, i, j));
 
-				std::vector<double> values;
-				values.reserve(m_KernelRows * m_KernelCols);
 				for (size_t x = 0; x < m_KernelRows; x++)
 					for (size_t y = 0; y < m_KernelCols; y++)
-						values.emplace_back(working.at(i * m_KernelRows + x, j * m_KernelCols + y, k));
-
-				outputWatcher.at(i, j) = m_PoolingFunction(values);
+						costBeforeView(k, i * m_KernelRows + x, j * m_KernelCols + y) = result.at(x * m_KernelCols + y);
 			}
 	}
-	pData.input = input;
-	pData.output = std::move(Tensor1D(m_InputType.parameters[2] * row * col, std::move(output)));
-	return pData;
 }
 
-std::string PoolingLayer::toString() const {
+template<class T>
+bool BasicPoolingLayer<T>::_isMaxPool() const {
+	return m_PoolingFunctionDiff.template target<MaxPoolDiff>() != nullptr;
+}
+
+template<class T>
+BasicDataLayout<T> BasicPoolingLayer<T>::getInputLayout() const {
+	return { m_Layout, m_InputType.parameters[0], m_InputType.parameters[1], m_InputType.parameters[2] };
+}
+
+template<class T>
+BasicDataLayout<T> BasicPoolingLayer<T>::getOutputLayout() const {
+	return { m_Layout,
+		calcConvParamsAfter(m_InputType.parameters[0], m_KernelRows, m_KernelRows),
+		calcConvParamsAfter(m_InputType.parameters[1], m_KernelCols, m_KernelCols),
+		m_InputType.parameters[2] };
+}
+
+template<class T>
+std::string BasicPoolingLayer<T>::toString() const {
 	std::stringstream ss;
 	ss << std::fixed << std::setprecision(8);
 
@@ -159,17 +219,23 @@ std::string PoolingLayer::toString() const {
 	return ss.str();
 }
 
-void PoolingLayer::fromString(const std::string& rawString) {
-	std::stringstream ss(rawString);
+template<class T>
+void BasicPoolingLayer<T>::fromString(const std::string& rawString) {
+	fromText(rawString);
+}
+
+template<class T>
+void BasicPoolingLayer<T>::fromText(std::string_view text) {
+	TextReader reader(text);
 
 	// Get parameters.
-	ss >> m_InputType.parameters[0];
-	ss >> m_InputType.parameters[1];
-	ss >> m_InputType.parameters[2];
+	reader.read(m_InputType.parameters[0]);
+	reader.read(m_InputType.parameters[1]);
+	reader.read(m_InputType.parameters[2]);
 
 	// Get kernel dimension.
-	ss >> m_KernelRows;
-	ss >> m_KernelCols;
+	reader.read(m_KernelRows);
+	reader.read(m_KernelCols);
 
 	m_PoolingFunction = maxPool;
 	m_PoolingFunctionDiff = maxPoolDiff;
@@ -177,4 +243,7 @@ void PoolingLayer::fromString(const std::string& rawString) {
 }
 
 
+template class DRAGON_API BasicPoolingLayer<float>;
+template class DRAGON_API BasicPoolingLayer<double>;
+
 DRAGON_END
\ No newline at end of file
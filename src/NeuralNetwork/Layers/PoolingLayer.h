@@ -11,17 +11,19 @@ DRAGON_BEGIN
 /// This layer taks in a Tensor and down sample it with a pooling function.
 /// This layer usully comes after a convolutional layer.
 /// </summary>
-class DRAGON_API PoolingLayer : public BaseLayer {
+template<class T>
+class BasicPoolingLayer : public BasicBaseLayer<T> {
 public:
+	DRAGON_LAYER_TYPES(T)
 
-	PoolingLayer();
-	PoolingLayer(
+	BasicPoolingLayer();
+	BasicPoolingLayer(
 		size_t inputRows, size_t inputCols, size_t inputDepth,
 		size_t kernelRows, size_t kernelCols,
-		const std::function<double(const std::vector<double>& values)> poolingFunc,
-		const std::function<std::vector<double>(const std::vector<double>& values, double value)> poolingFuncDiff);
-	PoolingLayer(const PoolingLayer& other);
-	PoolingLayer(PoolingLayer&& other) noexcept;
+		const std::function<precision(const std::vector<precision>& values)> poolingFunc,
+		const std::function<std::vector<precision>(const std::vector<precision>& values, precision value)> poolingFuncDiff);
+	BasicPoolingLayer(const BasicPoolingLayer& other);
+	BasicPoolingLayer(BasicPoolingLayer&& other) noexcept;
 	
 	Tensor1D feedForward(const Tensor1D& input) const override;
 
@@ -33,17 +35,50 @@ public:
 
 	PreparePropagateData preparePropagate(const Tensor1D& input) const override;
 
+	// The allocating batch versions run the samples one by one.
+	using BaseLayer::feedForwardBatch;
+	using BaseLayer::preparePropagateBatch;
+	using BaseLayer::gradientsBatch;
+	void feedForwardBatch(const Tensor2D& input, Tensor2D& output) const override;
+	// The pooling layer has no sums, sum is not written.
+	void preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const override;
+	void gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients,
+		Tensor2D& costBefore) override;
+
+	void setLayout(Layout layout) override { m_Layout = layout; }
+	DataLayout getInputLayout() const override;
+	DataLayout getOutputLayout() const override;
+
 	std::string toString() const override;
 	void fromString(const std::string& rawString) override;
+	void fromText(std::string_view text) override;
 	std::string getName() const override { return "PoolingLayer"; }
 
+private:
+	// Pool one sample into the output, the padding of the blocked layout is cleared.
+	void _pool(const precision* input, precision* output) const;
+	// Gradient respect to the input of one sample into costBefore.
+	void _poolDiff(const precision* costAfter, const precision* activationsBefore, precision* costBefore) const;
+	// The max pooling gradient is calculated without the vector returned by maxPoolDiff.
+	bool _isMaxPool() const;
+
 private:
 	// inputType[0] = inputRows, inputType[1] = inputCols, inputType[2] = inputDepth
 	ParameterType<3> m_InputType;
 	size_t m_KernelRows = 0;
 	size_t m_KernelCols = 0;
-	std::function<double(const std::vector<double>& values)> m_PoolingFunction;
-	std::function<std::vector<double>(const std::vector<double>& values, double value)> m_PoolingFunctionDiff;
+	// Layout of the input and output.
+	Layout m_Layout = Layout::Planar;
+	std::function<precision(const std::vector<precision>& values)> m_PoolingFunction;
+	std::function<std::vector<precision>(const std::vector<precision>& values, precision value)> m_PoolingFunctionDiff;
 };
 
+extern template class DRAGON_API BasicPoolingLayer<float>;
+extern template class DRAGON_API BasicPoolingLayer<double>;
+using PoolingLayer = BasicPoolingLayer<precision>;
+
 DRAGON_END
\ No newline at end of file
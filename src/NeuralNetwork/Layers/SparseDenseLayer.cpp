@@ -0,0 +1,381 @@
+#include "SparseDenseLayer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+DRAGON_BEGIN
+
+template<class T>
+BasicSparseDenseLayer<T>::BasicSparseDenseLayer() : m_InputType({ 0, 0 }), m_RowStarts(1, 0) { }
+
+template<class T>
+BasicSparseDenseLayer<T>::BasicSparseDenseLayer(const BasicDenseLayer<T>& layer, double sparsity) :
+	BaseLayer(layer.getActivation()),
+	m_InputType({ layer.getWeights().getCols(), layer.getWeights().getRows() }),
+	m_Biases(layer.getBiases()) {
+	assert(layer.getWeightFormat() == WeightFormat::Precision && "Only a layer with precision weights can be pruned!");
+	assert((sparsity >= 0.0 && sparsity <= 1.0) && "The sparsity has to be between 0 and 1!");
+
+	const Tensor2D& weights = layer.getWeights();
+	size_t count = weights.getCount();
+	size_t keep = count - std::min(count, size_t(sparsity * double(count) + 0.5));
+
+	// The keep largest magnitudes are not less than the threshold, from the weights equal to it
+	// only as many are kept as needed for exactly keep nonzeros.
+	precision threshold = std::numeric_limits<precision>::infinity();
+	size_t ties = 0;
+	if (keep > 0) {
+		std::vector<precision> magnitudes(count);
+		for (size_t i = 0; i < count; i++)
+			magnitudes[i] = std::abs(weights.getData()[i]);
+		std::nth_element(magnitudes.begin(), magnitudes.begin() + (count - keep), magnitudes.end());
+		threshold = magnitudes[count - keep];
+		ties = keep - size_t(std::count_if(magnitudes.begin() + (count - keep), magnitudes.end(),
+			[threshold](precision magnitude) { return magnitude > threshold; }));
+	}
+
+	size_t rows = m_InputType.parameters[1];
+	size_t cols = m_InputType.parameters[0];
+	m_RowStarts.assign(rows + 1, 0);
+	m_Columns.reserve(keep);
+	std::vector<precision> values;
+	values.reserve(keep);
+	for (size_t i = 0; i < rows; i++) {
+		const precision* row = weights.getData() + i * cols;
+		for (size_t j = 0; j < cols; j++) {
+			precision magnitude = std::abs(row[j]);
+			if (magnitude < threshold || (magnitude == threshold && ties-- == 0))
+				continue;
+			m_Columns.push_back(uint32_t(j));
+			values.push_back(row[j]);
+		}
+		m_RowStarts[i + 1] = m_Columns.size();
+	}
+	m_Values = Tensor1D(values.size(), values.data());
+}
+
+template<class T>
+BasicSparseDenseLayer<T>::BasicSparseDenseLayer(const BasicSparseDenseLayer& other) :
+	BaseLayer(other.m_Activation),
+	m_InputType(other.m_InputType),
+	m_RowStarts(other.m_RowStarts),
+	m_Columns(other.m_Columns),
+	m_Values(other.m_Values),
+	m_Biases(other.m_Biases) { }
+
+template<class T>
+BasicSparseDenseLayer<T>::BasicSparseDenseLayer(BasicSparseDenseLayer&& other) noexcept :
+	BaseLayer(other.m_Activation),
+	m_InputType(other.m_InputType),
+	m_RowStarts(std::move(other.m_RowStarts)),
+	m_Columns(std::move(other.m_Columns)),
+	m_Values(std::move(other.m_Values)),
+	m_Biases(std::move(other.m_Biases)) { }
+
+template<class T>
+BasicCsrMatrix<T> BasicSparseDenseLayer<T>::getWeights() const {
+	CsrMatrix weights;
+	weights.rows = m_InputType.parameters[1];
+	weights.cols = m_InputType.parameters[0];
+	weights.rowStarts = m_RowStarts.data();
+	weights.columns = m_Columns.data();
+	weights.values = m_Values.getData();
+	return weights;
+}
+
+template<class T>
+BasicTensor2D<T> BasicSparseDenseLayer<T>::toDense() const {
+	size_t rows = m_InputType.parameters[1];
+	size_t cols = m_InputType.parameters[0];
+	Tensor2D dense = Tensor2D(Tensor::allocateData(rows * cols), rows, cols);
+	kernel::fill(dense.getData(), precision(), dense.getCount());
+	for (size_t i = 0; i < rows; i++) {
+		for (size_t k = m_RowStarts[i]; k < m_RowStarts[i + 1]; k++)
+			dense.getData()[i * cols + m_Columns[k]] = m_Values.getData()[k];
+	}
+	return dense;
+}
+
+template<class T>
+BasicTensor1D<T> BasicSparseDenseLayer<T>::feedForward(const Tensor1D& input) const {
+	assert((input.getCount() == m_InputType.parameters[0]) && "Invalid input parameters!");
+
+	Tensor1D working = Tensor1D(Tensor::allocateData(m_InputType.parameters[1]), m_InputType.parameters[1]);
+	Epilogue epilogue = _epilogue(nullptr);
+	spmv(getWeights(), input.getData(), working.getData(), &epilogue);
+	return working;
+}
+
+template<class T>
+BasicTensor1D<T> BasicSparseDenseLayer<T>::backPropagate(
+	Tensor1D& sumsAfter,
+	Tensor1D& costAfter,
+	Tensor1D& activationBefore,
+	double learningRate) {
+
+	assert((activationBefore.getCount() == m_InputType.parameters[0]) && "Invalid before activation parameters!");
+	assert((sumsAfter.getCount() == costAfter.getCount() && sumsAfter.getCount() == m_InputType.parameters[1]) &&
+		"Invalid cost and sums parameters!");
+
+	m_Activation.applyDiff(sumsAfter).mult(costAfter);
+
+	// Cost respect to the input, with the weights before the update.
+	Tensor1D costBefore = Tensor1D(Tensor::allocateData(m_InputType.parameters[0]), m_InputType.parameters[0]);
+	spmvTrans(getWeights(), sumsAfter.getData(), costBefore.getData());
+
+	// The weight gradient is the outer product of the local gradient and the input, only at the nonzeros.
+	sparseGer(getWeights(), -precision(learningRate), sumsAfter.getData(), activationBefore.getData(), m_Values.getData());
+	axpy(m_InputType.parameters[1], -precision(learningRate), sumsAfter.getData(), m_Biases.getData());
+	return costBefore;
+}
+
+template<class T>
+BasicPreparePropagateData<T> BasicSparseDenseLayer<T>::preparePropagate(const Tensor1D& input) const {
+	assert((input.getCount() == m_InputType.parameters[0]) && "Invalid input parameters!");
+	PreparePropagateData pData;
+
+	pData.input = Tensor1D(input);
+	pData.sum = Tensor1D(Tensor::allocateData(m_InputType.parameters[1]), m_InputType.parameters[1]);
+	pData.output = Tensor1D(Tensor::allocateData(m_InputType.parameters[1]), m_InputType.parameters[1]);
+	Epilogue epilogue = _epilogue(pData.sum.getData());
+	spmv(getWeights(), input.getData(), pData.output.getData(), &epilogue);
+
+	return pData;
+}
+
+template<class T>
+BasicTensor2D<T> BasicSparseDenseLayer<T>::feedForwardBatch(const Tensor2D& input) const {
+	Tensor2D working = Tensor2D(Tensor::allocateData(input.getRows() * m_InputType.parameters[1]),
+		input.getRows(), m_InputType.parameters[1]);
+	_forwardBatch(input, nullptr, working);
+	return working;
+}
+
+template<class T>
+void BasicSparseDenseLayer<T>::feedForwardBatch(const Tensor2D& input, Tensor2D& output) const {
+	_forwardBatch(input, nullptr, output);
+}
+
+template<class T>
+BasicTensor2D<T> BasicSparseDenseLayer<T>::backPropagateBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	double learningRate) {
+	size_t batchSize = sumsAfter.getRows();
+	Tensor2D costBefore = Tensor2D(Tensor::allocateData(batchSize * m_InputType.parameters[0]), batchSize, m_InputType.parameters[0]);
+	_costBeforeBatch(sumsAfter, costAfter, activationsBefore, costBefore);
+
+	// The summed weight gradient of the nonzeros, the average is applied in place.
+	precision rate = precision(learningRate / double(batchSize));
+	sparseGradient(getWeights(), batchSize,
+		-rate, sumsAfter.getData(), sumsAfter.getCols(),
+		activationsBefore.getData(), activationsBefore.getCols(),
+		m_Values.getData());
+	for (size_t n = 0; n < batchSize; n++)
+		axpy(m_InputType.parameters[1], -rate, sumsAfter.getData() + n * sumsAfter.getCols(), m_Biases.getData());
+
+	return costBefore;
+}
+
+template<class T>
+BasicTensor2D<T> BasicSparseDenseLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision* gradients) {
+	size_t batchSize = sumsAfter.getRows();
+	Tensor2D costBefore = Tensor2D(Tensor::allocateData(batchSize * m_InputType.parameters[0]), batchSize, m_InputType.parameters[0]);
+	gradientsBatch(sumsAfter, costAfter, activationsBefore, gradients, costBefore);
+	return costBefore;
+}
+
+template<class T>
+void BasicSparseDenseLayer<T>::gradientsBatch(
+	Tensor2D& sumsAfter,
+	Tensor2D& costAfter,
+	Tensor2D& activationsBefore,
+	precision* gradients,
+	Tensor2D& costBefore) {
+	_costBeforeBatch(sumsAfter, costAfter, activationsBefore, costBefore);
+
+	// Weight gradient += trans(local gradients) * inputs at the nonzeros, than the bias gradient.
+	size_t batchSize = sumsAfter.getRows();
+	sparseGradient(getWeights(), batchSize,
+		precision(1), sumsAfter.getData(), sumsAfter.getCols(),
+		activationsBefore.getData(), activationsBefore.getCols(),
+		gradients);
+	precision* biasGradient = gradients + m_Values.getCount();
+	for (size_t n = 0; n < batchSize; n++)
+		kernel::add(biasGradient, sumsAfter.getData() + n * sumsAfter.getCols(), m_Biases.getCount());
+}
+
+template<class T>
+BasicPreparePropagateBatchData<T> BasicSparseDenseLayer<T>::preparePropagateBatch(const Tensor2D& input) const {
+	PreparePropagateBatchData bData;
+	size_t batchSize = input.getRows();
+
+	bData.input = input;
+	bData.sum = Tensor2D(Tensor::allocateData(batchSize * m_InputType.parameters[1]), batchSize, m_InputType.parameters[1]);
+	bData.output = Tensor2D(Tensor::allocateData(batchSize * m_InputType.parameters[1]), batchSize, m_InputType.parameters[1]);
+	_forwardBatch(input, bData.sum.getData(), bData.output);
+
+	return bData;
+}
+
+template<class T>
+void BasicSparseDenseLayer<T>::preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const {
+	assert((output.getRows() == sum.getRows() && output.getCols() == sum.getCols()) && "Invalid output parameters!");
+	_forwardBatch(input, sum.getData(), output);
+}
+
+template<class T>
+void BasicSparseDenseLayer<T>::_forwardBatch(const Tensor2D& input, precision* sums, Tensor2D& output) const {
+	assert((input.getRows() > 0 && input.getCols() == m_InputType.parameters[0]) && "Invalid input parameters!");
+	assert((output.getRows() == input.getRows() && output.getCols() == m_InputType.parameters[1]) && "Invalid output parameters!");
+	Epilogue epilogue = _epilogue(sums);
+
+	// A single sample is a sparse matrix vector product, like in feedForward.
+	if (input.getRows() == 1) {
+		spmv(getWeights(), input.getData(), output.getData(), &epilogue);
+		return;
+	}
+
+	// outputs = activation(inputs * trans(weights) + biases).
+	spmm(true, input.getRows(),
+		input.getData(), input.getCols(),
+		getWeights(),
+		output.getData(), output.getCols(), &epilogue);
+}
+
+template<class T>
+BasicEpilogue<T> BasicSparseDenseLayer<T>::_epilogue(precision* sums) const {
+	Epilogue epilogue;
+	epilogue.bias = m_Biases.getData();
+	epilogue.sums = sums;
+	epilogue.sumsStride = m_InputType.parameters[1];
+	epilogue.activation = &m_Activation.getActivationSpan();
+	return epilogue;
+}
+
+template<class T>
+void BasicSparseDenseLayer<T>::_costBeforeBatch(Tensor2D& sumsAfter, const Tensor2D& costAfter, const Tensor2D& activationsBefore,
+	Tensor2D& costBefore) const {
+	size_t batchSize = sumsAfter.getRows();
+	assert((activationsBefore.getRows() == batchSize && activationsBefore.getCols() == m_InputType.parameters[0]) &&
+		"Invalid before activation parameters!");
+	assert((costAfter.getRows() == batchSize && sumsAfter.getCols() == m_InputType.parameters[1] &&
+		costAfter.getCols() == m_InputType.parameters[1]) &&
+		"Invalid cost and sums parameters!");
+	assert((costBefore.getRows() == batchSize && costBefore.getCols() == m_InputType.parameters[0]) &&
+		"Invalid cost before parameters!");
+
+	// Local gradients of the samples, batch size x output nodes.
+	m_Activation.applyDiff(sumsAfter).mult(costAfter);
+
+	// Cost respect to the inputs = local gradients * weights, before the update.
+	spmm(false, batchSize,
+		sumsAfter.getData(), sumsAfter.getCols(),
+		getWeights(),
+		costBefore.getData(), costBefore.getCols());
+}
+
+template<class T>
+std::string BasicSparseDenseLayer<T>::toString() const {
+	// Create a string stream.
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(8);
+
+	// Put the node counts and the places of the nonzeros.
+	ss << getDescription();
+
+	// Put the nonzero weights.
+	for (size_t i = 0; i < m_Values.getCount(); i++) {
+		ss << m_Values.getData()[i] << " ";
+	}
+	// Put the biases.
+	for (size_t i = 0; i < m_Biases.getCount(); i++) {
+		ss << m_Biases.getData()[i] << " ";
+	}
+
+	return ss.str();
+}
+
+template<class T>
+void BasicSparseDenseLayer<T>::fromString(const std::string& rawString) {
+	fromText(rawString);
+}
+
+template<class T>
+void BasicSparseDenseLayer<T>::fromText(std::string_view text) {
+	TextReader reader(text);
+	_readDescription(reader);
+
+	// Get the nonzero weights.
+	reader.read(m_Values.getData(), m_Values.getCount());
+	// Get the biases.
+	reader.read(m_Biases.getData(), m_Biases.getCount());
+}
+
+template<class T>
+std::string BasicSparseDenseLayer<T>::getDescription() const {
+	// Input nodes, output nodes and the number of nonzeros.
+	std::string description = std::to_string(m_InputType.parameters[0]) + " " + std::to_string(m_InputType.parameters[1]) + " " +
+		std::to_string(m_Columns.size()) + " ";
+	// The nonzero count of every row, than the column indices.
+	for (size_t i = 0; i < m_InputType.parameters[1]; i++)
+		description += std::to_string(m_RowStarts[i + 1] - m_RowStarts[i]) + " ";
+	for (uint32_t column : m_Columns)
+		description += std::to_string(column) + " ";
+	return description;
+}
+
+template<class T>
+void BasicSparseDenseLayer<T>::fromDescription(const std::string& description) {
+	TextReader reader(description);
+	_readDescription(reader);
+}
+
+template<class T>
+void BasicSparseDenseLayer<T>::_readDescription(TextReader& reader) {
+	// Get the input nodes, the output nodes and the number of nonzeros.
+	size_t nonZeros = 0;
+	reader.read(m_InputType.parameters[0]);
+	reader.read(m_InputType.parameters[1]);
+	reader.read(nonZeros);
+	size_t rows = m_InputType.parameters[1];
+	size_t cols = m_InputType.parameters[0];
+	bool valid = reader.isValid() && (rows == 0 || nonZeros / rows <= cols) && cols <= std::numeric_limits<uint32_t>::max();
+
+	// Get the nonzero counts of the rows and the column indices.
+	m_RowStarts.assign(rows + 1, 0);
+	for (size_t i = 0; i < rows && valid; i++) {
+		size_t rowCount = 0;
+		valid = reader.read(rowCount) && rowCount <= cols && m_RowStarts[i] + rowCount <= nonZeros;
+		m_RowStarts[i + 1] = m_RowStarts[i] + rowCount;
+	}
+	valid = valid && m_RowStarts[rows] == nonZeros;
+	m_Columns.resize(valid ? nonZeros : 0);
+	for (size_t k = 0; k < m_Columns.size() && valid; k++) {
+		size_t column = 0;
+		valid = reader.read(column) && column < cols;
+		m_Columns[k] = uint32_t(column);
+	}
+
+	// The products index the input with the columns, so a broken description leaves no nonzeros.
+	if (!valid) {
+		std::cout << "Couldn't read the nonzeros of the SparseDenseLayer, the layer has no weights!" << std::endl;
+		m_RowStarts.assign(rows + 1, 0);
+		m_Columns.clear();
+	}
+
+	// Create the nonzero weights and the biases.
+	m_Values = Tensor1D(Tensor::allocateData(m_Columns.size()), m_Columns.size());
+	m_Biases = Tensor1D(Tensor::allocateData(rows), rows);
+}
+
+template class DRAGON_API BasicSparseDenseLayer<float>;
+template class DRAGON_API BasicSparseDenseLayer<double>;
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "BaseLayer.h"
+#include "DenseLayer.h"
+
+DRAGON_BEGIN
+
+/// <summary>
+/// Sparse Dense Layer is the child of Base Layer.
+/// Fully conected layer that keeps only the nonzero weights, in compressed sparse row (CSR) format.
+/// It's made from a trained DenseLayer by magnitude pruning: the smallest weights are dropped at the given sparsity.
+/// The places of the nonzeros are fixed, training only changes their values (and the biases), so the layer can be
+/// fine tuned after the pruning. The products only touch the nonzeros, at 90% sparsity the layer reads a tenth of the values.
+/// [example]
+/// SparseDenseLayer sparse(denseLayer, 0.9);
+/// </summary>
+template<class T>
+class BasicSparseDenseLayer : public BasicBaseLayer<T> {
+public:
+	DRAGON_LAYER_TYPES(T)
+
+private:
+	using BaseLayer::m_Activation;
+
+	// m_InputType.parameters[0] = numInputNodes, m_inputType.parameters[1] = numOutputNodes
+	ParameterType<2> m_InputType;
+
+	// The rows are the output nodes, the columns are the input nodes.
+	std::vector<size_t> m_RowStarts;
+	std::vector<uint32_t> m_Columns;
+	Tensor1D m_Values;
+	Tensor1D m_Biases;
+public:
+	BasicSparseDenseLayer();
+	// Prune the weights of the trained layer, the sparsity part (0 <= sparsity <= 1) of the weights with the smallest
+	// absolute values is dropped. The biases and the activation are kept.
+	BasicSparseDenseLayer(const BasicDenseLayer<T>& layer, double sparsity);
+	BasicSparseDenseLayer(const BasicSparseDenseLayer& other);
+	BasicSparseDenseLayer(BasicSparseDenseLayer&& other) noexcept;
+
+	inline const Tensor1D& getValues() const { return m_Values; }
+	inline const Tensor1D& getBiases() const { return m_Biases; }
+	inline Tensor1D& getValues() { return m_Values; }
+	inline Tensor1D& getBiases() { return m_Biases; }
+	inline size_t getNonZeroCount() const { return m_Columns.size(); }
+
+	// The weights as a CSR matrix of output nodes x input nodes.
+	CsrMatrix getWeights() const;
+	// The weights as a dense output nodes x input nodes matrix, the pruned weights are zero.
+	Tensor2D toDense() const;
+
+public:
+
+	Tensor1D feedForward(const Tensor1D& input) const override;
+
+	Tensor1D backPropagate(
+		Tensor1D& sumsAfter,
+		Tensor1D& costAfter,
+		Tensor1D& activationsBefore,
+		double learningRate) override;
+
+	PreparePropagateData preparePropagate(const Tensor1D& input) const override;
+
+	// The batched functions are dense times sparse matrix products over the whole batch.
+	Tensor2D feedForwardBatch(const Tensor2D& input) const override;
+	void feedForwardBatch(const Tensor2D& input, Tensor2D& output) const override;
+	Tensor2D backPropagateBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		double learningRate) override;
+	PreparePropagateBatchData preparePropagateBatch(const Tensor2D& input) const override;
+	void preparePropagateBatch(const Tensor2D& input, Tensor2D& sum, Tensor2D& output) const override;
+
+	// The nonzero weights and the biases.
+	std::vector<Tensor*> getParameters() override { return { &m_Values, &m_Biases }; }
+	Tensor2D gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients) override;
+	void gradientsBatch(
+		Tensor2D& sumsAfter,
+		Tensor2D& costAfter,
+		Tensor2D& activationsBefore,
+		precision* gradients,
+		Tensor2D& costBefore) override;
+
+	// The flat input and output, as one row of values.
+	DataLayout getInputLayout() const override { return { Layout::Planar, 1, m_InputType.parameters[0], 1 }; }
+	DataLayout getOutputLayout() const override { return { Layout::Planar, 1, m_InputType.parameters[1], 1 }; }
+
+	std::string toString() const override;
+	void fromString(const std::string& rawString) override;
+	void fromText(std::string_view text) override;
+	// The node counts and the places of the nonzeros: the number of nonzeros, the nonzero count of every row
+	// and the column indices.
+	std::string getDescription() const override;
+	void fromDescription(const std::string& description) override;
+	std::string getName() const override { return "SparseDenseLayer"; }
+
+private:
+	// Read the node counts and the places of the nonzeros and allocate the values and biases, their values are junk.
+	void _readDescription(TextReader& reader);
+	// Outputs of the batch, batch size x output nodes. The weighted sums are saved into sums if it's not null.
+	void _forwardBatch(const Tensor2D& input, precision* sums, Tensor2D& output) const;
+	// The biases, the saving of the sums and the activation, done by the matrix product on its result.
+	Epilogue _epilogue(precision* sums) const;
+	// Turn the sums into the local gradients and calculate the cost respect to the inputs into costBefore.
+	void _costBeforeBatch(Tensor2D& sumsAfter, const Tensor2D& costAfter, const Tensor2D& activationsBefore,
+		Tensor2D& costBefore) const;
+};
+
+extern template class DRAGON_API BasicSparseDenseLayer<float>;
+extern template class DRAGON_API BasicSparseDenseLayer<double>;
+using SparseDenseLayer = BasicSparseDenseLayer<precision>;
+
+DRAGON_END
\ No newline at end of file
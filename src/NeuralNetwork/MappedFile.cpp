@@ -0,0 +1,76 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+DRAGON_BEGIN
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filePath) {
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	m_File = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		return;
+
+	// A read only mapping, the copy view gives private copies of the written pages.
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (!mapping)
+		return;
+	m_Mapping = mapping;
+
+	m_Data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+	if (m_Data)
+		m_Size = size_t(size.QuadPart);
+}
+
+MappedFile::~MappedFile() {
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_File)
+		CloseHandle(m_File);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filePath) {
+	int file = open(filePath.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+
+	struct stat status;
+	if (fstat(file, &status) == 0 && status.st_size > 0) {
+		// Private mapping, the written pages are copied and never go back to the file.
+		void* data = mmap(nullptr, size_t(status.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			m_Data = static_cast<char*>(data);
+			m_Size = size_t(status.st_size);
+		}
+	}
+
+	// The mapping stays valid after the file is closed.
+	close(file);
+}
+
+MappedFile::~MappedFile() {
+	if (m_Data)
+		munmap(m_Data, m_Size);
+}
+
+#endif
+
+DRAGON_END
\ No newline at end of file
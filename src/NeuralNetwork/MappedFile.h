@@ -0,0 +1,42 @@
+#pragma once
+#include <string>
+
+#include "../Core.h"
+
+/*
+A file mapped into memory, for the binary model format.
+The pages are read from the disk when they are first touched, so opening even a large file is fast.
+The mapping is copy on write: the data can be changed (like the weights while training), the file never changes.
+*/
+
+DRAGON_BEGIN
+
+/// <summary>
+/// MappedFile maps the whole file at filePath into memory for its lifetime.
+/// If the file can't be opened or mapped, isOpen is false.
+/// [example]
+/// MappedFile file("model.drgb");
+/// if (file.isOpen()) process(file.getData(), file.getSize());
+/// </summary>
+class DRAGON_API MappedFile {
+public:
+	MappedFile(const std::string& filePath);
+	~MappedFile();
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator=(const MappedFile& other) = delete;
+
+	inline bool isOpen() const { return m_Data != nullptr; }
+	// The first byte of the file, the mapping starts at a page boundary.
+	inline char* getData() const { return m_Data; }
+	inline size_t getSize() const { return m_Size; }
+
+private:
+	char* m_Data = nullptr;
+	size_t m_Size = 0;
+#ifdef _WIN32
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+#endif
+};
+
+DRAGON_END
\ No newline at end of file
@@ -1,8 +1,146 @@
 #include "Model.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
 DRAGON_BEGIN
 
-Model::~Model() { 
+namespace {
+
+	// The binary model file (little endian):
+	// header: the magic "DRGB", the format version, sizeof(precision) and the number of layers (uint32 each),
+	// the values are float or double (4 or 8 bytes), a file of the other precision is converted by the loader,
+	// layer table: the name, the activation name and the description of every layer (uint32 size and the characters),
+	// the layout of its data and its WeightFormat (uint32), for the 16 bit formats the offset and count of the 16 bit weights
+	// (uint64), the number of its parameters (uint32) and the offset and count of every parameter (uint64),
+	// parameters: the raw values of every parameter and the 16 bit weights (row by row),
+	// each starts at a DATA_ALIGNMENT boundary of the file.
+	// The version 1 files have no weight formats in the layer table, they are loaded too.
+	const char BINARY_MAGIC[4] = { 'D', 'R', 'G', 'B' };
+	constexpr uint32_t BINARY_VERSION = 2;
+
+	// The quantization file: the magic "DRGQ", the format version, sizeof(precision) and the number of layers (uint32 each),
+	// the precision values are float or double like in the binary model file,
+	// for every layer a uint32 flag if it's quantized, and for the quantized ones the rows, cols and bias count (uint64),
+	// the input scale, the row scales and the biases (precision), than the int8 weights row by row.
+	const char QUANTIZATION_MAGIC[4] = { 'D', 'R', 'G', 'Q' };
+	constexpr uint32_t QUANTIZATION_VERSION = 1;
+
+	template<class T>
+	void writeValue(std::string& data, T value) {
+		data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	void writeString(std::string& data, const std::string& value) {
+		writeValue(data, uint32_t(value.size()));
+		data += value;
+	}
+
+	// Reads the values of the binary file one after the other, a read past the end of the data fails.
+	struct BinaryReader {
+		const char* data;
+		size_t size;
+		size_t position = 0;
+
+		template<class T>
+		bool read(T& value) {
+			if (size - position < sizeof(T))
+				return false;
+			std::memcpy(&value, data + position, sizeof(T));
+			position += sizeof(T);
+			return true;
+		}
+
+		// A float or double value (valueSize bytes) of the file converted to T.
+		template<class T>
+		bool readValue(T& value, uint32_t valueSize) {
+			if (valueSize == sizeof(float)) {
+				float stored = 0.0f;
+				if (!read(stored))
+					return false;
+				value = T(stored);
+				return true;
+			}
+			double stored = 0.0;
+			if (!read(stored))
+				return false;
+			value = T(stored);
+			return true;
+		}
+
+		bool readString(std::string& value) {
+			uint32_t length = 0;
+			if (!read(length) || size - position < length)
+				return false;
+			value.assign(data + position, length);
+			position += length;
+			return true;
+		}
+	};
+
+	// Copy count float or double values (valueSize bytes) of the file, converted to precision.
+	template<class T>
+	void readValues(T* result, const char* data, size_t count, uint32_t valueSize) {
+		if (valueSize == sizeof(T)) {
+			std::memcpy(result, data, count * sizeof(T));
+			return;
+		}
+		BinaryReader reader{ data, count * valueSize };
+		for (size_t i = 0; i < count; i++)
+			reader.readValue(result[i], valueSize);
+	}
+
+	// The text without the whitespace at its ends.
+	std::string_view trim(std::string_view text) {
+		const char* spaces = " \t\r\n";
+		size_t begin = text.find_first_not_of(spaces);
+		if (begin == std::string_view::npos)
+			return std::string_view();
+		return text.substr(begin, text.find_last_not_of(spaces) - begin + 1);
+	}
+
+	// Convert the flat data between the layouts of two neighbouring layers, or a layer and the planar model boundary.
+	// The shape comes from the layer that is not planar.
+	template<class T>
+	BasicTensor1D<T> convertData(const BasicTensor1D<T>& data, const BasicDataLayout<T>& from, const BasicDataLayout<T>& to) {
+		const BasicDataLayout<T>& shape = from.layout != Layout::Planar ? from : to;
+		assert((data.getCount() == layoutCount<T>(from.layout, shape.depth, shape.rows, shape.cols)) &&
+			"Layer parameters not match!");
+
+		size_t count = layoutCount<T>(to.layout, shape.depth, shape.rows, shape.cols);
+		BasicTensor1D<T> result(BasicTensor<T>::allocateData(count), count);
+		convertLayout(data.getData(), from.layout, result.getData(), to.layout, shape.depth, shape.rows, shape.cols);
+		return result;
+	}
+
+	// Convert every sample (row) of the batch like convertData into result.
+	template<class T>
+	void convertBatch(const BasicTensor2D<T>& data, const BasicDataLayout<T>& from, const BasicDataLayout<T>& to, BasicTensor2D<T>& result) {
+		const BasicDataLayout<T>& shape = from.layout != Layout::Planar ? from : to;
+		assert((data.getCols() == layoutCount<T>(from.layout, shape.depth, shape.rows, shape.cols)) &&
+			"Layer parameters not match!");
+		assert((result.getRows() == data.getRows() && result.getCols() == layoutCount<T>(to.layout, shape.depth, shape.rows, shape.cols)) &&
+			"Result parameters not match!");
+
+		for (size_t n = 0; n < data.getRows(); n++)
+			convertLayout(data.getData() + n * data.getCols(), from.layout, result.getData() + n * result.getCols(), to.layout,
+				shape.depth, shape.rows, shape.cols);
+	}
+
+	template<class T>
+	BasicTensor2D<T> convertBatch(const BasicTensor2D<T>& data, const BasicDataLayout<T>& from, const BasicDataLayout<T>& to) {
+		const BasicDataLayout<T>& shape = from.layout != Layout::Planar ? from : to;
+		size_t count = layoutCount<T>(to.layout, shape.depth, shape.rows, shape.cols);
+		BasicTensor2D<T> result(BasicTensor<T>::allocateData(data.getRows() * count), data.getRows(), count);
+		convertBatch(data, from, to, result);
+		return result;
+	}
+
+}
+
+template<class T>
+BasicModel<T>::~BasicModel() { 
 	for (size_t i = 0; i < m_Layers.size(); i++) {
 		if (m_Layers[i].isInitializedOnModel) {
 			delete m_Layers[i].layer;
@@ -10,35 +148,54 @@ Model::~Model() {
 	}
 }
 
-void Model::addLayer(BaseLayer* layer) {
+template<class T>
+void BasicModel<T>::addLayer(BaseLayer* layer) {
 	m_Layers.push_back({ layer, false });
 }
 
-void Model::addLayerCreatorFunction(const std::function<BaseLayer* (const std::string& layerName)>& creator) {
+template<class T>
+void BasicModel<T>::setLayout(Layout layout) {
+	for (size_t i = 0; i < m_Layers.size(); i++)
+		m_Layers[i].layer->setLayout(layout);
+}
+
+template<class T>
+void BasicModel<T>::setWeightFormat(WeightFormat format) {
+	for (size_t i = 0; i < m_Layers.size(); i++)
+		m_Layers[i].layer->setWeightFormat(format);
+}
+
+template<class T>
+void BasicModel<T>::addLayerCreatorFunction(const std::function<BaseLayer* (const std::string& layerName)>& creator) {
 	m_LayerCreator.push_back(creator);
 }
 
-void Model::addActivationCreatorFunction(const std::function<ActivationFunction(const std::string& activationName)>& creator) {
+template<class T>
+void BasicModel<T>::addActivationCreatorFunction(const std::function<ActivationFunction(const std::string& activationName)>& creator) {
 	m_ActivationCreator.push_back(creator);
 }
 
-BaseLayer* Model::createLayer(const std::string& layerName) {
+template<class T>
+BasicBaseLayer<T>* BasicModel<T>::createLayer(const std::string& layerName) {
 	BaseLayer* newLayer = nullptr;
 
 	// Built in layers.
-	DenseLayer dummyDense;
-	ConvolutionalLayer dummyConv;
-	ConvolutionalTreeLayer dummyConvTree;
-	PoolingLayer dummyPool;
+	BasicDenseLayer<T> dummyDense;
+	BasicSparseDenseLayer<T> dummySparseDense;
+	BasicConvolutionalLayer<T> dummyConv;
+	BasicConvolutionalTreeLayer<T> dummyConvTree;
+	BasicPoolingLayer<T> dummyPool;
 
 	if (layerName == dummyDense.getName())
-		newLayer = new DenseLayer();
+		newLayer = new BasicDenseLayer<T>();
+	else if (layerName == dummySparseDense.getName())
+		newLayer = new BasicSparseDenseLayer<T>();
 	else if (layerName == dummyConv.getName())
-		newLayer = new ConvolutionalLayer();
+		newLayer = new BasicConvolutionalLayer<T>();
 	else if (layerName == dummyConvTree.getName())
-		newLayer = new ConvolutionalTreeLayer();
+		newLayer = new BasicConvolutionalTreeLayer<T>();
 	else if (layerName == dummyPool.getName())
-		newLayer = new PoolingLayer();
+		newLayer = new BasicPoolingLayer<T>();
 
 	// Costum created layers.
 	if (!newLayer) {
@@ -54,24 +211,25 @@ BaseLayer* Model::createLayer(const std::string& layerName) {
 	return newLayer;
 }
 
-ActivationFunction Model::createActivation(const std::string& activationName) {
+template<class T>
+BasicActivationFunction<T> BasicModel<T>::createActivation(const std::string& activationName) {
 	ActivationFunction activation;
 
 	// Built in activation functions.
-	if (activationName.compare(sigmoid().getName()) == 0) {
-		activation = sigmoid();
+	if (activationName.compare(sigmoid<precision>().getName()) == 0) {
+		activation = sigmoid<precision>();
 	}
-	else if (activationName == relU().getName()) {
-		activation = relU();
+	else if (activationName == relU<precision>().getName()) {
+		activation = relU<precision>();
 	} 
-	else if (activationName == relU10().getName()) {
-		activation = relU10();
+	else if (activationName == relU10<precision>().getName()) {
+		activation = relU10<precision>();
 	}
-	else if (activationName == relU100().getName()) {
-		activation = relU100();
+	else if (activationName == relU100<precision>().getName()) {
+		activation = relU100<precision>();
 	}
-	else if (activationName == relU500().getName()) {
-		activation = relU500();
+	else if (activationName == relU500<precision>().getName()) {
+		activation = relU500<precision>();
 	}
 
 	if (activation.getName().empty()) {
@@ -87,7 +245,8 @@ ActivationFunction Model::createActivation(const std::string& activationName) {
 	return activation;
 }
 
-void Model::save(const std::string& filePath) {
+template<class T>
+void BasicModel<T>::save(const std::string& filePath) {
 	
 	std::string outData = std::to_string(m_Layers.size()) + "!\n";
 	for (size_t i = 0; i < m_Layers.size(); i++) {
@@ -104,41 +263,299 @@ void Model::save(const std::string& filePath) {
 		std::cout << "Couldn't open file at: " << filePath << std::endl;
 }
 
-void Model::load(const std::string& filePath) {
+template<class T>
+void BasicModel<T>::load(const std::string& filePath) {
+	_loadText(filePath, nullptr);
+}
+
+template<class T>
+void BasicModel<T>::load(const std::string& filePath, ThreadPool& pool) {
+	_loadText(filePath, &pool);
+}
+
+template<class T>
+void BasicModel<T>::_loadText(const std::string& filePath, ThreadPool* pool) {
 
-	std::ifstream file(filePath);
+	std::ifstream file(filePath, std::ios::binary | std::ios::ate);
 	if (!file.is_open()) {
 		std::cout << "Couldn't open file at: " << filePath << std::endl;
 		return;
 	}
 
-	std::stringstream ss;
-	std::string inData = "";
-	ss << file.rdbuf();
+	// The whole file is read at once, the layers only slice it.
+	std::string contents(size_t(file.tellg()), '\0');
+	file.seekg(0);
+	file.read(contents.data(), contents.size());
+	file.close();
 
+	// The binary files start with the magic.
+	if (contents.size() >= 4 && std::equal(contents.data(), contents.data() + 4, BINARY_MAGIC)) {
+		loadBinary(filePath);
+		return;
+	}
+
+	// The file is "numLayers!" and a "layerName; layerActivation@ layerData!" part for every layer.
+	std::string_view text(contents);
 	size_t numLayers = 0;
-	ss >> numLayers;
+	TextReader(text).read(numLayers);
+	size_t position = text.find('!');
 
-	inData = ss.str();
-	inData = inData.substr(inData.find('!') + 1);
+	std::vector<BaseLayer*> layers;
+	std::vector<std::string_view> layerData;
+	std::vector<std::string> layerActivations;
+	for (size_t i = 0; i < numLayers && position != std::string_view::npos; i++) {
+		size_t nameEnd = text.find(';', position + 1);
+		size_t activationEnd = text.find('@', nameEnd);
+		size_t end = text.find('!', activationEnd);
+		if (end == std::string_view::npos) {
+			std::cout << "Couldn't load the model, the file ended after " << i << " layers!" << std::endl;
+			break;
+		}
 
-	for (size_t i = 0; i < numLayers; i++) {
-		std::string layerName = inData.substr(1, inData.find(';') - 1);
-		std::string layerActivation = inData.substr(layerName.size() + 3, inData.find('@') - layerName.size() - 3);
-		std::string layerData = inData.substr(layerName.size() + 2 + layerActivation.size() + 2, inData.find('!') - layerName.size() - 1);
+		std::string layerName(trim(text.substr(position + 1, nameEnd - position - 1)));
+		std::string layerActivation(trim(text.substr(nameEnd + 1, activationEnd - nameEnd - 1)));
+		position = end;
 
 		BaseLayer* newLayer = createLayer(layerName);
-		ActivationFunction activation = createActivation(layerActivation);
+		if (!newLayer) {
+			std::cout << "Couldn't construct layer! Please provide a layerCreator to the model with a name of " << 
+				layerName << "!" << std::endl;
+			continue;
+		}
+
+		layers.push_back(newLayer);
+		layerData.push_back(text.substr(activationEnd + 1, end - activationEnd - 1));
+		layerActivations.push_back(layerActivation);
+	}
 
-		if (newLayer) {
-			newLayer->fromString(layerData);
-			m_Layers.push_back({ newLayer, true });
+	// The layers don't share anything, so they can be parsed at the same time.
+	if (pool) {
+		pool->parallelFor(layers.size(), [&](size_t index, size_t) {
+			layers[index]->fromText(layerData[index]);
+		});
+	}
+	else {
+		for (size_t i = 0; i < layers.size(); i++)
+			layers[i]->fromText(layerData[i]);
+	}
+
+	for (size_t i = 0; i < layers.size(); i++) {
+		ActivationFunction activation = createActivation(layerActivations[i]);
+		if (!activation.getName().empty()) {
+			layers[i]->getActivation() = activation;
 		}
 		else {
-			std::cout << "Couldn't construct layer! Please provide a layerCreator to the model with a name of " << 
+			std::cout << "Couldn't construct activation! Please provide an activationCreator to the model with a name of " <<
+				layerActivations[i] << "!" << std::endl;
+		}
+
+		m_Layers.push_back({ layers[i], true });
+	}
+}
+
+template<class T>
+void BasicModel<T>::saveBinary(const std::string& filePath) {
+	// The table is written with zero offsets first, the offsets are known after the size of the table.
+	// A block is the raw values of a parameter, or the 16 bit weights of a layer that are unpacked when they are written.
+	struct Block {
+		const char* data = nullptr;
+		size_t bytes = 0;
+		const HalfWeights* halfWeights = nullptr;
+	};
+	std::string table;
+	std::vector<size_t> offsetPositions;
+	std::vector<Block> blocks;
+	auto addBlock = [&](const Block& block, size_t count) {
+		offsetPositions.push_back(table.size());
+		writeValue(table, uint64_t(0));
+		writeValue(table, uint64_t(count));
+		blocks.push_back(block);
+	};
+
+	table.append(BINARY_MAGIC, 4);
+	writeValue(table, BINARY_VERSION);
+	writeValue(table, uint32_t(sizeof(precision)));
+	writeValue(table, uint32_t(m_Layers.size()));
+
+	for (size_t i = 0; i < m_Layers.size(); i++) {
+		BaseLayer* layer = m_Layers[i].layer;
+		std::vector<Tensor*> layerParameters = layer->getParameters();
+		WeightFormat format = layer->getWeightFormat();
+
+		writeString(table, layer->getName());
+		writeString(table, layer->getActivation().getName());
+		writeString(table, layer->getDescription());
+		writeValue(table, uint32_t(layer->getOutputLayout().layout));
+		writeValue(table, uint32_t(format));
+		if (format != WeightFormat::Precision) {
+			const HalfWeights* weights = layer->getHalfWeights();
+			size_t count = weights->rows * weights->cols;
+			addBlock({ nullptr, count * sizeof(uint16_t), weights }, count);
+		}
+		writeValue(table, uint32_t(layerParameters.size()));
+		for (Tensor* parameter : layerParameters)
+			addBlock({ reinterpret_cast<const char*>(parameter->getData()), parameter->getCount() * sizeof(precision) }, parameter->getCount());
+	}
+
+	std::vector<size_t> offsets;
+	size_t offset = table.size();
+	for (size_t b = 0; b < blocks.size(); b++) {
+		offset = (offset + Tensor::DATA_ALIGNMENT - 1) / Tensor::DATA_ALIGNMENT * Tensor::DATA_ALIGNMENT;
+		uint64_t value = offset;
+		std::memcpy(&table[offsetPositions[b]], &value, sizeof(value));
+		offsets.push_back(offset);
+		offset += blocks[b].bytes;
+	}
+
+	std::ofstream file(filePath, std::ios::binary);
+	if (!file.is_open()) {
+		std::cout << "Couldn't open file at: " << filePath << std::endl;
+		return;
+	}
+
+	file.write(table.data(), table.size());
+	size_t position = table.size();
+	const char padding[Tensor::DATA_ALIGNMENT] = {};
+	std::vector<uint16_t> halfValues;
+	for (size_t b = 0; b < blocks.size(); b++) {
+		const char* data = blocks[b].data;
+		if (blocks[b].halfWeights) {
+			halfValues.resize(blocks[b].bytes / sizeof(uint16_t));
+			unpackHalf(halfValues.data(), *blocks[b].halfWeights);
+			data = reinterpret_cast<const char*>(halfValues.data());
+		}
+		file.write(padding, offsets[b] - position);
+		file.write(data, blocks[b].bytes);
+		position = offsets[b] + blocks[b].bytes;
+	}
+}
+
+template<class T>
+void BasicModel<T>::loadBinary(const std::string& filePath, bool mapWeights) {
+	// The parameters watch the mapping, or they are copied from the contents of the file.
+	std::shared_ptr<MappedFile> mapping;
+	std::vector<char> contents;
+	char* data = nullptr;
+	size_t size = 0;
+
+	if (mapWeights) {
+		mapping = std::make_shared<MappedFile>(filePath);
+		data = mapping->getData();
+		size = mapping->getSize();
+	}
+	else {
+		std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+		if (file.is_open()) {
+			contents.resize(size_t(file.tellg()));
+			file.seekg(0);
+			file.read(contents.data(), contents.size());
+		}
+		data = contents.data();
+		size = contents.size();
+	}
+	if (!data) {
+		std::cout << "Couldn't open file at: " << filePath << std::endl;
+		return;
+	}
+
+	BinaryReader reader{ data, size };
+	char magic[4] = {};
+	uint32_t version = 0, precisionSize = 0, numLayers = 0;
+	if (!reader.read(magic) || !std::equal(magic, magic + 4, BINARY_MAGIC) ||
+		!reader.read(version) || !reader.read(precisionSize) || !reader.read(numLayers)) {
+		std::cout << "Couldn't load the model, " << filePath << " is not a binary model file!" << std::endl;
+		return;
+	}
+	if (version == 0 || version > BINARY_VERSION || (precisionSize != sizeof(float) && precisionSize != sizeof(double))) {
+		std::cout << "Couldn't load the model, the file version is " << version << " with " << precisionSize <<
+			" byte values, expected version 1 to " << BINARY_VERSION << " with float or double values!" << std::endl;
+		return;
+	}
+	// The values of the other precision are converted, the parameters can't watch the file.
+	bool watchValues = mapWeights && precisionSize == sizeof(precision);
+
+	for (uint32_t i = 0; i < numLayers; i++) {
+		std::string layerName, layerActivation, layerDescription;
+		uint32_t layout = 0, weightFormat = 0, numParameters = 0;
+		uint64_t halfOffset = 0, halfCount = 0;
+		bool layerValid = reader.readString(layerName) && reader.readString(layerActivation) && reader.readString(layerDescription) &&
+			reader.read(layout);
+		// The 16 bit weights are in the table from version 2.
+		if (layerValid && version >= 2) {
+			layerValid = reader.read(weightFormat) && weightFormat <= uint32_t(WeightFormat::BFloat16) &&
+				(weightFormat == uint32_t(WeightFormat::Precision) || (reader.read(halfOffset) && reader.read(halfCount)));
+		}
+		if (!layerValid || !reader.read(numParameters)) {
+			std::cout << "Couldn't load the model, the layer table is broken!" << std::endl;
+			break;
+		}
+
+		std::vector<uint64_t> offsets(numParameters), counts(numParameters);
+		bool tableValid = true;
+		for (uint32_t p = 0; p < numParameters; p++)
+			tableValid = tableValid && reader.read(offsets[p]) && reader.read(counts[p]);
+		if (!tableValid) {
+			std::cout << "Couldn't load the model, the layer table is broken!" << std::endl;
+			break;
+		}
+
+		// A block of the blocked layout is CHANNEL_BLOCK values, that's different for float and double models.
+		if (Layout(layout) == Layout::Blocked && numParameters && precisionSize != sizeof(precision)) {
+			std::cout << "Couldn't load layer " << layerName << ", it was saved in the blocked layout with " <<
+				precisionSize << " byte values! Save it with an other layout to convert it." << std::endl;
+			continue;
+		}
+
+		BaseLayer* newLayer = createLayer(layerName);
+		if (!newLayer) {
+			std::cout << "Couldn't construct layer! Please provide a layerCreator to the model with a name of " <<
 				layerName << "!" << std::endl;
+			continue;
+		}
+
+		// The layer gets the weight format first, so fromDescription doesn't allocate the precision weights.
+		WeightFormat format = WeightFormat(weightFormat);
+		if (format != WeightFormat::Precision && !newLayer->setWeightFormat(format)) {
+			std::cout << "Couldn't load layer " << layerName << ", it can't keep its weights in 16 bits!" << std::endl;
+			delete newLayer;
+			continue;
+		}
+		newLayer->fromDescription(layerDescription);
+		newLayer->setLayout(Layout(layout));
+
+		// Every parameter has to be inside the file with the size of the layer's tensor.
+		std::vector<Tensor*> parameters = newLayer->getParameters();
+		bool parametersValid = parameters.size() == numParameters;
+		for (uint32_t p = 0; parametersValid && p < numParameters; p++) {
+			parametersValid = counts[p] == parameters[p]->getCount() && offsets[p] % precisionSize == 0 &&
+				offsets[p] <= size && counts[p] <= (size - offsets[p]) / precisionSize;
+		}
+		HalfWeights* halfWeights = newLayer->getHalfWeights();
+		if (parametersValid && format != WeightFormat::Precision) {
+			parametersValid = halfWeights && halfCount == halfWeights->rows * halfWeights->cols && halfOffset % sizeof(uint16_t) == 0 &&
+				halfOffset <= size && halfCount <= (size - halfOffset) / sizeof(uint16_t);
+		}
+		if (!parametersValid) {
+			std::cout << "Couldn't load the parameters of layer " << layerName << ", they don't match with the layer!" << std::endl;
+			delete newLayer;
+			continue;
 		}
 
+		// The 16 bit weights are packed for the kernels, they don't watch the file.
+		if (format != WeightFormat::Precision) {
+			packHalf(halfWeights->packed, reinterpret_cast<const uint16_t*>(data + halfOffset),
+				halfWeights->rows, halfWeights->cols, halfWeights->cols);
+		}
+
+		for (uint32_t p = 0; p < numParameters; p++) {
+			if (watchValues)
+				parameters[p]->watch(reinterpret_cast<precision*>(data + offsets[p]));
+			else
+				readValues(parameters[p]->getData(), data + offsets[p], counts[p], precisionSize);
+		}
+		newLayer->parametersChanged();
+
+		ActivationFunction activation = createActivation(layerActivation);
 		if (!activation.getName().empty()) {
 			newLayer->getActivation() = activation;
 		}
@@ -147,54 +564,852 @@ void Model::load(const std::string& filePath) {
 				layerActivation << "!" << std::endl;
 		}
 
-		inData = inData.substr(inData.find('!') + 1);
+		m_Layers.push_back({ newLayer, true });
 	}
-		
+
+	if (watchValues)
+		m_MappedFiles.push_back(mapping);
 }
 
+template<class T>
+BasicInferencePlan<T> BasicModel<T>::compile(size_t maxBatchSize) const {
+	return compile(maxBatchSize, Quantization());
+}
 
-Tensor1D feedForward(const Model& neuralNetwork, const Tensor1D& input) {
-	Tensor1D working = input;
-	const std::vector<Layer>& layers = neuralNetwork.getLayers();
+template<class T>
+BasicInferencePlan<T> BasicModel<T>::compile(size_t maxBatchSize, const Quantization& quantization) const {
+	InferencePlan plan;
+	plan.m_MaxBatchSize = maxBatchSize;
+	if (m_Layers.empty() || maxBatchSize == 0) {
+		std::cout << "Couldn't compile the model, it has no layers or the batch size is zero!" << std::endl;
+		return plan;
+	}
+
+	// The input of the model is planar.
+	DataLayout firstLayout = m_Layers[0].layer->getInputLayout();
+	size_t count = layoutCount<precision>(Layout::Planar, firstLayout.depth, firstLayout.rows, firstLayout.cols);
+	if (count == 0) {
+		std::cout << "Couldn't compile the model, the input size of the first layer is not known!" << std::endl;
+		return plan;
+	}
+	plan.m_InputCount = count;
+
+	const std::vector<std::shared_ptr<QuantizedWeights>>& quantizedLayers = quantization.getLayers();
+	if (!quantizedLayers.empty() && quantizedLayers.size() != m_Layers.size()) {
+		std::cout << "Couldn't compile the model, the quantization has " << quantizedLayers.size() <<
+			" layers, the model has " << m_Layers.size() << "!" << std::endl;
+		return plan;
+	}
+
+	// The steps with the count of their data, the layout is converted between layers that keep it differently.
+	std::vector<typename InferencePlan::Step>& steps = plan.m_Steps;
+	DataLayout layout;
+	auto addConversion = [&](const DataLayout& to) {
+		const DataLayout& shape = layout.layout != Layout::Planar ? layout : to;
+		if (count != layoutCount<precision>(layout.layout, shape.depth, shape.rows, shape.cols))
+			return false;
+
+		typename InferencePlan::Step step;
+		step.from = layout;
+		step.to = to;
+		step.inputCount = count;
+		step.outputCount = layoutCount<precision>(to.layout, shape.depth, shape.rows, shape.cols);
+		steps.push_back(step);
+		count = step.outputCount;
+		return true;
+	};
+
+	for (size_t i = 0; i < m_Layers.size(); i++) {
+		const BaseLayer* layer = m_Layers[i].layer;
+		DataLayout inputLayout = layer->getInputLayout();
+		size_t inputCount = inputLayout.getCount();
+		bool converted = inputLayout.layout == layout.layout || addConversion(inputLayout);
+		if (!converted || (inputCount != 0 && inputCount != count)) {
+			std::cout << "Couldn't compile the model, the input size of layer " << i <<
+				" not match with the output of the layer before!" << std::endl;
+			return plan;
+		}
+
+		typename InferencePlan::Step step;
+		step.layer = layer;
+		step.inputCount = count;
+		step.outputCount = layer->getOutputLayout().getCount();
+		// Layers that don't tell their output shape are measured with one sample.
+		if (step.outputCount == 0)
+			step.outputCount = layer->feedForward(Tensor1D(count, 0.0)).getCount();
+
+		if (!quantizedLayers.empty() && quantizedLayers[i]) {
+			const QuantizedWeights& weights = *quantizedLayers[i];
+			DataLayout outputLayout = layer->getOutputLayout();
+			if (weights.values.size() != weights.rows * weights.cols || weights.scales.size() != weights.rows || weights.packed.empty() ||
+				weights.biases.size() != layoutCount<precision>(Layout::Planar, outputLayout.depth, outputLayout.rows, outputLayout.cols)) {
+				std::cout << "Couldn't compile the model, the quantized weights of layer " << i << " not match with the layer!" << std::endl;
+				return plan;
+			}
+			step.quantized = quantizedLayers[i];
+		}
+		steps.push_back(step);
+
+		count = step.outputCount;
+		layout = layer->getOutputLayout();
+	}
+
+	if (layout.layout != Layout::Planar && !addConversion(DataLayout())) {
+		std::cout << "Couldn't compile the model, the output size of the last layer not match with its layout!" << std::endl;
+		return plan;
+	}
+	plan.m_OutputCount = count;
+
+	// The steps write into the two buffers by turns, the last one writes the caller's output.
+	size_t sizes[2] = { 0, 0 };
+	for (size_t s = 0; s < steps.size(); s++) {
+		typename InferencePlan::Step& step = steps[s];
+		step.source = s == 0 ? InferencePlan::Slot::Input : ((s - 1) % 2 == 0 ? InferencePlan::Slot::First : InferencePlan::Slot::Second);
+		step.destination = s + 1 == steps.size() ? InferencePlan::Slot::Output : (s % 2 == 0 ? InferencePlan::Slot::First : InferencePlan::Slot::Second);
+
+		size_t live = 0;
+		if (s > 0)
+			live += step.inputCount;
+		if (s + 1 < steps.size()) {
+			live += step.outputCount;
+			sizes[s % 2] = std::max(sizes[s % 2], step.outputCount);
+		}
+		plan.m_PeakMemory = std::max(plan.m_PeakMemory, live * maxBatchSize * sizeof(precision));
+	}
+
+	// The second buffer starts at a DATA_ALIGNMENT boundary, like the allocated tensors.
+	size_t alignment = Tensor::DATA_ALIGNMENT / sizeof(precision);
+	plan.m_Second = (maxBatchSize * sizes[0] + alignment - 1) / alignment * alignment;
+	size_t bufferSize = plan.m_Second + maxBatchSize * sizes[1];
+	if (bufferSize > 0)
+		plan.m_Buffer = Tensor1D(bufferSize, precision());
+	plan.m_Valid = true;
+	return plan;
+}
+
+
+template<class T>
+BasicQuantization<T> BasicModel<T>::quantize(const Tensor2D& calibrationInput) const {
+	Quantization quantization;
+	std::vector<std::shared_ptr<QuantizedWeights>>& quantizedLayers = quantization.getLayers();
+
+	// The calibration samples go through the layers in precision, the input of every layer is measured on the way.
+	// The int8 input covers the largest absolute value of the samples.
+	Tensor2D working = calibrationInput;
+	DataLayout layout;
+	for (size_t i = 0; i < m_Layers.size(); i++) {
+		const BaseLayer* layer = m_Layers[i].layer;
+		DataLayout inputLayout = layer->getInputLayout();
+		if (inputLayout.layout != layout.layout)
+			working = convertBatch(working, layout, inputLayout);
+
+		std::shared_ptr<QuantizedWeights> weights = std::make_shared<QuantizedWeights>();
+		if (layer->quantize(*weights)) {
+			weights->inputScale = quantizationScale(maxAbs(working.getData(), working.getCount()));
+			quantizedLayers.push_back(weights);
+		}
+		else {
+			quantizedLayers.push_back(nullptr);
+		}
+
+		working = layer->feedForwardBatch(working);
+		layout = layer->getOutputLayout();
+	}
+
+	return quantization;
+}
+
+template<class T>
+void BasicQuantization<T>::save(const std::string& filePath) const {
+	std::string data;
+	data.append(QUANTIZATION_MAGIC, 4);
+	writeValue(data, QUANTIZATION_VERSION);
+	writeValue(data, uint32_t(sizeof(precision)));
+	writeValue(data, uint32_t(m_Layers.size()));
+
+	for (const std::shared_ptr<QuantizedWeights>& weights : m_Layers) {
+		writeValue(data, uint32_t(weights ? 1 : 0));
+		if (!weights)
+			continue;
+
+		writeValue(data, uint64_t(weights->rows));
+		writeValue(data, uint64_t(weights->cols));
+		writeValue(data, uint64_t(weights->biases.size()));
+		writeValue(data, weights->inputScale);
+		data.append(reinterpret_cast<const char*>(weights->scales.data()), weights->scales.size() * sizeof(precision));
+		data.append(reinterpret_cast<const char*>(weights->biases.data()), weights->biases.size() * sizeof(precision));
+		data.append(reinterpret_cast<const char*>(weights->values.data()), weights->values.size());
+	}
+
+	std::ofstream file(filePath, std::ios::binary);
+	if (file.is_open())
+		file.write(data.data(), data.size());
+	else
+		std::cout << "Couldn't open file at: " << filePath << std::endl;
+}
+
+template<class T>
+void BasicQuantization<T>::load(const std::string& filePath) {
+	std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) {
+		std::cout << "Couldn't open file at: " << filePath << std::endl;
+		return;
+	}
+	std::vector<char> contents(size_t(file.tellg()));
+	file.seekg(0);
+	file.read(contents.data(), contents.size());
+
+	BinaryReader reader{ contents.data(), contents.size() };
+	char magic[4] = {};
+	uint32_t version = 0, precisionSize = 0, numLayers = 0;
+	if (!reader.read(magic) || !std::equal(magic, magic + 4, QUANTIZATION_MAGIC) ||
+		!reader.read(version) || !reader.read(precisionSize) || !reader.read(numLayers) ||
+		version != QUANTIZATION_VERSION || (precisionSize != sizeof(float) && precisionSize != sizeof(double))) {
+		std::cout << "Couldn't load the quantization, " << filePath << " is not a quantization file of this version!" << std::endl;
+		return;
+	}
+
+	std::vector<std::shared_ptr<QuantizedWeights>> layers;
+	for (uint32_t i = 0; i < numLayers; i++) {
+		uint32_t quantized = 0;
+		if (!reader.read(quantized)) {
+			std::cout << "Couldn't load the quantization, the file ended after " << i << " layers!" << std::endl;
+			return;
+		}
+		if (!quantized) {
+			layers.push_back(nullptr);
+			continue;
+		}
+
+		std::shared_ptr<QuantizedWeights> weights = std::make_shared<QuantizedWeights>();
+		uint64_t rows = 0, cols = 0, biasCount = 0;
+		bool valid = reader.read(rows) && reader.read(cols) && reader.read(biasCount) &&
+			reader.readValue(weights->inputScale, precisionSize);
+		// The sizes are checked against the rest of the file before anything is allocated.
+		size_t rest = reader.size - reader.position;
+		valid = valid && rows <= rest / precisionSize && biasCount <= rest / precisionSize &&
+			(cols == 0 || rows <= rest / cols) && (rows + biasCount) * precisionSize + rows * cols <= rest;
+		if (!valid) {
+			std::cout << "Couldn't load the quantization, the weights of layer " << i << " are broken!" << std::endl;
+			return;
+		}
+
+		weights->rows = size_t(rows);
+		weights->cols = size_t(cols);
+		weights->scales.resize(weights->rows);
+		weights->biases.resize(size_t(biasCount));
+		weights->values.resize(weights->rows * weights->cols);
+		for (precision& scale : weights->scales)
+			reader.readValue(scale, precisionSize);
+		for (precision& bias : weights->biases)
+			reader.readValue(bias, precisionSize);
+		std::memcpy(weights->values.data(), reader.data + reader.position, weights->values.size());
+		reader.position += weights->values.size();
+
+		packInt8(weights->packed, false, weights->values.data(), weights->rows, weights->cols, weights->cols);
+		layers.push_back(weights);
+	}
+
+	m_Layers = layers;
+}
+
+template<class T>
+BasicTensor1D<T> feedForward(const BasicModel<T>& neuralNetwork, const BasicTensor1D<T>& input) {
+	BasicTensor1D<T> working = input;
+	const std::vector<BasicLayer<T>>& layers = neuralNetwork.getLayers();
+	BasicDataLayout<T> layout;
+
+	// Push the data through the layers, converting it where the layouts of the layers differ.
+	for (size_t i = 0; i < layers.size(); i++) {
+		BasicDataLayout<T> inputLayout = layers[i].layer->getInputLayout();
+		if (inputLayout.layout != layout.layout)
+			working = convertData(working, layout, inputLayout);
 
-	// Push the data through the layers.
-	for (size_t i = 0; i < layers.size(); i++)
 		working = layers[i].layer->feedForward(working);
+		layout = layers[i].layer->getOutputLayout();
+	}
+
+	// The output of the model is planar.
+	if (layout.layout != Layout::Planar)
+		working = convertData(working, layout, BasicDataLayout<T>());
 
 	return working;
 }
 
-Tensor1D trainModel(
-	Model& neuralNetwork,
-	const Tensor1D& input,
-	const Tensor1D& target,
-	const std::function<Tensor1D(const Tensor1D& output, const Tensor1D& target)>& costFunction,
+template<class T>
+BasicTensor1D<T> trainModel(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor1D<T>& input,
+	const BasicTensor1D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
 	double learningRate) {
-	std::vector<Layer>& layers = neuralNetwork.getLayers();
+	std::vector<BasicLayer<T>>& layers = neuralNetwork.getLayers();
 
 	assert((layers.size() > 0.0) && "NeuralNetwork is empty!");
 
-	std::vector<PreparePropagateData> preparedData;
+	std::vector<BasicPreparePropagateData<T>> preparedData;
 	preparedData.reserve(layers.size());
 
-	// Gether prepared propagate data.
-	preparedData.emplace_back(layers[0].layer->preparePropagate(input));
-	for (size_t i = 1; i < layers.size(); i++)
-		preparedData.emplace_back(layers[i].layer->preparePropagate(preparedData[i - 1].output));
+	// Gether prepared propagate data, every layer saves its input in its own layout.
+	for (size_t i = 0; i < layers.size(); i++) {
+		const BasicTensor1D<T>& previous = i == 0 ? input : preparedData[i - 1].output;
+		BasicDataLayout<T> previousLayout = i == 0 ? BasicDataLayout<T>() : layers[i - 1].layer->getOutputLayout();
+		BasicDataLayout<T> inputLayout = layers[i].layer->getInputLayout();
+
+		if (inputLayout.layout == previousLayout.layout)
+			preparedData.emplace_back(layers[i].layer->preparePropagate(previous));
+		else
+			preparedData.emplace_back(layers[i].layer->preparePropagate(convertData(previous, previousLayout, inputLayout)));
+	}
 
-	// Calculate the differentiated cost respect to the output
-	Tensor1D localCost = costFunction(preparedData[layers.size() - 1].output, target);
+	// Calculate the differentiated cost respect to the output, the cost function sees planar data.
+	BasicDataLayout<T> outputLayout = layers[layers.size() - 1].layer->getOutputLayout();
+	BasicTensor1D<T> localCost;
+	if (outputLayout.layout == Layout::Planar)
+		localCost = costFunction(preparedData[layers.size() - 1].output, target);
+	else
+		localCost = convertData(
+			costFunction(convertData(preparedData[layers.size() - 1].output, outputLayout, BasicDataLayout<T>()), target),
+			BasicDataLayout<T>(), outputLayout);
 
 	// Push the cost backward in the layers, calculate the gradients and updating the parameters.
-	for (int i = (int)layers.size() - 1; i >= 0; i--)
+	for (int i = (int)layers.size() - 1; i >= 0; i--) {
 		localCost = layers[i].layer->backPropagate(
 			preparedData[i].sum,
 			localCost,
 			preparedData[i].input, 
 			learningRate);
 
+		BasicDataLayout<T> inputLayout = layers[i].layer->getInputLayout();
+		BasicDataLayout<T> previousLayout = i == 0 ? BasicDataLayout<T>() : layers[i - 1].layer->getOutputLayout();
+		if (inputLayout.layout != previousLayout.layout)
+			localCost = convertData(localCost, inputLayout, previousLayout);
+	}
+
 	// The first layer's cost respect to the input.
 	return localCost;
 }
 
+template<class T>
+BasicTensor2D<T> feedForwardBatch(const BasicModel<T>& neuralNetwork, const BasicTensor2D<T>& input) {
+	BasicTensor2D<T> working = input;
+	const std::vector<BasicLayer<T>>& layers = neuralNetwork.getLayers();
+	BasicDataLayout<T> layout;
+
+	// Same as feedForward, every layer gets the whole batch at once.
+	for (size_t i = 0; i < layers.size(); i++) {
+		BasicDataLayout<T> inputLayout = layers[i].layer->getInputLayout();
+		if (inputLayout.layout != layout.layout)
+			working = convertBatch(working, layout, inputLayout);
+
+		working = layers[i].layer->feedForwardBatch(working);
+		layout = layers[i].layer->getOutputLayout();
+	}
+
+	if (layout.layout != Layout::Planar)
+		working = convertBatch(working, layout, BasicDataLayout<T>());
+
+	return working;
+}
+
+template<class T>
+std::vector<BasicTensor1D<T>> feedForwardMany(const BasicModel<T>& neuralNetwork, const std::vector<BasicTensor1D<T>>& inputs, ThreadPool& pool) {
+	std::vector<BasicTensor1D<T>> outputs(inputs.size());
+	pool.parallelFor(inputs.size(), [&](size_t index, size_t) {
+		outputs[index] = feedForward(neuralNetwork, inputs[index]);
+	});
+	return outputs;
+}
+
+template<class T>
+BasicTensor2D<T> feedForwardMany(const BasicModel<T>& neuralNetwork, const BasicTensor2D<T>& input, ThreadPool& pool, size_t chunkSize) {
+	assert((input.getRows() > 0 && chunkSize > 0) && "Invalid batch parameters!");
+
+	size_t chunkCount = (input.getRows() + chunkSize - 1) / chunkSize;
+	std::vector<BasicTensor2D<T>> outputs(chunkCount);
+	pool.parallelFor(chunkCount, [&](size_t index, size_t) {
+		size_t begin = index * chunkSize;
+		size_t rows = std::min(chunkSize, input.getRows() - begin);
+		BasicTensor2D<T> chunk(rows, input.getCols(), input.getData() + begin * input.getCols());
+		outputs[index] = feedForwardBatch(neuralNetwork, chunk);
+	});
+
+	// The output size is known from the first chunk.
+	size_t outputCols = outputs[0].getCols();
+	BasicTensor2D<T> result(BasicTensor<T>::allocateData(input.getRows() * outputCols), input.getRows(), outputCols);
+	for (size_t i = 0; i < chunkCount; i++)
+		kernel::copy(result.getData() + i * chunkSize * outputCols, outputs[i].getData(), outputs[i].getCount());
+	return result;
+}
+
+namespace {
+
+	template<class T>
+	using CostFunction = std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>;
+
+	// Samples per task in the Hogwild training, their summed gradient is one update.
+	constexpr size_t HOGWILD_CHUNK_SIZE = 4;
+
+	// Gether prepared propagate data of the whole batch layer by layer, every layer saves its input in its own layout.
+	template<class T>
+	std::vector<BasicPreparePropagateBatchData<T>> prepareBatch(const std::vector<BasicLayer<T>>& layers, const BasicTensor2D<T>& input) {
+		std::vector<BasicPreparePropagateBatchData<T>> preparedData;
+		preparedData.reserve(layers.size());
+
+		for (size_t i = 0; i < layers.size(); i++) {
+			const BasicTensor2D<T>& previous = i == 0 ? input : preparedData[i - 1].output;
+			BasicDataLayout<T> previousLayout = i == 0 ? BasicDataLayout<T>() : layers[i - 1].layer->getOutputLayout();
+			BasicDataLayout<T> inputLayout = layers[i].layer->getInputLayout();
+
+			if (inputLayout.layout == previousLayout.layout)
+				preparedData.emplace_back(layers[i].layer->preparePropagateBatch(previous));
+			else
+				preparedData.emplace_back(layers[i].layer->preparePropagateBatch(convertBatch(previous, previousLayout, inputLayout)));
+		}
+		return preparedData;
+	}
+
+	// Differentiated cost of the batch respect to the model output, in the layout of the last layer.
+	// The cost function is called per sample, with planar data.
+	template<class T>
+	BasicTensor2D<T> batchCost(const std::vector<BasicLayer<T>>& layers, std::vector<BasicPreparePropagateBatchData<T>>& preparedData,
+		const BasicTensor2D<T>& target, const CostFunction<T>& costFunction) {
+		BasicDataLayout<T> outputLayout = layers[layers.size() - 1].layer->getOutputLayout();
+		BasicTensor2D<T> output = outputLayout.layout == Layout::Planar ?
+			std::move(preparedData[layers.size() - 1].output) :
+			convertBatch(preparedData[layers.size() - 1].output, outputLayout, BasicDataLayout<T>());
+
+		BasicTensor2D<T> localCost = BasicTensor2D<T>(BasicTensor<T>::allocateData(output.getCount()), output.getRows(), output.getCols());
+		for (size_t n = 0; n < output.getRows(); n++) {
+			BasicTensor1D<T> cost = costFunction(
+				BasicTensor1D<T>(output.getCols(), output.getData() + n * output.getCols()),
+				BasicTensor1D<T>(target.getCols(), target.getData() + n * target.getCols()));
+			assert((cost.getCount() == output.getCols()) && "Cost function result not match with the output!");
+			kernel::copy(localCost.getData() + n * localCost.getCols(), cost.getData(), cost.getCount());
+		}
+		if (outputLayout.layout != Layout::Planar)
+			localCost = convertBatch(localCost, BasicDataLayout<T>(), outputLayout);
+		return localCost;
+	}
+
+	// Push the cost of the batch backward, step(i, cost) runs the backward of the i-th layer
+	// and returns the cost respect to its input. Returns the cost respect to the planar model input.
+	template<class T, class Step>
+	BasicTensor2D<T> backwardBatch(const std::vector<BasicLayer<T>>& layers, BasicTensor2D<T> localCost, const Step& step) {
+		for (int i = (int)layers.size() - 1; i >= 0; i--) {
+			localCost = step(size_t(i), localCost);
+
+			BasicDataLayout<T> inputLayout = layers[i].layer->getInputLayout();
+			BasicDataLayout<T> previousLayout = i == 0 ? BasicDataLayout<T>() : layers[i - 1].layer->getOutputLayout();
+			if (inputLayout.layout != previousLayout.layout)
+				localCost = convertBatch(localCost, inputLayout, previousLayout);
+		}
+		return localCost;
+	}
+
+}
+
+template<class T>
+BasicPackedParameters<T>::BasicPackedParameters(std::vector<Layer>& layers) {
+	for (size_t i = 0; i < layers.size(); i++) {
+		layerOffsets.push_back(count);
+		std::vector<Tensor*> parameters = layers[i].layer->getParameters();
+		for (size_t j = 0; j < parameters.size(); j++) {
+			tensors.push_back(parameters[j]);
+			tensorOffsets.push_back(count);
+			count += parameters[j]->getCount();
+		}
+	}
+}
+
+template<class T>
+void BasicPackedParameters<T>::update(Optimizer& optimizer, const precision* gradients, size_t begin, size_t end, precision scale) const {
+	for (size_t i = 0; i < tensors.size(); i++) {
+		size_t first = std::max(begin, tensorOffsets[i]);
+		size_t last = std::min(end, tensorOffsets[i] + tensors[i]->getCount());
+		if (first < last)
+			optimizer.update(tensors[i]->getData() + first - tensorOffsets[i], gradients + first, first, last - first, scale);
+	}
+}
+
+template<class T>
+BasicTensor2D<T> trainBatch(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor2D<T>& input,
+	const BasicTensor2D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
+	double learningRate) {
+	std::vector<BasicLayer<T>>& layers = neuralNetwork.getLayers();
+
+	assert((layers.size() > 0.0) && "NeuralNetwork is empty!");
+	assert((input.getRows() > 0 && input.getRows() == target.getRows()) && "Invalid batch parameters!");
+
+	std::vector<BasicPreparePropagateBatchData<T>> preparedData = prepareBatch(layers, input);
+
+	// Every layer updates its parameters once with the averaged gradients.
+	// Returns the cost respect to the inputs of the batch.
+	return backwardBatch(layers, batchCost(layers, preparedData, target, costFunction), [&](size_t i, BasicTensor2D<T>& localCost) {
+		return layers[i].layer->backPropagateBatch(preparedData[i].sum, localCost, preparedData[i].input, learningRate);
+	});
+}
+
+template<class T>
+BasicTensor2D<T> trainBatch(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor2D<T>& input,
+	const BasicTensor2D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
+	BasicOptimizer<T>& optimizer) {
+	std::vector<BasicLayer<T>>& layers = neuralNetwork.getLayers();
+
+	assert((layers.size() > 0.0) && "NeuralNetwork is empty!");
+	assert((input.getRows() > 0 && input.getRows() == target.getRows()) && "Invalid batch parameters!");
+
+	BasicPackedParameters<T> parameters(layers);
+	std::vector<T> gradients(parameters.count, T());
+
+	// The layers only calculate the gradients, the optimizer updates the parameters after the whole backward.
+	std::vector<BasicPreparePropagateBatchData<T>> preparedData = prepareBatch(layers, input);
+	BasicTensor2D<T> costBefore = backwardBatch(layers, batchCost(layers, preparedData, target, costFunction), [&](size_t i, BasicTensor2D<T>& localCost) {
+		return layers[i].layer->gradientsBatch(preparedData[i].sum, localCost, preparedData[i].input,
+			gradients.data() + parameters.layerOffsets[i]);
+	});
+
+	optimizer.beginStep(parameters.count);
+	parameters.update(optimizer, gradients.data(), 0, parameters.count, T(1.0 / double(input.getRows())));
+	for (size_t i = 0; i < layers.size(); i++)
+		layers[i].layer->parametersChanged();
+	return costBefore;
+}
+
+template<class T>
+BasicTensor2D<T> trainBatchParallel(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor2D<T>& input,
+	const BasicTensor2D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
+	double learningRate,
+	ThreadPool& pool,
+	GradientReduction reduction) {
+	BasicSGD<T> optimizer(learningRate);
+	return trainBatchParallel(neuralNetwork, input, target, costFunction, optimizer, pool, reduction);
+}
+
+template<class T>
+BasicTensor2D<T> trainBatchParallel(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor2D<T>& input,
+	const BasicTensor2D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
+	BasicOptimizer<T>& optimizer,
+	ThreadPool& pool,
+	GradientReduction reduction) {
+	std::vector<BasicLayer<T>>& layers = neuralNetwork.getLayers();
+
+	assert((layers.size() > 0.0) && "NeuralNetwork is empty!");
+	assert((input.getRows() > 0 && input.getRows() == target.getRows()) && "Invalid batch parameters!");
+
+	size_t batchSize = input.getRows();
+	BasicPackedParameters<T> parameters(layers);
+	BasicTensor2D<T> costBefore = BasicTensor2D<T>(BasicTensor<T>::allocateData(input.getCount()), batchSize, input.getCols());
+
+	// Forward and backward of the [begin, end) rows of the batch, their summed gradients are added to gradients.
+	auto shardGradients = [&](size_t begin, size_t end, T* gradients) {
+		BasicTensor2D<T> shardInput(end - begin, input.getCols(), input.getData() + begin * input.getCols());
+		BasicTensor2D<T> shardTarget(end - begin, target.getCols(), target.getData() + begin * target.getCols());
+
+		std::vector<BasicPreparePropagateBatchData<T>> preparedData = prepareBatch(layers, shardInput);
+		BasicTensor2D<T> localCost = backwardBatch(layers, batchCost(layers, preparedData, shardTarget, costFunction),
+			[&](size_t i, BasicTensor2D<T>& localCost) {
+				return layers[i].layer->gradientsBatch(preparedData[i].sum, localCost, preparedData[i].input,
+					gradients + parameters.layerOffsets[i]);
+			});
+		kernel::copy(costBefore.getData() + begin * input.getCols(), localCost.getData(), localCost.getCount());
+	};
+
+	T scale = T(1.0 / double(batchSize));
+	optimizer.beginStep(parameters.count);
+
+	if (reduction == GradientReduction::Hogwild) {
+		// Every chunk updates the shared parameters right after its gradient is ready, without locks,
+		// so the other threads read partly updated parameters (and optimizer state), all the chunks are in the same step.
+		// The kernel caches are rebuilt only at the end.
+		std::vector<T> gradients(pool.getThreadCount() * parameters.count);
+		size_t chunkCount = (batchSize + HOGWILD_CHUNK_SIZE - 1) / HOGWILD_CHUNK_SIZE;
+		pool.parallelFor(chunkCount, [&](size_t index, size_t thread) {
+			T* threadGradients = gradients.data() + thread * parameters.count;
+			kernel::fill(threadGradients, T(), parameters.count);
+			shardGradients(index * HOGWILD_CHUNK_SIZE, std::min(batchSize, (index + 1) * HOGWILD_CHUNK_SIZE), threadGradients);
+			parameters.update(optimizer, threadGradients, 0, parameters.count, scale);
+		});
+	}
+	else {
+		// One shard of the batch per thread, every shard has its own gradients.
+		size_t shardCount = std::min(pool.getThreadCount(), batchSize);
+		std::vector<T> gradients(shardCount * parameters.count, T());
+		auto shardData = [&](size_t shard) { return gradients.data() + shard * parameters.count; };
+		// The packed vector is cut into shardCount segments for the ring reduction and the parallel update.
+		auto segmentBegin = [&](size_t segment) { return segment * parameters.count / shardCount; };
+
+		pool.parallelFor(shardCount, [&](size_t shard, size_t) {
+			shardGradients(shard * batchSize / shardCount, (shard + 1) * batchSize / shardCount, shardData(shard));
+		});
+
+		if (reduction == GradientReduction::Tree) {
+			// Pairwise sums, after log2(shardCount) rounds the first shard holds the sum.
+			for (size_t step = 1; step < shardCount; step *= 2) {
+				pool.parallelFor(shardCount, [&](size_t shard, size_t) {
+					if (shard % (2 * step) == 0 && shard + step < shardCount)
+						kernel::add(shardData(shard), shardData(shard + step), parameters.count);
+				});
+			}
+			pool.parallelFor(shardCount, [&](size_t segment, size_t) {
+				parameters.update(optimizer, shardData(0), segmentBegin(segment), segmentBegin(segment + 1), scale);
+			});
+		}
+		else {
+			// Ring reduce-scatter: in the step-th round every shard adds the previous shard's partial sum
+			// of one segment to its own, after shardCount - 1 rounds shard s holds the sum of segment s + 1.
+			// The parameters are shared, so the all-gather of the ring is replaced by the segment updates.
+			for (size_t step = 0; step + 1 < shardCount; step++) {
+				pool.parallelFor(shardCount, [&](size_t shard, size_t) {
+					size_t segment = (shard + shardCount - step - 1) % shardCount;
+					size_t previous = (shard + shardCount - 1) % shardCount;
+					size_t begin = segmentBegin(segment);
+					kernel::add(shardData(shard) + begin, shardData(previous) + begin, segmentBegin(segment + 1) - begin);
+				});
+			}
+			pool.parallelFor(shardCount, [&](size_t shard, size_t) {
+				size_t segment = (shard + 1) % shardCount;
+				parameters.update(optimizer, shardData(shard), segmentBegin(segment), segmentBegin(segment + 1), scale);
+			});
+		}
+	}
+
+	for (size_t i = 0; i < layers.size(); i++)
+		layers[i].layer->parametersChanged();
+	return costBefore;
+}
+
+template<class T>
+BasicTrainingSession<T>::BasicTrainingSession(Model& neuralNetwork, size_t maxBatchSize, const CostFunction& costFunction) :
+	m_Model(neuralNetwork), m_MaxBatchSize(maxBatchSize), m_CostFunction(costFunction), m_GradientDescent(0.0) {
+	assert((maxBatchSize > 0) && "Invalid batch size!");
+}
+
+template<class T>
+BasicTensor2D<T> BasicTrainingSession<T>::train(const Tensor2D& input, const Tensor2D& target, double learningRate) {
+	m_GradientDescent.setLearningRate(learningRate);
+	return train(input, target, m_GradientDescent);
+}
+
+template<class T>
+BasicTensor2D<T> BasicTrainingSession<T>::train(const Tensor2D& input, const Tensor2D& target, Optimizer& optimizer) {
+	std::vector<Layer>& layers = m_Model.getLayers();
+	size_t batchSize = input.getRows();
+
+	assert((layers.size() > 0) && "NeuralNetwork is empty!");
+	assert((batchSize > 0 && batchSize <= m_MaxBatchSize && target.getRows() == batchSize) && "Invalid batch parameters!");
+
+	if (m_Layers.size() != layers.size() || input.getCols() != m_InputCount)
+		_plan(input.getCols());
+
+	// Push the batch forward, every layer writes its sums and outputs into its own buffers.
+	for (size_t i = 0; i < layers.size(); i++) {
+		const LayerBuffers& buffers = m_Layers[i];
+		Tensor2D layerInput = _layerInput(i, input);
+		if (buffers.input != NO_BUFFER)
+			convertBatch(_previousOutput(i, input), buffers.previousLayout, buffers.inputLayout, layerInput);
+
+		Tensor2D sum = _buffer(buffers.sum, batchSize, buffers.sumCount);
+		Tensor2D output = _buffer(buffers.output, batchSize, buffers.outputCount);
+		layers[i].layer->preparePropagateBatch(layerInput, sum, output);
+	}
+
+	// The cost function sees the planar output, its cost is converted back to the layout of the last layer.
+	const LayerBuffers& last = m_Layers[layers.size() - 1];
+	Tensor2D output = _buffer(last.output, batchSize, last.outputCount);
+	Tensor2D cost = _buffer(m_Costs[0], batchSize, m_OutputCount);
+	size_t current = 0;
+	if (m_Output == NO_BUFFER) {
+		m_CostFunction(output, target, cost);
+	}
+	else {
+		Tensor2D planarOutput = _buffer(m_Output, batchSize, m_OutputCount);
+		convertBatch(output, m_OutputLayout, DataLayout(), planarOutput);
+		m_CostFunction(planarOutput, target, cost);
+
+		Tensor2D layoutCost = _buffer(m_Costs[1], batchSize, last.outputCount);
+		convertBatch(cost, DataLayout(), m_OutputLayout, layoutCost);
+		current = 1;
+	}
+
+	// Push the cost backward, the cost after and before a layer are the two cost buffers in turn.
+	precision* gradients = m_Buffer.getData() + m_Gradients;
+	kernel::fill(gradients, precision(), m_Parameters.count);
+	for (size_t i = layers.size(); i-- > 0;) {
+		const LayerBuffers& buffers = m_Layers[i];
+		Tensor2D sum = _buffer(buffers.sum, batchSize, buffers.sumCount);
+		Tensor2D costAfter = _buffer(m_Costs[current], batchSize, buffers.outputCount);
+		Tensor2D costBefore = _buffer(m_Costs[1 - current], batchSize, buffers.inputCount);
+		Tensor2D layerInput = _layerInput(i, input);
+		layers[i].layer->gradientsBatch(sum, costAfter, layerInput, gradients + m_Parameters.layerOffsets[i], costBefore);
+		current = 1 - current;
+
+		if (buffers.input != NO_BUFFER) {
+			size_t previousCount = i == 0 ? m_InputCount : m_Layers[i - 1].outputCount;
+			Tensor2D converted = _buffer(m_Costs[1 - current], batchSize, previousCount);
+			convertBatch(costBefore, buffers.inputLayout, buffers.previousLayout, converted);
+			current = 1 - current;
+		}
+	}
+
+	optimizer.beginStep(m_Parameters.count);
+	m_Parameters.update(optimizer, gradients, 0, m_Parameters.count, precision(1.0 / double(batchSize)));
+	for (size_t i = 0; i < layers.size(); i++)
+		layers[i].layer->parametersChanged();
+
+	return _buffer(m_Costs[current], batchSize, m_InputCount);
+}
+
+template<class T>
+void BasicTrainingSession<T>::_plan(size_t inputCount) {
+	std::vector<Layer>& layers = m_Model.getLayers();
+
+	// Every buffer starts at a DATA_ALIGNMENT boundary, like the allocated tensors.
+	size_t alignment = Tensor::DATA_ALIGNMENT / sizeof(precision);
+	size_t size = 0;
+	auto place = [&](size_t count) {
+		size_t offset = size;
+		size += (count + alignment - 1) / alignment * alignment;
+		return offset;
+	};
+
+	// One sample goes through the layers, the sizes of their data come from the result.
+	Tensor1D sample(inputCount, 0.0);
+	DataLayout layout;
+	size_t costCount = inputCount;
+
+	m_Layers.assign(layers.size(), LayerBuffers());
+	for (size_t i = 0; i < layers.size(); i++) {
+		LayerBuffers& buffers = m_Layers[i];
+		buffers.previousLayout = layout;
+		buffers.inputLayout = layers[i].layer->getInputLayout();
+		if (buffers.inputLayout.layout != layout.layout)
+			sample = convertData(sample, layout, buffers.inputLayout);
+
+		PreparePropagateData pData = layers[i].layer->preparePropagate(sample);
+		buffers.inputCount = sample.getCount();
+		buffers.sumCount = pData.sum.getCount();
+		buffers.outputCount = pData.output.getCount();
+		if (buffers.inputLayout.layout != layout.layout)
+			buffers.input = place(m_MaxBatchSize * buffers.inputCount);
+		buffers.sum = place(m_MaxBatchSize * buffers.sumCount);
+		buffers.output = place(m_MaxBatchSize * buffers.outputCount);
+		costCount = std::max(costCount, std::max(buffers.inputCount, buffers.outputCount));
+
+		sample = std::move(pData.output);
+		layout = layers[i].layer->getOutputLayout();
+	}
+
+	m_InputCount = inputCount;
+	m_OutputLayout = layout;
+	m_OutputCount = m_Layers.back().outputCount;
+	m_Output = NO_BUFFER;
+	if (layout.layout != Layout::Planar) {
+		m_OutputCount = layoutCount<precision>(Layout::Planar, layout.depth, layout.rows, layout.cols);
+		m_Output = place(m_MaxBatchSize * m_OutputCount);
+		costCount = std::max(costCount, m_OutputCount);
+	}
+
+	m_Costs[0] = place(m_MaxBatchSize * costCount);
+	m_Costs[1] = place(m_MaxBatchSize * costCount);
+	m_Parameters = PackedParameters(layers);
+	m_Gradients = place(m_Parameters.count);
+
+	m_Buffer = Tensor1D(size, precision());
+}
+
+template<class T>
+BasicTensor2D<T> BasicTrainingSession<T>::_buffer(size_t offset, size_t rows, size_t cols) {
+	return Tensor2D(rows, cols, Tensor(m_Buffer.getData() + offset, true));
+}
+
+template<class T>
+BasicTensor2D<T> BasicTrainingSession<T>::_previousOutput(size_t i, const Tensor2D& input) {
+	if (i > 0)
+		return _buffer(m_Layers[i - 1].output, input.getRows(), m_Layers[i - 1].outputCount);
+
+	// The first layer gets the input of the batch, the layers only read their input.
+	return Tensor2D(input.getRows(), m_InputCount, Tensor(const_cast<precision*>(input.getData()), true));
+}
+
+template<class T>
+BasicTensor2D<T> BasicTrainingSession<T>::_layerInput(size_t i, const Tensor2D& input) {
+	if (m_Layers[i].input != NO_BUFFER)
+		return _buffer(m_Layers[i].input, input.getRows(), m_Layers[i].inputCount);
+	return _previousOutput(i, input);
+}
+
+template<class T>
+void BasicInferencePlan<T>::run(const Tensor2D& input, Tensor2D& output) {
+	size_t batchSize = input.getRows();
+	assert((m_Valid) && "The model couldn't be compiled!");
+	assert((batchSize > 0 && batchSize <= m_MaxBatchSize && input.getCols() == m_InputCount) && "Invalid input parameters!");
+	assert((output.getRows() == batchSize && output.getCols() == m_OutputCount) && "Invalid output parameters!");
+
+	for (const Step& step : m_Steps) {
+		Tensor2D source = _slot(step.source, batchSize, step.inputCount, input, output);
+		Tensor2D destination = _slot(step.destination, batchSize, step.outputCount, input, output);
+		if (step.quantized)
+			step.layer->feedForwardQuantized(source, destination, *step.quantized);
+		else if (step.layer)
+			step.layer->feedForwardBatch(source, destination);
+		else
+			convertBatch(source, step.from, step.to, destination);
+	}
+}
+
+template<class T>
+void BasicInferencePlan<T>::run(const Tensor1D& input, Tensor1D& output) {
+	assert((input.getCount() == m_InputCount && output.getCount() == m_OutputCount) && "Invalid input or output parameters!");
+	Tensor2D inputRow(1, m_InputCount, Tensor(const_cast<precision*>(input.getData()), true));
+	Tensor2D outputRow(1, m_OutputCount, Tensor(output.getData(), true));
+	run(inputRow, outputRow);
+}
+
+template<class T>
+BasicTensor2D<T> BasicInferencePlan<T>::_slot(Slot slot, size_t rows, size_t count, const Tensor2D& input, Tensor2D& output) {
+	// The layers only read their input.
+	if (slot == Slot::Input)
+		return Tensor2D(rows, count, Tensor(const_cast<precision*>(input.getData()), true));
+	if (slot == Slot::Output)
+		return Tensor2D(rows, count, Tensor(output.getData(), true));
+	if (slot == Slot::First)
+		return Tensor2D(rows, count, Tensor(m_Buffer.getData(), true));
+	return Tensor2D(rows, count, Tensor(m_Buffer.getData() + m_Second, true));
+}
+
+#define MODEL_TEMPLATES(T) \
+	template class DRAGON_API BasicModel<T>; \
+	template class DRAGON_API BasicQuantization<T>; \
+	template struct DRAGON_API BasicPackedParameters<T>; \
+	template class DRAGON_API BasicTrainingSession<T>; \
+	template class DRAGON_API BasicInferencePlan<T>; \
+	template DRAGON_API BasicTensor1D<T> feedForward(const BasicModel<T>&, const BasicTensor1D<T>&); \
+	template DRAGON_API BasicTensor1D<T> trainModel(BasicModel<T>&, const BasicTensor1D<T>&, const BasicTensor1D<T>&, \
+		const CostFunction<T>&, double); \
+	template DRAGON_API BasicTensor2D<T> feedForwardBatch(const BasicModel<T>&, const BasicTensor2D<T>&); \
+	template DRAGON_API std::vector<BasicTensor1D<T>> feedForwardMany(const BasicModel<T>&, const std::vector<BasicTensor1D<T>>&, ThreadPool&); \
+	template DRAGON_API BasicTensor2D<T> feedForwardMany(const BasicModel<T>&, const BasicTensor2D<T>&, ThreadPool&, size_t); \
+	template DRAGON_API BasicTensor2D<T> trainBatch(BasicModel<T>&, const BasicTensor2D<T>&, const BasicTensor2D<T>&, \
+		const CostFunction<T>&, double); \
+	template DRAGON_API BasicTensor2D<T> trainBatch(BasicModel<T>&, const BasicTensor2D<T>&, const BasicTensor2D<T>&, \
+		const CostFunction<T>&, BasicOptimizer<T>&); \
+	template DRAGON_API BasicTensor2D<T> trainBatchParallel(BasicModel<T>&, const BasicTensor2D<T>&, const BasicTensor2D<T>&, \
+		const CostFunction<T>&, double, ThreadPool&, GradientReduction); \
+	template DRAGON_API BasicTensor2D<T> trainBatchParallel(BasicModel<T>&, const BasicTensor2D<T>&, const BasicTensor2D<T>&, \
+		const CostFunction<T>&, BasicOptimizer<T>&, ThreadPool&, GradientReduction);
+DRAGON_INSTANTIATE(MODEL_TEMPLATES)
+
 DRAGON_END
\ No newline at end of file
@@ -2,18 +2,43 @@
 #include <vector>
 #include <functional>
 #include <string>
+#include <memory>
 
 #include "Layers/Layers.h"
+#include "ThreadPool.h"
+#include "Optimizers.h"
+#include "MappedFile.h"
 
 DRAGON_BEGIN
 
+template<class T> class BasicInferencePlan;
+template<class T> class BasicQuantization;
+
 /// <summary>
 /// Layer stuct containes all the layer information.
 /// </summary>
-struct Layer {
-	BaseLayer* layer;			// Contains the layer parameters
+template<class T>
+struct BasicLayer {
+	BasicBaseLayer<T>* layer;	// Contains the layer parameters
 	bool isInitializedOnModel;	// True if the layer initialized on the model object, than it's need to be deleted by the model object.
 };
+using Layer = BasicLayer<precision>;
+
+template<class T> class BasicModel;
+template<class T> struct BasicPackedParameters;
+template<class T> class BasicTrainingSession;
+
+// The names of the model types with the element type T inside the model class templates, like DRAGON_LAYER_TYPES.
+#define DRAGON_MODEL_TYPES(T) \
+	DRAGON_LAYER_TYPES(T) \
+	using Layer = BasicLayer<T>; \
+	using Model = BasicModel<T>; \
+	using Optimizer = BasicOptimizer<T>; \
+	using SGD = BasicSGD<T>; \
+	using PackedParameters = BasicPackedParameters<T>; \
+	using Quantization = BasicQuantization<T>; \
+	using InferencePlan = BasicInferencePlan<T>; \
+	using TrainingSession = BasicTrainingSession<T>;
 
 /// <summary>
 /// Model class wraps the Layers together creating a neuralnetwork.
@@ -27,16 +52,32 @@ struct Layer {
 /// model.addLayer<DenseLayer>(DenseLayer(3, 1, initFunction, sigmoid, sigmoidDiff));
 /// To save the model into file, use the save function with a file path and an extension of .txt.
 /// To load the model from file, use the load funtcoin with a file path and an extension of .txt.
+/// For large models use saveBinary, the binary file keeps the exact values and load maps it into memory,
+/// the parameters of the loaded layers point into the mapping, so nothing is parsed or copied.
 /// Note that if you have costum layer or functions, first you need to provide the model with
 /// the specific createLayer and createActivation functions.
+/// The input and output of the model are always planar, the layers can keep their 3D data in other layouts (setLayout),
+/// the data is converted only between neighbouring layers with different layouts.
 /// </summary>
-class DRAGON_API Model {
+template<class T>
+class BasicModel {
 public:
-	Model() = default;
-	~Model();
+	DRAGON_MODEL_TYPES(T)
+
+	BasicModel() = default;
+	~BasicModel();
 	 
 	void addLayer(BaseLayer* layer);
 
+	// Set the memory layout of the 3D data in every layer, layers working on flat data keep it planar.
+	// With the blocked layout the convolutional and pooling layers pass the data to each other without conversion.
+	void setLayout(Layout layout);
+	// Store the weights of the dense and convolutional layers in the format, the other layers stay in precision.
+	// With Float16 or BFloat16 the precision weights are freed and the layers run with the 16 bit ones (no calibration
+	// is needed), saveBinary saves them in 16 bits too. The 16 bit weights are for inference, Precision widens them back
+	// for training. The text file keeps the widened values.
+	void setWeightFormat(WeightFormat format);
+
 	// Adds your costum layerCreator.
 	// If you want to load your previously saved model, first you need to provide the model with your costum layerCreator function.
 	// The function should take in a string(layerName like DenseLayer) and contruct a new Layer on the heap and return it as BaseLayer*.
@@ -48,17 +89,36 @@ public:
 
 	// Save your model to file (txt).
 	void save(const std::string& filePath);
-	// Load your model from file (txt).
+	// Load your model from file (txt), or from a binary file written by saveBinary.
 	void load(const std::string& filePath);
+	// Same as load, but the layers of a text file are parsed on the threads of the pool at the same time.
+	void load(const std::string& filePath, ThreadPool& pool);
+	// Save your model to a binary file: a header, a table of the layers and the raw values of their parameters.
+	void saveBinary(const std::string& filePath);
+	// Load your model from a binary file. With mapWeights the file is mapped into memory and the parameters watch it
+	// (the written pages are private copies, the file doesn't change), else the values are copied into the layers.
+	// The values of a file saved with the other precision (float or double) are always copied and converted.
+	void loadBinary(const std::string& filePath, bool mapWeights = true);
 
 	inline const std::vector<Layer>& getLayers() const { return m_Layers; }
 	inline std::vector<Layer>& getLayers() { return m_Layers; }
 
+	// Check the shapes of the layers and plan the buffers of the inference for batches of at most maxBatchSize samples.
+	// The plan only points to the layers, compile again after the layers or their layouts changed.
+	InferencePlan compile(size_t maxBatchSize = 1) const;
+	// Same as compile, but the layers with weights in the quantization run with int8 weights.
+	InferencePlan compile(size_t maxBatchSize, const Quantization& quantization) const;
+	// Quantize the weights of the layers to int8 (the dense and convolutional layers, the others stay in precision).
+	// The rows of calibrationInput are samples like the real inputs, the input range of every layer is measured on them.
+	Quantization quantize(const Tensor2D& calibrationInput) const;
+
 private:
 	// Create a Layer in the load function from the given layerName.
 	BaseLayer* createLayer(const std::string& layerName);
 	// Create an Activation in the load function from the given layerName.
 	ActivationFunction createActivation(const std::string& activationName);
+	// Load the model from the text file in one pass over the contents, with the pool the layers are parsed in parallel.
+	void _loadText(const std::string& filePath, ThreadPool* pool);
 
 private:
 	// This member holds the costum layer creator functions to load costum layers.
@@ -70,19 +130,290 @@ private:
 	std::vector<std::function<ActivationFunction(const std::string& functionName)>> m_ActivationCreator;
 	// This member holds the layers as BaseLayer pointer.
 	std::vector<Layer> m_Layers;
+	// The mapped binary files that the parameters of the loaded layers watch, released after the layers.
+	std::vector<std::shared_ptr<MappedFile>> m_MappedFiles;
+};
+
+extern template class DRAGON_API BasicModel<float>;
+extern template class DRAGON_API BasicModel<double>;
+using Model = BasicModel<precision>;
+
+/// <summary>
+/// Quantization holds the int8 weights of the layers of a model for the quantized InferencePlan.
+/// The weights of the i-th layer are getLayers()[i], nullptr for the layers running in precision (pooling, costum layers).
+/// It's a copy of the weights, quantize the model again after it was trained.
+/// Save it next to the model file, and load it together with the model.
+/// [example]
+/// Quantization quantization = model.quantize(calibrationInputs);
+/// quantization.save("model.drgq");
+/// InferencePlan plan = model.compile(64, quantization);
+/// plan.run(inputs, outputs);
+/// </summary>
+template<class T>
+class BasicQuantization {
+public:
+	DRAGON_MODEL_TYPES(T)
+
+	inline const std::vector<std::shared_ptr<QuantizedWeights>>& getLayers() const { return m_Layers; }
+	inline std::vector<std::shared_ptr<QuantizedWeights>>& getLayers() { return m_Layers; }
+
+	// Save to a binary file: a header, than the scales, biases and int8 weights of every layer.
+	void save(const std::string& filePath) const;
+	// Load a file written by save, the loaded layers replace the current ones.
+	void load(const std::string& filePath);
+
+private:
+	std::vector<std::shared_ptr<QuantizedWeights>> m_Layers;
 };
 
+extern template class DRAGON_API BasicQuantization<float>;
+extern template class DRAGON_API BasicQuantization<double>;
+using Quantization = BasicQuantization<precision>;
+
 // Push the input data through the model and returns the output.
-DRAGON_API Tensor1D feedForward(const Model& neuralNetwork, const Tensor1D& input);
+template<class T> DRAGON_API BasicTensor1D<T> feedForward(const BasicModel<T>& neuralNetwork, const BasicTensor1D<T>& input);
 
 // Superwised learning (Classification)
 // CostFunction parameter should return the cost differentiated by the output.
 // Returns the differentiated cost respect to the input
-DRAGON_API Tensor1D trainModel(
-	Model& neuralNetwork,
-	const Tensor1D& input,
-	const Tensor1D& target,
-	const std::function<Tensor1D(const Tensor1D& output, const Tensor1D& target)>& costFunction,
+template<class T> DRAGON_API BasicTensor1D<T> trainModel(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor1D<T>& input,
+	const BasicTensor1D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
+	double learningRate);
+
+// Push a mini-batch through the model, every row of the input is a sample, every row of the result is its output.
+// The dense layers run the whole batch as one matrix multiplication.
+template<class T> DRAGON_API BasicTensor2D<T> feedForwardBatch(const BasicModel<T>& neuralNetwork, const BasicTensor2D<T>& input);
+
+// Push every input through the model on the threads of the pool.
+// The layers are only read, the result is the same as calling feedForward for every input.
+template<class T> DRAGON_API std::vector<BasicTensor1D<T>> feedForwardMany(const BasicModel<T>& neuralNetwork, const std::vector<BasicTensor1D<T>>& inputs, ThreadPool& pool);
+// Split the batch (rows of the input) into chunks of chunkSize samples and run feedForwardBatch on the chunks
+// on the threads of the pool. A sample's output doesn't depend on the other rows of its batch,
+// so the result is the same as feedForwardBatch on the whole input, for any chunkSize and thread count.
+template<class T> DRAGON_API BasicTensor2D<T> feedForwardMany(const BasicModel<T>& neuralNetwork, const BasicTensor2D<T>& input, ThreadPool& pool, size_t chunkSize = 64);
+
+// Superwised learning on a mini-batch, the samples and their targets are the rows of input and target.
+// CostFunction is called for every sample, like in trainModel.
+// The gradients are averaged over the batch and every parameter is updated once with learningRate.
+// Returns the differentiated cost respect to the inputs, one row per sample.
+template<class T> DRAGON_API BasicTensor2D<T> trainBatch(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor2D<T>& input,
+	const BasicTensor2D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
 	double learningRate);
 
+// Same as trainBatch, but the layers only calculate the gradients and the optimizer updates the parameters
+// with the batch average of the gradients. The optimizer keeps its state between the calls, use it with one model.
+template<class T> DRAGON_API BasicTensor2D<T> trainBatch(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor2D<T>& input,
+	const BasicTensor2D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
+	BasicOptimizer<T>& optimizer);
+
+// How trainBatchParallel combines the gradients of the threads.
+enum class GradientReduction {
+	Tree,		// Pairwise sums in log2(threads) rounds, than one update.
+	Ring,		// Ring reduce-scatter, every thread sums and updates its own segment of the parameters.
+	Hogwild		// No reduction: small chunks of samples update the shared parameters without locks as they finish.
+};
+
+// Data parallel trainBatch on the threads of the pool, every thread calculates the gradients of a shard of the batch.
+// With Tree and Ring the summed gradients are applied in one update, the result is the same as trainBatch
+// up to rounding and doesn't change between runs with the same thread count.
+// Hogwild is not deterministic, the threads train on parameters that the others are updating.
+// Returns the differentiated cost respect to the inputs, one row per sample.
+template<class T> DRAGON_API BasicTensor2D<T> trainBatchParallel(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor2D<T>& input,
+	const BasicTensor2D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
+	double learningRate,
+	ThreadPool& pool,
+	GradientReduction reduction = GradientReduction::Tree);
+// trainBatchParallel with an optimizer, with Tree and Ring the threads update their parts of the parameters in parallel.
+template<class T> DRAGON_API BasicTensor2D<T> trainBatchParallel(
+	BasicModel<T>& neuralNetwork,
+	const BasicTensor2D<T>& input,
+	const BasicTensor2D<T>& target,
+	const NonDeduced<std::function<BasicTensor1D<T>(const BasicTensor1D<T>& output, const BasicTensor1D<T>& target)>>& costFunction,
+	BasicOptimizer<T>& optimizer,
+	ThreadPool& pool,
+	GradientReduction reduction = GradientReduction::Tree);
+
+
+/// <summary>
+/// The parameters of every layer of a model seen as one packed vector, in the order of the layers' getParameters,
+/// that is the order of the gradients of gradientsBatch.
+/// </summary>
+template<class T>
+struct BasicPackedParameters {
+	DRAGON_MODEL_TYPES(T)
+
+	std::vector<Tensor*> tensors;
+	std::vector<size_t> tensorOffsets;	// Offset of every tensor in the packed vector.
+	std::vector<size_t> layerOffsets;	// Offset of the first parameter of every layer.
+	size_t count = 0;
+
+	BasicPackedParameters() = default;
+	BasicPackedParameters(std::vector<Layer>& layers);
+
+	// Update the [begin, end) part of the packed vector with the optimizer.
+	void update(Optimizer& optimizer, const precision* gradients, size_t begin, size_t end, precision scale) const;
+};
+
+extern template class DRAGON_API BasicPackedParameters<float>;
+extern template class DRAGON_API BasicPackedParameters<double>;
+using PackedParameters = BasicPackedParameters<precision>;
+
+
+/// <summary>
+/// TrainingSession trains a model on mini-batches with buffers that are planned only once.
+/// At the first step one sample is pushed through the layers to get their shapes, than the inputs, sums and outputs
+/// of every layer, the layout conversions, the costs and the packed gradients are placed in one allocation
+/// for maxBatchSize samples. The later steps (of at most maxBatchSize samples) reuse them, so with the built in layers
+/// the steady state training does no heap allocation at all.
+/// The cost function gets the whole batch: it writes the cost differentiated by the (planar) output into cost.
+/// Don't change the layers of the model while the session is used, a session is for one thread.
+/// </summary>
+template<class T>
+class BasicTrainingSession {
+public:
+	DRAGON_MODEL_TYPES(T)
+
+	using CostFunction = std::function<void(const Tensor2D& output, const Tensor2D& target, Tensor2D& cost)>;
+
+	BasicTrainingSession(Model& neuralNetwork, size_t maxBatchSize, const CostFunction& costFunction);
+
+	// Same as trainBatch with the optimizer, the samples and their targets are the rows of input and target.
+	// Returns the differentiated cost respect to the inputs as a watcher of the session's buffer, valid until the next step.
+	// Assigning it moves the watcher, copy construct a Tensor2D from it to keep the values.
+	// [example] Tensor2D cost; cost = session.train(input, target, optimizer); cost = session.train(input, target, optimizer);
+	Tensor2D train(const Tensor2D& input, const Tensor2D& target, Optimizer& optimizer);
+	// Same as above, with plain gradient descent.
+	Tensor2D train(const Tensor2D& input, const Tensor2D& target, double learningRate);
+
+	inline size_t getMaxBatchSize() const { return m_MaxBatchSize; }
+	// Number of values in the planned buffers, zero before the first step.
+	inline size_t getBufferSize() const { return m_Buffer.getCount(); }
+
+private:
+	// Plan the buffers for the input size.
+	void _plan(size_t inputCount);
+	// Watcher of the rows x cols values at the offset of the buffer.
+	Tensor2D _buffer(size_t offset, size_t rows, size_t cols);
+	// The data the i-th layer gets: the input of the batch or the output of the layer before it.
+	Tensor2D _previousOutput(size_t i, const Tensor2D& input);
+	// The input of the i-th layer, the converted copy of the previous output if the layouts differ.
+	Tensor2D _layerInput(size_t i, const Tensor2D& input);
+
+private:
+	// Offset of a buffer that is not needed.
+	static constexpr size_t NO_BUFFER = size_t(-1);
+
+	// Where the data of a layer is in the buffer, and the layouts of its input.
+	struct LayerBuffers {
+		size_t input = NO_BUFFER;	// The converted input, if the input layout differs from the output of the layer before.
+		size_t sum = 0;
+		size_t output = 0;
+		size_t inputCount = 0;
+		size_t sumCount = 0;
+		size_t outputCount = 0;
+		DataLayout inputLayout;
+		DataLayout previousLayout;
+	};
+
+	Model& m_Model;
+	size_t m_MaxBatchSize;
+	CostFunction m_CostFunction;
+
+	std::vector<LayerBuffers> m_Layers;
+	PackedParameters m_Parameters;
+	size_t m_InputCount = 0;
+	DataLayout m_OutputLayout;
+	size_t m_OutputCount = 0;			// Values of a planar output sample.
+	size_t m_Output = NO_BUFFER;		// The planar output, if the last layer is not planar.
+	size_t m_Costs[2] = { 0, 0 };		// The costs go back between these two.
+	size_t m_Gradients = 0;
+	Tensor1D m_Buffer;
+	SGD m_GradientDescent;
+};
+
+extern template class DRAGON_API BasicTrainingSession<float>;
+extern template class DRAGON_API BasicTrainingSession<double>;
+using TrainingSession = BasicTrainingSession<precision>;
+
+
+
+/// <summary>
+/// InferencePlan is the compiled form of a model for inference.
+/// Compiling checks that the input size of every layer matches the output of the layer before it, adds the layout
+/// conversions and places the intermediate data of the steps into one allocation. A step only reads the data of
+/// the step before it, so two buffers are enough: the steps write into them by turns (the first step reads
+/// the caller's input and the last one writes the caller's output). Running the plan does no heap allocation
+/// with the built in layers, the latency doesn't depend on the allocator.
+/// A plan is for one thread, more threads need their own plans.
+/// </summary>
+template<class T>
+class BasicInferencePlan {
+public:
+	DRAGON_MODEL_TYPES(T)
+
+	BasicInferencePlan() = default;
+
+	// Push the rows of the input through the layers into the rows of output (at most getMaxBatchSize rows).
+	void run(const Tensor2D& input, Tensor2D& output);
+	// One sample.
+	void run(const Tensor1D& input, Tensor1D& output);
+
+	// False if the layer shapes didn't match, an invalid plan can't run.
+	inline bool isValid() const { return m_Valid; }
+	inline size_t getInputCount() const { return m_InputCount; }
+	inline size_t getOutputCount() const { return m_OutputCount; }
+	inline size_t getMaxBatchSize() const { return m_MaxBatchSize; }
+	// Largest number of bytes of intermediate data alive at the same time (the input and output of a step).
+	inline size_t getPeakMemory() const { return m_PeakMemory; }
+	// Number of values in the planned buffers.
+	inline size_t getBufferSize() const { return m_Buffer.getCount(); }
+
+private:
+	friend class BasicModel<T>;
+
+	// Where a step reads from or writes to.
+	enum class Slot { Input, Output, First, Second };
+
+	// A layer, or a layout conversion if layer is nullptr. The layer runs in int8 if it has quantized weights.
+	struct Step {
+		const BaseLayer* layer = nullptr;
+		std::shared_ptr<const QuantizedWeights> quantized;
+		DataLayout from;
+		DataLayout to;
+		size_t inputCount = 0;
+		size_t outputCount = 0;
+		Slot source = Slot::Input;
+		Slot destination = Slot::Output;
+	};
+
+	// The data of the slot with rows samples of count values.
+	Tensor2D _slot(Slot slot, size_t rows, size_t count, const Tensor2D& input, Tensor2D& output);
+
+private:
+	std::vector<Step> m_Steps;
+	size_t m_InputCount = 0;
+	size_t m_OutputCount = 0;
+	size_t m_MaxBatchSize = 0;
+	size_t m_PeakMemory = 0;
+	size_t m_Second = 0;		// Offset of the second buffer.
+	bool m_Valid = false;
+	Tensor1D m_Buffer;
+};
+
+extern template class DRAGON_API BasicInferencePlan<float>;
+extern template class DRAGON_API BasicInferencePlan<double>;
+using InferencePlan = BasicInferencePlan<precision>;
+
 DRAGON_END
\ No newline at end of file
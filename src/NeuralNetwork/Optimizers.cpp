@@ -0,0 +1,124 @@
+#include "Optimizers.h"
+
+#include <cmath>
+
+DRAGON_BEGIN
+
+template<class T>
+BasicOptimizer<T>::BasicOptimizer(double learningRate) : m_LearningRate(learningRate) { }
+
+template<class T>
+void BasicOptimizer<T>::beginStep(size_t parameterCount) {
+	assert((_getStateCount() <= 2) && "An optimizer can have at most two state values per parameter!");
+	if (parameterCount != m_ParameterCount) {
+		m_ParameterCount = parameterCount;
+		m_State.assign(_getStateCount() * parameterCount, precision());
+		m_Step = 0;
+	}
+	m_Step++;
+}
+
+template<class T>
+void BasicOptimizer<T>::update(precision* parameters, const precision* gradients, size_t offset, size_t count, precision scale) {
+	assert((m_Step > 0 && offset + count <= m_ParameterCount) && "Call beginStep with the parameter count first!");
+
+	precision* state[2] = {};
+	for (size_t i = 0; i < _getStateCount(); i++)
+		state[i] = m_State.data() + i * m_ParameterCount + offset;
+	_update(parameters, gradients, state, count, scale);
+}
+
+
+template<class T>
+BasicSGD<T>::BasicSGD(double learningRate) : BasicOptimizer<T>(learningRate) { }
+
+template<class T>
+void BasicSGD<T>::_update(precision* parameters, const precision* gradients, precision* const*, size_t count, precision scale) const {
+	axpy(count, precision(-m_LearningRate * scale), gradients, parameters);
+}
+
+
+template<class T>
+BasicMomentum<T>::BasicMomentum(double learningRate, double momentum, bool nesterov) :
+	BasicOptimizer<T>(learningRate), m_Momentum(momentum), m_Nesterov(nesterov) { }
+
+template<class T>
+void BasicMomentum<T>::_update(precision* parameters, const precision* gradients, precision* const* state, size_t count, precision scale) const {
+	precision* velocity = state[0];
+	precision rate = precision(m_LearningRate);
+	precision momentum = precision(m_Momentum);
+
+	if (m_Nesterov) {
+		for (size_t i = 0; i < count; i++) {
+			precision gradient = gradients[i] * scale;
+			precision v = momentum * velocity[i] + gradient;
+			velocity[i] = v;
+			parameters[i] -= rate * (gradient + momentum * v);
+		}
+	}
+	else {
+		for (size_t i = 0; i < count; i++) {
+			precision v = momentum * velocity[i] + gradients[i] * scale;
+			velocity[i] = v;
+			parameters[i] -= rate * v;
+		}
+	}
+}
+
+
+template<class T>
+BasicAdam<T>::BasicAdam(double learningRate, double beta1, double beta2, double epsilon) :
+	BasicOptimizer<T>(learningRate), m_Beta1(beta1), m_Beta2(beta2), m_Epsilon(epsilon) { }
+
+template<class T>
+void BasicAdam<T>::_update(precision* parameters, const precision* gradients, precision* const* state, size_t count, precision scale) const {
+	precision* average = state[0];
+	precision* squareAverage = state[1];
+
+	// The bias corrections are folded into the step size and the scale of the square average.
+	double correction1 = 1.0 - std::pow(m_Beta1, double(m_Step));
+	double correction2 = 1.0 - std::pow(m_Beta2, double(m_Step));
+	precision stepSize = precision(m_LearningRate / correction1);
+	precision squareScale = precision(1.0 / correction2);
+	precision beta1 = precision(m_Beta1), beta2 = precision(m_Beta2);
+	precision epsilon = precision(m_Epsilon);
+
+	for (size_t i = 0; i < count; i++) {
+		precision gradient = gradients[i] * scale;
+		precision m = beta1 * average[i] + (1 - beta1) * gradient;
+		precision v = beta2 * squareAverage[i] + (1 - beta2) * gradient * gradient;
+		average[i] = m;
+		squareAverage[i] = v;
+		parameters[i] -= stepSize * m / (std::sqrt(v * squareScale) + epsilon);
+	}
+}
+
+
+template<class T>
+BasicRMSProp<T>::BasicRMSProp(double learningRate, double decay, double epsilon) :
+	BasicOptimizer<T>(learningRate), m_Decay(decay), m_Epsilon(epsilon) { }
+
+template<class T>
+void BasicRMSProp<T>::_update(precision* parameters, const precision* gradients, precision* const* state, size_t count, precision scale) const {
+	precision* squareAverage = state[0];
+	precision rate = precision(m_LearningRate);
+	precision decay = precision(m_Decay);
+	precision epsilon = precision(m_Epsilon);
+
+	for (size_t i = 0; i < count; i++) {
+		precision gradient = gradients[i] * scale;
+		precision v = decay * squareAverage[i] + (1 - decay) * gradient * gradient;
+		squareAverage[i] = v;
+		parameters[i] -= rate * gradient / (std::sqrt(v) + epsilon);
+	}
+}
+
+#define OPTIMIZER_TEMPLATES(T) \
+	template class DRAGON_API BasicOptimizer<T>; \
+	template class DRAGON_API BasicSGD<T>; \
+	template class DRAGON_API BasicMomentum<T>; \
+	template class DRAGON_API BasicAdam<T>; \
+	template class DRAGON_API BasicRMSProp<T>;
+DRAGON_INSTANTIATE(OPTIMIZER_TEMPLATES)
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,161 @@
+#pragma once
+#include <vector>
+
+#include "../Core.h"
+#include "../Math/MathCore.h"
+
+/*
+Optimizers apply the gradients calculated by the layers (gradientsBatch) to the parameters.
+Every update is one fused pass that reads the parameter, its gradient and the optimizer state
+and writes the parameter and the state back, so the step touches every value only once.
+*/
+
+DRAGON_BEGIN
+
+/// <summary>
+/// Optimizer is the base of the optimizers, it holds their state (one or more values per parameter).
+/// The parameters of a model are seen as one packed vector, in the order of the layers and their getParameters,
+/// that is the order of the gradients of gradientsBatch. Use one optimizer per model, the state belongs to its parameters.
+/// A step is beginStep and updates on parts of the packed vector, the updates of different parts can run on different threads.
+/// </summary>
+template<class T>
+class BasicOptimizer {
+public:
+	DRAGON_TENSOR_TYPES(T)
+
+	BasicOptimizer(double learningRate);
+	virtual ~BasicOptimizer() = default;
+
+	inline double getLearningRate() const { return m_LearningRate; }
+	inline void setLearningRate(double learningRate) { m_LearningRate = learningRate; }
+	// Number of steps made.
+	inline size_t getStep() const { return m_Step; }
+
+	// Start a step on parameterCount packed parameters, the state is reset if the parameter count changed.
+	void beginStep(size_t parameterCount);
+	// Update the count parameters starting at offset in the packed vector, with gradients * scale
+	// (scale is 1 / batch size for summed gradients).
+	void update(precision* parameters, const precision* gradients, size_t offset, size_t count, precision scale);
+
+protected:
+	// Number of state values per parameter.
+	virtual size_t _getStateCount() const = 0;
+	// The fused update of count parameters, state[i] points to the i-th state value of the first parameter.
+	virtual void _update(precision* parameters, const precision* gradients, precision* const* state, size_t count, precision scale) const = 0;
+
+protected:
+	double m_LearningRate;
+	size_t m_Step = 0;
+
+private:
+	// The state values are stored state by state, every one is as long as the packed parameters.
+	std::vector<precision> m_State;
+	size_t m_ParameterCount = 0;
+};
+
+extern template class DRAGON_API BasicOptimizer<float>;
+extern template class DRAGON_API BasicOptimizer<double>;
+using Optimizer = BasicOptimizer<precision>;
+
+
+/// <summary>
+/// Plain gradient descent: parameter -= learningRate * gradient.
+/// </summary>
+template<class T>
+class BasicSGD : public BasicOptimizer<T> {
+public:
+	DRAGON_TENSOR_TYPES(T)
+
+	BasicSGD(double learningRate);
+
+protected:
+	using BasicOptimizer<T>::m_LearningRate;
+	size_t _getStateCount() const override { return 0; }
+	void _update(precision* parameters, const precision* gradients, precision* const* state, size_t count, precision scale) const override;
+};
+
+extern template class DRAGON_API BasicSGD<float>;
+extern template class DRAGON_API BasicSGD<double>;
+using SGD = BasicSGD<precision>;
+
+
+/// <summary>
+/// Gradient descent with momentum: velocity = momentum * velocity + gradient, parameter -= learningRate * velocity.
+/// With nesterov the parameter steps with gradient + momentum * velocity (the look ahead velocity).
+/// </summary>
+template<class T>
+class BasicMomentum : public BasicOptimizer<T> {
+public:
+	DRAGON_TENSOR_TYPES(T)
+
+	BasicMomentum(double learningRate, double momentum = 0.9, bool nesterov = false);
+
+protected:
+	using BasicOptimizer<T>::m_LearningRate;
+	size_t _getStateCount() const override { return 1; }
+	void _update(precision* parameters, const precision* gradients, precision* const* state, size_t count, precision scale) const override;
+
+private:
+	double m_Momentum;
+	bool m_Nesterov;
+};
+
+extern template class DRAGON_API BasicMomentum<float>;
+extern template class DRAGON_API BasicMomentum<double>;
+using Momentum = BasicMomentum<precision>;
+
+
+/// <summary>
+/// Adam: running averages of the gradient (beta1) and its square (beta2) with bias correction,
+/// parameter -= learningRate * average / (sqrt(square average) + epsilon).
+/// </summary>
+template<class T>
+class BasicAdam : public BasicOptimizer<T> {
+public:
+	DRAGON_TENSOR_TYPES(T)
+
+	BasicAdam(double learningRate = 0.001, double beta1 = 0.9, double beta2 = 0.999, double epsilon = 1e-8);
+
+protected:
+	using BasicOptimizer<T>::m_LearningRate;
+	using BasicOptimizer<T>::m_Step;
+	size_t _getStateCount() const override { return 2; }
+	void _update(precision* parameters, const precision* gradients, precision* const* state, size_t count, precision scale) const override;
+
+private:
+	double m_Beta1;
+	double m_Beta2;
+	double m_Epsilon;
+};
+
+extern template class DRAGON_API BasicAdam<float>;
+extern template class DRAGON_API BasicAdam<double>;
+using Adam = BasicAdam<precision>;
+
+
+/// <summary>
+/// RMSProp: running average of the squared gradient (decay),
+/// parameter -= learningRate * gradient / (sqrt(square average) + epsilon).
+/// </summary>
+template<class T>
+class BasicRMSProp : public BasicOptimizer<T> {
+public:
+	DRAGON_TENSOR_TYPES(T)
+
+	BasicRMSProp(double learningRate = 0.001, double decay = 0.9, double epsilon = 1e-8);
+
+protected:
+	using BasicOptimizer<T>::m_LearningRate;
+	size_t _getStateCount() const override { return 1; }
+	void _update(precision* parameters, const precision* gradients, precision* const* state, size_t count, precision scale) const override;
+
+private:
+	double m_Decay;
+	double m_Epsilon;
+};
+
+extern template class DRAGON_API BasicRMSProp<float>;
+extern template class DRAGON_API BasicRMSProp<double>;
+using RMSProp = BasicRMSProp<precision>;
+
+DRAGON_END
\ No newline at end of file
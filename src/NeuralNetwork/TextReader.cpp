@@ -0,0 +1,61 @@
+#include "TextReader.h"
+
+#include <charconv>
+
+DRAGON_BEGIN
+
+namespace {
+
+	inline bool isSpace(char character) {
+		return character == ' ' || character == '\n' || character == '\r' || character == '\t';
+	}
+
+}
+
+template<class T>
+bool TextReader::_read(T& value) {
+	if (!m_Valid)
+		return false;
+
+	size_t begin = 0;
+	while (begin < m_Text.size() && isSpace(m_Text[begin]))
+		begin++;
+
+	const char* end = m_Text.data() + m_Text.size();
+	std::from_chars_result result = std::from_chars(m_Text.data() + begin, end, value);
+	if (result.ec != std::errc()) {
+		m_Valid = false;
+		return false;
+	}
+
+	m_Text.remove_prefix(result.ptr - m_Text.data());
+	return true;
+}
+
+template<class T>
+bool TextReader::_read(T* data, size_t count) {
+	for (size_t i = 0; i < count && _read(data[i]); i++);
+	return m_Valid;
+}
+
+bool TextReader::read(size_t& value) {
+	return _read(value);
+}
+
+bool TextReader::read(float& value) {
+	return _read(value);
+}
+
+bool TextReader::read(double& value) {
+	return _read(value);
+}
+
+bool TextReader::read(float* data, size_t count) {
+	return _read(data, count);
+}
+
+bool TextReader::read(double* data, size_t count) {
+	return _read(data, count);
+}
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+#include <string_view>
+
+#include "../Core.h"
+#include "../Math/Tensor.h"
+
+/*
+Reading the numbers of the text model files in place.
+The reader only moves a position in the text, so nothing is copied and no stream is created,
+the values are converted with std::from_chars.
+*/
+
+DRAGON_BEGIN
+
+/// <summary>
+/// TextReader reads whitespace separated numbers from the front of a text, the text has to outlive the reader.
+/// Like a stream, if a value can't be read the reader fails, and after that every read fails.
+/// [example]
+/// TextReader reader("2 3 0.5 -1.25");
+/// size_t rows, cols;
+/// reader.read(rows); reader.read(cols);
+/// </summary>
+class DRAGON_API TextReader {
+public:
+	TextReader(std::string_view text) : m_Text(text) { }
+
+	bool read(size_t& value);
+	bool read(float& value);
+	bool read(double& value);
+	// Read count values into data.
+	bool read(float* data, size_t count);
+	bool read(double* data, size_t count);
+
+	inline bool isValid() const { return m_Valid; }
+	// The part of the text that is not read yet.
+	inline std::string_view getRest() const { return m_Text; }
+
+private:
+	template<class T>
+	bool _read(T& value);
+	template<class T>
+	bool _read(T* data, size_t count);
+
+private:
+	std::string_view m_Text;
+	bool m_Valid = true;
+};
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#elif defined(__linux__)
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+DRAGON_BEGIN
+
+ThreadPool::ThreadPool(size_t threadCount, bool pinThreads) {
+	if (threadCount == 0)
+		threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+	m_Workers.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; i++) {
+		m_Workers.emplace_back(&ThreadPool::_work, this, i);
+		if (pinThreads)
+			_pin(i);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Start.notify_all();
+	for (size_t i = 0; i < m_Workers.size(); i++)
+		m_Workers[i].join();
+}
+
+void ThreadPool::parallelFor(size_t taskCount, const std::function<void(size_t index, size_t thread)>& task) {
+	if (taskCount == 0)
+		return;
+
+	std::lock_guard<std::mutex> run(m_RunMutex);
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Task = &task;
+	m_TaskCount = taskCount;
+	m_NextTask = 0;
+	m_ActiveWorkers = m_Workers.size();
+	m_Generation++;
+	m_Start.notify_all();
+
+	m_Done.wait(lock, [this]() { return m_ActiveWorkers == 0; });
+	m_Task = nullptr;
+}
+
+void ThreadPool::_work(size_t thread) {
+	size_t generation = 0;
+	while (true) {
+		const std::function<void(size_t, size_t)>* task = nullptr;
+		size_t taskCount = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Start.wait(lock, [&]() { return m_Stop || m_Generation != generation; });
+			if (m_Stop)
+				return;
+			generation = m_Generation;
+			task = m_Task;
+			taskCount = m_TaskCount;
+		}
+
+		for (size_t index = m_NextTask++; index < taskCount; index = m_NextTask++)
+			(*task)(index, thread);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (--m_ActiveWorkers == 0)
+			m_Done.notify_one();
+	}
+}
+
+void ThreadPool::_pin(size_t thread) {
+	size_t core = thread % std::max<size_t>(1, std::thread::hardware_concurrency());
+#ifdef _WIN32
+	SetThreadAffinityMask(m_Workers[thread].native_handle(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core, &set);
+	pthread_setaffinity_np(m_Workers[thread].native_handle(), sizeof(cpu_set_t), &set);
+#else
+	(void)core;
+#endif
+}
+
+DRAGON_END
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "../Core.h"
+
+/*
+Fixed size pool of worker threads for the parallel model functions.
+The workers live as long as the pool, so the per thread scratch buffers of the kernels
+(thread_local) are allocated once per worker and reused by every call.
+*/
+
+DRAGON_BEGIN
+
+/// <summary>
+/// ThreadPool runs the tasks of parallelFor on its worker threads, the calling thread waits for them.
+/// With pinThreads the i-th worker is bound to the i-th core (Windows and Linux, ignored elsewhere).
+/// One parallelFor runs at a time, the pool can be shared by calls from different threads.
+/// [example]
+/// ThreadPool pool(4, true);
+/// Tensor2D outputs = feedForwardMany(model, inputs, pool);
+/// </summary>
+class DRAGON_API ThreadPool {
+public:
+	// Zero threadCount means one worker per hardware thread.
+	ThreadPool(size_t threadCount = 0, bool pinThreads = false);
+	~ThreadPool();
+	ThreadPool(const ThreadPool& other) = delete;
+	ThreadPool& operator=(const ThreadPool& other) = delete;
+
+	inline size_t getThreadCount() const { return m_Workers.size(); }
+
+	// Call task(index, thread) for every index < taskCount, thread is the index of the worker running it.
+	// The tasks are handed out one by one, the function returns when all of them are done.
+	void parallelFor(size_t taskCount, const std::function<void(size_t index, size_t thread)>& task);
+
+private:
+	void _work(size_t thread);
+	void _pin(size_t thread);
+
+private:
+	std::vector<std::thread> m_Workers;
+
+	// The running parallelFor, m_Generation changes with every new one.
+	std::mutex m_RunMutex;
+	std::mutex m_Mutex;
+	std::condition_variable m_Start;
+	std::condition_variable m_Done;
+	const std::function<void(size_t index, size_t thread)>* m_Task = nullptr;
+	size_t m_TaskCount = 0;
+	std::atomic<size_t> m_NextTask{ 0 };
+	size_t m_ActiveWorkers = 0;
+	size_t m_Generation = 0;
+	bool m_Stop = false;
+};
+
+DRAGON_END
\ No newline at end of file